@@ -0,0 +1,211 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.cpp
+
+  ==============================================================================
+*/
+
+#include "ChannelWorkerPool.h"
+#include "RealtimeSafety.h"
+#include <thread>
+
+#if JUCE_MAC || JUCE_IOS
+ #include <dispatch/dispatch.h>
+#elif JUCE_WINDOWS
+ #ifndef NOMINMAX
+  #define NOMINMAX
+ #endif
+ #include <windows.h>
+#else
+ #include <semaphore.h>
+ #include <cerrno>
+#endif
+
+//==============================================================================
+// 计数信号量。juce::WaitableEvent::signal() 要先拿互斥锁，这里直接用系统的信号量，
+// post() 只是一次原子操作（必要时一次唤醒用的系统调用），音频线程上调用不会阻塞
+class ChannelWorkerPool::Semaphore
+{
+public:
+   #if JUCE_MAC || JUCE_IOS
+    Semaphore()                    : semaphore (dispatch_semaphore_create (0)) {}
+    ~Semaphore()                   { dispatch_release (semaphore); }
+    void post() noexcept           { dispatch_semaphore_signal (semaphore); }
+    void wait() noexcept           { dispatch_semaphore_wait (semaphore, DISPATCH_TIME_FOREVER); }
+
+   private:
+    dispatch_semaphore_t semaphore;
+   #elif JUCE_WINDOWS
+    Semaphore()                    : semaphore (CreateSemaphoreW (nullptr, 0, maxWorkers + 1, nullptr)) {}
+    ~Semaphore()                   { CloseHandle (semaphore); }
+    void post() noexcept           { ReleaseSemaphore (semaphore, 1, nullptr); }
+    void wait() noexcept           { WaitForSingleObject (semaphore, INFINITE); }
+
+   private:
+    HANDLE semaphore;
+   #else
+    Semaphore()                    { sem_init (&semaphore, 0, 0); }
+    ~Semaphore()                   { sem_destroy (&semaphore); }
+    void post() noexcept           { sem_post (&semaphore); }
+
+    void wait() noexcept
+    {
+        while (sem_wait (&semaphore) != 0 && errno == EINTR)
+        {
+        }
+    }
+
+   private:
+    sem_t semaphore;
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (Semaphore)
+};
+
+//==============================================================================
+class ChannelWorkerPool::Worker  : private juce::Thread
+{
+public:
+    Worker (ChannelWorkerPool& ownerPool, int workerLane)
+        : juce::Thread ("ExchangeBand channels"), pool (ownerPool), lane (workerLane)
+    {
+        // 工作线程替音频线程处理通道，优先级也要与音频线程相当
+        startRealtimeThread (juce::Thread::RealtimeOptions{});
+    }
+
+    ~Worker() override
+    {
+        stopThread (1000);
+    }
+
+    // 先让所有线程都收到退出请求，再统一唤醒，避免逐个等待
+    using juce::Thread::signalThreadShouldExit;
+
+private:
+    void run() override
+    {
+        // 与调用 run() 的音频线程一样关闭非规格化数（FTZ / DAZ）；这个线程只处理通道，整个生命周期都保持
+        const juce::ScopedNoDenormals noDenormals;
+
+        while (! threadShouldExit())
+        {
+            pool.numSleeping.fetch_add (1, std::memory_order_release);
+            pool.wakeUp->wait();
+
+            if (threadShouldExit())
+                break;
+
+            // 替音频线程处理通道的这段时间同样不能分配内存或加锁
+            EXCHANGEBAND_REALTIME_SECTION();
+            pool.help (lane);
+        }
+    }
+
+    ChannelWorkerPool& pool;
+    const int lane;
+
+    JUCE_DECLARE_NON_COPYABLE (Worker)
+};
+
+//==============================================================================
+ChannelWorkerPool::ChannelWorkerPool()
+    : wakeUp (std::make_unique<Semaphore>())
+{
+}
+
+ChannelWorkerPool::~ChannelWorkerPool()
+{
+    setNumWorkers (0);
+}
+
+void ChannelWorkerPool::setNumWorkers (int numWorkers)
+{
+    numWorkers = juce::jlimit (0, maxWorkers, numWorkers);
+
+    if (numWorkers == getNumWorkers())
+        return;
+
+    for (auto& worker : workers)
+        worker->signalThreadShouldExit();
+
+    // 每个线程最多还在等一次 wait()，各 post 一次就都能醒来退出
+    for (size_t i = 0; i < workers.size(); ++i)
+        wakeUp->post();
+
+    workers.clear();
+
+    // 退出时可能有没被消耗的计数，换一个新的信号量重新开始
+    wakeUp = std::make_unique<Semaphore>();
+    numSleeping.store (0, std::memory_order_relaxed);
+
+    for (int lane = 1; lane <= numWorkers; ++lane)
+        workers.push_back (std::make_unique<Worker> (*this, lane));
+}
+
+//==============================================================================
+void ChannelWorkerPool::run (ChannelFunction function, void* context, int numChannels) noexcept
+{
+    jassert (numChannels <= maxChannelsPerJob);
+
+    if (workers.empty() || numChannels <= 1)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            function (context, channel, 0);
+
+        return;
+    }
+
+    // 先写好这一轮的任务，再以 release 发布新的轮次
+    jobFunction.store (function, std::memory_order_relaxed);
+    jobContext.store (context, std::memory_order_relaxed);
+    numFinished.store (0, std::memory_order_relaxed);
+
+    const auto round = (state.load (std::memory_order_relaxed) >> 32) + 1;
+    state.store ((round << 32) | ((juce::uint64) numChannels << 16), std::memory_order_release);
+
+    // 只唤醒正在睡眠的线程，信号量的计数不会超过工作线程数
+    for (int toWake = juce::jmin (numChannels - 1, getNumWorkers()); toWake > 0; --toWake)
+    {
+        auto sleeping = numSleeping.load (std::memory_order_acquire);
+
+        while (sleeping > 0 && ! numSleeping.compare_exchange_weak (sleeping, sleeping - 1, std::memory_order_acq_rel))
+        {
+        }
+
+        if (sleeping <= 0)
+            break;
+
+        wakeUp->post();
+    }
+
+    help (0);
+
+    // 余下的只有工作线程已经领走、正在处理的通道
+    while (numFinished.load (std::memory_order_acquire) < numChannels)
+        std::this_thread::yield();
+}
+
+void ChannelWorkerPool::help (int lane) noexcept
+{
+    for (;;)
+    {
+        auto current = state.load (std::memory_order_acquire);
+        const auto numChannels = (int) ((current >> 16) & 0xffff);
+        const auto channel = (int) (current & 0xffff);
+
+        if (channel >= numChannels)
+            return;
+
+        // 读到的任务只有在 compare-exchange 成功（轮次没变、通道还没领完）时才会被使用，
+        // 而轮次没结束之前 run() 不会改写任务
+        const auto function = jobFunction.load (std::memory_order_relaxed);
+        auto* context = jobContext.load (std::memory_order_relaxed);
+
+        if (! state.compare_exchange_weak (current, current + 1, std::memory_order_acq_rel, std::memory_order_acquire))
+            continue;
+
+        function (context, channel, lane);
+        numFinished.fetch_add (1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    ChannelWorkerPool.h
+    多声道时把同一个 hop 的各个通道分给几个工作线程并行处理。
+    调用线程（音频线程）自己也领取通道，所以工作线程来不及醒来时不会有通道干等；
+    run() 返回前只会等待已经被工作线程领走、正在处理的通道。
+
+    音频线程这一侧不加锁、不分配内存：派发只是几次原子操作，
+    唤醒工作线程用操作系统的信号量（post 不会阻塞）。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+class ChannelWorkerPool
+{
+public:
+    // lane 为执行线程的编号：0 是调用 run() 的线程，1 ~ getNumWorkers() 是工作线程。
+    // 同一个 lane 上的调用不会并发，可以用它选择各自的工作区
+    using ChannelFunction = void (*) (void* context, int channel, int lane) noexcept;
+
+    static constexpr int maxWorkers = 15;
+    static constexpr int maxChannelsPerJob = 0xffff;
+
+    ChannelWorkerPool();
+    ~ChannelWorkerPool();
+
+    // 停掉原来的工作线程并启动 numWorkers 个新的（0 = 所有通道都在调用线程上处理）。
+    // 只在音频回调停止时调用（prepare() 里）
+    void setNumWorkers (int numWorkers);
+    int getNumWorkers() const noexcept                { return (int) workers.size(); }
+    int getNumLanes() const noexcept                  { return getNumWorkers() + 1; }
+
+    // 对 0 ~ numChannels - 1 的每个通道调用一次 function，全部完成后返回。
+    // 只能由一个线程调用
+    void run (ChannelFunction function, void* context, int numChannels) noexcept;
+
+private:
+    //==============================================================================
+    class Semaphore;
+    class Worker;
+
+    // 领取一个通道并处理，直到这一轮的通道都被领完
+    void help (int lane) noexcept;
+
+    // 高 32 位为轮次，中间 16 位为这一轮的通道数，低 16 位为下一个待领取的通道。
+    // 领取用 compare-exchange，轮次不对或已经领完就不会误领下一轮的通道
+    std::atomic<juce::uint64> state { 0 };
+    std::atomic<ChannelFunction> jobFunction { nullptr };
+    std::atomic<void*> jobContext { nullptr };
+    std::atomic<int> numFinished { 0 };
+    std::atomic<int> numSleeping { 0 };
+
+    std::unique_ptr<Semaphore> wakeUp;
+    std::vector<std::unique_ptr<Worker>> workers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ChannelWorkerPool)
+};
@@ -0,0 +1,897 @@
+/*
+  ==============================================================================
+
+    CrossoverEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "CrossoverEngine.h"
+#include <algorithm>
+#include <cmath>
+
+namespace
+{
+    // Hilbert 变换用的两路全通（Olli Niemitalo 的 4 级设计）：每级 H(z) = (a² - z^-2) / (1 - a² z^-2)。
+    // 第一路再延迟一个样本之后，两路输出在 20 Hz ~ 0.49 fs 内相差 90°（误差约 0.7°）
+    constexpr int numHilbertStages = 4;
+    constexpr double hilbertInPhase[numHilbertStages]   { 0.6923878, 0.9360654322959, 0.9882295226860, 0.9987488452737 };
+    constexpr double hilbertQuadrature[numHilbertStages] { 0.4021921162426, 0.8561710882420, 0.9722909545651, 0.9952884791278 };
+}
+
+//==============================================================================
+// 一种精度下的分频网络。系数对象在构造时一次分配好，所有通道组的滤波器都指向它们，
+// 参数变化时原地改写系数；每个通道组是 SIMDRegister::size() 个通道，各 lane 独立滤波。
+// 第 k 个分频点的低通 / 高通是下标 [k * stagesPerEdge, (k + 1) * stagesPerEdge) 的滤波器
+// （每节 Butterworth 连续两个），相位补偿的全通是 [k * numSections, (k + 1) * numSections)
+template <typename SampleType>
+class CrossoverEngine::Network
+{
+public:
+    using Vector = juce::dsp::SIMDRegister<SampleType>;
+    using Filter = juce::dsp::IIR::Filter<Vector>;
+    using Coefficients = juce::dsp::IIR::Coefficients<SampleType>;
+    using ArrayCoefficients = juce::dsp::IIR::ArrayCoefficients<SampleType>;
+
+    static constexpr int lanes = (int) Vector::size();
+    static constexpr int stagesPerEdge = 2 * numSections;
+
+    Network (double newSampleRate, int maximumBlockSize, int channels)
+        : sampleRate (newSampleRate),
+          blockSize (juce::jmax (1, maximumBlockSize)),
+          numChannels (channels),
+          numGroups ((channels + lanes - 1) / lanes)
+    {
+        // 先用单位系数占位，分频点第一次出现时再按频率计算
+        for (auto& edge : edgeCoefficients)
+        {
+            for (size_t section = 0; section < (size_t) numSections; ++section)
+            {
+                edge.lowPass[section]  = new Coefficients (1, 0, 0, 1, 0, 0);
+                edge.highPass[section] = new Coefficients (1, 0, 0, 1, 0, 0);
+                edge.allPass[section]  = new Coefficients (1, 0, 0, 1, 0, 0);
+            }
+        }
+
+        for (int stage = 0; stage < numHilbertStages; ++stage)
+        {
+            const auto inPhase = (SampleType) (hilbertInPhase[stage] * hilbertInPhase[stage]);
+            const auto quadrature = (SampleType) (hilbertQuadrature[stage] * hilbertQuadrature[stage]);
+            hilbertCoefficients[(size_t) stage] = new Coefficients (inPhase, 0, -1, 1, 0, -inPhase);
+            hilbertCoefficients[(size_t) (numHilbertStages + stage)] = new Coefficients (quadrature, 0, -1, 1, 0, -quadrature);
+        }
+
+        const auto makeFilters = [] (std::vector<Filter>& filters, size_t count)
+        {
+            filters = std::vector<Filter> (count);
+        };
+
+        groups.resize ((size_t) numGroups);
+
+        for (auto& group : groups)
+        {
+            makeFilters (group.mainLowPass, stagesPerEdge * maxEdges);
+            makeFilters (group.mainHighPass, stagesPerEdge * maxEdges);
+            makeFilters (group.sidechainLowPass, stagesPerEdge * maxEdges);
+            makeFilters (group.sidechainHighPass, stagesPerEdge * maxEdges);
+            makeFilters (group.allPass, numSections * maxEdges);
+            makeFilters (group.hilbert, 2 * numHilbertStages * ExchangeBandParameters::maxBands);
+
+            for (size_t k = 0; k < (size_t) maxEdges; ++k)
+            {
+                const auto& edge = edgeCoefficients[k];
+
+                for (size_t stage = 0; stage < (size_t) stagesPerEdge; ++stage)
+                {
+                    const auto index = k * stagesPerEdge + stage;
+                    group.mainLowPass[index].coefficients       = edge.lowPass[stage / 2];
+                    group.sidechainLowPass[index].coefficients  = edge.lowPass[stage / 2];
+                    group.mainHighPass[index].coefficients      = edge.highPass[stage / 2];
+                    group.sidechainHighPass[index].coefficients = edge.highPass[stage / 2];
+                }
+
+                for (size_t section = 0; section < (size_t) numSections; ++section)
+                    group.allPass[k * numSections + section].coefficients = edge.allPass[section];
+            }
+
+            for (size_t i = 0; i < group.hilbert.size(); ++i)
+                group.hilbert[i].coefficients = hilbertCoefficients[i % (2 * numHilbertStages)];
+        }
+
+        mainLanes.resize ((size_t) blockSize);
+        sidechainLanes.resize ((size_t) blockSize);
+        linkedSidechain.resize ((size_t) blockSize);
+        oscillatorCos.resize ((size_t) (blockSize * ExchangeBandParameters::maxBands));
+        oscillatorSin.resize ((size_t) (blockSize * ExchangeBandParameters::maxBands));
+        dryBuffer.setSize (numChannels, blockSize);
+
+        // Filter::reset() 按系数的阶数分配状态，这里做过之后音频线程上的 reset() 只清零
+        reset();
+    }
+
+    void reset() noexcept
+    {
+        for (auto& group : groups)
+        {
+            for (auto* filters : { &group.mainLowPass, &group.mainHighPass, &group.sidechainLowPass,
+                                   &group.sidechainHighPass, &group.allPass, &group.hilbert })
+                for (auto& filter : *filters)
+                    filter.reset();
+
+            std::fill (group.hilbertDelay.begin(), group.hilbertDelay.end(), Vector::expand (0));
+        }
+
+        for (auto& exchange : exchanges)
+        {
+            exchange.cosine = 1.0;
+            exchange.sine = 0.0;
+        }
+
+        mainGain = mainGainTarget;
+        sidechainGain = sidechainGainTarget;
+
+        for (auto& exchange : exchanges)
+        {
+            exchange.mainGain = exchange.mainGainTarget;
+            exchange.sidechainGain = exchange.sidechainGainTarget;
+            exchange.overlapMainGain = exchange.overlapMainGainTarget;
+            exchange.overlapSidechainGain = exchange.overlapSidechainGainTarget;
+        }
+    }
+
+    // 只重新计算频率变了的分频点；jump 时增益直接跳到目标，否则在下一个 block 里线性过渡
+    void setLayout (const Layout& layout, bool jump) noexcept
+    {
+        for (int k = 0; k < layout.numEdges; ++k)
+        {
+            if (edgeFrequencies[(size_t) k] == layout.edges[(size_t) k])
+                continue;
+
+            const auto frequency = (SampleType) layout.edges[(size_t) k];
+            auto& edge = edgeCoefficients[(size_t) k];
+
+            for (size_t section = 0; section < (size_t) numSections; ++section)
+            {
+                const auto q = (SampleType) butterworthQ[section];
+                *edge.lowPass[section]  = ArrayCoefficients::makeLowPass (sampleRate, frequency, q);
+                *edge.highPass[section] = ArrayCoefficients::makeHighPass (sampleRate, frequency, q);
+                *edge.allPass[section]  = ArrayCoefficients::makeAllPass (sampleRate, frequency, q);
+            }
+
+            edgeFrequencies[(size_t) k] = layout.edges[(size_t) k];
+        }
+
+        numEdges = layout.numEdges;
+
+        for (size_t r = 0; r < (size_t) maxRegions; ++r)
+        {
+            mainGainTarget[r] = (SampleType) layout.mainGain[r];
+            sidechainGainTarget[r] = (SampleType) layout.sidechainGain[r];
+        }
+
+        if (jump)
+        {
+            mainGain = mainGainTarget;
+            sidechainGain = sidechainGainTarget;
+        }
+
+        // 新出现的交换（或来源 / 目标区段变了的）从 0 淡入，移频的振荡器保持相位连续
+        for (int j = 0; j < layout.numExchanges; ++j)
+        {
+            const auto& source = layout.exchanges[(size_t) j];
+            auto& exchange = exchanges[(size_t) j];
+            const bool sameRegions = j < numExchanges
+                                      && exchange.firstSourceRegion == source.firstSourceRegion
+                                      && exchange.numSourceRegions == source.numSourceRegions
+                                      && exchange.firstOverlapRegion == source.firstOverlapRegion
+                                      && exchange.numOverlapRegions == source.numOverlapRegions
+                                      && exchange.destinationRegion == source.destinationRegion;
+
+            exchange.firstSourceRegion = source.firstSourceRegion;
+            exchange.numSourceRegions = source.numSourceRegions;
+            exchange.firstOverlapRegion = source.firstOverlapRegion;
+            exchange.numOverlapRegions = source.numOverlapRegions;
+            exchange.destinationRegion = source.destinationRegion;
+            exchange.mainGainTarget = (SampleType) source.mainGain;
+            exchange.sidechainGainTarget = (SampleType) source.sidechainGain;
+            exchange.overlapMainGainTarget = (SampleType) source.overlapMainGain;
+            exchange.overlapSidechainGainTarget = (SampleType) source.overlapSidechainGain;
+            exchange.shifted = source.shift != 0.0;
+
+            const auto phaseIncrement = juce::MathConstants<double>::twoPi * source.shift / sampleRate;
+            exchange.rotationCosine = std::cos (phaseIncrement);
+            exchange.rotationSine = std::sin (phaseIncrement);
+
+            if (jump)
+            {
+                exchange.mainGain = exchange.mainGainTarget;
+                exchange.sidechainGain = exchange.sidechainGainTarget;
+                exchange.overlapMainGain = exchange.overlapMainGainTarget;
+                exchange.overlapSidechainGain = exchange.overlapSidechainGainTarget;
+            }
+            else if (! sameRegions)
+            {
+                exchange.mainGain = 0;
+                exchange.sidechainGain = 0;
+                exchange.overlapMainGain = 0;
+                exchange.overlapSidechainGain = 0;
+            }
+        }
+
+        numExchanges = layout.numExchanges;
+    }
+
+    // 主链原地替换成分频处理后的输出。wetGain < 1 或 gainStep != 0 时与未处理的主链交叉淡化，
+    // wetGain 每个样本移动 gainStep，限制在 0 ~ 1
+    void process (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer,
+                  bool linkSidechain, float& wetGain, float gainStep) noexcept
+    {
+        const int numSamples = mainBuffer.getNumSamples();
+
+        for (int start = 0; start < numSamples; start += blockSize)
+        {
+            const int numThisTime = juce::jmin (blockSize, numSamples - start);
+            const bool mixWithDry = wetGain < 1.0f || gainStep != 0.0f;
+
+            if (mixWithDry)
+                for (int channel = 0; channel < mainBuffer.getNumChannels(); ++channel)
+                    dryBuffer.copyFrom (channel, 0, mainBuffer, channel, start, numThisTime);
+
+            processChunk (mainBuffer, sidechainBuffer, start, numThisTime, linkSidechain);
+
+            if (mixWithDry)
+                mixDry (mainBuffer, start, numThisTime, wetGain, gainStep);
+        }
+    }
+
+private:
+    //==============================================================================
+    struct EdgeCoefficients
+    {
+        std::array<typename Coefficients::Ptr, numSections> lowPass, highPass, allPass;
+    };
+
+    struct ExchangeState
+    {
+        int firstSourceRegion = 0, numSourceRegions = 0;
+        int firstOverlapRegion = 0, numOverlapRegions = 0;
+        int destinationRegion = 0;
+        SampleType mainGain = 0, sidechainGain = 0;
+        SampleType mainGainTarget = 0, sidechainGainTarget = 0;
+        SampleType overlapMainGain = 0, overlapSidechainGain = 0;
+        SampleType overlapMainGainTarget = 0, overlapSidechainGainTarget = 0;
+        bool shifted = false;
+
+        // 移频振荡器：每个样本按 (rotationCosine, rotationSine) 旋转一次，每个 block 归一化一次
+        double cosine = 1.0, sine = 0.0;
+        double rotationCosine = 1.0, rotationSine = 0.0;
+    };
+
+    // 一组 lanes 个通道的全部滤波器状态。hilbert 每个交换 2 * numHilbertStages 个（前一半是带一个样本延迟的那一路）
+    struct Group
+    {
+        std::vector<Filter> mainLowPass, mainHighPass, sidechainLowPass, sidechainHighPass;
+        std::vector<Filter> allPass;
+        std::vector<Filter> hilbert;
+        std::array<Vector, ExchangeBandParameters::maxBands> hilbertDelay;
+    };
+
+    void processChunk (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer,
+                       int start, int numSamples, bool linkSidechain) noexcept
+    {
+        const int numSidechainInputs = sidechainBuffer.getNumChannels();
+        const bool broadcastSidechain = numSidechainInputs > 0 && (linkSidechain || numSidechainInputs == 1);
+
+        // 联动或单声道侧链：各通道平均后广播到所有 lane
+        if (broadcastSidechain)
+        {
+            auto* linked = linkedSidechain.data();
+            juce::FloatVectorOperations::copy (linked, sidechainBuffer.getReadPointer (0, start), numSamples);
+
+            for (int channel = 1; channel < numSidechainInputs; ++channel)
+                juce::FloatVectorOperations::add (linked, sidechainBuffer.getReadPointer (channel, start), numSamples);
+
+            if (numSidechainInputs > 1)
+                juce::FloatVectorOperations::multiply (linked, (SampleType) 1 / (SampleType) numSidechainInputs, numSamples);
+
+            for (int i = 0; i < numSamples; ++i)
+                sidechainLanes[(size_t) i] = Vector::expand (linked[i]);
+        }
+
+        // 所有通道组共用同一条振荡器相位和增益曲线，先按样本算好
+        for (int j = 0; j < numExchanges; ++j)
+        {
+            auto& exchange = exchanges[(size_t) j];
+
+            if (! exchange.shifted)
+                continue;
+
+            auto* cosines = oscillatorCos.data() + j * blockSize;
+            auto* sines = oscillatorSin.data() + j * blockSize;
+            auto c = exchange.cosine, s = exchange.sine;
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                cosines[i] = (SampleType) c;
+                sines[i] = (SampleType) s;
+                const auto nextCosine = c * exchange.rotationCosine - s * exchange.rotationSine;
+                s = s * exchange.rotationCosine + c * exchange.rotationSine;
+                c = nextCosine;
+            }
+
+            const auto normalise = 1.0 / std::sqrt (c * c + s * s);
+            exchange.cosine = c * normalise;
+            exchange.sine = s * normalise;
+        }
+
+        const int numRegions = numEdges + 1;
+        const auto rampScale = (SampleType) 1 / (SampleType) numSamples;
+        std::array<SampleType, maxRegions> mainStep, sidechainStep;
+        std::array<SampleType, ExchangeBandParameters::maxBands> exchangeMainStep, exchangeSidechainStep;
+        std::array<SampleType, ExchangeBandParameters::maxBands> overlapMainStep, overlapSidechainStep;
+
+        for (size_t r = 0; r < (size_t) numRegions; ++r)
+        {
+            mainStep[r] = (mainGainTarget[r] - mainGain[r]) * rampScale;
+            sidechainStep[r] = (sidechainGainTarget[r] - sidechainGain[r]) * rampScale;
+        }
+
+        for (size_t j = 0; j < (size_t) numExchanges; ++j)
+        {
+            exchangeMainStep[j] = (exchanges[j].mainGainTarget - exchanges[j].mainGain) * rampScale;
+            exchangeSidechainStep[j] = (exchanges[j].sidechainGainTarget - exchanges[j].sidechainGain) * rampScale;
+            overlapMainStep[j] = (exchanges[j].overlapMainGainTarget - exchanges[j].overlapMainGain) * rampScale;
+            overlapSidechainStep[j] = (exchanges[j].overlapSidechainGainTarget - exchanges[j].overlapSidechainGain) * rampScale;
+        }
+
+        std::array<Vector, maxRegions> mainRegions, sidechainRegions, shiftedRegions;
+        std::array<bool, maxRegions> hasShifted {};
+
+        for (int j = 0; j < numExchanges; ++j)
+            hasShifted[(size_t) exchanges[(size_t) j].destinationRegion] = true;
+
+        for (int group = 0; group < numGroups; ++group)
+        {
+            auto& state = groups[(size_t) group];
+            const int firstChannel = group * lanes;
+            const int numLanes = juce::jmin (lanes, mainBuffer.getNumChannels() - firstChannel);
+
+            if (numLanes <= 0)
+                break;
+
+            // 交错：每个向量的 lane c 是通道 firstChannel + c，多出来的 lane 为 0
+            std::fill (mainLanes.begin(), mainLanes.begin() + numSamples, Vector::expand (0));
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                const auto* source = mainBuffer.getReadPointer (firstChannel + lane, start);
+
+                for (int i = 0; i < numSamples; ++i)
+                    mainLanes[(size_t) i].set ((size_t) lane, source[i]);
+            }
+
+            if (! broadcastSidechain)
+            {
+                std::fill (sidechainLanes.begin(), sidechainLanes.begin() + numSamples, Vector::expand (0));
+
+                for (int lane = 0; lane < juce::jmin (numLanes, numSidechainInputs - firstChannel); ++lane)
+                {
+                    const auto* source = sidechainBuffer.getReadPointer (firstChannel + lane, start);
+
+                    for (int i = 0; i < numSamples; ++i)
+                        sidechainLanes[(size_t) i].set ((size_t) lane, source[i]);
+                }
+            }
+
+            auto* mainLowPass = state.mainLowPass.data();
+            auto* mainHighPass = state.mainHighPass.data();
+            auto* sidechainLowPass = state.sidechainLowPass.data();
+            auto* sidechainHighPass = state.sidechainHighPass.data();
+            auto* allPass = state.allPass.data();
+
+            for (int i = 0; i < numSamples; ++i)
+            {
+                const auto ramp = (SampleType) (i + 1);
+
+                // 从低到高依次分出各区段：低通部分是这个区段，高通部分继续往上分
+                auto restMain = mainLanes[(size_t) i];
+                auto restSidechain = sidechainLanes[(size_t) i];
+
+                for (int k = 0; k < numEdges; ++k)
+                {
+                    auto lowMain = restMain, lowSidechain = restSidechain;
+
+                    for (int stage = k * stagesPerEdge; stage < (k + 1) * stagesPerEdge; ++stage)
+                    {
+                        lowMain = mainLowPass[stage].processSample (lowMain);
+                        restMain = mainHighPass[stage].processSample (restMain);
+                        lowSidechain = sidechainLowPass[stage].processSample (lowSidechain);
+                        restSidechain = sidechainHighPass[stage].processSample (restSidechain);
+                    }
+
+                    mainRegions[(size_t) k] = lowMain;
+                    sidechainRegions[(size_t) k] = lowSidechain;
+                }
+
+                mainRegions[(size_t) numEdges] = restMain;
+                sidechainRegions[(size_t) numEdges] = restSidechain;
+
+                // 交换：来源区段按交换对象的 mix 混合，移频后加到目标区段
+                for (int j = 0; j < numExchanges; ++j)
+                    shiftedRegions[(size_t) exchanges[(size_t) j].destinationRegion] = Vector::expand (0);
+
+                for (int j = 0; j < numExchanges; ++j)
+                {
+                    const auto& exchange = exchanges[(size_t) j];
+                    const auto gainMain = exchange.mainGain + exchangeMainStep[(size_t) j] * ramp;
+                    const auto gainSidechain = exchange.sidechainGain + exchangeSidechainStep[(size_t) j] * ramp;
+                    auto sourceMain = Vector::expand (0), sourceSidechain = Vector::expand (0);
+                    auto overlapMain = Vector::expand (0), overlapSidechain = Vector::expand (0);
+                    const int overlapEnd = exchange.firstOverlapRegion + exchange.numOverlapRegions;
+
+                    for (int r = exchange.firstSourceRegion; r < exchange.firstSourceRegion + exchange.numSourceRegions; ++r)
+                    {
+                        if (r >= exchange.firstOverlapRegion && r < overlapEnd)
+                        {
+                            overlapMain += mainRegions[(size_t) r];
+                            overlapSidechain += sidechainRegions[(size_t) r];
+                        }
+                        else
+                        {
+                            sourceMain += mainRegions[(size_t) r];
+                            sourceSidechain += sidechainRegions[(size_t) r];
+                        }
+                    }
+
+                    auto content = sourceMain * gainMain + sourceSidechain * gainSidechain;
+
+                    if (exchange.numOverlapRegions > 0)
+                        content += overlapMain * (exchange.overlapMainGain + overlapMainStep[(size_t) j] * ramp)
+                                 + overlapSidechain * (exchange.overlapSidechainGain + overlapSidechainStep[(size_t) j] * ramp);
+
+                    if (exchange.shifted)
+                    {
+                        // 单边带移频：解析信号 I + jQ 乘以 e^(jφ) 取实部
+                        auto* hilbert = state.hilbert.data() + j * 2 * numHilbertStages;
+                        auto inPhase = content, quadrature = content;
+
+                        for (int stage = 0; stage < numHilbertStages; ++stage)
+                        {
+                            inPhase = hilbert[stage].processSample (inPhase);
+                            quadrature = hilbert[numHilbertStages + stage].processSample (quadrature);
+                        }
+
+                        auto& delayed = state.hilbertDelay[(size_t) j];
+                        std::swap (inPhase, delayed);
+
+                        content = inPhase * oscillatorCos[(size_t) (j * blockSize + i)]
+                                + quadrature * oscillatorSin[(size_t) (j * blockSize + i)];
+                    }
+
+                    shiftedRegions[(size_t) exchange.destinationRegion] += content;
+                }
+
+                // 重新组合：每个区段先经过它上方所有分频点的全通，与 LR8 分频后的相位对齐
+                auto output = mainRegions[0] * (mainGain[0] + mainStep[0] * ramp)
+                            + sidechainRegions[0] * (sidechainGain[0] + sidechainStep[0] * ramp);
+
+                if (hasShifted[0])
+                    output += shiftedRegions[0];
+
+                for (int r = 1; r < numRegions; ++r)
+                {
+                    if (r < numEdges)
+                        for (int section = r * numSections; section < (r + 1) * numSections; ++section)
+                            output = allPass[section].processSample (output);
+
+                    output += mainRegions[(size_t) r] * (mainGain[(size_t) r] + mainStep[(size_t) r] * ramp)
+                            + sidechainRegions[(size_t) r] * (sidechainGain[(size_t) r] + sidechainStep[(size_t) r] * ramp);
+
+                    if (hasShifted[(size_t) r])
+                        output += shiftedRegions[(size_t) r];
+                }
+
+                mainLanes[(size_t) i] = output;
+            }
+
+            for (int lane = 0; lane < numLanes; ++lane)
+            {
+                auto* destination = mainBuffer.getWritePointer (firstChannel + lane, start);
+
+                for (int i = 0; i < numSamples; ++i)
+                    destination[i] = mainLanes[(size_t) i].get ((size_t) lane);
+            }
+        }
+
+        mainGain = mainGainTarget;
+        sidechainGain = sidechainGainTarget;
+
+        for (int j = 0; j < numExchanges; ++j)
+        {
+            exchanges[(size_t) j].mainGain = exchanges[(size_t) j].mainGainTarget;
+            exchanges[(size_t) j].sidechainGain = exchanges[(size_t) j].sidechainGainTarget;
+            exchanges[(size_t) j].overlapMainGain = exchanges[(size_t) j].overlapMainGainTarget;
+            exchanges[(size_t) j].overlapSidechainGain = exchanges[(size_t) j].overlapSidechainGainTarget;
+        }
+    }
+
+    void mixDry (juce::AudioBuffer<SampleType>& mainBuffer, int start, int numSamples, float& wetGain, float gainStep) const noexcept
+    {
+        auto gain = wetGain;
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            gain = juce::jlimit (0.0f, 1.0f, gain + gainStep);
+
+            for (int channel = 0; channel < mainBuffer.getNumChannels(); ++channel)
+            {
+                auto* wet = mainBuffer.getWritePointer (channel, start);
+                const auto dry = dryBuffer.getSample (channel, i);
+                wet[i] = dry + (SampleType) gain * (wet[i] - dry);
+            }
+        }
+
+        wetGain = gain;
+    }
+
+    //==============================================================================
+    double sampleRate;
+    int blockSize, numChannels, numGroups;
+
+    std::array<EdgeCoefficients, maxEdges> edgeCoefficients;
+    std::array<double, maxEdges> edgeFrequencies {};
+    std::array<typename Coefficients::Ptr, 2 * numHilbertStages> hilbertCoefficients;
+    int numEdges = 0;
+
+    std::array<SampleType, maxRegions> mainGain {}, sidechainGain {}, mainGainTarget {}, sidechainGainTarget {};
+    std::array<ExchangeState, ExchangeBandParameters::maxBands> exchanges;
+    int numExchanges = 0;
+
+    std::vector<Group> groups;
+    std::vector<Vector> mainLanes, sidechainLanes;
+    std::vector<SampleType> linkedSidechain;
+    std::vector<SampleType> oscillatorCos, oscillatorSin;  // 每个交换 blockSize 个
+    juce::AudioBuffer<SampleType> dryBuffer;
+};
+
+//==============================================================================
+CrossoverEngine::CrossoverEngine() = default;
+CrossoverEngine::~CrossoverEngine() = default;
+
+void CrossoverEngine::prepare (double newSampleRate, int maximumBlockSize, int numChannels, int numSidechainChannelsToUse,
+                               ProcessingPrecision newPrecision)
+{
+    jassert (numChannels > 0);
+    jassert (numSidechainChannelsToUse == 0 || numSidechainChannelsToUse == 1 || numSidechainChannelsToUse == numChannels);
+
+    sampleRate = newSampleRate;
+    maxBlockSize = juce::jmax (1, maximumBlockSize);
+    numMainChannels = numChannels;
+    numSidechainChannels = numSidechainChannelsToUse;
+    precision = newPrecision;
+
+    // 只为用到的精度分配滤波器，另一种精度的释放掉
+    singleNetwork.reset();
+    doubleNetwork.reset();
+
+    if (precision == ProcessingPrecision::doublePrecision)
+        doubleNetwork = std::make_unique<Network<double>> (sampleRate, maxBlockSize, numMainChannels);
+    else
+        singleNetwork = std::make_unique<Network<float>> (sampleRate, maxBlockSize, numMainChannels);
+
+    reset();
+}
+
+void CrossoverEngine::reset() noexcept
+{
+    if (parameterSource.isValid())
+        currentParameters = parameterSource.load();
+
+    updateLayout (true);
+
+    if (singleNetwork != nullptr)   singleNetwork->reset();
+    if (doubleNetwork != nullptr)   doubleNetwork->reset();
+
+    // 没有侧链时从一开始就是旁路
+    running = numSidechainChannels > 0;
+    wetGain = running ? 1.0f : 0.0f;
+    quietSamples = 0;
+}
+
+void CrossoverEngine::setParameters (const ExchangeBandParameters& newParameters) noexcept
+{
+    const bool bandsChanged = ! newParameters.hasSameBands (currentParameters);
+    currentParameters = newParameters;
+
+    if (bandsChanged)
+        updateLayout (false);
+}
+
+void CrossoverEngine::setParameterSource (const ExchangeBandParameterPointers& newSource) noexcept
+{
+    parameterSource = newSource;
+}
+
+void CrossoverEngine::updateLayout (bool resetGains) noexcept
+{
+    if (sampleRate <= 0.0)
+        return;
+
+    Layout newLayout;
+    computeLayout (currentParameters, sampleRate, newLayout);
+
+    // 分频点个数变了时各区段的下标和滤波器状态对不上，不能直接换：先把输出淡化到未处理的主链，
+    // processBlock() 在淡完之后换成新的分频结构，再从清空的滤波器状态淡入。等待期间的参数变化
+    // 到换的时候一起生效
+    if (! resetGains && running && wetGain > 0.0f && (layoutPending || newLayout.numEdges != layout.numEdges))
+    {
+        layoutPending = true;
+        return;
+    }
+
+    // 旁路中（或已经淡到未处理的主链）时直接换，增益跳到新值
+    const bool jump = resetGains || layoutPending || newLayout.numEdges != layout.numEdges;
+    layout = newLayout;
+    layoutPending = false;
+
+    if (singleNetwork != nullptr)   singleNetwork->setLayout (layout, jump);
+    if (doubleNetwork != nullptr)   doubleNetwork->setLayout (layout, jump);
+}
+
+//==============================================================================
+void CrossoverEngine::computeLayout (const ExchangeBandParameters& parameters, double sampleRate, Layout& result) noexcept
+{
+    const auto nyquist = sampleRate * 0.5;
+    const auto highestEdge = maxEdgeFrequencyRatio * sampleRate;
+    const int numBands = juce::jlimit (0, ExchangeBandParameters::maxBands, parameters.numBands);
+
+    // 与频谱掩码相同的规则：频段自身按 mix 混合；有交换对象时从下沿起按两者中较窄的宽度换成交换对象的内容
+    std::array<juce::Range<double>, ExchangeBandParameters::maxBands> ranges;
+    std::array<double, ExchangeBandParameters::maxBands> pairedWidth {};
+
+    const auto hasPartner = [&] (int band)
+    {
+        const auto partner = parameters.bands[(size_t) band].partner;
+        return partner >= 0 && partner < numBands && partner != band;
+    };
+
+    for (int i = 0; i < numBands; ++i)
+    {
+        const auto range = parameters.bands[(size_t) i].getFrequencyRange (sampleRate);
+        ranges[(size_t) i] = { juce::jlimit (0.0, nyquist, range.getStart()), juce::jlimit (0.0, nyquist, range.getEnd()) };
+    }
+
+    std::array<double, maxEdges> candidates {};
+    int numCandidates = 0;
+
+    const auto addCandidate = [&] (double frequency)
+    {
+        if (frequency > minEdgeFrequency && frequency < highestEdge)
+            candidates[(size_t) numCandidates++] = frequency;
+    };
+
+    for (int i = 0; i < numBands; ++i)
+    {
+        const auto& range = ranges[(size_t) i];
+        addCandidate (range.getStart());
+        addCandidate (range.getEnd());
+
+        if (hasPartner (i))
+        {
+            const auto& partnerRange = ranges[(size_t) parameters.bands[(size_t) i].partner];
+            pairedWidth[(size_t) i] = juce::jmin (range.getLength(), partnerRange.getLength());
+            addCandidate (range.getStart() + pairedWidth[(size_t) i]);
+            addCandidate (partnerRange.getStart() + pairedWidth[(size_t) i]);
+        }
+    }
+
+    std::sort (candidates.begin(), candidates.begin() + numCandidates);
+    result.numEdges = 0;
+
+    for (int i = 0; i < numCandidates; ++i)
+        if (result.numEdges == 0 || candidates[(size_t) i] > result.edges[(size_t) (result.numEdges - 1)] * edgeMergeRatio)
+            result.edges[(size_t) result.numEdges++] = candidates[(size_t) i];
+
+    //==============================================================================
+    // 每个区段按它的（对数）中点归属：覆盖中点的频段里下标最大的那个
+    const int numRegions = result.getNumRegions();
+    std::array<double, maxRegions> centres {};
+    std::array<int, maxRegions> owners {};
+
+    for (int r = 0; r < numRegions; ++r)
+    {
+        const auto low = r > 0 ? result.edges[(size_t) (r - 1)] : 0.0;
+        const auto high = r < result.numEdges ? result.edges[(size_t) r] : nyquist;
+        centres[(size_t) r] = low > 0.0 ? std::sqrt (low * high) : high * 0.5;
+        owners[(size_t) r] = -1;
+
+        for (int i = numBands; --i >= 0;)
+        {
+            if (ranges[(size_t) i].getStart() <= centres[(size_t) r] && centres[(size_t) r] < ranges[(size_t) i].getEnd())
+            {
+                owners[(size_t) r] = i;
+                break;
+            }
+        }
+
+        const auto owner = owners[(size_t) r];
+        auto& mainGain = result.mainGain[(size_t) r];
+        auto& sidechainGain = result.sidechainGain[(size_t) r];
+
+        if (owner < 0)
+        {
+            mainGain = 1.0f;
+            sidechainGain = 0.0f;
+        }
+        else if (hasPartner (owner) && centres[(size_t) r] < ranges[(size_t) owner].getStart() + pairedWidth[(size_t) owner])
+        {
+            // 成对交换的部分由交换的内容代替
+            mainGain = 0.0f;
+            sidechainGain = 0.0f;
+        }
+        else
+        {
+            const auto mix = parameters.bands[(size_t) owner].mix;
+            mainGain = 1.0f - mix;
+            sidechainGain = mix;
+        }
+    }
+
+    const auto findRegion = [&result] (double frequency)
+    {
+        return (int) (std::upper_bound (result.edges.begin(), result.edges.begin() + result.numEdges, frequency) - result.edges.begin());
+    };
+
+    // 交换的内容整段跟随成对部分中点处的归属，被下标更大的频段覆盖时不输出
+    result.numExchanges = 0;
+
+    for (int i = 0; i < numBands; ++i)
+    {
+        if (! hasPartner (i) || pairedWidth[(size_t) i] <= 0.0)
+            continue;
+
+        const auto& range = ranges[(size_t) i];
+        const auto partner = parameters.bands[(size_t) i].partner;
+        const auto& partnerRange = ranges[(size_t) partner];
+        const auto width = pairedWidth[(size_t) i];
+        const int destination = findRegion (range.getStart() + width * 0.5);
+
+        if (owners[(size_t) destination] != i)
+            continue;
+
+        auto& exchange = result.exchanges[(size_t) result.numExchanges++];
+        exchange.firstSourceRegion = maxRegions;
+        exchange.numSourceRegions = 0;
+        exchange.firstOverlapRegion = maxRegions;
+        exchange.numOverlapRegions = 0;
+
+        for (int r = 0; r < numRegions; ++r)
+        {
+            if (partnerRange.getStart() <= centres[(size_t) r] && centres[(size_t) r] < partnerRange.getStart() + width)
+            {
+                exchange.firstSourceRegion = juce::jmin (exchange.firstSourceRegion, r);
+                ++exchange.numSourceRegions;
+
+                // 来源区段落在本频段自身范围内：按 overlapMix 混合
+                if (parameters.bands[(size_t) i].overlapMix >= 0.0f
+                     && range.getStart() <= centres[(size_t) r] && centres[(size_t) r] < range.getEnd())
+                {
+                    exchange.firstOverlapRegion = juce::jmin (exchange.firstOverlapRegion, r);
+                    ++exchange.numOverlapRegions;
+                }
+            }
+        }
+
+        // 交换对象的成对部分窄到和相邻边缘合并了：取它中点所在的区段
+        if (exchange.numSourceRegions == 0)
+        {
+            exchange.firstSourceRegion = findRegion (partnerRange.getStart() + width * 0.5);
+            exchange.numSourceRegions = 1;
+        }
+
+        // 来源区段在中心频率处的 LR8 幅度响应：下方分频点的高通乘上方分频点的低通
+        const auto sourceLow = partnerRange.getStart();
+        const auto sourceCentre = sourceLow > 0.0 ? std::sqrt (sourceLow * (sourceLow + width)) : width * 0.5;
+        const int lastSourceRegion = exchange.firstSourceRegion + exchange.numSourceRegions - 1;
+        double response = 1.0;
+
+        for (int k = 0; k < result.numEdges; ++k)
+        {
+            const auto edge = result.edges[(size_t) k];
+
+            if (k < exchange.firstSourceRegion)
+                response /= 1.0 + std::pow (edge / sourceCentre, 8.0);
+            else if (k >= lastSourceRegion)
+                response /= 1.0 + std::pow (sourceCentre / edge, 8.0);
+        }
+
+        const auto compensation = (float) juce::jmin ((double) maxExchangeCompensation, 1.0 / response);
+        const auto partnerMix = parameters.bands[(size_t) partner].mix;
+        exchange.destinationRegion = destination;
+        exchange.mainGain = (1.0f - partnerMix) * compensation;
+        exchange.sidechainGain = partnerMix * compensation;
+
+        const auto overlapMix = exchange.numOverlapRegions > 0 ? parameters.bands[(size_t) i].overlapMix : partnerMix;
+        exchange.overlapMainGain = (1.0f - overlapMix) * compensation;
+        exchange.overlapSidechainGain = overlapMix * compensation;
+        exchange.shift = range.getStart() - partnerRange.getStart();
+    }
+}
+
+//==============================================================================
+void CrossoverEngine::process (juce::AudioBuffer<float>& mainBuffer, const juce::AudioBuffer<float>& sidechainBuffer) noexcept
+{
+    jassert (precision == ProcessingPrecision::singlePrecision);
+    EXCHANGEBAND_REALTIME_SECTION();
+    const juce::ScopedNoDenormals noDenormals;
+    processBlock (mainBuffer, sidechainBuffer);
+}
+
+void CrossoverEngine::process (juce::AudioBuffer<double>& mainBuffer, const juce::AudioBuffer<double>& sidechainBuffer) noexcept
+{
+    jassert (precision == ProcessingPrecision::doublePrecision);
+    EXCHANGEBAND_REALTIME_SECTION();
+    const juce::ScopedNoDenormals noDenormals;
+    processBlock (mainBuffer, sidechainBuffer);
+}
+
+template <>
+CrossoverEngine::Network<float>& CrossoverEngine::getNetwork<float>() noexcept     { return *singleNetwork; }
+
+template <>
+CrossoverEngine::Network<double>& CrossoverEngine::getNetwork<double>() noexcept   { return *doubleNetwork; }
+
+template <typename SampleType>
+void CrossoverEngine::processBlock (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer) noexcept
+{
+    const int numSamples = mainBuffer.getNumSamples();
+    jassert (mainBuffer.getNumChannels() <= numMainChannels);
+    jassert (sidechainBuffer.getNumChannels() <= juce::jmax (1, numSidechainChannels));
+
+    // 每个 block 读一次参数，频段表没变时不重新计算系数
+    if (parameterSource.isValid())
+        setParameters (parameterSource.load());
+
+    // 侧链静音超过 idleHoldSeconds 后淡化到未处理的主链，之后跳过滤波；
+    // 侧链再出现时从清空的滤波器状态淡入
+    const int holdSamples = numSidechainChannels > 0 ? juce::roundToInt (idleHoldSeconds * sampleRate) : 0;
+    quietSamples = isSidechainIdle (sidechainBuffer, numSamples) ? juce::jmin (quietSamples + numSamples, holdSamples) : 0;
+    const bool wantsWet = quietSamples < holdSamples;
+    auto& network = getNetwork<SampleType>();
+
+    // 分频点个数的变化：输出已经淡到未处理的主链，换成新的分频结构后从清空的滤波器状态淡入
+    if (layoutPending && (wetGain <= 0.0f || ! running))
+    {
+        updateLayout (false);
+        network.reset();
+    }
+
+    if (! running)
+    {
+        if (! wantsWet)
+            return;
+
+        network.reset();
+        running = true;
+    }
+
+    const auto gainStep = wantsWet && ! layoutPending ? (wetGain < 1.0f ? 1.0f / (float) idleCrossfadeSamples : 0.0f)
+                                                      : -1.0f / (float) idleCrossfadeSamples;
+    network.process (mainBuffer, sidechainBuffer, currentParameters.sidechainLink, wetGain, gainStep);
+
+    if (! wantsWet && wetGain <= 0.0f)
+        running = false;
+}
+
+template <typename SampleType>
+bool CrossoverEngine::isSidechainIdle (const juce::AudioBuffer<SampleType>& sidechainBuffer, int numSamples) const noexcept
+{
+    if (numSidechainChannels == 0)
+        return true;
+
+    for (int channel = 0; channel < sidechainBuffer.getNumChannels(); ++channel)
+        if (sidechainBuffer.getRMSLevel (channel, 0, numSamples) > (SampleType) silenceThreshold)
+            return false;
+
+    return true;
+}
@@ -0,0 +1,170 @@
+/*
+  ==============================================================================
+
+    CrossoverEngine.h
+    零延迟的频段交换引擎：用 juce::dsp::IIR 的 Linkwitz-Riley 分频器把主链和侧链分成频率区段，
+    在时域里按与 STFT 引擎相同的频段表重新组合，适合现场演出和录音监听。
+    ExchangeBandAudioProcessor 的 "engine" 参数选择用它还是 ExchangeBandEngine。
+
+    - 频段表的所有边缘（每个频段的上下沿，有交换对象时再加上成对部分的上沿）排序后作为分频点，
+      相邻分频点之间是一个区段。每个分频点是一对 8 阶 Linkwitz-Riley 低通 / 高通（4 阶 Butterworth
+      的平方，共四节双二阶），从低到高依次从剩余信号里分出一个区段。
+    - 每个区段按覆盖它的频段（下标大的优先，与频谱掩码的规则相同）取主链 / 侧链的增益。
+      LR8 低通 + 高通 = 四阶全通（两节与 Butterworth 同 Q 的二阶全通），区段相加前用各分频点的全通补偿相位，
+      所有增益为 1 : 0 时输出是主链经过全通滤波的结果，幅度响应完全平坦。
+    - 交换：交换对象成对部分的区段按它自己的 mix 混合后，用 Hilbert 全通对做单边带移频，
+      把内容搬到本频段的位置上（移动的 Hz 数与频谱掩码的 bin 偏移一致）。窄的区段在中心也达不到 0 dB，
+      交换的内容按来源区段在中心频率处的响应补偿电平（最多 maxExchangeCompensation 倍）。
+    - 滤波器在 SIMDRegister 上运行，每个向量的各个 lane 是不同的通道，立体声 float 一次处理两个通道，
+      更多的通道按 SIMDRegister::size() 分组。
+    - 分频点的系数由所有通道组共用，只有频段表或采样率变化时才在音频线程上原地重新计算（不分配内存），
+      各区段的增益在一个 block 内线性过渡。
+
+    与 STFT 引擎的差别：分频器的斜率是 48 dB / 倍频程，频段边缘没有 STFT 那样陡，
+    不到一个倍频程宽的频段两侧会漏进一部分相邻的内容；
+    频段部分重叠时按区段决定归属，交换的内容整段跟随频段成对部分中点处的归属。
+
+    线程模型与 ExchangeBandEngine 相同：prepare() / setParameterSource() 只在音频回调停止时调用，
+    reset() 和 process() 在处理线程上调用，不分配内存也不加锁。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include "ExchangeBandEngine.h"
+#include <array>
+#include <memory>
+
+//==============================================================================
+class CrossoverEngine
+{
+public:
+    //==============================================================================
+    using ProcessingPrecision = ExchangeBandEngine::ProcessingPrecision;
+
+    // 每个频段最多贡献 4 个分频点（上下沿、本频段和交换对象成对部分的上沿）
+    static constexpr int maxEdges = 4 * ExchangeBandParameters::maxBands;
+    static constexpr int maxRegions = maxEdges + 1;
+
+    // 分频点的范围：更低的边缘并入最低的区段，更高的并入最高的区段
+    static constexpr double minEdgeFrequency = 10.0;
+    static constexpr double maxEdgeFrequencyRatio = 0.45;  // 相对采样率
+
+    // 比值在这以内的两个边缘合并成一个分频点，避免出现几乎为空的区段
+    static constexpr double edgeMergeRatio = 1.002;
+
+    // 4 阶 Butterworth 两节双二阶的 Q。LR8 的低通 / 高通每节各用两次，相位补偿的全通每节用一次
+    static constexpr int numSections = 2;
+    static constexpr float butterworthQ[numSections] { 0.54119610f, 1.30656296f };
+
+    // 交换内容的电平补偿上限（+12 dB），频段窄到分频器完全分不出来时不会无限放大
+    static constexpr float maxExchangeCompensation = 4.0f;
+
+    // 输入停止后报告给宿主的尾音长度：最低分频点的 IIR 衰减到 -120 dB 左右所需的时间
+    static constexpr double tailSeconds = 0.2;
+
+    // 侧链空闲时的旁路与 STFT 引擎共用阈值和保持时间；旁路时直接输出主链。
+    // 分频点个数变化时也按 idleCrossfadeSamples 先淡化到主链，换成新的分频结构后再淡入
+    static constexpr float silenceThreshold = ExchangeBandEngine::silenceThreshold;
+    static constexpr double idleHoldSeconds = ExchangeBandEngine::idleHoldSeconds;
+    static constexpr int idleCrossfadeSamples = ExchangeBandEngine::idleCrossfadeSamples;
+
+    CrossoverEngine();
+    ~CrossoverEngine();
+
+    //==============================================================================
+    // 分配所有滤波器和缓冲区。通道数的约定与 ExchangeBandEngine::prepare() 相同
+    void prepare (double newSampleRate, int maximumBlockSize, int numChannels, int numSidechainChannels,
+                  ProcessingPrecision precision = ProcessingPrecision::singlePrecision);
+    // 清空滤波器状态，从参数里的频段表重新计算分频点，不分配内存
+    void reset() noexcept;
+
+    // 直接设置参数快照（离线 / 无插件外壳时使用）
+    void setParameters (const ExchangeBandParameters& newParameters) noexcept;
+    // 设置后每个 block 从这些原子变量读取频段表，只有变化时才重新计算系数，优先于 setParameters()
+    void setParameterSource (const ExchangeBandParameterPointers& newSource) noexcept;
+    const ExchangeBandParameters& getParameters() const noexcept   { return currentParameters; }
+
+    // 处理一个 block：mainBuffer 原地写回输出，sidechainBuffer 只读，没有通道时视为侧链缺失
+    void process (juce::AudioBuffer<float>& mainBuffer, const juce::AudioBuffer<float>& sidechainBuffer) noexcept;
+    void process (juce::AudioBuffer<double>& mainBuffer, const juce::AudioBuffer<double>& sidechainBuffer) noexcept;
+
+    ProcessingPrecision getProcessingPrecision() const noexcept     { return precision; }
+    double getSampleRate() const noexcept                           { return sampleRate; }
+
+    int getLatencySamples() const noexcept                          { return 0; }
+    int getTailSamples() const noexcept                             { return juce::roundToInt (tailSeconds * sampleRate); }
+
+    // 当前的分频点个数（只在处理线程上调用）
+    int getNumEdges() const noexcept                                { return layout.numEdges; }
+    // 是否因为侧链缺失 / 静音而旁路（只在处理线程上调用）
+    bool isIdle() const noexcept                                    { return ! running; }
+
+private:
+    //==============================================================================
+    // 频段表编译成的分频结构，只含定长数组，在音频线程上计算
+    struct Layout
+    {
+        int numEdges = 0;
+        std::array<double, maxEdges> edges {};  // Hz，升序
+
+        // 每个区段自身的增益（没有频段覆盖的区段为 1 : 0）
+        std::array<float, maxRegions> mainGain {}, sidechainGain {};
+
+        // 一个交换：把 [firstSourceRegion, firstSourceRegion + numSourceRegions) 区段按增益混合，
+        // 移频 shift Hz 后在 destinationRegion 处加入输出。其中与目标频段重叠的
+        // [firstOverlapRegion, firstOverlapRegion + numOverlapRegions) 按 overlap 增益混合
+        struct Exchange
+        {
+            int firstSourceRegion = 0, numSourceRegions = 0;
+            int firstOverlapRegion = 0, numOverlapRegions = 0;
+            int destinationRegion = 0;
+            float mainGain = 0.0f, sidechainGain = 0.0f;
+            float overlapMainGain = 0.0f, overlapSidechainGain = 0.0f;
+            double shift = 0.0;
+        };
+
+        std::array<Exchange, ExchangeBandParameters::maxBands> exchanges;
+        int numExchanges = 0;
+
+        int getNumRegions() const noexcept                          { return numEdges + 1; }
+    };
+
+    static void computeLayout (const ExchangeBandParameters& parameters, double sampleRate, Layout& result) noexcept;
+
+    // 一种精度下的系数、各通道组的滤波器和交错缓冲区（定义在 .cpp 里）
+    template <typename SampleType>
+    class Network;
+
+    template <typename SampleType> void processBlock (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer) noexcept;
+    template <typename SampleType> Network<SampleType>& getNetwork() noexcept;
+    template <typename SampleType> bool isSidechainIdle (const juce::AudioBuffer<SampleType>& sidechainBuffer, int numSamples) const noexcept;
+    void updateLayout (bool resetGains) noexcept;
+
+    //==============================================================================
+    ExchangeBandParameters currentParameters;
+    ExchangeBandParameterPointers parameterSource;
+    Layout layout;
+
+    double sampleRate = 0.0;
+    int maxBlockSize = 0;
+    int numMainChannels = 0;
+    int numSidechainChannels = 0;
+    ProcessingPrecision precision = ProcessingPrecision::singlePrecision;
+
+    std::unique_ptr<Network<float>> singleNetwork;
+    std::unique_ptr<Network<double>> doubleNetwork;
+
+    // 空闲旁路：wetGain 是分频处理后的输出所占的比例，其余为未处理的主链
+    bool running = true;
+    float wetGain = 1.0f;
+    int quietSamples = 0;
+
+    // 分频点个数变了，正在淡化到未处理的主链，淡完后换成新的分频结构（见 updateLayout()）
+    bool layoutPending = false;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CrossoverEngine)
+};
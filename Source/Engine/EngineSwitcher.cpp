@@ -0,0 +1,320 @@
+/*
+  ==============================================================================
+
+    EngineSwitcher.cpp
+
+  ==============================================================================
+*/
+
+#include "EngineSwitcher.h"
+#include "RealtimeSafety.h"
+
+namespace
+{
+    template <typename SampleType>
+    void copyIntoRing (SampleType* ring, int ringSize, int position, const SampleType* source, int numSamples) noexcept
+    {
+        const int numBeforeWrap = juce::jmin (numSamples, ringSize - position);
+        juce::FloatVectorOperations::copy (ring + position, source, numBeforeWrap);
+        juce::FloatVectorOperations::copy (ring, source + numBeforeWrap, numSamples - numBeforeWrap);
+    }
+
+    // buffer 中 [start, start + numSamples) 的视图，不拷贝样本。各通道的起点写进 prepare() 里分配好的 pointers；
+    // AudioBuffer 构造时再把这些指针复制到它自己的数组里，只有少于 32 个通道时才用对象内部的预分配空间，
+    // 所以通道数不能超过 ExchangeBandEngine::maxChannels，否则这里会分配内存
+    template <typename SampleType>
+    juce::AudioBuffer<SampleType> getRange (const juce::AudioBuffer<SampleType>& buffer, std::vector<SampleType*>& pointers,
+                                            int start, int numSamples) noexcept
+    {
+        const int numChannels = buffer.getNumChannels();
+        jassert (numChannels <= (int) pointers.size() && numChannels <= ExchangeBandEngine::maxChannels);
+
+        if (numChannels == 0)
+            return {};
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            pointers[(size_t) channel] = const_cast<SampleType*> (buffer.getReadPointer (channel, start));
+
+        return { pointers.data(), numChannels, numSamples };
+    }
+}
+
+//==============================================================================
+EngineSwitcher::EngineSwitcher (ExchangeBandEngine& stftEngine, CrossoverEngine& crossoverEngine) noexcept
+    : engine (stftEngine), crossover (crossoverEngine)
+{
+}
+
+void EngineSwitcher::prepare (int maximumBlockSize, int numChannels, ProcessingPrecision precision, bool useCrossover)
+{
+    jassert (numChannels <= ExchangeBandEngine::maxChannels);
+
+    const auto allocate = [&] (auto& state, bool used)
+    {
+        // 侧链的通道数不会超过主链（单声道或与主链相同）
+        const auto numPointers = used ? (size_t) numChannels : 0;
+        state.mainPointers.assign (numPointers, nullptr);
+        state.sidechainPointers.assign (numPointers, nullptr);
+        state.transitionPointers.assign (numPointers, nullptr);
+
+        if (used)
+        {
+            state.transitionBuffer.setSize (numChannels, juce::jmax (1, maximumBlockSize));
+            state.alignmentDelay.setSize (numChannels, ExchangeBandEngine::maxFftSize + juce::jmax (1, maximumBlockSize));
+        }
+        else
+        {
+            state.transitionBuffer.setSize (0, 0);
+            state.alignmentDelay.setSize (0, 0);
+        }
+    };
+
+    allocate (floatState, precision == ProcessingPrecision::singlePrecision);
+    allocate (doubleState, precision == ProcessingPrecision::doublePrecision);
+    reset (useCrossover);
+}
+
+void EngineSwitcher::reset (bool useCrossover) noexcept
+{
+    if (useCrossover)
+        crossover.reset();
+    else
+        engine.clearState();
+
+    crossoverActive = useCrossover;
+    transitionInProgress = false;
+    transitionLatencySwitched = false;
+}
+
+//==============================================================================
+bool EngineSwitcher::isOutputFromCrossover() const noexcept
+{
+    return transitionInProgress && transitionLatencySwitched ? ! crossoverActive : crossoverActive;
+}
+
+int EngineSwitcher::getLatencySamples() const noexcept
+{
+    return isOutputFromCrossover() ? crossover.getLatencySamples() : engine.getLatencySamples();
+}
+
+int EngineSwitcher::getTailSamples() const noexcept
+{
+    return isOutputFromCrossover() ? crossover.getTailSamples() : engine.getTailSamples();
+}
+
+//==============================================================================
+void EngineSwitcher::process (juce::AudioBuffer<float>& mainBuffer, const juce::AudioBuffer<float>& sidechainBuffer, bool useCrossover)
+{
+    processBlock (mainBuffer, sidechainBuffer, useCrossover);
+}
+
+void EngineSwitcher::process (juce::AudioBuffer<double>& mainBuffer, const juce::AudioBuffer<double>& sidechainBuffer, bool useCrossover)
+{
+    processBlock (mainBuffer, sidechainBuffer, useCrossover);
+}
+
+template <>
+EngineSwitcher::PrecisionState<float>& EngineSwitcher::getState<float>() noexcept     { return floatState; }
+
+template <>
+EngineSwitcher::PrecisionState<double>& EngineSwitcher::getState<double>() noexcept   { return doubleState; }
+
+template <typename SampleType>
+void EngineSwitcher::processBlock (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer, bool useCrossover)
+{
+    EXCHANGEBAND_REALTIME_SECTION();
+
+    // STFT 几何切换中延迟还会变，等它结束再开始
+    if (! transitionInProgress && useCrossover != crossoverActive && ! engine.isChangingStftSettings())
+        beginTransition();
+
+    if (transitionInProgress)
+        processTransition (mainBuffer, sidechainBuffer);
+    else if (crossoverActive)
+        crossover.process (mainBuffer, sidechainBuffer);
+    else
+        engine.process (mainBuffer, sidechainBuffer);
+}
+
+void EngineSwitcher::beginTransition() noexcept
+{
+    // 即将使用的引擎从空的状态开始（不分配内存）。分频引擎的滤波器要一个尾音长度才从零状态稳定下来，
+    // 它经过对齐延迟线的那一份还要再晚 L 个样本；STFT 与几何切换一样预热两帧
+    if (crossoverActive)
+    {
+        engine.clearState();
+        transitionLatencyDifference = engine.getLatencySamples();
+        transitionWarmUpSamples = 2 * engine.getActiveStftSettings().getFftSize();
+    }
+    else
+    {
+        crossover.reset();
+        transitionLatencyDifference = -engine.getLatencySamples();
+        transitionWarmUpSamples = crossover.getTailSamples() + engine.getLatencySamples();
+    }
+
+    transitionSamplesDone = 0;
+    transitionLatencySwitched = false;
+    alignmentWritePosition = 0;
+    transitionInProgress = true;
+}
+
+template <typename SampleType>
+void EngineSwitcher::processTransition (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer)
+{
+    // 与 ExchangeBandEngine::processTransition() 相同的时间线（J = latencyJumpFadeSamples，C = crossfadeSamples）：
+    // - 切回 STFT（新引擎延迟较大）：分频引擎淡出 J，跳变到 L，延迟对齐的分频引擎淡入 J，再与 STFT 交叉淡化 C。
+    // - 切到分频引擎（新引擎延迟较小）：STFT 与延迟对齐的分频引擎交叉淡化 C，后者淡出 J，跳变到 0，分频引擎淡入 J。
+    // 旧引擎原地处理 mainBuffer，新引擎处理拷贝；延迟的总是分频引擎
+    const int numSamples = mainBuffer.getNumSamples();
+    const int numChannels = mainBuffer.getNumChannels();
+    const int difference = transitionLatencyDifference;
+    const int delay = std::abs (difference);
+    const int jumpFade = difference != 0 ? latencyJumpFadeSamples : 0;
+    const bool delayOld = difference > 0;
+
+    const int fadeStart = transitionWarmUpSamples;
+    const int switchPoint = delayOld ? fadeStart + jumpFade : fadeStart + (difference != 0 ? crossfadeSamples : 0) + jumpFade;
+    const int fadeEnd = delayOld ? switchPoint + jumpFade + crossfadeSamples
+                                 : switchPoint + (difference != 0 ? jumpFade : crossfadeSamples);
+
+    auto& state = getState<SampleType>();
+    auto& transitionBuffer = state.transitionBuffer;
+    auto& alignmentDelay = state.alignmentDelay;
+    const int ringSize = alignmentDelay.getNumSamples();
+    jassert (delay + transitionBuffer.getNumSamples() <= ringSize);
+
+    const auto processOld = [this] (juce::AudioBuffer<SampleType>& buffer, const juce::AudioBuffer<SampleType>& sidechain)
+    {
+        if (crossoverActive)
+            crossover.process (buffer, sidechain);
+        else
+            engine.process (buffer, sidechain);
+    };
+
+    const auto processNew = [this] (juce::AudioBuffer<SampleType>& buffer, const juce::AudioBuffer<SampleType>& sidechain)
+    {
+        if (crossoverActive)
+            engine.process (buffer, sidechain);
+        else
+            crossover.process (buffer, sidechain);
+    };
+
+    // [start, start + length) 上从 0 到 1 的线性斜坡，length 为 0 时是阶跃
+    const auto ramp = [] (int t, int start, int length)
+    {
+        if (t < start)
+            return SampleType (0);
+
+        return length > 0 ? juce::jmin (SampleType (1), (SampleType) (t - start) / (SampleType) length) : SampleType (1);
+    };
+
+    for (int position = 0; position < numSamples;)
+    {
+        const int numThisTime = juce::jmin (numSamples - position, transitionBuffer.getNumSamples());
+        auto mainRange = getRange (mainBuffer, state.mainPointers, position, numThisTime);
+        const auto sidechainRange = getRange (sidechainBuffer, state.sidechainPointers, position, numThisTime);
+        auto incoming = getRange (transitionBuffer, state.transitionPointers, 0, numThisTime);
+
+        // 两个引擎并行处理同一段输入
+        for (int channel = 0; channel < numChannels; ++channel)
+            transitionBuffer.copyFrom (channel, 0, mainBuffer, channel, position, numThisTime);
+
+        processOld (mainRange, sidechainRange);
+        processNew (incoming, sidechainRange);
+
+        // 分频引擎的输出写进对齐延迟线，先写后读，延迟小于这一段的长度时读到的是刚写进去的样本
+        const int readStart = (alignmentWritePosition - delay + ringSize) % ringSize;
+
+        if (difference != 0)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                copyIntoRing (alignmentDelay.getWritePointer (channel), ringSize, alignmentWritePosition,
+                              delayOld ? mainBuffer.getReadPointer (channel, position) : transitionBuffer.getReadPointer (channel),
+                              numThisTime);
+
+            alignmentWritePosition = (alignmentWritePosition + numThisTime) % ringSize;
+        }
+
+        // 预热阶段只输出旧引擎，mainBuffer 里已经是它的输出
+        const int mixFrom = juce::jlimit (0, numThisTime, fadeStart - transitionSamplesDone);
+
+        for (int i = mixFrom; i < numThisTime; ++i)
+        {
+            const int t = transitionSamplesDone + i;
+
+            // 旧引擎、新引擎和对齐延迟线（分频引擎）各自的增益
+            SampleType oldGain = 0, newGain = 0, delayedGain = 0;
+
+            if (difference == 0)
+            {
+                newGain = ramp (t, fadeStart, crossfadeSamples);
+                oldGain = 1 - newGain;
+            }
+            else if (delayOld)
+            {
+                if (t < switchPoint)
+                {
+                    oldGain = 1 - ramp (t, fadeStart, jumpFade);
+                }
+                else
+                {
+                    newGain = ramp (t, switchPoint + jumpFade, crossfadeSamples);
+                    delayedGain = ramp (t, switchPoint, jumpFade) * (1 - newGain);
+                }
+            }
+            else
+            {
+                if (t < switchPoint)
+                {
+                    const auto crossfade = ramp (t, fadeStart, crossfadeSamples);
+                    oldGain = 1 - crossfade;
+                    delayedGain = crossfade * (1 - ramp (t, fadeStart + crossfadeSamples, jumpFade));
+                }
+                else
+                {
+                    newGain = ramp (t, switchPoint, jumpFade);
+                }
+            }
+
+            int readPosition = readStart + i;
+
+            if (readPosition >= ringSize)
+                readPosition -= ringSize;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto& output = mainBuffer.getWritePointer (channel, position)[i];
+                output = oldGain * output + newGain * transitionBuffer.getSample (channel, i);
+
+                if (delayedGain > 0)
+                    output += delayedGain * alignmentDelay.getSample (channel, readPosition);
+            }
+        }
+
+        transitionSamplesDone += numThisTime;
+        position += numThisTime;
+        transitionLatencySwitched = transitionSamplesDone >= switchPoint;
+
+        if (transitionSamplesDone >= fadeEnd)
+        {
+            // 切换完成，block 剩下的部分只由新引擎处理
+            crossoverActive = ! crossoverActive;
+            transitionInProgress = false;
+            transitionLatencySwitched = false;
+
+            if (position < numSamples)
+            {
+                auto rest = getRange (mainBuffer, state.mainPointers, position, numSamples - position);
+                const auto sidechainRest = getRange (sidechainBuffer, state.sidechainPointers, position, numSamples - position);
+
+                if (crossoverActive)
+                    crossover.process (rest, sidechainRest);
+                else
+                    engine.process (rest, sidechainRest);
+            }
+
+            return;
+        }
+    }
+}
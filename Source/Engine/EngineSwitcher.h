@@ -0,0 +1,101 @@
+/*
+  ==============================================================================
+
+    EngineSwitcher.h
+    在 STFT 引擎（ExchangeBandEngine）和零延迟的分频引擎（CrossoverEngine）之间无缝切换。
+    ExchangeBandAudioProcessor 的 "engine" 参数改变时，两个引擎并行处理同一段输入一小段时间，
+    再交叉淡化过去，不会出现咔嗒声。
+
+    - 两个引擎的延迟不同（STFT 为 L，分频引擎为 0），分频引擎的输出先经过长 L 的对齐延迟线，
+      交叉淡化时混在一起的两份输出在时间上对齐。延迟跳变前后各淡出 / 淡入
+      ExchangeBandEngine::latencyJumpFadeSamples，跳变本身落在静音里。时间线与 STFT 几何切换相同：
+      - 切到分频引擎：分频引擎先预热（一个尾音长度 + L），STFT 与延迟对齐的分频引擎交叉淡化，
+        后者淡出，跳变到 0 延迟，分频引擎淡入。
+      - 切回 STFT：STFT 从空的状态预热两帧，分频引擎淡出，跳变到 L，延迟对齐的分频引擎淡入，
+        再与 STFT 交叉淡化。
+    - getLatencySamples() / getTailSamples() 在跳变的那个样本从旧引擎切换到新引擎，
+      处理器每个 block 之后发布给宿主。
+    - STFT 几何切换进行中时推迟开始，等它结束、延迟固定下来之后再切换引擎；
+      切换进行中选择又变了的，等这一次完成之后再切回去。
+
+    线程模型与两个引擎相同：prepare() 只在音频回调停止时调用（在两个引擎的 prepare() 之后），
+    reset() 和 process() 在处理线程上调用，不分配内存也不加锁。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "CrossoverEngine.h"
+#include "ExchangeBandEngine.h"
+
+//==============================================================================
+class EngineSwitcher
+{
+public:
+    //==============================================================================
+    using ProcessingPrecision = ExchangeBandEngine::ProcessingPrecision;
+
+    // 两个引擎输出的交叉淡化长度，与 STFT 几何切换相同
+    static constexpr int crossfadeSamples = ExchangeBandEngine::geometryCrossfadeSamples;
+    static constexpr int latencyJumpFadeSamples = ExchangeBandEngine::latencyJumpFadeSamples;
+
+    EngineSwitcher (ExchangeBandEngine& stftEngine, CrossoverEngine& crossoverEngine) noexcept;
+
+    //==============================================================================
+    // 分配对齐延迟线和第二个引擎的输入拷贝，从 useCrossover 选中的引擎开始
+    void prepare (int maximumBlockSize, int numChannels, ProcessingPrecision precision, bool useCrossover);
+    // 放弃进行中的切换，清空即将使用的引擎，从 useCrossover 选中的引擎开始
+    void reset (bool useCrossover) noexcept;
+
+    // 处理一个 block：mainBuffer 原地写回输出，sidechainBuffer 只读。
+    // useCrossover 与当前的引擎不同时开始切换
+    void process (juce::AudioBuffer<float>& mainBuffer, const juce::AudioBuffer<float>& sidechainBuffer, bool useCrossover);
+    void process (juce::AudioBuffer<double>& mainBuffer, const juce::AudioBuffer<double>& sidechainBuffer, bool useCrossover);
+
+    // 输出当前的延迟 / 尾音长度：切换中在跳变之前是旧引擎的，之后是新引擎的（只在处理线程上调用）
+    int getLatencySamples() const noexcept;
+    int getTailSamples() const noexcept;
+
+    // 输出来自分频引擎（切换中为正在淡出的那一个）
+    bool isCrossoverActive() const noexcept                         { return crossoverActive; }
+    bool isSwitching() const noexcept                               { return transitionInProgress; }
+
+private:
+    //==============================================================================
+    template <typename SampleType>
+    struct PrecisionState
+    {
+        // 切换时分频引擎处理的输入拷贝（最大 block 长度）
+        juce::AudioBuffer<SampleType> transitionBuffer;
+        // 分频引擎输出的对齐延迟线（maxFftSize + 最大 block 长度）
+        juce::AudioBuffer<SampleType> alignmentDelay;
+        // 按 block 分段处理时各段视图的通道指针（每个通道一个）
+        std::vector<SampleType*> mainPointers, sidechainPointers, transitionPointers;
+    };
+
+    template <typename SampleType> PrecisionState<SampleType>& getState() noexcept;
+    template <typename SampleType> void processBlock (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer, bool useCrossover);
+    template <typename SampleType> void processTransition (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer);
+    void beginTransition() noexcept;
+    bool isOutputFromCrossover() const noexcept;
+
+    //==============================================================================
+    ExchangeBandEngine& engine;
+    CrossoverEngine& crossover;
+
+    PrecisionState<float> floatState;
+    PrecisionState<double> doubleState;
+
+    bool crossoverActive = false;
+
+    // 切换的进度：difference = 新引擎的延迟 - 旧引擎的延迟，按它选择时间线
+    bool transitionInProgress = false;
+    bool transitionLatencySwitched = false;
+    int transitionLatencyDifference = 0;
+    int transitionSamplesDone = 0;
+    int transitionWarmUpSamples = 0;
+    int alignmentWritePosition = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (EngineSwitcher)
+};
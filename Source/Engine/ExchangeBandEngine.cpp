@@ -0,0 +1,1614 @@
+/*
+  ==============================================================================
+
+    ExchangeBandEngine.cpp
+
+  ==============================================================================
+*/
+
+#include "ExchangeBandEngine.h"
+#include <numeric>
+
+namespace
+{
+    // FFT 工作区和逐 bin 内核只有 float 版本（RealFft 的各个后端都只支持 float），
+    // 时域状态为 double 时，加窗和 overlap-add 都在 double 下计算，只在进出 FFT 时转换
+    inline void windowIntoFrame (float* frame, const float* source, const float* window, int numSamples) noexcept
+    {
+        juce::FloatVectorOperations::multiply (frame, source, window, numSamples);
+    }
+
+    inline void windowIntoFrame (float* frame, const double* source, const double* window, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            frame[i] = (float) (source[i] * window[i]);
+    }
+
+    inline void addWindowedSamples (float* frame, const float* source, const float* window, int numSamples) noexcept
+    {
+        juce::FloatVectorOperations::addWithMultiply (frame, source, window, numSamples);
+    }
+
+    inline void addWindowedSamples (float* frame, const double* source, const double* window, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            frame[i] += (float) (source[i] * window[i]);
+    }
+
+    inline void addWindowedFrame (float* accumulator, const float* frame, const float* window, int numSamples) noexcept
+    {
+        juce::FloatVectorOperations::addWithMultiply (accumulator, frame, window, numSamples);
+    }
+
+    inline void addWindowedFrame (double* accumulator, const float* frame, const double* window, int numSamples) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            accumulator[i] += (double) frame[i] * window[i];
+    }
+
+    // 加窗后一帧的能量；帧里有 NaN / Inf（或大到平方溢出）时结果不是有限值。
+    // 四路独立累加，不依赖编译器重排浮点加法
+    inline float frameEnergy (const float* frame, int numSamples) noexcept
+    {
+        float sums[4] = {};
+
+        for (int i = 0; i < numSamples; i += 4)
+            for (int j = 0; j < 4; ++j)
+                sums[j] += frame[i + j] * frame[i + j];
+
+        return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+    }
+
+    // 长度为 ringSize 的环形缓冲区，回绕时分两段拷贝
+    template <typename SampleType>
+    void copyIntoRing (SampleType* ring, int ringSize, int position, const SampleType* source, int numSamples) noexcept
+    {
+        const int numBeforeWrap = juce::jmin (numSamples, ringSize - position);
+        juce::FloatVectorOperations::copy (ring + position, source, numBeforeWrap);
+        juce::FloatVectorOperations::copy (ring, source + numBeforeWrap, numSamples - numBeforeWrap);
+    }
+
+    template <typename SampleType>
+    void copyFromRing (SampleType* destination, const SampleType* ring, int ringSize, int position, int numSamples) noexcept
+    {
+        const int numBeforeWrap = juce::jmin (numSamples, ringSize - position);
+        juce::FloatVectorOperations::copy (destination, ring + position, numBeforeWrap);
+        juce::FloatVectorOperations::copy (destination + numBeforeWrap, ring, numSamples - numBeforeWrap);
+    }
+}
+
+//==============================================================================
+// 一套完整的 STFT 状态：输入环形缓冲区、overlap-add 缓冲区和 FFT 工作区。
+// 缓冲区按最大几何分配，configure() 只切换 plan / 窗表指针和每帧处理函数，不分配内存。
+// 每帧的处理按 FFT 阶数模板特化，帧长和 bin 数都是编译期常量。
+// 环形缓冲区、窗和 overlap-add 按 SampleType（float / double）各编译一份，没有虚函数
+template <typename SampleType>
+class ExchangeBandEngine::StftSlot
+{
+public:
+    StftSlot (ExchangeBandEngine& ownerEngine, int slotIndex)
+        : engine (ownerEngine), firstHazard (2 * slotIndex), currentHazard (firstHazard)
+    {
+    }
+
+    ~StftSlot()
+    {
+        releaseMasks();
+    }
+
+    void allocate (int numChannels, int numSidechainChannelsToUse)
+    {
+        numMainChannels = numChannels;
+        numSidechainChannels = numSidechainChannelsToUse;
+
+        mainInputRing.setSize (numMainChannels, maxFftSize);
+        sidechainInputRing.setSize (juce::jmax (1, numSidechainChannels), maxFftSize);
+        outputAccumulator.setSize (numMainChannels, maxFftSize);
+
+        // 每个 lane（执行线程）一份 FFT 工作区，并行处理的通道之间不共享写入
+        lanes.resize ((size_t) engine.workers.getNumLanes());
+        sharedSidechainFFTData.assign (maxFftSize * 2, 0.0f);
+
+        for (auto& lane : lanes)
+            lane.allocate (engine.fftWorkspaceSize);
+    }
+
+    // 另一种精度在用时，这一套的内存全部还回去
+    void releaseBuffers()
+    {
+        releaseMasks();
+        numMainChannels = numSidechainChannels = 0;
+
+        mainInputRing.setSize (0, 0);
+        sidechainInputRing.setSize (0, 0);
+        outputAccumulator.setSize (0, 0);
+
+        lanes.clear();
+        lanes.shrink_to_fit();
+        sharedSidechainFFTData.clear();
+        sharedSidechainFFTData.shrink_to_fit();
+    }
+
+    // 切换到另一种几何并清空状态。不分配内存，可以在音频线程上调用
+    void configure (const StftSettings& newSettings) noexcept
+    {
+        settings = newSettings;
+        fftSize = settings.getFftSize();
+        hopSize = settings.getHopSize();
+        synthesisOffset = fftSize - settings.getLatencySamples();
+
+        const auto orderIndex = settings.fftOrder - StftSettings::minOrder;
+        const auto& tables = engine.getState<SampleType>().windowTables[(size_t) orderIndex];
+
+        fft = engine.fftPlans[orderIndex];
+        processHopFunction = hopFunctions[(size_t) orderIndex];
+        sparseSynthesis = engine.synthesisMode == SynthesisMode::sparseCorrection;
+
+        // 满幅正弦在峰值 bin 上的幅度为 Σw / 2，频谱显示按它归一化
+        SampleType analysisWindowSum;
+
+        if (settings.lowLatency)
+        {
+            analysisWindow = tables.lowLatencyAnalysis[(size_t) settings.overlapIndex].data();
+            synthesisWindow = tables.lowLatencySynthesis[(size_t) settings.overlapIndex].data();
+            analysisWindowSum = tables.lowLatencyAnalysisSum[(size_t) settings.overlapIndex];
+        }
+        else
+        {
+            analysisWindow = tables.analysis[(size_t) settings.windowType].data();
+            synthesisWindow = tables.synthesis[(size_t) settings.windowType][(size_t) settings.overlapIndex].data();
+            analysisWindowSum = tables.analysisSum[(size_t) settings.windowType];
+        }
+
+        spectrumGain = juce::square (2.0f / (float) analysisWindowSum);
+
+        // 新几何直接使用最新的掩码，不做插值
+        releaseMasks();
+        currentMask = engine.maskPublisher.acquire (currentHazard);
+        interpolationSteps = juce::jmax (1, juce::roundToInt (maskInterpolationSeconds * engine.sampleRate / hopSize));
+
+        reset();
+    }
+
+    // 不再处理时放开登记的掩码，让写入端可以复用
+    void releaseMasks() noexcept
+    {
+        engine.maskPublisher.release (firstHazard);
+        engine.maskPublisher.release (firstHazard + 1);
+        currentMask = previousMask = nullptr;
+    }
+
+    void reset() noexcept
+    {
+        // 只有前 fftSize 个样本会被用到
+        mainInputRing.clear (0, fftSize);
+        sidechainInputRing.clear (0, fftSize);
+        outputAccumulator.clear (0, fftSize);
+        ringWritePosition = 0;
+        samplesUntilNextHop = hopSize;
+    }
+
+    // 按 hop 边界切分：每一段整块拷贝进环形缓冲区，凑满一个 hop 就处理一帧
+    void process (juce::AudioBuffer<SampleType>& mainBuffer, int mainStartSample,
+                  const juce::AudioBuffer<SampleType>& sidechainBuffer, int sidechainStartSample, int numSamples) noexcept
+    {
+        for (int position = 0; position < numSamples;)
+        {
+            const int numThisTime = juce::jmin (numSamples - position, samplesUntilNextHop);
+
+            {
+                EXCHANGEBAND_TIME_STAGE (engine.timings, 0, ringFill);
+                exchangeWithRings (mainBuffer, mainStartSample + position, sidechainBuffer, sidechainStartSample + position, numThisTime);
+            }
+
+            position += numThisTime;
+            samplesUntilNextHop -= numThisTime;
+
+            if (samplesUntilNextHop == 0)
+            {
+                (this->*processHopFunction)();
+                samplesUntilNextHop = hopSize;
+            }
+        }
+    }
+
+    //==============================================================================
+    // 一个 lane 处理一个通道所需的全部工作区
+    struct LaneScratch
+    {
+        void allocate (int fftWorkspaceSize)
+        {
+            // RealFft 的变换需要 2 * fftSize 的空间
+            mainFFTData.assign (maxFftSize * 2, 0.0f);
+            sidechainFFTData.assign (maxFftSize * 2, 0.0f);
+            fftWorkspace.assign ((size_t) juce::jmax (1, fftWorkspaceSize), 0.0f);
+            exchangeScratch.assign (maxNumBins * 2, 0.0f);
+            ownScratch.assign (maxNumBins * 2, 0.0f);
+            correction.assign (maxNumBins * 2, 0.0f);
+
+            sidechainMagnitude.assign (maxNumBins, 0.0f);
+            sidechainPhase.assign (maxNumBins, 0.0f);
+            outMagnitude.assign (maxNumBins, 0.0f);
+            outPhase.assign (maxNumBins, 0.0f);
+        }
+
+        // 从环形缓冲区取出的一帧，变换后前 numBins 个交错复数就是频谱；
+        // 交叉合成原地写回 mainFFTData，IFFT 也在这里进行
+        std::vector<float> mainFFTData;
+        std::vector<float> sidechainFFTData;
+        // 后端自己的临时空间（RealFft::getWorkspaceSize()），同一个 plan 在各个 lane 上并发使用
+        std::vector<float> fftWorkspace;
+        // 交换过来的 bin 先累加到这里，插值时新掩码的本位混合写到 ownScratch（都是最多 numBins 个复数）
+        std::vector<float> exchangeScratch;
+        std::vector<float> ownScratch;
+        // 稀疏修正合成：改变的 bin 上交叉合成之前的频谱 X，之后原地换成差值 Y - X（按 bin 下标存放）
+        std::vector<float> correction;
+
+        // 储存fft后幅度和相位信息（只有 polar 模式会更新）：
+        // 主链分解到 outMagnitude / outPhase 后原地做交叉合成
+        std::vector<float> sidechainMagnitude;
+        std::vector<float> sidechainPhase;
+        std::vector<float> outMagnitude;
+        std::vector<float> outPhase;
+
+        // 数值保护的事件计数，只由这个 lane 写入，调用线程在通道处理结束后汇总
+        juce::int64 numFlushedFrames = 0;
+        juce::int64 numNonFiniteResets = 0;
+    };
+
+    StftSettings settings;
+
+    // lane 0 是调用 process() 的线程，getSidechainMagnitude() 等返回它最后处理的那个通道
+    const LaneScratch& getCallerLane() const noexcept   { return lanes.front(); }
+
+    // 把所有 lane 的数值保护计数加到参数上（只在调用线程上、没有通道正在处理时调用）
+    void addGuardCounts (juce::int64& numFlushedFrames, juce::int64& numNonFiniteResets) const noexcept
+    {
+        for (auto& lane : lanes)
+        {
+            numFlushedFrames += lane.numFlushedFrames;
+            numNonFiniteResets += lane.numNonFiniteResets;
+        }
+    }
+
+private:
+    //==============================================================================
+    // 把一段输入写进环形缓冲区，同时从 overlap-add 缓冲区取出同样长度的输出
+    void exchangeWithRings (juce::AudioBuffer<SampleType>& mainBuffer, int mainStartSample,
+                            const juce::AudioBuffer<SampleType>& sidechainBuffer, int sidechainStartSample, int numSamples) noexcept
+    {
+        // 环形缓冲区回绕时分两段拷贝
+        const int numBeforeWrap = juce::jmin (numSamples, fftSize - ringWritePosition);
+        const int numAfterWrap  = numSamples - numBeforeWrap;
+
+        for (int channel = 0; channel < mainBuffer.getNumChannels(); ++channel)
+        {
+            auto* io = mainBuffer.getWritePointer (channel, mainStartSample);
+            auto* ring = mainInputRing.getWritePointer (channel);
+            auto* accumulator = outputAccumulator.getWritePointer (channel);
+
+            if (sparseSynthesis)
+            {
+                // 输出 = 修正量 + 延迟 latency 的干声。干声在环形缓冲区里 ringWritePosition + synthesisOffset 处，
+                // 普通模式下就是这个位置上将要被覆盖的旧样本，所以逐个样本先读后写；
+                // 低延迟模式下它落在 [ringWritePosition - 2 hop, ringWritePosition - hop)，不会与写入的范围重叠
+                for (int i = 0; i < numSamples; ++i)
+                {
+                    const int position = (ringWritePosition + i) & (fftSize - 1);
+                    const auto input = io[i];
+
+                    io[i] = accumulator[position] + ring[(position + synthesisOffset) & (fftSize - 1)];
+                    accumulator[position] = 0;
+                    ring[position] = input;
+                }
+
+                continue;
+            }
+
+            // 先存输入，再用同一位置的 overlap-add 结果覆盖（原地处理）
+            juce::FloatVectorOperations::copy (ring + ringWritePosition, io, numBeforeWrap);
+            juce::FloatVectorOperations::copy (ring, io + numBeforeWrap, numAfterWrap);
+
+            juce::FloatVectorOperations::copy (io, accumulator + ringWritePosition, numBeforeWrap);
+            juce::FloatVectorOperations::copy (io + numBeforeWrap, accumulator, numAfterWrap);
+
+            // 读过的位置清零，留给之后的帧累加
+            juce::FloatVectorOperations::clear (accumulator + ringWritePosition, numBeforeWrap);
+            juce::FloatVectorOperations::clear (accumulator, numAfterWrap);
+        }
+
+        for (int channel = 0; channel < sidechainBuffer.getNumChannels(); ++channel)
+        {
+            const auto* input = sidechainBuffer.getReadPointer (channel, sidechainStartSample);
+            auto* ring = sidechainInputRing.getWritePointer (channel);
+
+            juce::FloatVectorOperations::copy (ring + ringWritePosition, input, numBeforeWrap);
+            juce::FloatVectorOperations::copy (ring, input + numBeforeWrap, numAfterWrap);
+        }
+
+        ringWritePosition = (ringWritePosition + numSamples) & (fftSize - 1);
+    }
+
+    //==============================================================================
+    template <int order>
+    void processHop() noexcept
+    {
+        jassert ((1 << order) == fftSize);
+
+        // 每个 hop 读取一次 STFT 几何，并检查有没有新发布的掩码
+        engine.updateParametersForHop();
+        updateMask();
+
+        if (sparseSynthesis)
+            updateChangedRuns();
+
+        synthesiseThisHop = ! sparseSynthesis || numChangedRuns > 0;
+
+        // 频谱显示只看正在输出的那一套几何；编辑器关闭时这里只有一次原子读取
+        auto& analyser = engine.analyser;
+        analyseThisHop = this == &engine.getActiveSlot<SampleType>() && analyser.beginHop();
+
+        // 单声道（或联动的多声道）侧链每个 hop 只分析一次，所有主链通道共用这一份频谱
+        shareSidechainThisHop = numSidechainChannels <= 1 || engine.currentParameters.sidechainLink;
+        sharedSidechainEnergy = 0.0f;
+
+        if (shareSidechainThisHop && (synthesiseThisHop || analyseThisHop))
+        {
+            EXCHANGEBAND_TIME_STAGE (engine.timings, 0, forwardFft);
+            analyseSharedSidechain<order>();
+        }
+
+        // 多声道且帧足够长时把通道分给工作线程；帧太短时派发的开销比一个通道的处理还大
+        if (order >= minParallelFftOrder)
+            engine.workers.run (&processChannelOnLane<order>, this, numMainChannels);
+        else
+            for (int channel = 0; channel < numMainChannels; ++channel)
+                processChannel<order> (channel, lanes.front(), 0);
+
+        if (analyseThisHop)
+            analyser.endHop (hopSize);
+
+        if (this == &engine.getActiveSlot<SampleType>())
+            ++engine.numHopsProcessed;
+    }
+
+    template <int order>
+    static void processChannelOnLane (void* context, int channel, int lane) noexcept
+    {
+        auto& slot = *static_cast<StftSlot*> (context);
+        slot.template processChannel<order> (channel, slot.lanes[(size_t) lane], lane);
+    }
+
+    // 一个通道的一帧：分析、交叉合成、IFFT（或稀疏修正合成）和 overlap-add。
+    // 只写这个通道自己的 overlap-add 缓冲区和这个 lane 的工作区，不同通道可以并发处理
+    template <int order>
+    void processChannel (int channel, LaneScratch& scratch, int lane) noexcept
+    {
+        constexpr int size = 1 << order;
+        constexpr int bins = size / 2 + 1;
+
+        auto* mainFFTData = scratch.mainFFTData.data();
+        auto* ownSidechainFFTData = scratch.sidechainFFTData.data();
+        const float* sidechainFFTData = shareSidechainThisHop ? sharedSidechainFFTData.data() : ownSidechainFFTData;
+        auto& analyser = engine.analyser;
+        auto& timings = engine.timings;
+        juce::ignoreUnused (timings);
+
+        // 分析：读帧加窗、检查能量、正向 FFT。
+        // 侧链与主链通道一一对应时才在这里各自分析，否则用 processHop() 里分析好的共用频谱
+        {
+            EXCHANGEBAND_TIME_STAGE (timings, lane, forwardFft);
+
+            readFrame<size> (mainInputRing, channel, mainFFTData);
+            const auto mainEnergy = frameEnergy (mainFFTData, size);
+            auto sidechainEnergy = sharedSidechainEnergy;
+
+            // 稀疏合成时掩码不改变任何 bin、也不需要显示频谱：输出就是干声，只检查主链的环形缓冲区
+            // （干声直接从里面读出，NaN / Inf 同样要在被读到之前清掉）
+            const bool needsSpectrum = synthesiseThisHop || analyseThisHop;
+
+            if (! shareSidechainThisHop && needsSpectrum)
+            {
+                readFrame<size> (sidechainInputRing, channel, ownSidechainFFTData);
+                sidechainEnergy = frameEnergy (ownSidechainFFTData, size);
+            }
+
+            // NaN / Inf 只会停留在环形缓冲区里，清空之后的帧就恢复正常；这一帧不输出
+            if (! std::isfinite (mainEnergy + sidechainEnergy))
+            {
+                resetChannel (channel, ! shareSidechainThisHop);
+                ++scratch.numNonFiniteResets;
+                return;
+            }
+
+            if (! needsSpectrum)
+                return;
+
+            // 两路输入都是静音：FFT 结果只会是非规格化数量级的噪声，直接跳过，这一帧对输出的贡献为 0
+            if (mainEnergy < flushEnergy && sidechainEnergy < flushEnergy)
+            {
+                ++scratch.numFlushedFrames;
+                return;
+            }
+
+            fft->forward (mainFFTData, scratch.fftWorkspace.data());
+
+            if (! shareSidechainThisHop)
+                fft->forward (ownSidechainFFTData, scratch.fftWorkspace.data());
+        }
+
+        if (analyseThisHop)
+        {
+            analyser.accumulate (lane, SpectrumAnalyser::mainInput, order, mainFFTData, spectrumGain);
+
+            if (! shareSidechainThisHop)
+                analyser.accumulate (lane, SpectrumAnalyser::sidechainInput, order, ownSidechainFFTData, spectrumGain);
+        }
+
+        // 执行交叉合成，结果原地写回主链的频谱
+        {
+            EXCHANGEBAND_TIME_STAGE (timings, lane, crossSynthesis);
+
+            // 稀疏合成要用到改变之前的值（polar 模式下要在换成幅度 / 相位之前保存）
+            if (sparseSynthesis)
+                copyChangedBins (scratch.correction.data(), mainFFTData);
+
+            if (engine.crossSynthesisMode == CrossSynthesisMode::polar)
+            {
+                auto* outMagnitude = scratch.outMagnitude.data();
+                auto* outPhase = scratch.outPhase.data();
+
+                if (! shareSidechainThisHop)
+                    toInterleavedPolar<bins> (ownSidechainFFTData, scratch.sidechainMagnitude.data(), scratch.sidechainPhase.data());
+
+                // 幅度和相位按 (幅度, 相位) 交错排进 FFT 缓冲区，套用同一个掩码分别混合 / 交换
+                toInterleavedPolar<bins> (mainFFTData, outMagnitude, outPhase);
+
+                crossSynthesis (mainFFTData, sidechainFFTData, scratch);
+
+                deinterleave (mainFFTData, outMagnitude, outPhase, bins);
+                engine.kernels->polarToCartesian (outMagnitude, outPhase, mainFFTData, bins);
+            }
+            else
+            {
+                // 直接在 FFT 输出的交错复数上混合 / 交换，不经过幅度 / 相位
+                crossSynthesis (mainFFTData, sidechainFFTData, scratch);
+            }
+
+            // 确保 DC(0Hz) 和 Nyquist(fftSize/2) 频率的虚部为 0（交换可能把别的 bin 搬到这里）
+            mainFFTData[1] = 0.0f;
+            mainFFTData[2 * (bins - 1) + 1] = 0.0f;
+        }
+
+        if (analyseThisHop)
+            analyser.accumulate (lane, SpectrumAnalyser::output, order, mainFFTData, spectrumGain);
+
+        // 只是为了显示频谱才做的变换
+        if (! synthesiseThisHop)
+            return;
+
+        // 负频率的共轭镜像由 RealFft::inverse 内部处理，
+        // 逆变换结果已经按 1 / fftSize 归一化，前 fftSize 个值就是时域帧
+        {
+            EXCHANGEBAND_TIME_STAGE (timings, lane, inverseFft);
+
+            if (sparseSynthesis)
+                synthesiseCorrection<size> (scratch);
+            else
+                fft->inverse (mainFFTData, scratch.fftWorkspace.data());
+        }
+
+        {
+            EXCHANGEBAND_TIME_STAGE (timings, lane, overlapAdd);
+            overlapAdd<size> (channel, mainFFTData);
+        }
+    }
+
+    // 所有侧链通道的平均（单声道时就是它本身）加窗后做一次 FFT，结果放在 sharedSidechainFFTData。
+    // 只在调用线程上、派发通道之前执行；polar 模式下同时转换成交错的 (幅度, 相位)
+    template <int order>
+    void analyseSharedSidechain() noexcept
+    {
+        constexpr int size = 1 << order;
+        constexpr int bins = size / 2 + 1;
+        auto* data = sharedSidechainFFTData.data();
+
+        // 没有侧链时按静音处理，静音的极坐标形式也是全 0
+        if (numSidechainChannels == 0)
+        {
+            std::fill (data, data + 2 * size, 0.0f);
+            sharedSidechainEnergy = 0.0f;
+            return;
+        }
+
+        readFrame<size> (sidechainInputRing, 0, data);
+
+        for (int channel = 1; channel < numSidechainChannels; ++channel)
+            addFrame<size> (sidechainInputRing, channel, data);
+
+        if (numSidechainChannels > 1)
+            juce::FloatVectorOperations::multiply (data, 1.0f / (float) numSidechainChannels, size);
+
+        // 共用的侧链在派发通道之前检查：有 NaN / Inf 时清空所有侧链通道，各通道按静音的侧链处理
+        sharedSidechainEnergy = frameEnergy (data, size);
+
+        if (! std::isfinite (sharedSidechainEnergy))
+        {
+            for (int channel = 0; channel < numSidechainChannels; ++channel)
+                juce::FloatVectorOperations::clear (sidechainInputRing.getWritePointer (channel), fftSize);
+
+            ++lanes.front().numNonFiniteResets;
+            sharedSidechainEnergy = 0.0f;
+        }
+
+        if (sharedSidechainEnergy < flushEnergy)
+        {
+            std::fill (data, data + 2 * size, 0.0f);
+            return;
+        }
+
+        fft->forward (data, lanes.front().fftWorkspace.data());
+
+        if (analyseThisHop)
+            engine.analyser.accumulate (0, SpectrumAnalyser::sidechainInput, order, data, spectrumGain);
+
+        if (engine.crossSynthesisMode == CrossSynthesisMode::polar)
+        {
+            auto& lane = lanes.front();
+            toInterleavedPolar<bins> (data, lane.sidechainMagnitude.data(), lane.sidechainPhase.data());
+        }
+    }
+
+    // FFT 输出的交错复数原地换成交错的 (幅度, 相位)，幅度和相位另外留一份
+    template <int bins>
+    void toInterleavedPolar (float* data, float* magnitude, float* phase) const noexcept
+    {
+        engine.kernels->cartesianToPolar (data, magnitude, phase, bins);
+        interleave (magnitude, phase, data, bins);
+    }
+
+    // 一个通道的输入里出现了 NaN / Inf：清空它自己的环形缓冲区和 overlap-add 缓冲区。
+    // 共用的侧链不在这里清空（见 analyseSharedSidechain()），不同通道可以并发调用
+    void resetChannel (int channel, bool includingSidechain) noexcept
+    {
+        juce::FloatVectorOperations::clear (mainInputRing.getWritePointer (channel), fftSize);
+        juce::FloatVectorOperations::clear (outputAccumulator.getWritePointer (channel), fftSize);
+
+        if (includingSidechain)
+            juce::FloatVectorOperations::clear (sidechainInputRing.getWritePointer (channel), fftSize);
+    }
+
+    template <int size>
+    void readFrame (const juce::AudioBuffer<SampleType>& ring, int channel, float* destination) const noexcept
+    {
+        // ringWritePosition 处是最旧的样本，把环形缓冲区展开成按时间排列的一帧并加分析窗
+        const auto* source = ring.getReadPointer (channel);
+        const int numToEnd = size - ringWritePosition;
+
+        windowIntoFrame (destination, source + ringWritePosition, analysisWindow, numToEnd);
+        windowIntoFrame (destination + numToEnd, source, analysisWindow + numToEnd, ringWritePosition);
+    }
+
+    // 与 readFrame() 相同，但累加到 destination 上
+    template <int size>
+    void addFrame (const juce::AudioBuffer<SampleType>& ring, int channel, float* destination) const noexcept
+    {
+        const auto* source = ring.getReadPointer (channel);
+        const int numToEnd = size - ringWritePosition;
+
+        addWindowedSamples (destination, source + ringWritePosition, analysisWindow, numToEnd);
+        addWindowedSamples (destination + numToEnd, source, analysisWindow + numToEnd, ringWritePosition);
+    }
+
+    template <int size>
+    void overlapAdd (int channel, const float* timeFrame) noexcept
+    {
+        // 加合成窗（已包含 overlap-add 归一化）后累加到输出缓冲区。合成窗在 synthesisOffset 之前全为 0，
+        // 只累加之后的部分：帧的第 synthesisOffset 个样本对应 ringWritePosition，紧接着就会被读出，
+        // 所以整体延迟为 fftSize - synthesisOffset（普通模式 fftSize，低延迟模式 2 * hop）
+        auto* accumulator = outputAccumulator.getWritePointer (channel);
+        const auto* frame = timeFrame + synthesisOffset;
+        const auto* window = synthesisWindow + synthesisOffset;
+        const int length = size - synthesisOffset;
+        const int numToEnd = juce::jmin (length, size - ringWritePosition);
+
+        addWindowedFrame (accumulator + ringWritePosition, frame, window, numToEnd);
+        addWindowedFrame (accumulator, frame + numToEnd, window + numToEnd, length - numToEnd);
+    }
+
+    static void interleave (const float* first, const float* second, float* destination, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            destination[2 * bin]     = first[bin];
+            destination[2 * bin + 1] = second[bin];
+        }
+    }
+
+    static void deinterleave (const float* source, float* first, float* second, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            first[bin]  = source[2 * bin];
+            second[bin] = source[2 * bin + 1];
+        }
+    }
+
+    //==============================================================================
+    // 稀疏修正合成：这个 hop 要合成的 bin（插值期间为新旧掩码的并集），以及用振荡器组还是 IFFT
+    void updateChangedRuns() noexcept
+    {
+        numChangedRuns = 0;
+        numChangedBins = 0;
+
+        if (currentMask == nullptr)
+            return;
+
+        const auto& mask = currentMask->getMask (settings.fftOrder);
+        const auto* oldMask = previousMask != nullptr ? &previousMask->getMask (settings.fftOrder) : nullptr;
+        const int numNew = mask.numChangedRuns;
+        const int numOld = oldMask != nullptr ? oldMask->numChangedRuns : 0;
+
+        // 两个掩码的区段都按频率排列，按起点顺序归并，重叠或相邻的合并成一段
+        for (int i = 0, j = 0; i < numNew || j < numOld;)
+        {
+            const auto& run = (j >= numOld || (i < numNew && mask.changedRuns[(size_t) i].firstBin <= oldMask->changedRuns[(size_t) j].firstBin))
+                                ? mask.changedRuns[(size_t) i++]
+                                : oldMask->changedRuns[(size_t) j++];
+
+            if (numChangedRuns > 0)
+            {
+                auto& last = changedRuns[(size_t) (numChangedRuns - 1)];
+
+                if (run.firstBin <= last.firstBin + last.numBins)
+                {
+                    last.numBins = juce::jmax (last.numBins, run.firstBin + run.numBins - last.firstBin);
+                    continue;
+                }
+            }
+
+            changedRuns[(size_t) numChangedRuns++] = run;
+        }
+
+        for (int i = 0; i < numChangedRuns; ++i)
+            numChangedBins += changedRuns[(size_t) i].numBins;
+
+        const auto oscillatorCost = (float) numChangedBins * (float) (fftSize - synthesisOffset) * oscillatorCostRatio;
+        oscillatorsThisHop = oscillatorCost < (float) (fftSize * settings.fftOrder);
+    }
+
+    // 改变的 bin 从 source 拷贝到 destination 的同一位置（交错复数）
+    void copyChangedBins (float* destination, const float* source) const noexcept
+    {
+        for (int i = 0; i < numChangedRuns; ++i)
+        {
+            const auto& run = changedRuns[(size_t) i];
+            juce::FloatVectorOperations::copy (destination + 2 * run.firstBin, source + 2 * run.firstBin, 2 * run.numBins);
+        }
+    }
+
+    // 交叉合成之后的 mainFFTData 换成修正量的时域帧：只有 [synthesisOffset, size) 有效，之前的部分合成窗为 0
+    template <int size>
+    void synthesiseCorrection (LaneScratch& scratch) noexcept
+    {
+        auto* frame = scratch.mainFFTData.data();
+        auto* difference = scratch.correction.data();
+
+        // 差值 Y - X，改变的 bin 之外都是 0
+        for (int i = 0; i < numChangedRuns; ++i)
+        {
+            const auto& run = changedRuns[(size_t) i];
+            juce::FloatVectorOperations::subtract (difference + 2 * run.firstBin, frame + 2 * run.firstBin,
+                                                   difference + 2 * run.firstBin, 2 * run.numBins);
+        }
+
+        if (oscillatorsThisHop)
+        {
+            synthesiseWithOscillators<size> (difference, frame);
+            return;
+        }
+
+        std::fill (frame, frame + size + 2, 0.0f);
+        copyChangedBins (frame, difference);
+        fft->inverse (frame, scratch.fftWorkspace.data());
+    }
+
+    // 振荡器组：frame[n] = Σ c_k / size · Re (D_k e^{2πi k n / size})，n ∈ [synthesisOffset, size)，
+    // DC 和 Nyquist 的 c_k = 1，其余为 2（负频率的共轭镜像），与 IFFT 的结果相同。
+    // 每 blockLength 个样本查一次表得到起点的相位，块内乘上预先算好的 e^{2πi k j / size}，
+    // 内层循环是对连续样本的乘加，可以直接向量化，相位误差也不会随样本数累积
+    template <int size>
+    void synthesiseWithOscillators (const float* difference, float* frame) const noexcept
+    {
+        constexpr int blockLength = 16;
+        constexpr int tableStride = maxFftSize / size;
+        const auto* cosTable = engine.oscillatorCos.data();
+        const auto* sinTable = engine.oscillatorSin.data();
+        jassert (synthesisOffset % blockLength == 0);
+
+        std::fill (frame + synthesisOffset, frame + size, 0.0f);
+
+        for (int i = 0; i < numChangedRuns; ++i)
+        {
+            const auto& run = changedRuns[(size_t) i];
+
+            for (int bin = run.firstBin; bin < run.firstBin + run.numBins; ++bin)
+            {
+                const auto gain = (bin == 0 || bin == size / 2 ? 1.0f : 2.0f) / (float) size;
+                const auto real = difference[2 * bin] * gain;
+                const auto imag = difference[2 * bin + 1] * gain;
+
+                if (real == 0.0f && imag == 0.0f)
+                    continue;
+
+                float stepCos[blockLength], stepSin[blockLength];
+
+                for (int j = 0; j < blockLength; ++j)
+                {
+                    const auto index = ((bin * j) & (size - 1)) * tableStride;
+                    stepCos[j] = cosTable[index];
+                    stepSin[j] = sinTable[index];
+                }
+
+                for (int start = synthesisOffset; start < size; start += blockLength)
+                {
+                    const auto index = ((bin * start) & (size - 1)) * tableStride;
+                    const auto blockReal = real * cosTable[index] - imag * sinTable[index];
+                    const auto blockImag = real * sinTable[index] + imag * cosTable[index];
+                    auto* destination = frame + start;
+
+                    for (int j = 0; j < blockLength; ++j)
+                        destination[j] += blockReal * stepCos[j] - blockImag * stepSin[j];
+                }
+            }
+        }
+    }
+
+    //==============================================================================
+    // 每个 hop 调用一次：上一次插值结束后才换用更新的掩码，
+    // 换用时旧掩码继续登记在另一个 hazard 槽位里，直到插值结束
+    void updateMask() noexcept
+    {
+        auto& publisher = engine.maskPublisher;
+
+        if (previousMask != nullptr && ++interpolationStep >= interpolationSteps - 1)
+        {
+            publisher.release (currentHazard ^ 1);
+            previousMask = nullptr;
+        }
+
+        if (previousMask != nullptr)
+            return;
+
+        const int freeHazard = currentHazard ^ 1;
+        const auto* latest = publisher.acquire (freeHazard);
+
+        if (latest == currentMask)
+        {
+            publisher.release (freeHazard);
+            return;
+        }
+
+        previousMask = currentMask;
+        currentMask = latest;
+        currentHazard = freeHazard;
+        interpolationStep = 0;
+
+        if (previousMask != nullptr && interpolationSteps <= 1)
+        {
+            publisher.release (currentHazard ^ 1);
+            previousMask = nullptr;
+        }
+    }
+
+    //==============================================================================
+    // 按频谱掩码原地修改主链频谱 data（交错的 re / im，或 polar 模式下交错的幅度 / 相位）。
+    // 只访问掩码覆盖的 bin，每一段都是一次逐元素乘加；插值期间新旧掩码各算一遍再按 alpha 混合
+    void crossSynthesis (float* data, const float* sidechainData, LaneScratch& lane) noexcept
+    {
+        if (currentMask == nullptr)
+            return;
+
+        const auto& mask = currentMask->getMask (settings.fftOrder);
+        const auto* oldMask = previousMask != nullptr ? &previousMask->getMask (settings.fftOrder) : nullptr;
+        const auto alpha = oldMask != nullptr ? (float) (interpolationStep + 1) / (float) interpolationSteps : 1.0f;
+        const auto& kernels = *engine.kernels;
+
+        // 1) 交换层要读其他位置上主链的原始值，先全部累加进 scratch，
+        //    这样后面原地修改时不会读到已经改过的 bin
+        int layerFirst = mask.firstLayerBin, layerEnd = mask.firstLayerBin + mask.numLayerBins;
+
+        if (oldMask != nullptr && oldMask->numLayerBins > 0)
+        {
+            layerFirst = mask.numLayerBins > 0 ? juce::jmin (layerFirst, oldMask->firstLayerBin) : oldMask->firstLayerBin;
+            layerEnd = juce::jmax (layerEnd, oldMask->firstLayerBin + oldMask->numLayerBins);
+        }
+
+        auto* scratch = lane.exchangeScratch.data();  // 第 0 个复数对应 layerFirst
+
+        if (layerEnd > layerFirst)
+        {
+            juce::FloatVectorOperations::clear (scratch, 2 * (layerEnd - layerFirst));
+
+            const auto accumulateLayers = [&] (const SpectralMask& m, float weight)
+            {
+                for (int i = 0; i < m.numLayers; ++i)
+                {
+                    const auto& layer = m.layers[(size_t) i];
+                    const int source = 2 * (layer.firstBin + layer.sourceOffset);
+
+                    kernels.accumulateWithGains (scratch + 2 * (layer.firstBin - layerFirst), data + source, layer.mainGain,
+                                                 sidechainData + source, layer.sidechainGain, weight, 2 * layer.numBins);
+                }
+            };
+
+            accumulateLayers (mask, alpha);
+
+            if (oldMask != nullptr)
+                accumulateLayers (*oldMask, 1.0f - alpha);
+        }
+
+        // 2) 本位混合只读写自己的 bin，直接原地进行
+        // destination 的第 0 个复数对应 destinationFirstBin
+        const auto applyOwn = [&] (const SpectralMask& m, float* destination, int destinationFirstBin)
+        {
+            if (m.numBins > 0)
+                kernels.blendWithGains (destination + 2 * (m.firstBin - destinationFirstBin), destination + 2 * (m.firstBin - destinationFirstBin),
+                                        m.mainGain, sidechainData + 2 * m.firstBin, m.sidechainGain, 2 * m.numBins);
+        };
+
+        if (oldMask == nullptr)
+        {
+            applyOwn (mask, data, 0);
+        }
+        else if (mask.numBins > 0 || oldMask->numBins > 0)
+        {
+            // 两个掩码覆盖范围的并集：新掩码作用在拷贝上，旧掩码原地作用，再按 alpha 混合
+            const int first = mask.numBins > 0 && oldMask->numBins > 0 ? juce::jmin (mask.firstBin, oldMask->firstBin)
+                                                                       : (mask.numBins > 0 ? mask.firstBin : oldMask->firstBin);
+            const int end = juce::jmax (mask.firstBin + mask.numBins, oldMask->firstBin + oldMask->numBins);
+            auto* copy = lane.ownScratch.data();
+
+            juce::FloatVectorOperations::copy (copy, data + 2 * first, 2 * (end - first));
+            applyOwn (mask, copy, first);
+            applyOwn (*oldMask, data, 0);
+
+            juce::FloatVectorOperations::multiply (data + 2 * first, 1.0f - alpha, 2 * (end - first));
+            juce::FloatVectorOperations::addWithMultiply (data + 2 * first, copy, alpha, 2 * (end - first));
+        }
+
+        // 3) 把交换过来的内容加回去
+        if (layerEnd > layerFirst)
+            juce::FloatVectorOperations::add (data + 2 * layerFirst, scratch, 2 * (layerEnd - layerFirst));
+    }
+
+    //==============================================================================
+    using HopFunction = void (StftSlot::*)() noexcept;
+
+    // 下标为 fftOrder - StftSettings::minOrder
+    static constexpr std::array<HopFunction, StftSettings::numOrders> hopFunctions
+    {
+        &StftSlot::processHop<8>,  &StftSlot::processHop<9>,  &StftSlot::processHop<10>, &StftSlot::processHop<11>,
+        &StftSlot::processHop<12>, &StftSlot::processHop<13>, &StftSlot::processHop<14>, &StftSlot::processHop<15>
+    };
+
+    static_assert (StftSettings::minOrder == 8 && StftSettings::maxOrder == 15, "hopFunctions 需要与支持的 FFT 阶数一致");
+
+    //==============================================================================
+    ExchangeBandEngine& engine;
+
+    int fftSize = 0;
+    int hopSize = 0;
+    int synthesisOffset = 0;           // 合成窗第一个非零样本的位置，等于 fftSize - 延迟
+    const RealFft* fft = nullptr;
+    const SampleType* analysisWindow = nullptr;
+    const SampleType* synthesisWindow = nullptr;
+    float spectrumGain = 1.0f;         // 频谱显示的功率归一化系数
+    HopFunction processHopFunction = nullptr;
+    bool sparseSynthesis = false;      // configure() 时从 engine.synthesisMode 取得
+
+    // 当前使用的掩码和插值期间正在淡出的掩码，分别登记在 currentHazard 和 currentHazard ^ 1
+    const int firstHazard;
+    int currentHazard;
+    const SpectralMaskSet* currentMask = nullptr;
+    const SpectralMaskSet* previousMask = nullptr;
+    int interpolationStep = 0;
+    int interpolationSteps = 1;
+
+    // 下标为 lane，大小为 engine.workers.getNumLanes()
+    std::vector<LaneScratch> lanes;
+    bool analyseThisHop = false;       // 派发通道之前写好，处理通道时只读
+    bool shareSidechainThisHop = false;
+    bool synthesiseThisHop = true;     // 稀疏合成且掩码不改变任何 bin 时为 false
+
+    // 稀疏修正合成这个 hop 要合成的 bin 区段（updateChangedRuns() 写好，处理通道时只读）
+    std::array<SpectralMask::BinRun, 2 * SpectralMask::maxChangedRuns> changedRuns;
+    int numChangedRuns = 0;
+    int numChangedBins = 0;
+    bool oscillatorsThisHop = false;
+
+    // 单声道 / 联动侧链每个 hop 共用的一份频谱（polar 模式下为交错的幅度 / 相位），处理通道时只读
+    std::vector<float> sharedSidechainFFTData;
+    float sharedSidechainEnergy = 0.0f;
+
+    // 每个通道各自的输入环形缓冲区和 overlap-add 输出缓冲区
+    int numMainChannels = 0;
+    int numSidechainChannels = 0;
+    juce::AudioBuffer<SampleType> mainInputRing;
+    juce::AudioBuffer<SampleType> sidechainInputRing;
+    juce::AudioBuffer<SampleType> outputAccumulator;
+    int ringWritePosition = 0;         // 所有通道共用的写入位置
+    int samplesUntilNextHop = 0;
+
+    JUCE_DECLARE_NON_COPYABLE (StftSlot)
+};
+
+//==============================================================================
+ExchangeBandEngine::ExchangeBandEngine()
+    : kernels (&SpectralKernels::getBestTable (SpectralKernels::Accuracy::exact))
+{
+    // 两种精度的 slot 共用同一组 hazard 槽位，同一时间只有一种精度在用
+    for (size_t i = 0; i < 2; ++i)
+    {
+        singleState.slots[i] = std::make_unique<StftSlot<float>> (*this, (int) i);
+        doubleState.slots[i] = std::make_unique<StftSlot<double>> (*this, (int) i);
+    }
+}
+
+ExchangeBandEngine::~ExchangeBandEngine()
+{
+}
+
+//==============================================================================
+void ExchangeBandEngine::prepare (double newSampleRate, int maximumBlockSize, int numChannels, int numSidechainChannelsToUse,
+                                  ProcessingPrecision newPrecision)
+{
+    jassert (numChannels > 0 && numChannels <= maxChannels);
+    jassert (numSidechainChannelsToUse == 0 || numSidechainChannelsToUse == 1 || numSidechainChannelsToUse == numChannels);
+
+    // 后台线程用旧采样率编译的掩码不能再发布
+    maskPublisher.stopWatching();
+
+    sampleRate = newSampleRate; // 存储采样率
+    numMainChannels = numChannels;
+    numSidechainChannels = numSidechainChannelsToUse;
+    precision = newPrecision;
+
+    // 每个 lane 至少分到 channelsPerLane 个通道才值得派发，立体声及以下全部在调用线程上处理
+    const auto numWorkers = juce::jmin (maxWorkerThreads, juce::SystemStats::getNumCpus() - 1,
+                                        (numMainChannels - 1) / channelsPerLane);
+    workers.setNumWorkers (juce::jmax (0, numWorkers));
+
+    buildPlans();
+    analyser.prepare (sampleRate, workers.getNumLanes());
+
+    // 只为用到的精度生成窗表、分配缓冲区，另一种精度的缓冲区释放掉
+    const auto allocateState = [this, maximumBlockSize] (auto& state)
+    {
+        buildWindows (state);
+
+        for (auto& slot : state.slots)
+            slot->allocate (numMainChannels, numSidechainChannels);
+
+        // 几何切换期间 incoming slot 在这里处理一份输入的拷贝
+        state.transitionBuffer.setSize (numMainChannels, juce::jmax (1, maximumBlockSize));
+        state.alignmentDelay.setSize (numMainChannels, maxFftSize + juce::jmax (1, maximumBlockSize));
+
+        // 延迟线先写后读，要同时容纳最大的延迟和一整个 block
+        state.dryDelay.setSize (numMainChannels, maxFftSize + juce::jmax (1, maximumBlockSize));
+        state.dryBuffer.setSize (numMainChannels, juce::jmax (1, maximumBlockSize));
+    };
+
+    const auto releaseState = [] (auto& state)
+    {
+        for (auto& slot : state.slots)
+            slot->releaseBuffers();
+
+        state.transitionBuffer.setSize (0, 0);
+        state.alignmentDelay.setSize (0, 0);
+        state.dryDelay.setSize (0, 0);
+        state.dryBuffer.setSize (0, 0);
+    };
+
+    if (precision == ProcessingPrecision::doublePrecision)
+    {
+        releaseState (singleState);
+        allocateState (doubleState);
+    }
+    else
+    {
+        releaseState (doubleState);
+        allocateState (singleState);
+    }
+
+    reset();
+
+    if (parameterSource.isValid())
+        maskPublisher.startWatching (parameterSource, sampleRate);
+}
+
+void ExchangeBandEngine::buildPlans()
+{
+    // 与采样率无关，只有选用的后端变了才重新生成
+    static_assert (StftSettings::minOrder == RealFft::minBenchmarkOrder && StftSettings::maxOrder == RealFft::maxBenchmarkOrder,
+                   "RealFft 需要测量所有支持的 FFT 阶数");
+
+    fftWorkspaceSize = 0;
+
+    for (int order = StftSettings::minOrder; order <= StftSettings::maxOrder; ++order)
+    {
+        const auto index = order - StftSettings::minOrder;
+        const auto backend = fftBackendForced ? forcedFftBackend : RealFft::getFastestBackend (order);
+
+        if (index >= fftPlans.size() || fftPlans[index]->getBackend() != backend)
+            fftPlans.set (index, RealFft::create (backend, order).release());
+
+        fftWorkspaceSize = juce::jmax (fftWorkspaceSize, fftPlans[index]->getWorkspaceSize());
+    }
+
+    if (oscillatorCos.empty())
+    {
+        oscillatorCos.resize ((size_t) maxFftSize);
+        oscillatorSin.resize ((size_t) maxFftSize);
+
+        for (int i = 0; i < maxFftSize; ++i)
+        {
+            const auto phase = juce::MathConstants<double>::twoPi * (double) i / (double) maxFftSize;
+            oscillatorCos[(size_t) i] = (float) std::cos (phase);
+            oscillatorSin[(size_t) i] = (float) std::sin (phase);
+        }
+    }
+}
+
+RealFft::Backend ExchangeBandEngine::getFftBackend (int fftOrder) const noexcept
+{
+    const auto index = juce::jlimit (StftSettings::minOrder, StftSettings::maxOrder, fftOrder) - StftSettings::minOrder;
+
+    if (index < fftPlans.size())
+        return fftPlans[index]->getBackend();
+
+    return fftBackendForced ? forcedFftBackend : RealFft::Backend::juce;
+}
+
+template <typename SampleType>
+void ExchangeBandEngine::buildWindows (PrecisionState<SampleType>& state)
+{
+    // 与采样率无关，每种精度只需生成一次；都在 double 下计算再转换
+    if (! state.windowTables[0].analysis[0].empty())
+        return;
+
+    for (int order = StftSettings::minOrder; order <= StftSettings::maxOrder; ++order)
+    {
+        const int size = 1 << order;
+        auto& tables = state.windowTables[(size_t) (order - StftSettings::minOrder)];
+
+        for (int windowType = 0; windowType < StftSettings::numWindowTypes; ++windowType)
+        {
+            // 周期窗（分母为 size），保证平移 hop 后能精确重叠
+            auto& analysis = tables.analysis[(size_t) windowType];
+            analysis.resize ((size_t) size);
+
+            for (int i = 0; i < size; ++i)
+            {
+                const auto x = juce::MathConstants<double>::twoPi * (double) i / (double) size;
+                const auto hann = 0.5 - 0.5 * std::cos (x);
+                double value = hann;
+
+                if (windowType == StftSettings::sqrtHann)
+                    value = std::sqrt (hann);
+                else if (windowType == StftSettings::blackmanHarris)
+                    value = 0.35875 - 0.48829 * std::cos (x) + 0.14128 * std::cos (2.0 * x) - 0.01168 * std::cos (3.0 * x);
+
+                analysis[(size_t) i] = (SampleType) value;
+            }
+
+            tables.analysisSum[(size_t) windowType] = std::accumulate (analysis.begin(), analysis.end(), (SampleType) 0);
+
+            // 合成窗与分析窗相同，再除以同一输出位置上所有重叠帧的 wa·ws 之和，
+            // 这样任意窗类型和重叠倍数都能完美重建（sqrt-Hann 时就是常数 hop / Σ wa·ws）
+            for (int overlapIndex = 0; overlapIndex < StftSettings::numOverlapChoices; ++overlapIndex)
+            {
+                const int hop = size / (2 << overlapIndex);
+                auto& synthesis = tables.synthesis[(size_t) windowType][(size_t) overlapIndex];
+                synthesis = analysis;
+
+                for (int offset = 0; offset < hop; ++offset)
+                {
+                    double sum = 0.0;
+
+                    for (int i = offset; i < size; i += hop)
+                        sum += (double) analysis[(size_t) i] * (double) analysis[(size_t) i];
+
+                    for (int i = offset; i < size; i += hop)
+                        synthesis[(size_t) i] = (SampleType) (synthesis[(size_t) i] / sum);
+                }
+            }
+        }
+
+        // 低延迟模式的非对称窗（Mauler & Martin, 2011），M = hop：
+        //   分析窗 = 长度 2 (size - M) 的 sqrt-Hann 上升沿 + 长度 2M 的 sqrt-Hann 下降沿（最后 M 个样本）
+        //   合成窗 = 最后 2M 个样本上的 Hann_2M / 分析窗，之前全为 0
+        // 两者乘积恰好是帧末尾的 Hann_2M，按 hop = M 平移相加为 1，所以延迟只有 2M。
+        // 重叠 50% 时 2M = size，退化为普通的 sqrt-Hann
+        for (int overlapIndex = 0; overlapIndex < StftSettings::numOverlapChoices; ++overlapIndex)
+        {
+            const int hop = size / (2 << overlapIndex);
+            const int riseLength = size - hop;
+            const int synthesisStart = size - 2 * hop;
+
+            auto& analysis = tables.lowLatencyAnalysis[(size_t) overlapIndex];
+            auto& synthesis = tables.lowLatencySynthesis[(size_t) overlapIndex];
+            analysis.assign ((size_t) size, (SampleType) 0);
+            synthesis.assign ((size_t) size, (SampleType) 0);
+
+            const auto periodicHann = [] (int i, int length)
+            {
+                return 0.5 - 0.5 * std::cos (juce::MathConstants<double>::twoPi * (double) i / (double) length);
+            };
+
+            for (int i = 0; i < size; ++i)
+            {
+                const auto a = i < riseLength ? std::sqrt (periodicHann (i, 2 * riseLength))
+                                              : std::sqrt (periodicHann (i - synthesisStart, 2 * hop));
+                analysis[(size_t) i] = (SampleType) a;
+
+                if (i >= synthesisStart && a > 0.0)
+                    synthesis[(size_t) i] = (SampleType) (periodicHann (i - synthesisStart, 2 * hop) / a);
+            }
+
+            tables.lowLatencyAnalysisSum[(size_t) overlapIndex] = std::accumulate (analysis.begin(), analysis.end(), (SampleType) 0);
+        }
+    }
+}
+
+void ExchangeBandEngine::reset()
+{
+    if (fftPlans.isEmpty())
+        return;
+
+    // 音频回调停止时直接切到参数里的几何，不做交叉淡化；掩码也在这里同步编译好
+    if (parameterSource.isValid())
+        setParameters (parameterSource.load());
+    else
+        maskPublisher.compile (currentParameters, sampleRate);
+
+    transitionInProgress = false;
+    transitionLatencySwitched = false;
+
+    withActiveState ([this] (auto& state)
+    {
+        state.slots[(size_t) (1 - activeSlot)]->releaseMasks();
+        state.slots[(size_t) activeSlot]->configure (currentParameters.stft);
+    });
+
+    resetIdleState();
+    numHopsProcessed = 0;
+}
+
+void ExchangeBandEngine::clearState() noexcept
+{
+    if (fftPlans.isEmpty())
+        return;
+
+    updateParametersForHop();
+    transitionInProgress = false;
+    transitionLatencySwitched = false;
+
+    withActiveState ([this] (auto& state)
+    {
+        state.slots[(size_t) (1 - activeSlot)]->releaseMasks();
+        state.slots[(size_t) activeSlot]->configure (currentParameters.stft);
+    });
+
+    resetIdleState();
+}
+
+void ExchangeBandEngine::resetIdleState() noexcept
+{
+    // 没有侧链时从一开始就是旁路，不经过 STFT 也不需要淡化
+    stftRunning = numSidechainChannels > 0;
+    wetGain = stftRunning ? 1.0f : 0.0f;
+    warmUpSamplesRemaining = 0;
+    quietSamples = 0;
+    dryDelayWritePosition = 0;
+
+    withActiveState ([] (auto& state) { state.dryDelay.clear(); });
+}
+
+void ExchangeBandEngine::setKernels (SpectralKernels::Accuracy accuracy, bool useScalarReference) noexcept
+{
+    kernels = useScalarReference ? &SpectralKernels::getScalarTable (accuracy)
+                                 : &SpectralKernels::getBestTable (accuracy);
+}
+
+void ExchangeBandEngine::setParameters (const ExchangeBandParameters& newParameters)
+{
+    currentParameters = newParameters;
+    currentParameters.stft = currentParameters.stft.withLegalValues();
+
+    // 频段表没变时 compile() 直接返回
+    if (sampleRate > 0.0)
+        maskPublisher.compile (currentParameters, sampleRate);
+}
+
+void ExchangeBandEngine::setParameterSource (const ExchangeBandParameterPointers& newSource)
+{
+    parameterSource = newSource;
+
+    // 已经 prepare() 过时立刻开始监视，否则等 prepare()
+    if (parameterSource.isValid() && ! fftPlans.isEmpty())
+        maskPublisher.startWatching (parameterSource, sampleRate);
+    else
+        maskPublisher.stopWatching();
+}
+
+void ExchangeBandEngine::updateParametersForHop() noexcept
+{
+    if (parameterSource.isValid())
+    {
+        currentParameters.stft = parameterSource.loadStftSettings();
+        currentParameters.sidechainLink = parameterSource.loadSidechainLink();
+    }
+}
+
+const StftSettings& ExchangeBandEngine::getActiveStftSettings() const noexcept
+{
+    return withActiveState ([this] (auto& state) -> const StftSettings& { return state.slots[(size_t) activeSlot]->settings; });
+}
+
+const StftSettings& ExchangeBandEngine::getOutputStftSettings() const noexcept
+{
+    if (! (transitionInProgress && transitionLatencySwitched))
+        return getActiveStftSettings();
+
+    return withActiveState ([this] (auto& state) -> const StftSettings& { return state.slots[(size_t) (1 - activeSlot)]->settings; });
+}
+
+const std::vector<float>& ExchangeBandEngine::getSidechainMagnitude() const noexcept
+{
+    return withActiveState ([this] (auto& state) -> const std::vector<float>& { return state.slots[(size_t) activeSlot]->getCallerLane().sidechainMagnitude; });
+}
+
+const std::vector<float>& ExchangeBandEngine::getOutputMagnitude() const noexcept
+{
+    return withActiveState ([this] (auto& state) -> const std::vector<float>& { return state.slots[(size_t) activeSlot]->getCallerLane().outMagnitude; });
+}
+
+//==============================================================================
+void ExchangeBandEngine::process (juce::AudioBuffer<float>& mainBuffer, const juce::AudioBuffer<float>& sidechainBuffer)
+{
+    jassert (precision == ProcessingPrecision::singlePrecision);
+    EXCHANGEBAND_REALTIME_SECTION();
+    const juce::ScopedNoDenormals noDenormals;
+    EXCHANGEBAND_TIME_BLOCK (timings, mainBuffer.getNumSamples(), sampleRate);
+    processBlock (mainBuffer, sidechainBuffer);
+}
+
+void ExchangeBandEngine::process (juce::AudioBuffer<double>& mainBuffer, const juce::AudioBuffer<double>& sidechainBuffer)
+{
+    jassert (precision == ProcessingPrecision::doublePrecision);
+    EXCHANGEBAND_REALTIME_SECTION();
+    const juce::ScopedNoDenormals noDenormals;
+    EXCHANGEBAND_TIME_BLOCK (timings, mainBuffer.getNumSamples(), sampleRate);
+    processBlock (mainBuffer, sidechainBuffer);
+}
+
+template <typename SampleType>
+void ExchangeBandEngine::processBlock (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer)
+{
+    const int numSamples = mainBuffer.getNumSamples();
+    jassert (mainBuffer.getNumChannels() <= numMainChannels);
+    jassert (sidechainBuffer.getNumChannels() <= juce::jmax (1, numSidechainChannels));
+
+    // 输入电平要在原地处理之前测
+    auto& meterData = meters.getWriteBuffer();
+    meterData.numChannels = juce::jmin (mainBuffer.getNumChannels(), ExchangeBandMeters::maxChannels);
+
+    for (int channel = 0; channel < meterData.numChannels; ++channel)
+    {
+        meterData.mainPeak[(size_t) channel] = (float) mainBuffer.getMagnitude (channel, 0, numSamples);
+        meterData.sidechainPeak[(size_t) channel] = channel < sidechainBuffer.getNumChannels() ? (float) sidechainBuffer.getMagnitude (channel, 0, numSamples) : 0.0f;
+    }
+
+    // 侧链静音持续一个尾音长度之后，STFT 的输出里已经没有侧链的贡献，再等到 idleHoldSeconds
+    // 才淡化到延迟线，避免在两次侧链触发之间来回切换；几何切换进行中不进入旁路
+    const int holdSamples = numSidechainChannels > 0 ? juce::jmax (getTailSamples(), juce::roundToInt (idleHoldSeconds * sampleRate)) : 0;
+    quietSamples = isSidechainIdle (sidechainBuffer, numSamples) ? juce::jmin (quietSamples + numSamples, holdSamples) : 0;
+    const bool wantsStft = quietSamples < holdSamples || transitionInProgress;
+
+    if (! stftRunning)
+    {
+        // 暂停期间没有 hop 读取参数，改为每个 block 读一次，延迟线的长度跟着参数里的几何走。
+        // 重新启动时从空的环形缓冲区开始，预热一个尾音长度之后输出才完整，这段时间仍然输出延迟线
+        updateParametersForHop();
+        auto& slot = getActiveSlot<SampleType>();
+
+        if (wantsStft || currentParameters.stft != slot.settings)
+            slot.configure (currentParameters.stft);
+
+        if (wantsStft)
+        {
+            warmUpSamplesRemaining = getTailSamples();
+            stftRunning = true;
+        }
+    }
+
+    const bool fullyWet = stftRunning && wantsStft && wetGain >= 1.0f && warmUpSamplesRemaining == 0;
+    delayDry (mainBuffer, ! fullyWet);
+
+    if (stftRunning)
+    {
+        // 上一个 block 里读到的 STFT 几何与当前不同时，从这个 block 开始切换；
+        // 与延迟线之间淡化（包括重新启动后的预热）时不切换，延迟线一直按同一个延迟对齐，
+        // 暂停之后直接换成新几何
+        if (fullyWet && ! transitionInProgress && currentParameters.stft != getActiveSlot<SampleType>().settings)
+            beginTransition<SampleType> (currentParameters.stft);
+
+        if (transitionInProgress)
+            processTransition (mainBuffer, sidechainBuffer);
+        else
+            getActiveSlot<SampleType>().process (mainBuffer, 0, sidechainBuffer, 0, numSamples);
+    }
+
+    if (! fullyWet)
+        mixDelayedDry (mainBuffer, wantsStft);
+
+    // 完全淡化到延迟线之后，从下一个 block 开始跳过 STFT
+    if (! wantsStft && wetGain <= 0.0f && ! transitionInProgress)
+        stftRunning = false;
+
+    for (int channel = 0; channel < meterData.numChannels; ++channel)
+        meterData.outputPeak[(size_t) channel] = (float) mainBuffer.getMagnitude (channel, 0, numSamples);
+
+    meterData.numHopsProcessed = numHopsProcessed;
+    meterData.idle = ! stftRunning;
+    meterData.numFlushedFrames = 0;
+    meterData.numNonFiniteResets = 0;
+
+    for (auto& slot : getState<SampleType>().slots)
+        slot->addGuardCounts (meterData.numFlushedFrames, meterData.numNonFiniteResets);
+
+    // 计数在 prepare() 减少 lane 时可能变小，只在增加时记日志
+    if (meterData.numNonFiniteResets != numNonFiniteResetsLogged)
+    {
+        if (meterData.numNonFiniteResets > numNonFiniteResetsLogged)
+            logger.post ("Non-finite input samples, channel state reset", (double) meterData.numNonFiniteResets);
+
+        numNonFiniteResetsLogged = meterData.numNonFiniteResets;
+    }
+
+    meters.publish();
+}
+
+template <typename SampleType>
+bool ExchangeBandEngine::isSidechainIdle (const juce::AudioBuffer<SampleType>& sidechainBuffer, int numSamples) const noexcept
+{
+    if (numSidechainChannels == 0)
+        return true;
+
+    for (int channel = 0; channel < sidechainBuffer.getNumChannels(); ++channel)
+        if (sidechainBuffer.getRMSLevel (channel, 0, numSamples) > (SampleType) silenceThreshold)
+            return false;
+
+    return true;
+}
+
+template <typename SampleType>
+void ExchangeBandEngine::delayDry (const juce::AudioBuffer<SampleType>& mainBuffer, bool readDelayed) noexcept
+{
+    // 延迟线始终跟着输入走，淡化开始时里面已经是最近的 latency 个样本。
+    // 先写后读，延迟小于 block 长度时读到的就是这个 block 刚写进去的样本
+    auto& state = getState<SampleType>();
+    const int numSamples = mainBuffer.getNumSamples();
+    const int ringSize = state.dryDelay.getNumSamples();
+    const int readPosition = (dryDelayWritePosition - getLatencySamples() + ringSize) % ringSize;
+    jassert (numSamples + getLatencySamples() <= ringSize);
+
+    for (int channel = 0; channel < mainBuffer.getNumChannels(); ++channel)
+    {
+        auto* ring = state.dryDelay.getWritePointer (channel);
+        copyIntoRing (ring, ringSize, dryDelayWritePosition, mainBuffer.getReadPointer (channel), numSamples);
+
+        if (readDelayed)
+            copyFromRing (state.dryBuffer.getWritePointer (channel), ring, ringSize, readPosition, numSamples);
+    }
+
+    dryDelayWritePosition = (dryDelayWritePosition + numSamples) % ringSize;
+}
+
+template <typename SampleType>
+void ExchangeBandEngine::mixDelayedDry (juce::AudioBuffer<SampleType>& mainBuffer, bool towardsWet) noexcept
+{
+    const auto& dryBuffer = getState<SampleType>().dryBuffer;
+    const int numSamples = mainBuffer.getNumSamples();
+    const int numChannels = mainBuffer.getNumChannels();
+
+    // 完全旁路：输出就是延迟线，mainBuffer 里没有经过 STFT 的内容
+    if (! towardsWet && wetGain <= 0.0f)
+    {
+        for (int channel = 0; channel < numChannels; ++channel)
+            mainBuffer.copyFrom (channel, 0, dryBuffer, channel, 0, numSamples);
+
+        return;
+    }
+
+    // 预热结束后 wetGain 每个样本朝目标移动 1 / idleCrossfadeSamples，所有通道用同一条增益曲线
+    const auto step = (towardsWet ? 1.0f : -1.0f) / (float) idleCrossfadeSamples;
+    auto* const* wet = mainBuffer.getArrayOfWritePointers();
+    auto* const* dry = dryBuffer.getArrayOfReadPointers();
+    auto gain = wetGain;
+    auto warmUp = warmUpSamplesRemaining;
+
+    for (int i = 0; i < numSamples; ++i)
+    {
+        if (warmUp > 0)
+            --warmUp;
+        else
+            gain = juce::jlimit (0.0f, 1.0f, gain + step);
+
+        for (int channel = 0; channel < numChannels; ++channel)
+            wet[channel][i] = dry[channel][i] + (SampleType) gain * (wet[channel][i] - dry[channel][i]);
+    }
+
+    wetGain = gain;
+    warmUpSamplesRemaining = warmUp;
+}
+
+template <typename SampleType>
+void ExchangeBandEngine::beginTransition (const StftSettings& newSettings) noexcept
+{
+    // 新几何从空的环形缓冲区开始，输出要等两帧之后才完整；
+    // 新几何的延迟较小时，它经过对齐延迟线的那一份还要再晚这么多样本才完整
+    const auto& oldSettings = getActiveSlot<SampleType>().settings;
+    getIncomingSlot<SampleType>().configure (newSettings);
+    transitionLatencyDifference = newSettings.getLatencySamples() - oldSettings.getLatencySamples();
+    transitionSamplesDone = 0;
+    transitionWarmUpSamples = 2 * newSettings.getFftSize() + juce::jmax (0, -transitionLatencyDifference);
+    transitionLatencySwitched = false;
+    alignmentWritePosition = 0;
+    transitionInProgress = true;
+}
+
+template <typename SampleType>
+void ExchangeBandEngine::processTransition (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer)
+{
+    // 预热之后的时间线（样本数从切换开始算，J = latencyJumpFadeSamples，C = geometryCrossfadeSamples）：
+    // - 延迟相同：旧几何与新几何交叉淡化 C，没有延迟跳变。
+    // - 新几何延迟较大：旧几何淡出 J，跳变到新延迟，延迟对齐的旧几何淡入 J，再与新几何交叉淡化 C。
+    // - 新几何延迟较小：旧几何与延迟对齐的新几何交叉淡化 C，后者淡出 J，跳变到新延迟，新几何淡入 J。
+    // 任何时刻混在一起的两份输出都按同一个延迟对齐，不会叠出梳状滤波或回声
+    const int numSamples = mainBuffer.getNumSamples();
+    const int numChannels = mainBuffer.getNumChannels();
+    const int difference = transitionLatencyDifference;
+    const int delay = std::abs (difference);
+    const int jumpFade = difference != 0 ? latencyJumpFadeSamples : 0;
+    const bool delayOld = difference > 0;
+
+    const int fadeStart = transitionWarmUpSamples;
+    const int switchPoint = delayOld ? fadeStart + jumpFade : fadeStart + (difference != 0 ? geometryCrossfadeSamples : 0) + jumpFade;
+    const int fadeEnd = delayOld ? switchPoint + jumpFade + geometryCrossfadeSamples
+                                 : switchPoint + (difference != 0 ? jumpFade : geometryCrossfadeSamples);
+
+    auto& state = getState<SampleType>();
+    auto& transitionBuffer = state.transitionBuffer;
+    auto& alignmentDelay = state.alignmentDelay;
+    const int ringSize = alignmentDelay.getNumSamples();
+    jassert (delay + transitionBuffer.getNumSamples() <= ringSize);
+
+    // [start, start + length) 上从 0 到 1 的线性斜坡，length 为 0 时是阶跃
+    const auto ramp = [] (int t, int start, int length)
+    {
+        if (t < start)
+            return SampleType (0);
+
+        return length > 0 ? juce::jmin (SampleType (1), (SampleType) (t - start) / (SampleType) length) : SampleType (1);
+    };
+
+    for (int position = 0; position < numSamples;)
+    {
+        const int numThisTime = juce::jmin (numSamples - position, transitionBuffer.getNumSamples());
+
+        // 两套几何并行处理同一段输入：active slot 原地处理 mainBuffer，incoming slot 处理拷贝
+        for (int channel = 0; channel < numChannels; ++channel)
+            transitionBuffer.copyFrom (channel, 0, mainBuffer, channel, position, numThisTime);
+
+        getActiveSlot<SampleType>().process (mainBuffer, position, sidechainBuffer, position, numThisTime);
+        getIncomingSlot<SampleType>().process (transitionBuffer, 0, sidechainBuffer, position, numThisTime);
+
+        // 延迟较小的一套写进对齐延迟线，先写后读，延迟小于这一段的长度时读到的是刚写进去的样本
+        const int readStart = (alignmentWritePosition - delay + ringSize) % ringSize;
+
+        if (difference != 0)
+        {
+            for (int channel = 0; channel < numChannels; ++channel)
+                copyIntoRing (alignmentDelay.getWritePointer (channel), ringSize, alignmentWritePosition,
+                              delayOld ? mainBuffer.getReadPointer (channel, position) : transitionBuffer.getReadPointer (channel),
+                              numThisTime);
+
+            alignmentWritePosition = (alignmentWritePosition + numThisTime) % ringSize;
+        }
+
+        // 预热阶段只输出旧几何，mainBuffer 里已经是它的输出
+        const int mixFrom = juce::jlimit (0, numThisTime, fadeStart - transitionSamplesDone);
+
+        for (int i = mixFrom; i < numThisTime; ++i)
+        {
+            const int t = transitionSamplesDone + i;
+
+            // 旧几何、新几何和对齐延迟线（延迟较小的那一套）各自的增益
+            SampleType oldGain = 0, newGain = 0, delayedGain = 0;
+
+            if (difference == 0)
+            {
+                newGain = ramp (t, fadeStart, geometryCrossfadeSamples);
+                oldGain = 1 - newGain;
+            }
+            else if (delayOld)
+            {
+                if (t < switchPoint)
+                {
+                    oldGain = 1 - ramp (t, fadeStart, jumpFade);
+                }
+                else
+                {
+                    newGain = ramp (t, switchPoint + jumpFade, geometryCrossfadeSamples);
+                    delayedGain = ramp (t, switchPoint, jumpFade) * (1 - newGain);
+                }
+            }
+            else
+            {
+                if (t < switchPoint)
+                {
+                    const auto crossfade = ramp (t, fadeStart, geometryCrossfadeSamples);
+                    oldGain = 1 - crossfade;
+                    delayedGain = crossfade * (1 - ramp (t, fadeStart + geometryCrossfadeSamples, jumpFade));
+                }
+                else
+                {
+                    newGain = ramp (t, switchPoint, jumpFade);
+                }
+            }
+
+            int readPosition = readStart + i;
+
+            if (readPosition >= ringSize)
+                readPosition -= ringSize;
+
+            for (int channel = 0; channel < numChannels; ++channel)
+            {
+                auto& output = mainBuffer.getWritePointer (channel, position)[i];
+                output = oldGain * output + newGain * transitionBuffer.getSample (channel, i);
+
+                if (delayedGain > 0)
+                    output += delayedGain * alignmentDelay.getSample (channel, readPosition);
+            }
+        }
+
+        transitionSamplesDone += numThisTime;
+        position += numThisTime;
+        transitionLatencySwitched = transitionSamplesDone >= switchPoint;
+
+        if (transitionSamplesDone >= fadeEnd)
+        {
+            // 切换完成，block 剩下的部分只由新几何处理
+            activeSlot = 1 - activeSlot;
+            transitionInProgress = false;
+            transitionLatencySwitched = false;
+            getIncomingSlot<SampleType>().releaseMasks();
+
+            if (position < numSamples)
+                getActiveSlot<SampleType>().process (mainBuffer, position, sidechainBuffer, position, numSamples - position);
+
+            return;
+        }
+    }
+}
+
+bool ExchangeBandEngine::readLatestMeters (ExchangeBandMeters& destination) noexcept
+{
+    if (! meters.update())
+        return false;
+
+    destination = meters.getReadBuffer();
+    return true;
+}
@@ -0,0 +1,369 @@
+/*
+  ==============================================================================
+
+    ExchangeBandEngine.h
+    与插件外壳无关的频段交换 DSP 引擎，只依赖 juce_core / juce_dsp。
+    ExchangeBandAudioProcessor 持有一个实例；离线工具和基准测试也可以直接驱动它。
+
+    线程模型：
+    - prepare() / reset() / setParameterSource() 只在音频回调停止时调用（message 线程）。
+    - 时域状态（环形缓冲区、窗、overlap-add）按 prepare() 时选择的精度分配，float / double
+      共用同一份模板代码；频谱部分（FFT 和交叉合成）两种精度下都是 float。
+    - FFT 通过 RealFft 接口调用，prepare() 时按每种点数选在当前 CPU 上最快的后端（可以强制指定）。
+    - 默认只合成掩码改变了的 bin 带来的修正量，加到延迟对齐的干声上（见 SynthesisMode），
+      频段表不改变任何 bin 时整帧跳过 FFT。
+    - process() 和 setParameters() 只在同一个处理线程上调用，内部不加锁。
+    - 多声道时同一个 hop 的各个通道由 ChannelWorkerPool 分给工作线程并行处理，调用线程自己也领取通道，
+      只会等待已经被工作线程领走、正在处理的通道；立体声及以下不启动工作线程。
+    - 侧链缺失或静音时整个 STFT 暂停（见 silenceThreshold），空闲的实例每个 block 只有一次侧链 RMS
+      和一次延迟线拷贝。
+    - 频段表在非实时线程上编译成逐 bin 的频谱掩码（SpectralMask），音频线程每个 hop
+      只取最新发布的指针，每帧的交叉合成只是按掩码逐元素乘加。
+    - 其他线程只能通过 wait-free 的通道读数据：参数是 std::atomic<float>，
+      电平 / 状态通过 TripleBuffer 发布（readLatestMeters() 只允许一个消费线程调用），
+      诊断日志通过 RealtimeLogger 的无锁 FIFO 输出，频谱显示帧通过 SpectrumAnalyser 的无锁 FIFO 交给编辑器，
+      各阶段耗时由各 lane 写进自己的 StageTimings 直方图。
+    因此音频线程永远不会阻塞在别的线程持有的锁上，多实例运行时不会出现优先级反转。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_dsp/juce_dsp.h>
+#include "ChannelWorkerPool.h"
+#include "ExchangeBandParameters.h"
+#include "RealFft.h"
+#include "RealtimeLogger.h"
+#include "RealtimeSafety.h"
+#include "SpectralKernels.h"
+#include "SpectralMask.h"
+#include "SpectrumAnalyser.h"
+#include "StageTimings.h"
+#include "TripleBuffer.h"
+#include <array>
+#include <atomic>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// 音频线程每个 block 发布一次的电平和状态
+struct ExchangeBandMeters
+{
+    static constexpr int maxChannels = 31;  // 与 ExchangeBandEngine::maxChannels 相同
+
+    int numChannels = 0;
+    std::array<float, maxChannels> mainPeak {};       // 主链输入峰值
+    std::array<float, maxChannels> sidechainPeak {};  // 侧链输入峰值
+    std::array<float, maxChannels> outputPeak {};     // 输出峰值
+    juce::int64 numHopsProcessed = 0;
+    bool idle = false;                                // STFT 已暂停，输出为延迟后的主链（见 ExchangeBandEngine::silenceThreshold）
+    juce::int64 numFlushedFrames = 0;                 // 主链和侧链都低于 flushEnergy、直接跳过的通道帧数
+    juce::int64 numNonFiniteResets = 0;               // 输入里出现 NaN / Inf、清空通道状态的次数
+};
+
+//==============================================================================
+class ExchangeBandEngine
+{
+public:
+    //==============================================================================
+    static constexpr int maxFftSize = 1 << StftSettings::maxOrder;
+    static constexpr int maxNumBins = maxFftSize / 2 + 1;
+
+    // STFT 几何切换时，新几何先在后台跑满两帧的预热，再用这么多样本线性交叉淡化
+    static constexpr int geometryCrossfadeSamples = 2048;
+
+    // 两套几何的延迟不同时，延迟较小的一套经过对齐延迟线后再交叉淡化，两份输出在时间上对齐。
+    // 延迟跳变（getLatencySamples() 改变的时刻）前后各用这么多样本淡出 / 淡入，跳变本身落在静音里。
+    // 这是有意的限制：输出的延迟变了，就必然要丢掉（延迟变小）或重复（延迟变大）|差值| 个样本的输入，
+    // 没有办法无缝衔接，所以延迟不同的切换在输出里总会留下一个 2 * latencyJumpFadeSamples 长的凹陷。
+    // 延迟不变的切换（例如只换窗函数或重叠倍数）没有跳变，只是两套几何之间的交叉淡化
+    static constexpr int latencyJumpFadeSamples = 256;
+
+    // 新发布的频谱掩码在这么长的时间内逐 hop 从旧掩码线性插值过去（至少一个 hop）
+    static constexpr double maskInterpolationSeconds = 0.02;
+
+    // 主链最多这么多通道：AudioBuffer 少于 32 个通道时通道指针放在对象内部的预分配空间里，
+    // 音频线程上建立的通道视图（宿主 buffer 的 getBusBuffer、EngineSwitcher 的分段）才不会分配内存
+    static constexpr int maxChannels = 31;
+
+    // 多声道并行：每个执行线程至少分到这么多通道才启动工作线程，
+    // FFT 短于 2^minParallelFftOrder 点时一个通道的处理比派发还快，始终在调用线程上处理
+    static constexpr int channelsPerLane = 2;
+    static constexpr int minParallelFftOrder = 10;
+
+    // 空闲旁路：侧链缺失（没有通道），或每个 block 的 RMS 都低于 silenceThreshold 并持续 idleHoldSeconds
+    // （至少一个尾音长度）后，输出淡化到与 STFT 延迟相同的主链延迟线，然后完全跳过 STFT。
+    // 侧链一出现就重新启动 STFT，从空的环形缓冲区预热一个尾音长度，再淡化回处理后的输出
+    static constexpr float silenceThreshold = 3.1623e-5f;  // -90 dBFS
+    static constexpr double idleHoldSeconds = 0.5;
+    static constexpr int idleCrossfadeSamples = 1024;
+
+    // 数值保护：process() 期间（包括工作线程）开启 FTZ / DAZ。每帧加窗后先算一次能量，
+    // 主链和侧链都低于 flushEnergy（约 -300 dBFS）时整帧跳过，静音的尾音直接归零而不是衰减成非规格化数；
+    // 能量不是有限值（输入里有 NaN / Inf）时清空这个通道的环形缓冲区和 overlap-add 状态，这一帧不输出。
+    // 两种事件的累计次数通过 ExchangeBandMeters 读取
+    static constexpr float flushEnergy = 1.0e-30f;
+
+    // 交叉合成在哪个域里进行：
+    // rectangular 直接混合 / 交换 FFT 输出的复数，每个 bin 不需要任何超越函数；
+    // polar 保留原来的幅度、相位分别线性混合的算法（相位混合会有回绕问题，仅用于对比）
+    enum class CrossSynthesisMode
+    {
+        rectangular,
+        polar
+    };
+
+    // 合成方式：
+    // fullInverse 每帧对交叉合成后的整个频谱做 IFFT 再 overlap-add；
+    // sparseCorrection 的输出 = 延迟对齐的干声（直接从主链环形缓冲区读出）+ 修正量，修正量只由掩码改变了的 bin
+    // 上的差值 Y - X 合成：这些 bin 很少时用振荡器组逐 bin 直接写出时域帧，超过平衡点就对差值频谱做一次 IFFT；
+    // 掩码没有改变任何 bin 时整帧跳过 FFT。窗满足完美重建，两种方式的差别只有 float 舍入
+    enum class SynthesisMode
+    {
+        fullInverse,
+        sparseCorrection
+    };
+
+    // 振荡器组与 IFFT 的平衡点：振荡器组每个 bin、每个输出样本的开销约等于 IFFT 每个 "N log2 N" 单位的这么多倍，
+    // 改变的 bin 数 × 合成长度 × oscillatorCostRatio 小于 N log2 N 时用振荡器组（在 x86-64 上按 stockham 后端测得）
+    static constexpr float oscillatorCostRatio = 1.6f;
+
+    // 时域状态的精度，与 juce::AudioProcessor::ProcessingPrecision 对应
+    enum class ProcessingPrecision
+    {
+        singlePrecision,
+        doublePrecision
+    };
+
+    ExchangeBandEngine();
+    ~ExchangeBandEngine();
+
+    //==============================================================================
+    // 分配所有缓冲区，并生成所有 STFT 几何的 FFT plan 和窗表；第一次调用时还要测量各个 FFT 后端（约几十毫秒）。
+    // numChannels 为主链（同时也是输出）的通道数，
+    // numSidechainChannels 可以是 0（没有侧链，输出延迟后的主链）、1（所有主链通道共用）或与主链相同。
+    // 之后只能调用与 precision 对应的 process() 重载
+    void prepare (double newSampleRate, int maximumBlockSize, int numChannels, int numSidechainChannels,
+                  ProcessingPrecision precision = ProcessingPrecision::singlePrecision);
+    // 清空环形缓冲区和 overlap-add 状态，但不释放内存；直接切到当前参数里的 STFT 几何
+    void reset();
+    // 与 reset() 一样清空状态、切到参数里的 STFT 几何，但沿用后台已经发布的掩码，不编译也不分配内存，
+    // 可以在处理线程上调用（插件从零延迟引擎切回 STFT 时使用）
+    void clearState() noexcept;
+
+    // 直接设置参数快照（离线 / 无插件外壳时使用）。频段表变化时在调用线程上同步编译频谱掩码，
+    // 这一步会分配内存，所以实时使用时应改用 setParameterSource()
+    void setParameters (const ExchangeBandParameters& newParameters);
+    // 设置后每个 hop 从这些原子变量读取 STFT 几何，频段表由共享的后台线程读取并编译，
+    // 优先于 setParameters()
+    void setParameterSource (const ExchangeBandParameterPointers& newSource);
+    // 使用参数来源时，其中的频段表是最近一次 reset() 时的值，实际生效的以后台编译的掩码为准
+    const ExchangeBandParameters& getParameters() const noexcept   { return currentParameters; }
+
+    // 多声道时处理通道的工作线程数上限（不含调用线程），下一次 prepare() 生效。
+    // 0 = 所有通道都在调用线程上处理，例如离线渲染已经按文件并行时
+    void setMaxWorkerThreads (int newMaximum) noexcept              { maxWorkerThreads = juce::jlimit (0, ChannelWorkerPool::maxWorkers, newMaximum); }
+    int getNumWorkerThreads() const noexcept                        { return workers.getNumWorkers(); }
+
+    // FFT 后端：默认每种点数用 RealFft::getFastestBackend() 测出的最快后端，
+    // forceFftBackend() 让所有点数都用指定的后端，useFastestFftBackend() 恢复默认；都在下一次 prepare() 生效
+    void forceFftBackend (RealFft::Backend backend) noexcept        { fftBackendForced = true; forcedFftBackend = backend; }
+    void useFastestFftBackend() noexcept                            { fftBackendForced = false; }
+    bool isFftBackendForced() const noexcept                        { return fftBackendForced; }
+    // fftOrder 点当前使用的后端（prepare() 之后有效，只在音频回调停止时或处理线程上调用）
+    RealFft::Backend getFftBackend (int fftOrder) const noexcept;
+
+    // 只在处理线程上或音频回调停止时调用
+    void setCrossSynthesisMode (CrossSynthesisMode newMode) noexcept { crossSynthesisMode = newMode; }
+    CrossSynthesisMode getCrossSynthesisMode() const noexcept       { return crossSynthesisMode; }
+
+    // overlap-add 缓冲区里的内容两种合成方式不通用，所以在下一次 reset() 或 STFT 几何切换时才生效
+    void setSynthesisMode (SynthesisMode newMode) noexcept          { synthesisMode = newMode; }
+    SynthesisMode getSynthesisMode() const noexcept                 { return synthesisMode; }
+
+    // 逐 bin 内核默认按 CPU 选最快的指令集；useScalarReference 用于和参考实现对比验证。
+    // Accuracy::fast 只影响 polar 模式下的 atan2 / sincos
+    void setKernels (SpectralKernels::Accuracy accuracy, bool useScalarReference = false) noexcept;
+    const SpectralKernels::Table& getKernels() const noexcept       { return *kernels; }
+
+    // 处理一个 block：mainBuffer 原地写回输出，sidechainBuffer 只读，没有通道时视为侧链缺失。
+    // prepare() 之后这里不会再分配内存或格式化字符串，诊断信息都交给 logger。
+    void process (juce::AudioBuffer<float>& mainBuffer, const juce::AudioBuffer<float>& sidechainBuffer);
+    void process (juce::AudioBuffer<double>& mainBuffer, const juce::AudioBuffer<double>& sidechainBuffer);
+
+    ProcessingPrecision getProcessingPrecision() const noexcept     { return precision; }
+
+    double getSampleRate() const noexcept                           { return sampleRate; }
+
+    // 当前输出所用的 STFT 几何（切换过程中为正在淡出的那一套）
+    const StftSettings& getActiveStftSettings() const noexcept;
+    // 输出当前的延迟 / 尾音长度。几何切换中延迟不同时，在淡化里静音的那一刻从旧几何跳到新几何，
+    // 与音频里的时间跳变同步（只在处理线程上或音频回调停止时调用）
+    int getLatencySamples() const noexcept                          { return getOutputStftSettings().getLatencySamples(); }
+    int getTailSamples() const noexcept                             { return getOutputStftSettings().getTailSamples(); }
+    bool isChangingStftSettings() const noexcept                    { return transitionInProgress; }
+    // STFT 是否因为侧链缺失 / 静音而暂停（只在处理线程上调用，其他线程读 ExchangeBandMeters::idle）
+    bool isIdle() const noexcept                                    { return ! stftRunning; }
+
+    // 取出音频线程最近发布的电平和状态，有新数据时返回 true（只能有一个消费线程）
+    bool readLatestMeters (ExchangeBandMeters& destination) noexcept;
+
+    // 音频线程上的诊断日志（无锁，由后台线程输出）
+    RealtimeLogger& getLogger() noexcept                            { return logger; }
+
+    // 编辑器的频谱显示：打开时 setEnabled (true)，再由 UI 线程 pop() 音频线程发布的帧
+    SpectrumAnalyser& getSpectrumAnalyser() noexcept                { return analyser; }
+
+    // 各处理阶段的耗时统计，任意线程都可以读（EXCHANGEBAND_STAGE_TIMING=0 时为空）
+    StageTimings& getStageTimings() noexcept                        { return timings; }
+    const StageTimings& getStageTimings() const noexcept            { return timings; }
+
+    //==============================================================================
+    // 最近一帧的频谱（只在处理线程上访问，只有 polar 模式会更新，长度为当前几何的 numBins）
+    const std::vector<float>& getSidechainMagnitude() const noexcept;
+    const std::vector<float>& getOutputMagnitude() const noexcept;
+
+private:
+    //==============================================================================
+    // 每种 FFT 点数一份：分析窗按窗类型，合成窗按窗类型 × 重叠倍数（已乘上 overlap-add 归一化）。
+    // 低延迟模式的非对称窗由 hop 决定，按重叠倍数各一对
+    template <typename SampleType>
+    struct WindowTables
+    {
+        std::array<std::vector<SampleType>, StftSettings::numWindowTypes> analysis;
+        std::array<std::array<std::vector<SampleType>, StftSettings::numOverlapChoices>, StftSettings::numWindowTypes> synthesis;
+        std::array<std::vector<SampleType>, StftSettings::numOverlapChoices> lowLatencyAnalysis;
+        std::array<std::vector<SampleType>, StftSettings::numOverlapChoices> lowLatencySynthesis;
+
+        // 分析窗的和，用于频谱显示的幅度归一化
+        std::array<SampleType, StftSettings::numWindowTypes> analysisSum {};
+        std::array<SampleType, StftSettings::numOverlapChoices> lowLatencyAnalysisSum {};
+    };
+
+    // 一套完整的 STFT 状态，缓冲区按最大几何分配，可以承载任意一种几何（定义在 .cpp 里）
+    template <typename SampleType>
+    class StftSlot;
+
+    // 一种精度下的窗表、两个 slot 和几何切换用的缓冲区；没用到的那种精度不占内存
+    template <typename SampleType>
+    struct PrecisionState
+    {
+        std::array<WindowTables<SampleType>, StftSettings::numOrders> windowTables;
+        std::array<std::unique_ptr<StftSlot<SampleType>>, 2> slots;
+        juce::AudioBuffer<SampleType> transitionBuffer;
+
+        // 几何切换时延迟较小的一套输出的对齐延迟线（maxFftSize + 最大 block 长度）
+        juce::AudioBuffer<SampleType> alignmentDelay;
+
+        // 空闲旁路：主链输入的延迟线（maxFftSize + 最大 block 长度）和从中读出的这个 block 的延迟输出
+        juce::AudioBuffer<SampleType> dryDelay;
+        juce::AudioBuffer<SampleType> dryBuffer;
+    };
+
+    void updateParametersForHop() noexcept;
+    void buildPlans();
+    template <typename SampleType> void buildWindows (PrecisionState<SampleType>& state);
+    template <typename SampleType> void processBlock (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer);
+    template <typename SampleType> void beginTransition (const StftSettings& newSettings) noexcept;
+    template <typename SampleType> void processTransition (juce::AudioBuffer<SampleType>& mainBuffer, const juce::AudioBuffer<SampleType>& sidechainBuffer);
+    template <typename SampleType> bool isSidechainIdle (const juce::AudioBuffer<SampleType>& sidechainBuffer, int numSamples) const noexcept;
+    template <typename SampleType> void delayDry (const juce::AudioBuffer<SampleType>& mainBuffer, bool readDelayed) noexcept;
+    template <typename SampleType> void mixDelayedDry (juce::AudioBuffer<SampleType>& mainBuffer, bool towardsWet) noexcept;
+    void resetIdleState() noexcept;
+    const StftSettings& getOutputStftSettings() const noexcept;
+
+    template <typename SampleType>
+    PrecisionState<SampleType>& getState() noexcept
+    {
+        if constexpr (std::is_same_v<SampleType, float>)
+            return singleState;
+        else
+            return doubleState;
+    }
+
+    // 对当前精度的 PrecisionState 调用 function（泛型 lambda）
+    template <typename Function>
+    decltype (auto) withActiveState (Function&& function) const
+    {
+        if (precision == ProcessingPrecision::doublePrecision)
+            return function (doubleState);
+
+        return function (singleState);
+    }
+
+    template <typename Function>
+    decltype (auto) withActiveState (Function&& function)
+    {
+        if (precision == ProcessingPrecision::doublePrecision)
+            return function (doubleState);
+
+        return function (singleState);
+    }
+
+    template <typename SampleType> StftSlot<SampleType>& getActiveSlot() noexcept    { return *getState<SampleType>().slots[(size_t) activeSlot]; }
+    template <typename SampleType> StftSlot<SampleType>& getIncomingSlot() noexcept  { return *getState<SampleType>().slots[(size_t) (1 - activeSlot)]; }
+
+    //==============================================================================
+    ExchangeBandParameters currentParameters;
+    ExchangeBandParameterPointers parameterSource;
+    double sampleRate = 0.0;
+
+    // 频段表编译成的逐 bin 掩码；slot i 使用 hazard 槽位 2i 和 2i + 1
+    SpectralMaskPublisher maskPublisher;
+
+    CrossSynthesisMode crossSynthesisMode = CrossSynthesisMode::rectangular;
+    SynthesisMode synthesisMode = SynthesisMode::sparseCorrection;
+    const SpectralKernels::Table* kernels = nullptr;
+
+    // 下标为 fftOrder - StftSettings::minOrder；每个 lane 的 FFT 工作区按所有 plan 里最大的需求分配
+    juce::OwnedArray<RealFft> fftPlans;
+    int fftWorkspaceSize = 0;
+    bool fftBackendForced = false;
+    RealFft::Backend forcedFftBackend = RealFft::Backend::juce;
+
+    // 振荡器组用的 cos / sin (2π m / maxFftSize) 表，所有点数按步长共用，prepare() 时生成一次
+    std::vector<float> oscillatorCos, oscillatorSin;
+
+    ProcessingPrecision precision = ProcessingPrecision::singlePrecision;
+    PrecisionState<float> singleState;
+    PrecisionState<double> doubleState;
+    int activeSlot = 0;
+
+    // 几何切换：incoming slot 和 active slot 并行处理，先预热再交叉淡化。
+    // transitionLatencyDifference 是新几何减旧几何的延迟，不为 0 时延迟较小的一套写进对齐延迟线；
+    // transitionLatencySwitched 表示已经过了延迟跳变的时刻，输出按新几何的延迟对齐
+    bool transitionInProgress = false;
+    int transitionSamplesDone = 0;
+    int transitionWarmUpSamples = 0;
+    int transitionLatencyDifference = 0;
+    bool transitionLatencySwitched = false;
+    int alignmentWritePosition = 0;
+
+    // 空闲旁路：wetGain 是 STFT 输出在最终输出里的比例，其余来自延迟线；
+    // STFT 重新启动后的 warmUpSamplesRemaining 个样本里 wetGain 保持为 0
+    bool stftRunning = true;
+    float wetGain = 1.0f;
+    int warmUpSamplesRemaining = 0;
+    int quietSamples = 0;
+    int dryDelayWritePosition = 0;
+
+    // 已经写进日志的清空次数，只在有新事件时才记一条
+    juce::int64 numNonFiniteResetsLogged = 0;
+
+    int numMainChannels = 0;
+    int numSidechainChannels = 0;
+
+    // 多声道时并行处理各通道的帧，工作线程数在 prepare() 时按通道数决定
+    ChannelWorkerPool workers;
+    int maxWorkerThreads = ChannelWorkerPool::maxWorkers;
+
+    RealtimeLogger logger;
+    TripleBuffer<ExchangeBandMeters> meters;
+    SpectrumAnalyser analyser;
+    StageTimings timings;
+    juce::int64 numHopsProcessed = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ExchangeBandEngine)
+};
@@ -0,0 +1,283 @@
+/*
+  ==============================================================================
+
+    ExchangeBandParameters.h
+    引擎参数：STFT 几何、频段表，以及从插件 APVTS 读取它们的原子指针。
+    引擎、频谱掩码编译器和插件外壳共用这些定义。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+
+//==============================================================================
+// STFT 几何：FFT 点数、重叠倍数、窗类型和低延迟模式，都可以由宿主自动化。
+// 所有组合的 FFT plan 和窗表都在 prepare() 时预先生成，切换时只换指针
+struct StftSettings
+{
+    static constexpr int minOrder  = 8;   // 256 点
+    static constexpr int maxOrder  = 15;  // 32768 点
+    static constexpr int numOrders = maxOrder - minOrder + 1;
+    static constexpr int numOverlapChoices = 3;  // 2 / 4 / 8 倍重叠，即 50% / 75% / 87.5%
+
+    enum WindowType
+    {
+        sqrtHann = 0,    // 分析、合成都用 sqrt-Hann，乘积为 Hann
+        hann,            // 分析、合成都用 Hann
+        blackmanHarris,  // 四项 Blackman-Harris，旁瓣最低，适合高重叠
+        numWindowTypes
+    };
+
+    int fftOrder     = 11;  // 默认 2048 点
+    int overlapIndex = 0;   // 默认 50% 重叠
+    int windowType   = sqrtHann;
+
+    // 低延迟模式：Mauler & Martin 的非对称窗，分析窗仍是整帧（频率分辨率不变），
+    // 合成窗只覆盖帧末尾的 2 * hop 个样本，延迟从 fftSize 降到 2 * hop。
+    // 此模式下 windowType 不起作用
+    bool lowLatency = false;
+
+    int getFftSize() const noexcept          { return 1 << fftOrder; }
+    int getNumBins() const noexcept          { return getFftSize() / 2 + 1; }
+    int getOverlapFactor() const noexcept    { return 2 << overlapIndex; }
+    int getHopSize() const noexcept          { return getFftSize() / getOverlapFactor(); }
+
+    // 输入到输出的延迟（样本数），例如 1024 点 + 87.5% 重叠的低延迟模式为 256（48 kHz 下约 5.3 ms）
+    int getLatencySamples() const noexcept   { return lowLatency ? 2 * getHopSize() : getFftSize(); }
+
+    // 输入停止后输出还会持续的长度：最后一帧覆盖的 fftSize 个输入样本再加上延迟
+    int getTailSamples() const noexcept      { return getFftSize() + getLatencySamples(); }
+
+    // 把超出范围的值（例如来自宿主或旧版本存档）夹到支持的范围内
+    StftSettings withLegalValues() const noexcept
+    {
+        StftSettings s;
+        s.fftOrder     = juce::jlimit (minOrder, maxOrder, fftOrder);
+        s.overlapIndex = juce::jlimit (0, numOverlapChoices - 1, overlapIndex);
+        s.windowType   = juce::jlimit (0, (int) numWindowTypes - 1, windowType);
+        s.lowLatency   = lowLatency;
+        return s;
+    }
+
+    bool operator== (const StftSettings& other) const noexcept
+    {
+        return fftOrder == other.fftOrder && overlapIndex == other.overlapIndex
+            && windowType == other.windowType && lowLatency == other.lowLatency;
+    }
+
+    bool operator!= (const StftSettings& other) const noexcept     { return ! operator== (other); }
+};
+
+//==============================================================================
+// 一个交换频段。频段之间互不影响，重叠时下标大的覆盖下标小的
+struct ExchangeBand
+{
+    enum WidthUnit
+    {
+        hertz = 0,  // 以中心为对称的 Hz 宽度（与原来两频段版本的算法相同）
+        octaves,    // 以中心为几何中点的倍频程宽度
+        erb,        // ERB-number 刻度上的宽度（Glasberg & Moore）
+        numWidthUnits
+    };
+
+    float centreFrequency = 1000.0f;  // Hz
+    float width           = 1.0f;     // 单位由 widthUnit 决定
+    int   widthUnit       = octaves;
+    float mix             = 0.0f;     // 频段自身的内容：0 = 主链，1 = 侧链
+    int   partner         = -1;       // 交换对象的下标：本频段输出 partner 的内容，-1 = 不交换
+    float overlapMix      = -1.0f;    // 交换进来的内容中来源落在本频段自身范围内的部分（重叠）按它混合，< 0 = 与其余部分一样按 partner 的 mix
+
+    // 频段覆盖的频率范围（Hz，未限制到 Nyquist 以内）。频谱掩码和编辑器的频段显示都按它计算
+    juce::Range<double> getFrequencyRange (double sampleRate) const noexcept
+    {
+        const auto nyquist = sampleRate * 0.5;
+
+        if (widthUnit == hertz)
+        {
+            // 与原来两频段版本相同：带宽限制在 20Hz ~ Nyquist，中心夹到能放下整个频段的范围
+            const auto bandWidth = juce::jlimit (20.0, nyquist, (double) width);
+            const auto halfBW = bandWidth * 0.5;
+            const auto centre = juce::jlimit (halfBW, nyquist - halfBW, (double) centreFrequency);
+            return { centre - halfBW, centre + halfBW };
+        }
+
+        const auto centre = juce::jlimit (1.0, nyquist, (double) centreFrequency);
+        const auto halfWidth = juce::jmax (0.0, (double) width) * 0.5;
+
+        if (widthUnit == octaves)
+            return { centre * std::exp2 (-halfWidth), centre * std::exp2 (halfWidth) };
+
+        // ERB-number：E(f) = 21.4 log10(1 + 0.00437 f)
+        const auto toErb = [] (double f)   { return 21.4 * std::log10 (1.0 + 0.00437 * f); };
+        const auto fromErb = [] (double e) { return (std::pow (10.0, e / 21.4) - 1.0) / 0.00437; };
+        return { fromErb (juce::jmax (0.0, toErb (centre) - halfWidth)), fromErb (toErb (centre) + halfWidth) };
+    }
+
+    bool operator== (const ExchangeBand& other) const noexcept
+    {
+        return centreFrequency == other.centreFrequency && width == other.width && widthUnit == other.widthUnit
+            && mix == other.mix && partner == other.partner && overlapMix == other.overlapMix;
+    }
+
+    bool operator!= (const ExchangeBand& other) const noexcept     { return ! operator== (other); }
+};
+
+//==============================================================================
+// 引擎参数快照：频段表 + STFT 几何
+struct ExchangeBandParameters
+{
+    static constexpr int maxBands = 16;
+
+    int numBands = 2;
+    std::array<ExchangeBand, maxBands> bands;
+    StftSettings stft;
+
+    // 多声道侧链联动：各通道取平均后只分析一次，所有主链通道共用同一份侧链频谱
+    bool sidechainLink = false;
+
+    ExchangeBandParameters() noexcept
+    {
+        setTwoBandLayout (2000.0f, 2000.0f, 1.0f, 1.0f, 0.01f, 0.01f);
+    }
+
+    // 原来的六个插件参数对应的前两个频段：
+    //   band1 = cutFrequencyFrom1 处按 band1Mix 混合，band2 = cutFrequencyFrom2 处的侧链原样；
+    //   交换时 band1 输出 band2 的内容，band2 输出 band1 的内容；两个频段重叠时，band2 换来的
+    //   内容里来自重叠部分的按 band2Mix 混合（overlapMix），其余按 band1Mix；
+    //   带宽 = FrequencyBandLength 从 0 ~ 2 线性映射到 20 ~ 2000 Hz。
+    void setTwoBandLayout (float cutFrequencyFrom1, float cutFrequencyFrom2, float frequencyBandLength,
+                           float exchangeBandValue, float band1Mix, float band2Mix) noexcept
+    {
+        const auto widthHz = juce::jmap (frequencyBandLength, 0.0f, 2.0f, 20.0f, 2000.0f);
+        const auto exchange = exchangeBandValue != 0.0f;
+
+        bands[0] = { cutFrequencyFrom1, widthHz, ExchangeBand::hertz, band1Mix, exchange ? 1 : -1 };
+        bands[1] = { cutFrequencyFrom2, widthHz, ExchangeBand::hertz, 1.0f,     exchange ? 0 : -1, band2Mix };
+        numBands = juce::jmax (numBands, 2);
+    }
+
+    // 频段表相同（不比较 STFT 几何），决定频谱掩码是否需要重新编译
+    bool hasSameBands (const ExchangeBandParameters& other) const noexcept
+    {
+        if (numBands != other.numBands)
+            return false;
+
+        for (int i = 0; i < numBands; ++i)
+            if (bands[(size_t) i] != other.bands[(size_t) i])
+                return false;
+
+        return true;
+    }
+
+    bool operator== (const ExchangeBandParameters& other) const noexcept
+    {
+        return stft == other.stft && sidechainLink == other.sidechainLink && hasSameBands (other);
+    }
+
+    bool operator!= (const ExchangeBandParameters& other) const noexcept   { return ! operator== (other); }
+};
+
+// 参数来源：指向插件 APVTS 原始参数值的指针（getRawParameterValue）。
+// 音频线程每个 hop 只读取 STFT 几何，频段表由掩码编译线程读取后编译成频谱掩码。
+// 前两个频段来自原来的六个参数；numBands 和第 3 个之后的频段、STFT 几何的指针都可以为空
+// （此时保持默认值），fftSizeIndex / overlapIndex / windowType 对应 AudioParameterChoice 的下标
+struct ExchangeBandParameterPointers
+{
+    struct BandPointers
+    {
+        std::atomic<float>* centreFrequency = nullptr;
+        std::atomic<float>* width           = nullptr;
+        std::atomic<float>* widthUnit       = nullptr;  // ExchangeBand::WidthUnit
+        std::atomic<float>* mix             = nullptr;
+        std::atomic<float>* partner         = nullptr;  // 0 = 不交换，n = 与第 n 个频段交换
+
+        bool isValid() const noexcept
+        {
+            return centreFrequency != nullptr && width != nullptr && widthUnit != nullptr && mix != nullptr && partner != nullptr;
+        }
+    };
+
+    std::atomic<float>* cutFrequencyFrom1   = nullptr;
+    std::atomic<float>* cutFrequencyFrom2   = nullptr;
+    std::atomic<float>* frequencyBandLength = nullptr;
+    std::atomic<float>* exchangeBandValue   = nullptr;
+    std::atomic<float>* band1Mix            = nullptr;
+    std::atomic<float>* band2Mix            = nullptr;
+    std::atomic<float>* fftSizeIndex        = nullptr;  // 0 = 256 点 ... 7 = 32768 点
+    std::atomic<float>* overlapIndex        = nullptr;
+    std::atomic<float>* windowType          = nullptr;
+    std::atomic<float>* lowLatency          = nullptr;  // AudioParameterBool，>= 0.5 为开
+    std::atomic<float>* sidechainLink       = nullptr;  // AudioParameterBool
+    std::atomic<float>* numBands            = nullptr;
+    std::array<BandPointers, ExchangeBandParameters::maxBands> extraBands;  // 下标 0、1 不使用
+
+    bool isValid() const noexcept
+    {
+        return cutFrequencyFrom1 != nullptr && cutFrequencyFrom2 != nullptr && frequencyBandLength != nullptr
+            && exchangeBandValue != nullptr && band1Mix != nullptr && band2Mix != nullptr;
+    }
+
+    ExchangeBandParameters load() const noexcept
+    {
+        ExchangeBandParameters p;
+        p.setTwoBandLayout (cutFrequencyFrom1->load (std::memory_order_relaxed),
+                            cutFrequencyFrom2->load (std::memory_order_relaxed),
+                            frequencyBandLength->load (std::memory_order_relaxed),
+                            exchangeBandValue->load (std::memory_order_relaxed),
+                            band1Mix->load (std::memory_order_relaxed),
+                            band2Mix->load (std::memory_order_relaxed));
+
+        if (numBands != nullptr)
+            p.numBands = juce::jlimit (2, ExchangeBandParameters::maxBands, juce::roundToInt (numBands->load (std::memory_order_relaxed)));
+
+        for (int i = 2; i < p.numBands; ++i)
+        {
+            const auto& source = extraBands[(size_t) i];
+            auto& band = p.bands[(size_t) i];
+
+            if (! source.isValid())
+                continue;
+
+            band.centreFrequency = source.centreFrequency->load (std::memory_order_relaxed);
+            band.width           = source.width->load (std::memory_order_relaxed);
+            band.widthUnit       = juce::jlimit (0, (int) ExchangeBand::numWidthUnits - 1,
+                                                 juce::roundToInt (source.widthUnit->load (std::memory_order_relaxed)));
+            band.mix             = source.mix->load (std::memory_order_relaxed);
+            band.partner         = juce::roundToInt (source.partner->load (std::memory_order_relaxed)) - 1;
+        }
+
+        p.stft = loadStftSettings();
+        p.sidechainLink = loadSidechainLink();
+        return p;
+    }
+
+    // 音频线程每个 hop 调用
+    bool loadSidechainLink() const noexcept
+    {
+        return sidechainLink != nullptr && sidechainLink->load (std::memory_order_relaxed) >= 0.5f;
+    }
+
+    // 只读取 STFT 几何（音频线程每个 hop 调用，频段表由掩码编译线程读取）
+    StftSettings loadStftSettings() const noexcept
+    {
+        StftSettings stft;
+
+        if (fftSizeIndex != nullptr)
+            stft.fftOrder = StftSettings::minOrder + juce::roundToInt (fftSizeIndex->load (std::memory_order_relaxed));
+
+        if (overlapIndex != nullptr)
+            stft.overlapIndex = juce::roundToInt (overlapIndex->load (std::memory_order_relaxed));
+
+        if (windowType != nullptr)
+            stft.windowType = juce::roundToInt (windowType->load (std::memory_order_relaxed));
+
+        if (lowLatency != nullptr)
+            stft.lowLatency = lowLatency->load (std::memory_order_relaxed) >= 0.5f;
+
+        return stft.withLegalValues();
+    }
+};
@@ -0,0 +1,368 @@
+/*
+  ==============================================================================
+
+    RealFft.cpp
+
+  ==============================================================================
+*/
+
+#include "RealFft.h"
+#include <juce_dsp/juce_dsp.h>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace
+{
+    //==============================================================================
+    class JuceRealFft final : public RealFft
+    {
+    public:
+        explicit JuceRealFft (int fftOrder) : RealFft (fftOrder), fft (fftOrder) {}
+
+        Backend getBackend() const noexcept override        { return Backend::juce; }
+        int getWorkspaceSize() const noexcept override      { return 0; }
+
+        void forward (float* data, float*) const noexcept override  { fft.performRealOnlyForwardTransform (data, true); }
+        void inverse (float* data, float*) const noexcept override  { fft.performRealOnlyInverseTransform (data); }
+
+    private:
+        juce::dsp::FFT fft;
+    };
+
+    //==============================================================================
+    // N 点实数 FFT = N/2 点复数 FFT + 分拆：
+    //   z[k] = x[2k] + i x[2k+1]，Z = FFT_{N/2} (z)，
+    //   X[k] = (Z[k] + conj Z[N/2-k]) / 2 - i W^k (Z[k] - conj Z[N/2-k]) / 2，W = e^{-2πi/N}。
+    // 逆变换反过来先合成 Z 再做一次复数 IFFT（交换实部 / 虚部后复用正向 FFT）。
+    // 复数 FFT 是 radix-4 的 Stockham 自动排序算法，点数为 2 的奇数次幂时最后补一级 radix-2；
+    // 每一级在工作区的两半之间来回读写，不需要位反转，实部和虚部分开存放
+    class StockhamRealFft final : public RealFft
+    {
+    public:
+        explicit StockhamRealFft (int fftOrder)
+            : RealFft (fftOrder), half (getSize() / 2)
+        {
+            // 各级的旋转因子：长度 n 的一级有 m = n / 4 组，依次存 W_n^p、W_n^2p、W_n^3p 的实部和虚部，各 m 个
+            for (int n = half; n >= 4; n /= 4)
+            {
+                const int m = n / 4;
+
+                for (int power = 1; power <= 3; ++power)
+                {
+                    for (int p = 0; p < m; ++p)
+                        stageTwiddles.push_back ((float) std::cos (juce::MathConstants<double>::twoPi * power * p / n));
+
+                    for (int p = 0; p < m; ++p)
+                        stageTwiddles.push_back ((float) -std::sin (juce::MathConstants<double>::twoPi * power * p / n));
+                }
+            }
+
+            // 分拆用的 W_N^k 的 cos / sin（k < N/2）
+            splitCos.resize ((size_t) half);
+            splitSin.resize ((size_t) half);
+
+            for (int k = 0; k < half; ++k)
+            {
+                splitCos[(size_t) k] = (float) std::cos (juce::MathConstants<double>::twoPi * k / getSize());
+                splitSin[(size_t) k] = (float) std::sin (juce::MathConstants<double>::twoPi * k / getSize());
+            }
+        }
+
+        Backend getBackend() const noexcept override        { return Backend::stockham; }
+
+        // 两个 N/2 点的复数缓冲区（实部、虚部各 N/2）
+        int getWorkspaceSize() const noexcept override      { return 2 * getSize(); }
+
+        void forward (float* data, float* workspace) const noexcept override
+        {
+            auto* re = workspace;
+            auto* im = workspace + half;
+
+            for (int k = 0; k < half; ++k)
+            {
+                re[k] = data[2 * k];
+                im[k] = data[2 * k + 1];
+            }
+
+            const auto result = transform (re, im, workspace + 2 * half, workspace + 3 * half);
+            const auto* zr = result.re;
+            const auto* zi = result.im;
+
+            data[0] = zr[0] + zi[0];
+            data[1] = 0.0f;
+            data[2 * half] = zr[0] - zi[0];
+            data[2 * half + 1] = 0.0f;
+
+            for (int k = 1; k < half; ++k)
+            {
+                const auto ar = zr[k], ai = zi[k];
+                const auto br = zr[half - k], bi = zi[half - k];
+
+                // 偶数样本的频谱 E 和奇数样本的频谱 O
+                const auto er = 0.5f * (ar + br);
+                const auto ei = 0.5f * (ai - bi);
+                const auto orr = 0.5f * (ai + bi);
+                const auto oi = 0.5f * (br - ar);
+
+                // X = E + W^k O，W^k = (cos, -sin)
+                const auto c = splitCos[(size_t) k], s = splitSin[(size_t) k];
+                data[2 * k]     = er + c * orr + s * oi;
+                data[2 * k + 1] = ei + c * oi - s * orr;
+            }
+        }
+
+        void inverse (float* data, float* workspace) const noexcept override
+        {
+            auto* re = workspace;
+            auto* im = workspace + half;
+
+            // 1 / N 把 E、O 的 1/2 和复数 IFFT 的 1 / (N/2) 合在一起
+            const auto scale = 1.0f / (float) getSize();
+
+            for (int k = 0; k < half; ++k)
+            {
+                const auto ar = data[2 * k], ai = data[2 * k + 1];
+                const auto br = data[2 * (half - k)], bi = data[2 * (half - k) + 1];
+
+                const auto er = scale * (ar + br);
+                const auto ei = scale * (ai - bi);
+                const auto dr = scale * (ar - br);
+                const auto di = scale * (ai + bi);
+
+                // O = D · conj (W^k)，Z = E + i O
+                const auto c = splitCos[(size_t) k], s = splitSin[(size_t) k];
+                const auto orr = dr * c - di * s;
+                const auto oi = dr * s + di * c;
+
+                re[k] = er - oi;
+                im[k] = ei + orr;
+            }
+
+            // IFFT (Z) = swap (FFT (swap (Z)))，swap 交换实部和虚部
+            const auto result = transform (im, re, workspace + 3 * half, workspace + 2 * half);
+
+            for (int k = 0; k < half; ++k)
+            {
+                data[2 * k] = result.im[k];
+                data[2 * k + 1] = result.re[k];
+            }
+        }
+
+    private:
+        struct SplitComplex
+        {
+            const float* re;
+            const float* im;
+        };
+
+        // N/2 点正向复数 FFT（不归一化），输入在 (re, im)，(otherRe, otherIm) 是同样大小的另一半工作区；
+        // 返回结果所在的那一半
+        SplitComplex transform (float* re, float* im, float* otherRe, float* otherIm) const noexcept
+        {
+            const auto* twiddles = stageTwiddles.data();
+            int n = half;
+            int stride = 1;
+
+            for (; n >= 4; n /= 4)
+            {
+                const int m = n / 4;
+                radix4Stage (re, im, otherRe, otherIm, m, stride, twiddles);
+                twiddles += 6 * m;
+                stride *= 4;
+                std::swap (re, otherRe);
+                std::swap (im, otherIm);
+            }
+
+            if (n == 2)
+            {
+                radix2Stage (re, im, otherRe, otherIm, stride);
+                std::swap (re, otherRe);
+                std::swap (im, otherIm);
+            }
+
+            return { re, im };
+        }
+
+        // Stockham DIF 的一级：长度 n = 4m 的子序列共 stride 个，交错存放（子序列 q 的第 j 个元素在 q + stride * j）
+        static void radix4Stage (const float* xr, const float* xi, float* yr, float* yi,
+                                 int m, int stride, const float* twiddles) noexcept
+        {
+            const auto* w1r = twiddles;
+            const auto* w1i = twiddles + m;
+            const auto* w2r = twiddles + 2 * m;
+            const auto* w2i = twiddles + 3 * m;
+            const auto* w3r = twiddles + 4 * m;
+            const auto* w3i = twiddles + 5 * m;
+            const int quarter = stride * m;
+
+            for (int p = 0; p < m; ++p)
+            {
+                const auto* ar = xr + stride * p;
+                const auto* ai = xi + stride * p;
+                auto* outR = yr + 4 * stride * p;
+                auto* outI = yi + 4 * stride * p;
+
+                for (int q = 0; q < stride; ++q)
+                {
+                    const auto aR = ar[q],               aI = ai[q];
+                    const auto bR = ar[q + quarter],     bI = ai[q + quarter];
+                    const auto cR = ar[q + 2 * quarter], cI = ai[q + 2 * quarter];
+                    const auto dR = ar[q + 3 * quarter], dI = ai[q + 3 * quarter];
+
+                    const auto apcR = aR + cR, apcI = aI + cI;
+                    const auto amcR = aR - cR, amcI = aI - cI;
+                    const auto bpdR = bR + dR, bpdI = bI + dI;
+                    const auto bmdR = bR - dR, bmdI = bI - dI;
+
+                    // t1 = (a - c) - i (b - d)，t2 = (a + c) - (b + d)，t3 = (a - c) + i (b - d)
+                    const auto t1R = amcR + bmdI, t1I = amcI - bmdR;
+                    const auto t2R = apcR - bpdR, t2I = apcI - bpdI;
+                    const auto t3R = amcR - bmdI, t3I = amcI + bmdR;
+
+                    outR[q] = apcR + bpdR;
+                    outI[q] = apcI + bpdI;
+                    outR[q + stride]     = t1R * w1r[p] - t1I * w1i[p];
+                    outI[q + stride]     = t1R * w1i[p] + t1I * w1r[p];
+                    outR[q + 2 * stride] = t2R * w2r[p] - t2I * w2i[p];
+                    outI[q + 2 * stride] = t2R * w2i[p] + t2I * w2r[p];
+                    outR[q + 3 * stride] = t3R * w3r[p] - t3I * w3i[p];
+                    outI[q + 3 * stride] = t3R * w3i[p] + t3I * w3r[p];
+                }
+            }
+        }
+
+        // 最后一级长度为 2 的子序列，旋转因子都是 1
+        static void radix2Stage (const float* xr, const float* xi, float* yr, float* yi, int stride) noexcept
+        {
+            for (int q = 0; q < stride; ++q)
+            {
+                const auto aR = xr[q], aI = xi[q];
+                const auto bR = xr[q + stride], bI = xi[q + stride];
+
+                yr[q] = aR + bR;
+                yi[q] = aI + bI;
+                yr[q + stride] = aR - bR;
+                yi[q + stride] = aI - bI;
+            }
+        }
+
+        const int half;
+        std::vector<float> stageTwiddles;
+        std::vector<float> splitCos, splitSin;
+    };
+
+    //==============================================================================
+    // 一个后端做 numIterations 次正向 + 逆向变换的耗时（秒）
+    double timeBackend (const RealFft& fft, std::vector<float>& data, std::vector<float>& workspace, int numIterations)
+    {
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+
+        for (int i = 0; i < numIterations; ++i)
+        {
+            fft.forward (data.data(), workspace.data());
+            fft.inverse (data.data(), workspace.data());
+        }
+
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks);
+    }
+
+    RealFft::Backend measureFastestBackend (int order)
+    {
+        constexpr int numRounds = 3;
+
+        // 每轮每个后端大约处理 2^16 个样本：小点数多做几次，计时器的分辨率不会影响结果
+        const int size = 1 << order;
+        const int numIterations = juce::jmax (2, (1 << 16) / size);
+
+        std::array<std::unique_ptr<RealFft>, RealFft::numBackends> plans;
+        std::array<double, RealFft::numBackends> bestSeconds;
+        bestSeconds.fill (std::numeric_limits<double>::max());
+
+        std::vector<float> data ((size_t) size * 2);
+        std::vector<float> workspace;
+        juce::Random random (0x5eed);
+
+        for (int backend = 0; backend < RealFft::numBackends; ++backend)
+        {
+            plans[(size_t) backend] = RealFft::create ((RealFft::Backend) backend, order);
+            workspace.resize (juce::jmax (workspace.size(), (size_t) plans[(size_t) backend]->getWorkspaceSize()));
+        }
+
+        // 各后端轮流测量，频率调节和其他负载对它们的影响大致相同；先各做一次预热
+        for (int round = -1; round < numRounds; ++round)
+        {
+            for (int backend = 0; backend < RealFft::numBackends; ++backend)
+            {
+                for (int i = 0; i < size; ++i)
+                    data[(size_t) i] = random.nextFloat() - 0.5f;
+
+                const auto seconds = timeBackend (*plans[(size_t) backend], data, workspace, round < 0 ? 1 : numIterations);
+
+                if (round >= 0)
+                    bestSeconds[(size_t) backend] = juce::jmin (bestSeconds[(size_t) backend], seconds);
+            }
+        }
+
+        // 相差不到 5% 时保留 juce（编译 JUCE 时选的实现，通常也是各平台上测试最充分的）
+        const auto stockham = (size_t) RealFft::Backend::stockham;
+        const auto juceBackend = (size_t) RealFft::Backend::juce;
+
+        return bestSeconds[stockham] < bestSeconds[juceBackend] * 0.95 ? RealFft::Backend::stockham
+                                                                       : RealFft::Backend::juce;
+    }
+}
+
+//==============================================================================
+std::unique_ptr<RealFft> RealFft::create (Backend backend, int order)
+{
+    jassert (order >= 2);
+
+    if (backend == Backend::stockham)
+        return std::make_unique<StockhamRealFft> (order);
+
+    return std::make_unique<JuceRealFft> (order);
+}
+
+RealFft::Backend RealFft::getFastestBackend (int order)
+{
+    jassert (order >= minBenchmarkOrder && order <= maxBenchmarkOrder);
+
+    // 函数内的静态变量只初始化一次，多个实例同时 prepare() 时也只测一次
+    static const auto fastest = []
+    {
+        std::array<Backend, maxBenchmarkOrder - minBenchmarkOrder + 1> result {};
+
+        for (int o = minBenchmarkOrder; o <= maxBenchmarkOrder; ++o)
+            result[(size_t) (o - minBenchmarkOrder)] = measureFastestBackend (o);
+
+        return result;
+    }();
+
+    return fastest[(size_t) (juce::jlimit (minBenchmarkOrder, maxBenchmarkOrder, order) - minBenchmarkOrder)];
+}
+
+const char* RealFft::getBackendName (Backend backend) noexcept
+{
+    switch (backend)
+    {
+        case Backend::juce:      return "juce";
+        case Backend::stockham:  return "stockham";
+        default:                 return "unknown";
+    }
+}
+
+bool RealFft::parseBackendName (const juce::String& name, Backend& result) noexcept
+{
+    for (int backend = 0; backend < numBackends; ++backend)
+    {
+        if (name.equalsIgnoreCase (getBackendName ((Backend) backend)))
+        {
+            result = (Backend) backend;
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,73 @@
+/*
+  ==============================================================================
+
+    RealFft.h
+    引擎正向 / 逆向变换使用的实数 FFT 接口，背后可以换不同的实现（后端）。
+
+    - juce：juce::dsp::FFT，实现在编译 JUCE 时决定（macOS 上是 vDSP，开启 IPP / FFTW 时是它们，
+      否则是 JUCE 自带的通用复数 FFT）。
+    - stockham：本仓库里的实现，把 N 点实数变换折成 N/2 点复数 FFT（radix-4 Stockham，实部 / 虚部分开存放，
+      内层循环是连续访问，编译器可以直接向量化），再做一次分拆。不加锁、不分配内存。
+    两个后端的输入输出格式完全相同，引擎的 prepare() 按每种点数在当前 CPU 上各测一次，选最快的那个。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <memory>
+
+class RealFft
+{
+public:
+    enum class Backend
+    {
+        juce,
+        stockham
+    };
+
+    static constexpr int numBackends = 2;
+
+    virtual ~RealFft() = default;
+
+    int getOrder() const noexcept   { return order; }
+    int getSize() const noexcept    { return 1 << order; }
+
+    virtual Backend getBackend() const noexcept = 0;
+
+    // 每次变换需要的工作区大小（float 个数）。工作区由调用方按执行线程分配，
+    // 所以同一个 plan 可以在多个线程上同时使用
+    virtual int getWorkspaceSize() const noexcept = 0;
+
+    // data 长度为 2 * size：输入前 size 个实数样本，输出 bin 0 ~ size / 2 的交错复数 (re, im, re, im ...)，
+    // 与 juce::dsp::FFT::performRealOnlyForwardTransform (data, true) 相同，之后的内容未定义
+    virtual void forward (float* data, float* workspace) const noexcept = 0;
+
+    // 输入 bin 0 ~ size / 2 的交错复数（负频率按共轭对称补全），输出前 size 个实数样本，
+    // 已按 1 / size 归一化，与 performRealOnlyInverseTransform 相同
+    virtual void inverse (float* data, float* workspace) const noexcept = 0;
+
+    //==============================================================================
+    static std::unique_ptr<RealFft> create (Backend backend, int order);
+
+    // 在当前 CPU 上对每个后端计时（正向 + 逆向各若干次，取几轮里最好的一次），返回 order 点最快的后端。
+    // 第一次调用时测量 minBenchmarkOrder ~ maxBenchmarkOrder 的所有点数，约几十毫秒，结果在进程内缓存
+    static Backend getFastestBackend (int order);
+
+    static constexpr int minBenchmarkOrder = 8;
+    static constexpr int maxBenchmarkOrder = 15;
+
+    static const char* getBackendName (Backend backend) noexcept;
+    // "juce" / "stockham"，不区分大小写；无法识别时返回 false
+    static bool parseBackendName (const juce::String& name, Backend& result) noexcept;
+
+protected:
+    explicit RealFft (int fftOrder) noexcept : order (fftOrder) {}
+
+private:
+    const int order;
+
+    JUCE_DECLARE_NON_COPYABLE (RealFft)
+};
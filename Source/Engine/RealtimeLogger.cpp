@@ -0,0 +1,100 @@
+/*
+  ==============================================================================
+
+    RealtimeLogger.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeLogger.h"
+
+//==============================================================================
+// 所有 RealtimeLogger 共享一个后台线程，周期性地把各自 FIFO 里的条目取出来写日志。
+// lock 只在注册/注销和后台线程之间使用，音频线程不会碰它。
+class RealtimeLogThread  : private juce::Thread
+{
+public:
+    RealtimeLogThread()  : juce::Thread ("ExchangeBand log") {}
+
+    ~RealtimeLogThread() override
+    {
+        stopThread (1000);
+    }
+
+    void add (RealtimeLogger* logger)
+    {
+        const juce::ScopedLock sl (lock);
+        loggers.addIfNotAlreadyThere (logger);
+
+        if (! isThreadRunning())
+            startThread (juce::Thread::Priority::background);
+    }
+
+    void remove (RealtimeLogger* logger)
+    {
+        const juce::ScopedLock sl (lock);
+        loggers.removeFirstMatchingValue (logger);
+    }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            {
+                const juce::ScopedLock sl (lock);
+
+                for (auto* logger : loggers)
+                    logger->flush();
+            }
+
+            wait (50);
+        }
+    }
+
+    juce::CriticalSection lock;
+    juce::Array<RealtimeLogger*> loggers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeLogThread)
+};
+
+//==============================================================================
+RealtimeLogger::RealtimeLogger()
+{
+    logThread->add (this);
+}
+
+RealtimeLogger::~RealtimeLogger()
+{
+    logThread->remove (this);
+}
+
+void RealtimeLogger::post (const char* message, double value) noexcept
+{
+    const auto scope = fifo.write (1);
+
+    if (scope.blockSize1 + scope.blockSize2 == 0)
+    {
+        numDropped.fetch_add (1, std::memory_order_relaxed);
+        return;
+    }
+
+    entries[(size_t) (scope.blockSize1 > 0 ? scope.startIndex1 : scope.startIndex2)] = { message, value };
+}
+
+void RealtimeLogger::flush()
+{
+    const auto scope = fifo.read (fifo.getNumReady());
+
+    auto writeEntries = [this] (int start, int size)
+    {
+        for (int i = start; i < start + size; ++i)
+        {
+            const auto& entry = entries[(size_t) i];
+            juce::Logger::writeToLog (juce::String ("[ExchangeBand] ") + entry.message + " " + juce::String (entry.value));
+        }
+    };
+
+    writeEntries (scope.startIndex1, scope.blockSize1);
+    writeEntries (scope.startIndex2, scope.blockSize2);
+}
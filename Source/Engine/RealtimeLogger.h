@@ -0,0 +1,53 @@
+/*
+  ==============================================================================
+
+    RealtimeLogger.h
+    音频线程可以安全调用的诊断日志：post() 只往一个预分配的无锁 FIFO 里写入
+    (静态字符串指针 + 数值)，不分配内存也不格式化字符串；
+    真正的格式化和输出由一个共享的后台线程完成。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+
+class RealtimeLogThread;
+
+//==============================================================================
+class RealtimeLogger
+{
+public:
+    RealtimeLogger();
+    ~RealtimeLogger();
+
+    // 只能传入字符串字面量（或其他生命周期足够长的字符串），音频线程调用，wait-free
+    void post (const char* message, double value = 0.0) noexcept;
+
+    // FIFO 写满后被丢弃的条目数
+    int getNumDroppedMessages() const noexcept   { return numDropped.load (std::memory_order_relaxed); }
+
+private:
+    //==============================================================================
+    struct Entry
+    {
+        const char* message = nullptr;
+        double value = 0.0;
+    };
+
+    static constexpr int capacity = 256;
+
+    friend class RealtimeLogThread;
+    void flush(); // 只在后台线程上调用
+
+    juce::SharedResourcePointer<RealtimeLogThread> logThread;
+
+    juce::AbstractFifo fifo { capacity };
+    std::array<Entry, capacity> entries;
+    std::atomic<int> numDropped { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (RealtimeLogger)
+};
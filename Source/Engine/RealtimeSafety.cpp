@@ -0,0 +1,227 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.cpp
+
+  ==============================================================================
+*/
+
+#include "RealtimeSafety.h"
+
+#if EXCHANGEBAND_REALTIME_CHECKS
+
+#if ! (JUCE_LINUX && defined (__GLIBC__))
+ #error "EXCHANGEBAND_REALTIME_CHECKS is only supported on Linux with glibc"
+#endif
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <new>
+#include <pthread.h>
+#include <unistd.h>
+
+// 引擎库用 -fvisibility=hidden 编译，拦截函数必须显式导出，其他库的调用才会绑定到这里
+#define EXCHANGEBAND_INTERPOSE __attribute__ ((visibility ("default")))
+
+// glibc 导出的原始分配函数，拦截函数检查之后转发给它们
+extern "C"
+{
+    void* __libc_malloc (size_t);
+    void* __libc_calloc (size_t, size_t);
+    void* __libc_realloc (void*, size_t);
+    void* __libc_memalign (size_t, size_t);
+    void  __libc_free (void*);
+}
+
+namespace
+{
+    // initial-exec：在 malloc 里读写时不会因为分配动态 TLS 再次进入 malloc
+    thread_local int realtimeDepth __attribute__ ((tls_model ("initial-exec"))) = 0;
+    thread_local bool reporting __attribute__ ((tls_model ("initial-exec"))) = false;
+
+    std::atomic<juce::int64> numViolations { 0 };
+    std::atomic<bool> abortOnViolation { false };
+
+    void writeToStandardError (const char* text) noexcept
+    {
+        for (auto length = std::strlen (text); length > 0;)
+        {
+            const auto written = ::write (STDERR_FILENO, text, length);
+
+            if (written <= 0)
+                return;
+
+            text += written;
+            length -= (size_t) written;
+        }
+    }
+
+    // 只报告第一次违规（abort 模式下每次都报告，反正只有一次）
+    void reportViolation (const char* function, size_t size) noexcept
+    {
+        const auto shouldAbort = abortOnViolation.load (std::memory_order_relaxed);
+
+        if (numViolations.fetch_add (1, std::memory_order_relaxed) != 0 && ! shouldAbort)
+            return;
+
+        reporting = true;
+
+        char message[192];
+        std::snprintf (message, sizeof (message),
+                       "\n*** Realtime violation: %s (%zu bytes) on a realtime thread. Backtrace:\n", function, size);
+        writeToStandardError (message);
+
+        void* frames[64];
+        backtrace_symbols_fd (frames, backtrace (frames, (int) juce::numElementsInArray (frames)), STDERR_FILENO);
+        writeToStandardError ("*** Further violations are only counted (RealtimeSafety::getNumViolations()).\n\n");
+
+        reporting = false;
+
+        if (shouldAbort)
+            std::abort();
+    }
+
+    inline void check (const char* function, size_t size = 0) noexcept
+    {
+        if (realtimeDepth > 0 && ! reporting)
+            reportViolation (function, size);
+    }
+
+    // 原始的 pthread_mutex_lock（glibc 没有可以直接链接的别名），第一次使用时用 dlsym 查找
+    using MutexLockFunction = int (*) (pthread_mutex_t*);
+    std::atomic<MutexLockFunction> originalMutexLock { nullptr };
+
+    MutexLockFunction getOriginalMutexLock() noexcept
+    {
+        auto function = originalMutexLock.load (std::memory_order_acquire);
+
+        if (function == nullptr)
+        {
+            function = reinterpret_cast<MutexLockFunction> (dlsym (RTLD_NEXT, "pthread_mutex_lock"));
+            originalMutexLock.store (function, std::memory_order_release);
+        }
+
+        return function;
+    }
+
+    // backtrace() 第一次调用时会加载 libgcc_s，这一步会分配内存，所以在加载时先调用一次；
+    // pthread_mutex_lock 的原始实现也在这里先查好
+    struct Initialiser
+    {
+        Initialiser() noexcept
+        {
+            void* frame = nullptr;
+            backtrace (&frame, 1);
+            getOriginalMutexLock();
+
+            if (const auto* value = std::getenv ("EXCHANGEBAND_REALTIME_ABORT"))
+                abortOnViolation.store (value[0] == '1', std::memory_order_relaxed);
+        }
+    };
+
+    const Initialiser initialiser;
+
+    void* allocate (const char* function, size_t size, size_t alignment) noexcept
+    {
+        check (function, size);
+        return alignment > alignof (std::max_align_t) ? __libc_memalign (alignment, size) : __libc_malloc (size);
+    }
+
+    void* allocateOrThrow (const char* function, size_t size, size_t alignment = 0)
+    {
+        if (auto* result = allocate (function, size != 0 ? size : 1, alignment))
+            return result;
+
+        throw std::bad_alloc();
+    }
+
+    void deallocate (const char* function, void* pointer) noexcept
+    {
+        if (pointer != nullptr)
+            check (function);
+
+        __libc_free (pointer);
+    }
+}
+
+//==============================================================================
+juce::int64 RealtimeSafety::getNumViolations() noexcept            { return numViolations.load (std::memory_order_relaxed); }
+void RealtimeSafety::setAbortOnViolation (bool shouldAbort) noexcept { abortOnViolation.store (shouldAbort, std::memory_order_relaxed); }
+bool RealtimeSafety::isInRealtimeSection() noexcept                 { return realtimeDepth > 0; }
+void RealtimeSafety::enter() noexcept                               { ++realtimeDepth; }
+void RealtimeSafety::leave() noexcept                               { --realtimeDepth; }
+
+//==============================================================================
+// C 的分配函数和互斥锁
+extern "C"
+{
+    EXCHANGEBAND_INTERPOSE void* malloc (size_t size) noexcept                          { return allocate ("malloc", size, 0); }
+    EXCHANGEBAND_INTERPOSE void* calloc (size_t count, size_t size) noexcept            { check ("calloc", count * size); return __libc_calloc (count, size); }
+    EXCHANGEBAND_INTERPOSE void* realloc (void* pointer, size_t size) noexcept          { check ("realloc", size); return __libc_realloc (pointer, size); }
+    EXCHANGEBAND_INTERPOSE void free (void* pointer) noexcept                           { deallocate ("free", pointer); }
+    EXCHANGEBAND_INTERPOSE void* memalign (size_t alignment, size_t size) noexcept      { check ("memalign", size); return __libc_memalign (alignment, size); }
+    EXCHANGEBAND_INTERPOSE void* aligned_alloc (size_t alignment, size_t size) noexcept { check ("aligned_alloc", size); return __libc_memalign (alignment, size); }
+
+    EXCHANGEBAND_INTERPOSE int posix_memalign (void** result, size_t alignment, size_t size) noexcept
+    {
+        check ("posix_memalign", size);
+
+        if (alignment % sizeof (void*) != 0 || (alignment & (alignment - 1)) != 0)
+            return EINVAL;
+
+        auto* pointer = __libc_memalign (alignment, size);
+
+        if (pointer == nullptr)
+            return ENOMEM;
+
+        *result = pointer;
+        return 0;
+    }
+
+    EXCHANGEBAND_INTERPOSE int pthread_mutex_lock (pthread_mutex_t* mutex) noexcept
+    {
+        check ("pthread_mutex_lock");
+        return getOriginalMutexLock() (mutex);
+    }
+}
+
+//==============================================================================
+// 可替换的全局 operator new / delete：插件里标准库的 operator new 不经过这里的 malloc，需要单独拦截。
+// 分配失败时直接抛出 std::bad_alloc，不调用 new_handler（只用于调试构建）
+EXCHANGEBAND_INTERPOSE void* operator new (std::size_t size)                                                    { return allocateOrThrow ("operator new", size); }
+EXCHANGEBAND_INTERPOSE void* operator new[] (std::size_t size)                                                  { return allocateOrThrow ("operator new[]", size); }
+EXCHANGEBAND_INTERPOSE void* operator new (std::size_t size, std::align_val_t alignment)                        { return allocateOrThrow ("operator new", size, (size_t) alignment); }
+EXCHANGEBAND_INTERPOSE void* operator new[] (std::size_t size, std::align_val_t alignment)                      { return allocateOrThrow ("operator new[]", size, (size_t) alignment); }
+EXCHANGEBAND_INTERPOSE void* operator new (std::size_t size, const std::nothrow_t&) noexcept                    { return allocate ("operator new", size != 0 ? size : 1, 0); }
+EXCHANGEBAND_INTERPOSE void* operator new[] (std::size_t size, const std::nothrow_t&) noexcept                  { return allocate ("operator new[]", size != 0 ? size : 1, 0); }
+EXCHANGEBAND_INTERPOSE void* operator new (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept   { return allocate ("operator new", size != 0 ? size : 1, (size_t) alignment); }
+EXCHANGEBAND_INTERPOSE void* operator new[] (std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return allocate ("operator new[]", size != 0 ? size : 1, (size_t) alignment); }
+
+EXCHANGEBAND_INTERPOSE void operator delete (void* pointer) noexcept                                            { deallocate ("operator delete", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete[] (void* pointer) noexcept                                          { deallocate ("operator delete[]", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete (void* pointer, std::size_t) noexcept                               { deallocate ("operator delete", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete[] (void* pointer, std::size_t) noexcept                             { deallocate ("operator delete[]", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete (void* pointer, std::align_val_t) noexcept                          { deallocate ("operator delete", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete[] (void* pointer, std::align_val_t) noexcept                        { deallocate ("operator delete[]", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete (void* pointer, std::size_t, std::align_val_t) noexcept             { deallocate ("operator delete", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete[] (void* pointer, std::size_t, std::align_val_t) noexcept           { deallocate ("operator delete[]", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete (void* pointer, const std::nothrow_t&) noexcept                     { deallocate ("operator delete", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete[] (void* pointer, const std::nothrow_t&) noexcept                   { deallocate ("operator delete[]", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete (void* pointer, std::align_val_t, const std::nothrow_t&) noexcept   { deallocate ("operator delete", pointer); }
+EXCHANGEBAND_INTERPOSE void operator delete[] (void* pointer, std::align_val_t, const std::nothrow_t&) noexcept { deallocate ("operator delete[]", pointer); }
+
+#else
+
+juce::int64 RealtimeSafety::getNumViolations() noexcept       { return 0; }
+void RealtimeSafety::setAbortOnViolation (bool) noexcept      {}
+bool RealtimeSafety::isInRealtimeSection() noexcept           { return false; }
+void RealtimeSafety::enter() noexcept                         {}
+void RealtimeSafety::leave() noexcept                         {}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+  ==============================================================================
+
+    RealtimeSafety.h
+    调试 / CI 用的实时安全检查。编译时定义 EXCHANGEBAND_REALTIME_CHECKS=1 后，
+    在实时区段里（音频回调，以及替它处理通道的工作线程）调用 malloc / free / operator new / delete
+    或 pthread_mutex_lock，会把第一次违规连同调用栈打印到 stderr，之后的违规只计数。
+
+    - 区段用 EXCHANGEBAND_REALTIME_SECTION() 在当前作用域内标记，可以嵌套；检查关闭时宏展开为空，没有任何开销。
+    - 拦截是在 RealtimeSafety.cpp 里定义同名函数，再转发给 glibc 的 __libc_malloc 等实现，只支持 Linux + glibc。
+      链接进可执行文件（ExchangeBandTests、ExchangeBandRender 等）时覆盖进程里所有库的调用；
+      插件是宿主用 dlopen 加载的共享库，要加链接选项 -Wl,-Bsymbolic-functions，
+      插件自身（包括编译进插件的 JUCE）的调用才会绑定到这里。
+    - 报告本身不分配内存、不加锁：直接 write() 到 stderr，调用栈用 backtrace_symbols_fd()。
+    - setAbortOnViolation (true) 或环境变量 EXCHANGEBAND_REALTIME_ABORT=1 时报告后直接 abort()，适合 CI。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+
+#ifndef EXCHANGEBAND_REALTIME_CHECKS
+ #define EXCHANGEBAND_REALTIME_CHECKS 0
+#endif
+
+//==============================================================================
+class RealtimeSafety
+{
+public:
+    static constexpr bool isCompiledIn() noexcept   { return EXCHANGEBAND_REALTIME_CHECKS != 0; }
+
+    // 任意线程：到目前为止所有线程上的违规次数（检查关闭时为 0）
+    static juce::int64 getNumViolations() noexcept;
+
+    // 任意线程：报告之后是否直接 abort()
+    static void setAbortOnViolation (bool shouldAbort) noexcept;
+
+    // 当前线程是否在实时区段里
+    static bool isInRealtimeSection() noexcept;
+
+    // 作用域内当前线程处于实时区段，通过 EXCHANGEBAND_REALTIME_SECTION 使用
+    class ScopedRealtimeSection
+    {
+    public:
+        ScopedRealtimeSection() noexcept    { enter(); }
+        ~ScopedRealtimeSection() noexcept   { leave(); }
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedRealtimeSection)
+    };
+
+private:
+    static void enter() noexcept;
+    static void leave() noexcept;
+
+    RealtimeSafety() = delete;
+};
+
+// 把当前作用域标记为实时区段；EXCHANGEBAND_REALTIME_CHECKS=0 时什么都不生成
+#if EXCHANGEBAND_REALTIME_CHECKS
+ #define EXCHANGEBAND_REALTIME_SECTION() \
+    const RealtimeSafety::ScopedRealtimeSection JUCE_JOIN_MACRO (realtimeSection_, __LINE__)
+#else
+ #define EXCHANGEBAND_REALTIME_SECTION()
+#endif
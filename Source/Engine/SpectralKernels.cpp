@@ -0,0 +1,486 @@
+/*
+  ==============================================================================
+
+    SpectralKernels.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectralKernels.h"
+#include <juce_core/juce_core.h>
+#include <cmath>
+
+#if JUCE_INTEL
+ #include <immintrin.h>
+ #if JUCE_MSVC
+  #include <intrin.h>
+ #else
+  #include <cpuid.h>
+ #endif
+ #define EXCHANGEBAND_KERNELS_X86 1
+#elif JUCE_ARM && (defined (__aarch64__) || defined (_M_ARM64))
+ #include <arm_neon.h>
+ #define EXCHANGEBAND_KERNELS_NEON 1
+#endif
+
+namespace SpectralKernels
+{
+
+//==============================================================================
+// 标量近似，所有向量实现的尾部也用它们。向量部分在有 FMA 的指令集上用融合乘加，
+// 所以各指令集之间、向量部分与尾部之间可能差最后一两位，但用的是同一组多项式
+namespace FastMath
+{
+    constexpr float pi        = 3.14159265358979f;
+    constexpr float halfPi    = 1.57079632679490f;
+    constexpr float twoOverPi = 0.63661977236758f;
+    constexpr float tiny      = 1.0e-30f;
+
+    // atan(a) = a * P(a^2), a ∈ [0, 1]，最大误差约 4e-6 rad
+    constexpr float atanC0 =  0.999995630f;
+    constexpr float atanC1 = -0.332994597f;
+    constexpr float atanC2 =  0.195635925f;
+    constexpr float atanC3 = -0.121239071f;
+    constexpr float atanC4 =  0.057477314f;
+    constexpr float atanC5 = -0.013480470f;
+
+    // Cody-Waite 区间缩减用的 pi/2 高低位
+    constexpr float halfPiHigh = 1.5707963705062866f;
+    constexpr float halfPiLow  = -4.371139000186243e-8f;
+
+    // [-pi/4, pi/4] 上的 sin / cos 多项式（Cephes）
+    constexpr float sinC1 = -1.6666654611e-1f;
+    constexpr float sinC2 =  8.3321608736e-3f;
+    constexpr float sinC3 = -1.9515295891e-4f;
+    constexpr float cosC1 =  4.166664568298827e-2f;
+    constexpr float cosC2 = -1.388731625493765e-3f;
+    constexpr float cosC3 =  2.443315711809948e-5f;
+
+    static inline float atan2 (float y, float x) noexcept
+    {
+        const auto ax = std::abs (x);
+        const auto ay = std::abs (y);
+        const auto a = std::min (ax, ay) / std::max (std::max (ax, ay), tiny);
+        const auto s = a * a;
+
+        auto r = (((((atanC5 * s + atanC4) * s + atanC3) * s + atanC2) * s + atanC1) * s + atanC0) * a;
+
+        if (ay > ax)   r = halfPi - r;
+        if (x < 0.0f)  r = pi - r;
+        return y < 0.0f ? -r : r;
+    }
+
+    static inline void sinCos (float x, float& sinOut, float& cosOut) noexcept
+    {
+        const auto j = std::nearbyint (x * twoOverPi);
+        auto r = x - j * halfPiHigh;
+        r = r - j * halfPiLow;
+        const auto z = r * r;
+
+        const auto sinR = ((sinC3 * z + sinC2) * z + sinC1) * z * r + r;
+        const auto cosR = z * z * ((cosC3 * z + cosC2) * z + cosC1) + (1.0f - 0.5f * z);
+
+        const auto q = (int) j & 3;
+        const auto s = (q & 1) != 0 ? cosR : sinR;
+        const auto c = (q & 1) != 0 ? sinR : cosR;
+        sinOut = (q & 2) != 0 ? -s : s;
+        cosOut = ((q + 1) & 2) != 0 ? -c : c;
+    }
+}
+
+//==============================================================================
+// 参考实现：逐元素、不依赖任何 SIMD
+namespace scalar
+{
+    static void blend (float* destination, const float* a, float gainA, const float* b, float gainB, int numValues) noexcept
+    {
+        for (int i = 0; i < numValues; ++i)
+            destination[i] = a[i] * gainA + b[i] * gainB;
+    }
+
+    static void blendWithGains (float* destination, const float* a, const float* gainA,
+                                const float* b, const float* gainB, int numValues) noexcept
+    {
+        for (int i = 0; i < numValues; ++i)
+            destination[i] = a[i] * gainA[i] + b[i] * gainB[i];
+    }
+
+    static void accumulateWithGains (float* destination, const float* a, const float* gainA,
+                                     const float* b, const float* gainB, float weight, int numValues) noexcept
+    {
+        for (int i = 0; i < numValues; ++i)
+            destination[i] += (a[i] * gainA[i] + b[i] * gainB[i]) * weight;
+    }
+
+    static void cartesianToPolarExact (const float* interleaved, float* magnitude, float* phase, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const auto re = interleaved[2 * bin];
+            const auto im = interleaved[2 * bin + 1];
+            magnitude[bin] = std::sqrt (re * re + im * im);
+            phase[bin] = std::atan2 (im, re);
+        }
+    }
+
+    static void cartesianToPolarFast (const float* interleaved, float* magnitude, float* phase, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            const auto re = interleaved[2 * bin];
+            const auto im = interleaved[2 * bin + 1];
+            magnitude[bin] = std::sqrt (re * re + im * im);
+            phase[bin] = FastMath::atan2 (im, re);
+        }
+    }
+
+    static void polarToCartesianExact (const float* magnitude, const float* phase, float* interleaved, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            interleaved[2 * bin]     = magnitude[bin] * std::cos (phase[bin]);
+            interleaved[2 * bin + 1] = magnitude[bin] * std::sin (phase[bin]);
+        }
+    }
+
+    static void polarToCartesianFast (const float* magnitude, const float* phase, float* interleaved, int numBins) noexcept
+    {
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            float s, c;
+            FastMath::sinCos (phase[bin], s, c);
+            interleaved[2 * bin]     = magnitude[bin] * c;
+            interleaved[2 * bin + 1] = magnitude[bin] * s;
+        }
+    }
+
+    const Table exactTable { InstructionSet::scalar, Accuracy::exact, blend, blendWithGains, accumulateWithGains, cartesianToPolarExact, polarToCartesianExact };
+    const Table fastTable  { InstructionSet::scalar, Accuracy::fast,  blend, blendWithGains, accumulateWithGains, cartesianToPolarFast,  polarToCartesianFast };
+}
+
+//==============================================================================
+// 各指令集的实现：Ops 只包装 intrinsic，算法本身在 SpectralKernelsImpl.h 里。
+// GCC / Clang 用 target pragma 单独为这一段打开对应的指令集，其余代码仍按基线编译，
+// 所以运行时检测到不支持时永远不会执行到这些指令
+#if EXCHANGEBAND_KERNELS_X86
+
+#if defined (__clang__)
+ #pragma clang attribute push (__attribute__ ((target ("sse2"))), apply_to = function)
+#elif defined (__GNUC__)
+ #pragma GCC push_options
+ #pragma GCC target ("sse2")
+#endif
+
+namespace sse2
+{
+    constexpr auto instructionSet = InstructionSet::sse2;
+
+    struct Ops
+    {
+        using Vec = __m128;
+        using Mask = __m128;
+        static constexpr int width = 4;
+
+        static Vec load (const float* p) noexcept                    { return _mm_loadu_ps (p); }
+        static void store (float* p, Vec v) noexcept                 { _mm_storeu_ps (p, v); }
+        static Vec set (float v) noexcept                            { return _mm_set1_ps (v); }
+        static Vec add (Vec a, Vec b) noexcept                       { return _mm_add_ps (a, b); }
+        static Vec sub (Vec a, Vec b) noexcept                       { return _mm_sub_ps (a, b); }
+        static Vec mul (Vec a, Vec b) noexcept                       { return _mm_mul_ps (a, b); }
+        static Vec div (Vec a, Vec b) noexcept                       { return _mm_div_ps (a, b); }
+        static Vec mulAdd (Vec a, Vec b, Vec c) noexcept             { return _mm_add_ps (_mm_mul_ps (a, b), c); }
+        static Vec min (Vec a, Vec b) noexcept                       { return _mm_min_ps (a, b); }
+        static Vec max (Vec a, Vec b) noexcept                       { return _mm_max_ps (a, b); }
+        static Vec abs (Vec a) noexcept                              { return _mm_andnot_ps (_mm_set1_ps (-0.0f), a); }
+        static Vec sqrt (Vec a) noexcept                             { return _mm_sqrt_ps (a); }
+        static Vec round (Vec a) noexcept                            { return _mm_cvtepi32_ps (_mm_cvtps_epi32 (a)); }
+        static Mask greaterThan (Vec a, Vec b) noexcept              { return _mm_cmpgt_ps (a, b); }
+        static Mask lessThan (Vec a, Vec b) noexcept                 { return _mm_cmplt_ps (a, b); }
+        static Vec select (Mask m, Vec a, Vec b) noexcept            { return _mm_or_ps (_mm_and_ps (m, a), _mm_andnot_ps (m, b)); }
+
+        static void loadDeinterleaved (const float* p, Vec& re, Vec& im) noexcept
+        {
+            const auto lo = _mm_loadu_ps (p);
+            const auto hi = _mm_loadu_ps (p + 4);
+            re = _mm_shuffle_ps (lo, hi, _MM_SHUFFLE (2, 0, 2, 0));
+            im = _mm_shuffle_ps (lo, hi, _MM_SHUFFLE (3, 1, 3, 1));
+        }
+
+        static void storeInterleaved (float* p, Vec re, Vec im) noexcept
+        {
+            _mm_storeu_ps (p,     _mm_unpacklo_ps (re, im));
+            _mm_storeu_ps (p + 4, _mm_unpackhi_ps (re, im));
+        }
+    };
+
+    #include "SpectralKernelsImpl.h"
+}
+
+#if defined (__clang__)
+ #pragma clang attribute pop
+ #pragma clang attribute push (__attribute__ ((target ("avx2,fma"))), apply_to = function)
+#elif defined (__GNUC__)
+ #pragma GCC pop_options
+ #pragma GCC push_options
+ #pragma GCC target ("avx2,fma")
+#endif
+
+namespace avx2
+{
+    constexpr auto instructionSet = InstructionSet::avx2;
+
+    struct Ops
+    {
+        using Vec = __m256;
+        using Mask = __m256;
+        static constexpr int width = 8;
+
+        static Vec load (const float* p) noexcept                    { return _mm256_loadu_ps (p); }
+        static void store (float* p, Vec v) noexcept                 { _mm256_storeu_ps (p, v); }
+        static Vec set (float v) noexcept                            { return _mm256_set1_ps (v); }
+        static Vec add (Vec a, Vec b) noexcept                       { return _mm256_add_ps (a, b); }
+        static Vec sub (Vec a, Vec b) noexcept                       { return _mm256_sub_ps (a, b); }
+        static Vec mul (Vec a, Vec b) noexcept                       { return _mm256_mul_ps (a, b); }
+        static Vec div (Vec a, Vec b) noexcept                       { return _mm256_div_ps (a, b); }
+        static Vec mulAdd (Vec a, Vec b, Vec c) noexcept             { return _mm256_fmadd_ps (a, b, c); }
+        static Vec min (Vec a, Vec b) noexcept                       { return _mm256_min_ps (a, b); }
+        static Vec max (Vec a, Vec b) noexcept                       { return _mm256_max_ps (a, b); }
+        static Vec abs (Vec a) noexcept                              { return _mm256_andnot_ps (_mm256_set1_ps (-0.0f), a); }
+        static Vec sqrt (Vec a) noexcept                             { return _mm256_sqrt_ps (a); }
+        static Vec round (Vec a) noexcept                            { return _mm256_round_ps (a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static Mask greaterThan (Vec a, Vec b) noexcept              { return _mm256_cmp_ps (a, b, _CMP_GT_OQ); }
+        static Mask lessThan (Vec a, Vec b) noexcept                 { return _mm256_cmp_ps (a, b, _CMP_LT_OQ); }
+        static Vec select (Mask m, Vec a, Vec b) noexcept            { return _mm256_blendv_ps (b, a, m); }
+
+        static void loadDeinterleaved (const float* p, Vec& re, Vec& im) noexcept
+        {
+            // shuffle 只在 128 位 lane 内进行，之后再把 64 位块排回顺序
+            const auto lo = _mm256_loadu_ps (p);
+            const auto hi = _mm256_loadu_ps (p + 8);
+            const auto reLanes = _mm256_shuffle_ps (lo, hi, _MM_SHUFFLE (2, 0, 2, 0));
+            const auto imLanes = _mm256_shuffle_ps (lo, hi, _MM_SHUFFLE (3, 1, 3, 1));
+            re = _mm256_castpd_ps (_mm256_permute4x64_pd (_mm256_castps_pd (reLanes), _MM_SHUFFLE (3, 1, 2, 0)));
+            im = _mm256_castpd_ps (_mm256_permute4x64_pd (_mm256_castps_pd (imLanes), _MM_SHUFFLE (3, 1, 2, 0)));
+        }
+
+        static void storeInterleaved (float* p, Vec re, Vec im) noexcept
+        {
+            const auto lo = _mm256_unpacklo_ps (re, im);
+            const auto hi = _mm256_unpackhi_ps (re, im);
+            _mm256_storeu_ps (p,     _mm256_permute2f128_ps (lo, hi, 0x20));
+            _mm256_storeu_ps (p + 8, _mm256_permute2f128_ps (lo, hi, 0x31));
+        }
+    };
+
+    #include "SpectralKernelsImpl.h"
+}
+
+#if defined (__clang__)
+ #pragma clang attribute pop
+ #pragma clang attribute push (__attribute__ ((target ("avx512f"))), apply_to = function)
+#elif defined (__GNUC__)
+ #pragma GCC pop_options
+ #pragma GCC push_options
+ #pragma GCC target ("avx512f")
+#endif
+
+namespace avx512
+{
+    constexpr auto instructionSet = InstructionSet::avx512;
+
+    struct Ops
+    {
+        using Vec = __m512;
+        using Mask = __mmask16;
+        static constexpr int width = 16;
+
+        static Vec load (const float* p) noexcept                    { return _mm512_loadu_ps (p); }
+        static void store (float* p, Vec v) noexcept                 { _mm512_storeu_ps (p, v); }
+        static Vec set (float v) noexcept                            { return _mm512_set1_ps (v); }
+        static Vec add (Vec a, Vec b) noexcept                       { return _mm512_add_ps (a, b); }
+        static Vec sub (Vec a, Vec b) noexcept                       { return _mm512_sub_ps (a, b); }
+        static Vec mul (Vec a, Vec b) noexcept                       { return _mm512_mul_ps (a, b); }
+        static Vec div (Vec a, Vec b) noexcept                       { return _mm512_div_ps (a, b); }
+        static Vec mulAdd (Vec a, Vec b, Vec c) noexcept             { return _mm512_fmadd_ps (a, b, c); }
+        static Vec min (Vec a, Vec b) noexcept                       { return _mm512_min_ps (a, b); }
+        static Vec max (Vec a, Vec b) noexcept                       { return _mm512_max_ps (a, b); }
+        static Vec abs (Vec a) noexcept                              { return _mm512_abs_ps (a); }
+        static Vec sqrt (Vec a) noexcept                             { return _mm512_sqrt_ps (a); }
+        static Vec round (Vec a) noexcept                            { return _mm512_roundscale_ps (a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+        static Mask greaterThan (Vec a, Vec b) noexcept              { return _mm512_cmp_ps_mask (a, b, _CMP_GT_OQ); }
+        static Mask lessThan (Vec a, Vec b) noexcept                 { return _mm512_cmp_ps_mask (a, b, _CMP_LT_OQ); }
+        static Vec select (Mask m, Vec a, Vec b) noexcept            { return _mm512_mask_blend_ps (m, b, a); }
+
+        static void loadDeinterleaved (const float* p, Vec& re, Vec& im) noexcept
+        {
+            const auto lo = _mm512_loadu_ps (p);
+            const auto hi = _mm512_loadu_ps (p + 16);
+            re = _mm512_permutex2var_ps (lo, _mm512_setr_epi32 (0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30), hi);
+            im = _mm512_permutex2var_ps (lo, _mm512_setr_epi32 (1, 3, 5, 7, 9, 11, 13, 15, 17, 19, 21, 23, 25, 27, 29, 31), hi);
+        }
+
+        static void storeInterleaved (float* p, Vec re, Vec im) noexcept
+        {
+            _mm512_storeu_ps (p,      _mm512_permutex2var_ps (re, _mm512_setr_epi32 (0, 16, 1, 17, 2, 18, 3, 19, 4, 20, 5, 21, 6, 22, 7, 23), im));
+            _mm512_storeu_ps (p + 16, _mm512_permutex2var_ps (re, _mm512_setr_epi32 (8, 24, 9, 25, 10, 26, 11, 27, 12, 28, 13, 29, 14, 30, 15, 31), im));
+        }
+    };
+
+    #include "SpectralKernelsImpl.h"
+}
+
+#if defined (__clang__)
+ #pragma clang attribute pop
+#elif defined (__GNUC__)
+ #pragma GCC pop_options
+#endif
+
+#endif // EXCHANGEBAND_KERNELS_X86
+
+//==============================================================================
+#if EXCHANGEBAND_KERNELS_NEON
+
+namespace neon
+{
+    constexpr auto instructionSet = InstructionSet::neon;
+
+    struct Ops
+    {
+        using Vec = float32x4_t;
+        using Mask = uint32x4_t;
+        static constexpr int width = 4;
+
+        static Vec load (const float* p) noexcept                    { return vld1q_f32 (p); }
+        static void store (float* p, Vec v) noexcept                 { vst1q_f32 (p, v); }
+        static Vec set (float v) noexcept                            { return vdupq_n_f32 (v); }
+        static Vec add (Vec a, Vec b) noexcept                       { return vaddq_f32 (a, b); }
+        static Vec sub (Vec a, Vec b) noexcept                       { return vsubq_f32 (a, b); }
+        static Vec mul (Vec a, Vec b) noexcept                       { return vmulq_f32 (a, b); }
+        static Vec div (Vec a, Vec b) noexcept                       { return vdivq_f32 (a, b); }
+        static Vec mulAdd (Vec a, Vec b, Vec c) noexcept             { return vfmaq_f32 (c, a, b); }
+        static Vec min (Vec a, Vec b) noexcept                       { return vminq_f32 (a, b); }
+        static Vec max (Vec a, Vec b) noexcept                       { return vmaxq_f32 (a, b); }
+        static Vec abs (Vec a) noexcept                              { return vabsq_f32 (a); }
+        static Vec sqrt (Vec a) noexcept                             { return vsqrtq_f32 (a); }
+        static Vec round (Vec a) noexcept                            { return vrndnq_f32 (a); }
+        static Mask greaterThan (Vec a, Vec b) noexcept              { return vcgtq_f32 (a, b); }
+        static Mask lessThan (Vec a, Vec b) noexcept                 { return vcltq_f32 (a, b); }
+        static Vec select (Mask m, Vec a, Vec b) noexcept            { return vbslq_f32 (m, a, b); }
+
+        static void loadDeinterleaved (const float* p, Vec& re, Vec& im) noexcept
+        {
+            const auto pair = vld2q_f32 (p);
+            re = pair.val[0];
+            im = pair.val[1];
+        }
+
+        static void storeInterleaved (float* p, Vec re, Vec im) noexcept
+        {
+            float32x4x2_t pair;
+            pair.val[0] = re;
+            pair.val[1] = im;
+            vst2q_f32 (p, pair);
+        }
+    };
+
+    #include "SpectralKernelsImpl.h"
+}
+
+#endif // EXCHANGEBAND_KERNELS_NEON
+
+//==============================================================================
+#if EXCHANGEBAND_KERNELS_X86
+// XCR0 里 AVX 需要的 XMM / YMM 状态位，以及 AVX-512 另外需要的 opmask / ZMM 状态位
+constexpr unsigned long long xcr0AvxState    = 0x06;
+constexpr unsigned long long xcr0Avx512State = 0xe6;
+
+// CPUID 的 AVX2 / AVX-512 位只说明 CPU 支持这些指令；YMM / ZMM 寄存器还要由操作系统在上下文切换时保存
+// （OSXSAVE 置位且 XCR0 打开对应的状态位），否则执行到这些指令就是 SIGILL。
+// 关掉了 AVX 的虚拟机和内核就是这种情况
+static bool isVectorStateEnabledByOs (unsigned long long requiredXcr0Bits) noexcept
+{
+   #if JUCE_MSVC
+    int info[4] {};
+    __cpuid (info, 1);
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+   #else
+    unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+    const bool osxsave = __get_cpuid (1, &eax, &ebx, &ecx, &edx) != 0 && (ecx & (1u << 27)) != 0;
+   #endif
+
+    if (! osxsave)
+        return false;
+
+   #if JUCE_MSVC
+    const auto xcr0 = (unsigned long long) _xgetbv (0);
+   #else
+    // 不用 _xgetbv()：GCC 要求调用它的函数打开 xsave 目标，xgetbv 本身在 OSXSAVE 置位时总是可用
+    unsigned int low = 0, high = 0;
+    __asm__ volatile ("xgetbv" : "=a" (low), "=d" (high) : "c" (0));
+    const auto xcr0 = ((unsigned long long) high << 32) | low;
+   #endif
+
+    return (xcr0 & requiredXcr0Bits) == requiredXcr0Bits;
+}
+#endif
+
+const Table& getScalarTable (Accuracy accuracy) noexcept
+{
+    return accuracy == Accuracy::fast ? scalar::fastTable : scalar::exactTable;
+}
+
+const Table* getTable (InstructionSet instructionSet, Accuracy accuracy) noexcept
+{
+    const auto pick = [accuracy] (const Table& exact, const Table& fast) { return accuracy == Accuracy::fast ? &fast : &exact; };
+
+    switch (instructionSet)
+    {
+        case InstructionSet::scalar:
+            return &getScalarTable (accuracy);
+
+       #if EXCHANGEBAND_KERNELS_X86
+        case InstructionSet::sse2:
+            return juce::SystemStats::hasSSE2() ? pick (sse2::exactTable, sse2::fastTable) : nullptr;
+
+        case InstructionSet::avx2:
+            return juce::SystemStats::hasAVX2() && juce::SystemStats::hasFMA3() && isVectorStateEnabledByOs (xcr0AvxState)
+                     ? pick (avx2::exactTable, avx2::fastTable) : nullptr;
+
+        case InstructionSet::avx512:
+            return juce::SystemStats::hasAVX512F() && isVectorStateEnabledByOs (xcr0Avx512State)
+                     ? pick (avx512::exactTable, avx512::fastTable) : nullptr;
+       #endif
+
+       #if EXCHANGEBAND_KERNELS_NEON
+        case InstructionSet::neon:
+            return pick (neon::exactTable, neon::fastTable);
+       #endif
+
+        default:
+            return nullptr;
+    }
+}
+
+const Table& getBestTable (Accuracy accuracy) noexcept
+{
+    for (auto instructionSet : { InstructionSet::avx512, InstructionSet::avx2, InstructionSet::neon, InstructionSet::sse2 })
+        if (auto* table = getTable (instructionSet, accuracy))
+            return *table;
+
+    return getScalarTable (accuracy);
+}
+
+const char* getInstructionSetName (InstructionSet instructionSet) noexcept
+{
+    switch (instructionSet)
+    {
+        case InstructionSet::scalar:  return "scalar";
+        case InstructionSet::sse2:    return "SSE2";
+        case InstructionSet::avx2:    return "AVX2";
+        case InstructionSet::avx512:  return "AVX-512";
+        case InstructionSet::neon:    return "NEON";
+        default:                      return "unknown";
+    }
+}
+
+} // namespace SpectralKernels
@@ -0,0 +1,169 @@
+/*
+  ==============================================================================
+
+    SpectralKernelsImpl.h
+    SpectralKernels.cpp 在每个指令集的 namespace 里各包含一次（所以没有 include guard），
+    使用外层 namespace 定义的 Ops（向量操作）和 instructionSet。
+    余下不足一个向量宽度的尾部用 FastMath 里的标量版本。多项式相同，但向量部分的 mulAdd 在有 FMA 的
+    指令集上是融合乘加，尾部不是，两者可能差最后一两位（远小于 Accuracy::fast 本身的误差）。
+
+  ==============================================================================
+*/
+
+//==============================================================================
+static inline Ops::Vec atan2Fast (Ops::Vec y, Ops::Vec x) noexcept
+{
+    const auto ax = Ops::abs (x);
+    const auto ay = Ops::abs (y);
+    const auto a = Ops::div (Ops::min (ax, ay), Ops::max (Ops::max (ax, ay), Ops::set (FastMath::tiny)));
+    const auto s = Ops::mul (a, a);
+
+    auto p = Ops::mulAdd (Ops::set (FastMath::atanC5), s, Ops::set (FastMath::atanC4));
+    p = Ops::mulAdd (p, s, Ops::set (FastMath::atanC3));
+    p = Ops::mulAdd (p, s, Ops::set (FastMath::atanC2));
+    p = Ops::mulAdd (p, s, Ops::set (FastMath::atanC1));
+    p = Ops::mulAdd (p, s, Ops::set (FastMath::atanC0));
+    auto r = Ops::mul (p, a);
+
+    r = Ops::select (Ops::greaterThan (ay, ax), Ops::sub (Ops::set (FastMath::halfPi), r), r);
+    r = Ops::select (Ops::lessThan (x, Ops::set (0.0f)), Ops::sub (Ops::set (FastMath::pi), r), r);
+    return Ops::select (Ops::lessThan (y, Ops::set (0.0f)), Ops::sub (Ops::set (0.0f), r), r);
+}
+
+static inline void sinCosFast (Ops::Vec x, Ops::Vec& sinOut, Ops::Vec& cosOut) noexcept
+{
+    // 按 pi/2 取整做区间缩减，r 落在 [-pi/4, pi/4]
+    const auto j = Ops::round (Ops::mul (x, Ops::set (FastMath::twoOverPi)));
+    auto r = Ops::mulAdd (j, Ops::set (-FastMath::halfPiHigh), x);
+    r = Ops::mulAdd (j, Ops::set (-FastMath::halfPiLow), r);
+    const auto z = Ops::mul (r, r);
+
+    auto sp = Ops::mulAdd (Ops::set (FastMath::sinC3), z, Ops::set (FastMath::sinC2));
+    sp = Ops::mulAdd (sp, z, Ops::set (FastMath::sinC1));
+    const auto sinR = Ops::mulAdd (Ops::mul (sp, z), r, r);
+
+    auto cp = Ops::mulAdd (Ops::set (FastMath::cosC3), z, Ops::set (FastMath::cosC2));
+    cp = Ops::mulAdd (cp, z, Ops::set (FastMath::cosC1));
+    const auto cosR = Ops::mulAdd (Ops::mul (z, z), cp, Ops::mulAdd (z, Ops::set (-0.5f), Ops::set (1.0f)));
+
+    // 象限 q = j mod 4，全部用浮点比较，不需要整数向量指令
+    const auto q = Ops::mulAdd (Ops::round (Ops::mulAdd (j, Ops::set (0.25f), Ops::set (-0.375f))), Ops::set (-4.0f), j);
+    const auto odd = Ops::mulAdd (Ops::round (Ops::mulAdd (q, Ops::set (0.5f), Ops::set (-0.25f))), Ops::set (-2.0f), q);
+
+    const auto swap = Ops::greaterThan (odd, Ops::set (0.5f));
+    const auto sinNegative = Ops::greaterThan (q, Ops::set (1.5f));
+    const auto cosNegative = Ops::lessThan (Ops::abs (Ops::sub (q, Ops::set (1.5f))), Ops::set (1.0f));
+
+    const auto s = Ops::select (swap, cosR, sinR);
+    const auto c = Ops::select (swap, sinR, cosR);
+    sinOut = Ops::select (sinNegative, Ops::sub (Ops::set (0.0f), s), s);
+    cosOut = Ops::select (cosNegative, Ops::sub (Ops::set (0.0f), c), c);
+}
+
+//==============================================================================
+static void blend (float* destination, const float* a, float gainA, const float* b, float gainB, int numValues) noexcept
+{
+    const auto ga = Ops::set (gainA);
+    const auto gb = Ops::set (gainB);
+    int i = 0;
+
+    for (; i + Ops::width <= numValues; i += Ops::width)
+        Ops::store (destination + i, Ops::mulAdd (Ops::load (a + i), ga, Ops::mul (Ops::load (b + i), gb)));
+
+    for (; i < numValues; ++i)
+        destination[i] = a[i] * gainA + b[i] * gainB;
+}
+
+static void blendWithGains (float* destination, const float* a, const float* gainA,
+                            const float* b, const float* gainB, int numValues) noexcept
+{
+    int i = 0;
+
+    for (; i + Ops::width <= numValues; i += Ops::width)
+        Ops::store (destination + i, Ops::mulAdd (Ops::load (a + i), Ops::load (gainA + i),
+                                                  Ops::mul (Ops::load (b + i), Ops::load (gainB + i))));
+
+    for (; i < numValues; ++i)
+        destination[i] = a[i] * gainA[i] + b[i] * gainB[i];
+}
+
+static void accumulateWithGains (float* destination, const float* a, const float* gainA,
+                                 const float* b, const float* gainB, float weight, int numValues) noexcept
+{
+    const auto w = Ops::set (weight);
+    int i = 0;
+
+    for (; i + Ops::width <= numValues; i += Ops::width)
+    {
+        const auto sum = Ops::mulAdd (Ops::load (a + i), Ops::load (gainA + i), Ops::mul (Ops::load (b + i), Ops::load (gainB + i)));
+        Ops::store (destination + i, Ops::mulAdd (sum, w, Ops::load (destination + i)));
+    }
+
+    for (; i < numValues; ++i)
+        destination[i] += (a[i] * gainA[i] + b[i] * gainB[i]) * weight;
+}
+
+static void cartesianToPolarExact (const float* interleaved, float* magnitude, float* phase, int numBins) noexcept
+{
+    int bin = 0;
+
+    for (; bin + Ops::width <= numBins; bin += Ops::width)
+    {
+        Ops::Vec re, im;
+        Ops::loadDeinterleaved (interleaved + 2 * bin, re, im);
+        Ops::store (magnitude + bin, Ops::sqrt (Ops::mulAdd (re, re, Ops::mul (im, im))));
+    }
+
+    for (; bin < numBins; ++bin)
+        magnitude[bin] = std::sqrt (interleaved[2 * bin] * interleaved[2 * bin] + interleaved[2 * bin + 1] * interleaved[2 * bin + 1]);
+
+    // 精确模式下相位仍然逐个调用 std::atan2
+    for (bin = 0; bin < numBins; ++bin)
+        phase[bin] = std::atan2 (interleaved[2 * bin + 1], interleaved[2 * bin]);
+}
+
+static void cartesianToPolarFast (const float* interleaved, float* magnitude, float* phase, int numBins) noexcept
+{
+    int bin = 0;
+
+    for (; bin + Ops::width <= numBins; bin += Ops::width)
+    {
+        Ops::Vec re, im;
+        Ops::loadDeinterleaved (interleaved + 2 * bin, re, im);
+        Ops::store (magnitude + bin, Ops::sqrt (Ops::mulAdd (re, re, Ops::mul (im, im))));
+        Ops::store (phase + bin, atan2Fast (im, re));
+    }
+
+    for (; bin < numBins; ++bin)
+    {
+        const auto re = interleaved[2 * bin];
+        const auto im = interleaved[2 * bin + 1];
+        magnitude[bin] = std::sqrt (re * re + im * im);
+        phase[bin] = FastMath::atan2 (im, re);
+    }
+}
+
+static void polarToCartesianFast (const float* magnitude, const float* phase, float* interleaved, int numBins) noexcept
+{
+    int bin = 0;
+
+    for (; bin + Ops::width <= numBins; bin += Ops::width)
+    {
+        Ops::Vec s, c;
+        sinCosFast (Ops::load (phase + bin), s, c);
+        const auto mag = Ops::load (magnitude + bin);
+        Ops::storeInterleaved (interleaved + 2 * bin, Ops::mul (mag, c), Ops::mul (mag, s));
+    }
+
+    for (; bin < numBins; ++bin)
+    {
+        float s, c;
+        FastMath::sinCos (phase[bin], s, c);
+        interleaved[2 * bin]     = magnitude[bin] * c;
+        interleaved[2 * bin + 1] = magnitude[bin] * s;
+    }
+}
+
+//==============================================================================
+const Table exactTable { instructionSet, Accuracy::exact, blend, blendWithGains, accumulateWithGains, cartesianToPolarExact, scalar::polarToCartesianExact };
+const Table fastTable  { instructionSet, Accuracy::fast,  blend, blendWithGains, accumulateWithGains, cartesianToPolarFast,  polarToCartesianFast };
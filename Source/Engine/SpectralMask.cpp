@@ -0,0 +1,450 @@
+/*
+  ==============================================================================
+
+    SpectralMask.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectralMask.h"
+
+//==============================================================================
+// 所有 SpectralMaskPublisher 共享一个后台线程，每隔几毫秒检查一次各自的参数来源，
+// 频段表变了就重新编译。lock 只在注册/注销和后台线程之间使用，音频线程不会碰它
+class SpectralMaskWatchThread  : private juce::Thread
+{
+public:
+    SpectralMaskWatchThread()  : juce::Thread ("ExchangeBand mask") {}
+
+    ~SpectralMaskWatchThread() override
+    {
+        stopThread (1000);
+    }
+
+    void add (SpectralMaskPublisher* publisher)
+    {
+        const juce::ScopedLock sl (lock);
+        publishers.addIfNotAlreadyThere (publisher);
+
+        if (! isThreadRunning())
+            startThread (juce::Thread::Priority::low);
+    }
+
+    // 返回之后不会再有 poll() 在这个 publisher 上运行
+    void remove (SpectralMaskPublisher* publisher)
+    {
+        const juce::ScopedLock sl (lock);
+        publishers.removeFirstMatchingValue (publisher);
+    }
+
+private:
+    void run() override
+    {
+        while (! threadShouldExit())
+        {
+            {
+                const juce::ScopedLock sl (lock);
+
+                for (auto* publisher : publishers)
+                    publisher->poll();
+            }
+
+            wait (10);
+        }
+    }
+
+    juce::CriticalSection lock;
+    juce::Array<SpectralMaskPublisher*> publishers;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectralMaskWatchThread)
+};
+
+//==============================================================================
+// 编译时用的稠密工作区：每个 bin 一个值，按最大 FFT 点数分配，只在写入端使用
+struct SpectralMaskPublisher::Workspace
+{
+    static constexpr int maxNumBins = (1 << StftSettings::maxOrder) / 2 + 1;
+
+    Workspace()
+        : ownMain ((size_t) maxNumBins), ownSidechain ((size_t) maxNumBins)
+    {
+        for (auto& layer : layerMain)       layer.resize ((size_t) maxNumBins);
+        for (auto& layer : layerSidechain)  layer.resize ((size_t) maxNumBins);
+    }
+
+    std::vector<float> ownMain, ownSidechain;
+    std::array<std::vector<float>, ExchangeBandParameters::maxBands> layerMain, layerSidechain;
+    std::array<int, ExchangeBandParameters::maxBands> layerOffset {};
+};
+
+namespace
+{
+    // 频段在连续 bin 刻度上的范围 [low, high]，bin b 占据 [b - 0.5, b + 0.5]
+    struct BandEdges
+    {
+        double low = 0.0, high = 0.0;
+    };
+
+    BandEdges getBandEdges (const ExchangeBand& band, double sampleRate, int fftSize) noexcept
+    {
+        const auto binsPerHz = (double) fftSize / sampleRate;
+        const auto range = band.getFrequencyRange (sampleRate);
+        const auto low = range.getStart(), high = range.getEnd();
+
+        const auto nyquistBin = (double) (fftSize / 2);
+        BandEdges edges { juce::jlimit (-0.5, nyquistBin + 0.5, low * binsPerHz),
+                          juce::jlimit (-0.5, nyquistBin + 0.5, high * binsPerHz) };
+
+        // 至少覆盖一个 bin 的宽度，否则窄频段在低分辨率下会整个消失
+        if (edges.high - edges.low < 1.0)
+        {
+            const auto centre = juce::jlimit (0.0, nyquistBin, (edges.low + edges.high) * 0.5);
+            edges = { centre - 0.5, centre + 0.5 };
+        }
+
+        return edges;
+    }
+
+    // bin 的单元格与 [low, high] 重叠的比例，这就是频段边缘的小数权重
+    float getCellWeight (int bin, double low, double high) noexcept
+    {
+        return (float) juce::jlimit (0.0, 1.0, juce::jmin (high, bin + 0.5) - juce::jmax (low, bin - 0.5));
+    }
+
+    // 浮点误差不应该让本来是恒等的 bin 进入掩码
+    float snapGain (float gain) noexcept
+    {
+        if (std::abs (gain) < 1.0e-6f)           return 0.0f;
+        if (std::abs (gain - 1.0f) < 1.0e-6f)    return 1.0f;
+        return gain;
+    }
+}
+
+//==============================================================================
+SpectralMaskPublisher::SpectralMaskPublisher()
+{
+    for (auto& set : pool)
+        set = std::make_unique<SpectralMaskSet>();
+
+    for (auto& hazard : hazards)
+        hazard.store (nullptr);
+}
+
+SpectralMaskPublisher::~SpectralMaskPublisher()
+{
+    stopWatching();
+}
+
+//==============================================================================
+void SpectralMaskPublisher::compile (const ExchangeBandParameters& parameters, double sampleRate)
+{
+    jassert (sampleRate > 0.0);
+    const juce::ScopedLock sl (writeLock);
+
+    if (const auto* current = latest.load(); current != nullptr && current->sampleRate == sampleRate
+                                               && current->parameters.hasSameBands (parameters))
+        return;
+
+    if (workspace == nullptr)
+        workspace = std::make_unique<Workspace>();
+
+    // 最新的和被读者登记的都不能动；池的大小保证一定有空闲的
+    auto* set = findUnusedSet();
+    jassert (set != nullptr);
+
+    set->parameters = parameters;
+    set->sampleRate = sampleRate;
+
+    for (int order = StftSettings::minOrder; order <= StftSettings::maxOrder; ++order)
+        compileMask (parameters, sampleRate, order, *workspace, set->masks[(size_t) (order - StftSettings::minOrder)]);
+
+    latest.store (set);
+}
+
+SpectralMaskSet* SpectralMaskPublisher::findUnusedSet() const noexcept
+{
+    const auto* current = latest.load();
+
+    for (auto& set : pool)
+    {
+        if (set.get() == current)
+            continue;
+
+        const auto isHeld = std::any_of (hazards.begin(), hazards.end(),
+                                         [&set] (const auto& hazard) { return hazard.load() == set.get(); });
+
+        if (! isHeld)
+            return set.get();
+    }
+
+    return nullptr;
+}
+
+void SpectralMaskPublisher::compileMask (const ExchangeBandParameters& parameters, double sampleRate, int fftOrder,
+                                         Workspace& workspace, SpectralMask& mask)
+{
+    const int fftSize = 1 << fftOrder;
+    const int numBins = fftSize / 2 + 1;
+    const int numBands = juce::jlimit (0, ExchangeBandParameters::maxBands, parameters.numBands);
+
+    auto* ownMain = workspace.ownMain.data();
+    auto* ownSidechain = workspace.ownSidechain.data();
+    std::fill (ownMain, ownMain + numBins, 1.0f);
+    std::fill (ownSidechain, ownSidechain + numBins, 0.0f);
+
+    std::array<BandEdges, ExchangeBandParameters::maxBands> edges;
+
+    for (int i = 0; i < numBands; ++i)
+        edges[(size_t) i] = getBandEdges (parameters.bands[(size_t) i], sampleRate, fftSize);
+
+    // 规则与原来的区段表相同：频段自身按 mix 混合主链和侧链；有交换对象时，从频段下沿起
+    // 按两者中较窄的宽度一一对应地换成交换对象按它自己的 mix 混合后的内容（来源与本频段重叠的部分
+    // 按本频段的 overlapMix），其余部分仍按自身规则。
+    // 下标大的频段覆盖下标小的，边缘 bin 按重叠比例 w 覆盖：已有的内容乘 (1 - w)，新内容乘 w
+    for (int i = 0; i < numBands; ++i)
+    {
+        const auto& band = parameters.bands[(size_t) i];
+        const auto& range = edges[(size_t) i];
+        auto* layerMain = workspace.layerMain[(size_t) i].data();
+        auto* layerSidechain = workspace.layerSidechain[(size_t) i].data();
+        std::fill (layerMain, layerMain + numBins, 0.0f);
+        std::fill (layerSidechain, layerSidechain + numBins, 0.0f);
+
+        auto pairedHigh = range.low;  // [range.low, pairedHigh] 是成对交换的部分
+        int sourceOffset = 0;
+        float partnerMix = 0.0f;
+
+        if (band.partner >= 0 && band.partner < numBands && band.partner != i)
+        {
+            const auto& partnerRange = edges[(size_t) band.partner];
+            pairedHigh = range.low + juce::jmin (range.high - range.low, partnerRange.high - partnerRange.low);
+            sourceOffset = juce::roundToInt (partnerRange.low - range.low);
+            partnerMix = parameters.bands[(size_t) band.partner].mix;
+        }
+
+        workspace.layerOffset[(size_t) i] = sourceOffset;
+
+        const int firstBin = juce::jlimit (0, numBins - 1, (int) std::floor (range.low + 0.5));
+        const int lastBin  = juce::jlimit (0, numBins - 1, (int) std::ceil (range.high - 0.5));
+
+        for (int bin = firstBin; bin <= lastBin; ++bin)
+        {
+            const auto weight = getCellWeight (bin, range.low, range.high);
+
+            if (weight <= 0.0f)
+                continue;
+
+            // 交换来源超出频谱范围的部分按自身规则处理
+            const auto sourceBin = bin + sourceOffset;
+            const auto paired = (sourceBin >= 0 && sourceBin < numBins) ? getCellWeight (bin, range.low, pairedHigh) : 0.0f;
+            const auto own = weight - paired;
+            const auto keep = 1.0f - weight;
+
+            ownMain[bin]      = ownMain[bin] * keep + own * (1.0f - band.mix);
+            ownSidechain[bin] = ownSidechain[bin] * keep + own * band.mix;
+
+            for (int j = 0; j < i; ++j)
+            {
+                workspace.layerMain[(size_t) j][(size_t) bin] *= keep;
+                workspace.layerSidechain[(size_t) j][(size_t) bin] *= keep;
+            }
+
+            // 来源落在本频段自身范围内（两个频段重叠）的部分按 overlapMix 混合
+            auto sourceMix = partnerMix;
+
+            if (band.overlapMix >= 0.0f && paired > 0.0f)
+            {
+                const auto overlap = getCellWeight (sourceBin, range.low, range.high);
+                sourceMix = partnerMix * (1.0f - overlap) + band.overlapMix * overlap;
+            }
+
+            layerMain[bin]      = paired * (1.0f - sourceMix);
+            layerSidechain[bin] = paired * sourceMix;
+        }
+    }
+
+    //==============================================================================
+    // 只保留真正有作用的范围：本位混合去掉两端的恒等 bin，交换层去掉两端的零
+    const auto trim = [numBins] (auto isInactive, int& first, int& count)
+    {
+        int begin = 0, end = numBins;
+
+        while (begin < end && isInactive (begin))       ++begin;
+        while (end > begin && isInactive (end - 1))     --end;
+
+        first = begin;
+        count = end - begin;
+    };
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        ownMain[bin] = snapGain (ownMain[bin]);
+        ownSidechain[bin] = snapGain (ownSidechain[bin]);
+    }
+
+    trim ([&] (int bin) { return ownMain[bin] == 1.0f && ownSidechain[bin] == 0.0f; }, mask.firstBin, mask.numBins);
+
+    mask.numLayers = 0;
+    std::array<int, ExchangeBandParameters::maxBands> layerBands {};  // 每一层来自哪个频段
+    size_t numValues = (size_t) mask.numBins * 4;
+
+    for (int i = 0; i < numBands; ++i)
+    {
+        auto* layerMain = workspace.layerMain[(size_t) i].data();
+        auto* layerSidechain = workspace.layerSidechain[(size_t) i].data();
+
+        for (int bin = 0; bin < numBins; ++bin)
+        {
+            layerMain[bin] = snapGain (layerMain[bin]);
+            layerSidechain[bin] = snapGain (layerSidechain[bin]);
+        }
+
+        auto& layer = mask.layers[(size_t) mask.numLayers];
+        trim ([&] (int bin) { return layerMain[bin] == 0.0f && layerSidechain[bin] == 0.0f; }, layer.firstBin, layer.numBins);
+
+        if (layer.numBins == 0)
+            continue;
+
+        layerBands[(size_t) mask.numLayers] = i;
+        numValues += (size_t) layer.numBins * 4;
+        ++mask.numLayers;
+    }
+
+    //==============================================================================
+    // 写入 storage，每个增益重复两次以对应交错复数的 re / im
+    mask.storage.resize (numValues);
+    auto* destination = mask.storage.data();
+
+    const auto pack = [&destination] (const float* gains, int firstBin, int count)
+    {
+        const auto* start = destination;
+
+        for (int bin = firstBin; bin < firstBin + count; ++bin)
+        {
+            *destination++ = gains[bin];
+            *destination++ = gains[bin];
+        }
+
+        return start;
+    };
+
+    mask.mainGain = pack (ownMain, mask.firstBin, mask.numBins);
+    mask.sidechainGain = pack (ownSidechain, mask.firstBin, mask.numBins);
+
+    int unionFirst = numBins, unionEnd = 0;
+
+    for (int i = 0; i < mask.numLayers; ++i)
+    {
+        auto& layer = mask.layers[(size_t) i];
+        const auto bandIndex = (size_t) layerBands[(size_t) i];
+
+        layer.sourceOffset = workspace.layerOffset[bandIndex];
+        layer.mainGain = pack (workspace.layerMain[bandIndex].data(), layer.firstBin, layer.numBins);
+        layer.sidechainGain = pack (workspace.layerSidechain[bandIndex].data(), layer.firstBin, layer.numBins);
+
+        unionFirst = juce::jmin (unionFirst, layer.firstBin);
+        unionEnd = juce::jmax (unionEnd, layer.firstBin + layer.numBins);
+    }
+
+    mask.firstLayerBin = mask.numLayers > 0 ? unionFirst : 0;
+    mask.numLayerBins = mask.numLayers > 0 ? unionEnd - unionFirst : 0;
+
+    //==============================================================================
+    // 改变的 bin 合并成区段，供稀疏修正合成使用
+    const auto isChanged = [&] (int bin)
+    {
+        if (ownMain[bin] != 1.0f || ownSidechain[bin] != 0.0f)
+            return true;
+
+        for (int i = 0; i < mask.numLayers; ++i)
+        {
+            const auto& layer = mask.layers[(size_t) i];
+
+            if (bin >= layer.firstBin && bin < layer.firstBin + layer.numBins)
+                return true;
+        }
+
+        return false;
+    };
+
+    mask.numChangedRuns = 0;
+    mask.numChangedBins = 0;
+
+    for (int bin = 0; bin < numBins; ++bin)
+    {
+        if (! isChanged (bin))
+            continue;
+
+        auto* last = mask.numChangedRuns > 0 ? &mask.changedRuns[(size_t) (mask.numChangedRuns - 1)] : nullptr;
+
+        // 紧接着上一段，或者容量已满：延伸上一段（多覆盖几个不变的 bin 不影响结果）
+        if (last != nullptr && (last->firstBin + last->numBins == bin || mask.numChangedRuns == SpectralMask::maxChangedRuns))
+        {
+            mask.numChangedBins += bin + 1 - (last->firstBin + last->numBins);
+            last->numBins = bin + 1 - last->firstBin;
+            continue;
+        }
+
+        mask.changedRuns[(size_t) mask.numChangedRuns++] = { bin, 1 };
+        ++mask.numChangedBins;
+    }
+}
+
+//==============================================================================
+void SpectralMaskPublisher::startWatching (const ExchangeBandParameterPointers& source, double sampleRate)
+{
+    jassert (source.isValid());
+
+    {
+        const juce::ScopedLock sl (writeLock);
+        watchedSource = source;
+        watchedSampleRate = sampleRate;
+    }
+
+    watchThread->add (this);
+}
+
+void SpectralMaskPublisher::stopWatching()
+{
+    watchThread->remove (this);
+}
+
+void SpectralMaskPublisher::poll()
+{
+    ExchangeBandParameterPointers source;
+    double sampleRate;
+
+    {
+        const juce::ScopedLock sl (writeLock);
+        source = watchedSource;
+        sampleRate = watchedSampleRate;
+    }
+
+    if (source.isValid() && sampleRate > 0.0)
+        compile (source.load(), sampleRate);
+}
+
+//==============================================================================
+const SpectralMaskSet* SpectralMaskPublisher::acquire (int readerIndex) noexcept
+{
+    // 先登记再确认 latest 没变：写入端要么看到这个登记，要么读者看到新的 latest 重试，
+    // 所以返回的对象在 release() 之前不会被写入端复用
+    auto& hazard = hazards[(size_t) readerIndex];
+    const SpectralMaskSet* set = latest.load();
+
+    for (;;)
+    {
+        hazard.store (set);
+        const SpectralMaskSet* check = latest.load();
+
+        if (check == set)
+            return set;
+
+        set = check;
+    }
+}
+
+void SpectralMaskPublisher::release (int readerIndex) noexcept
+{
+    hazards[(size_t) readerIndex].store (nullptr);
+}
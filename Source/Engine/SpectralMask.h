@@ -0,0 +1,130 @@
+/*
+  ==============================================================================
+
+    SpectralMask.h
+    频段表编译成的逐 bin 掩码，以及把它从编译线程交给音频线程的 RCU 式发布器。
+
+    - 编译（SpectralMaskPublisher::compile）在 message 线程或共享的后台线程上进行，
+      可以分配内存；每次为所有支持的 FFT 点数各编译一份，切换几何时不需要重新编译。
+    - 音频线程每个 hop 用 acquire() 取最新的一套掩码：读指针、登记为 hazard、再确认一次，
+      全程只有原子操作，不加锁也不等待编译线程。
+    - 写入端只复用既不是最新、也没有被任何读者登记的对象，所以读者手上的掩码永远不会被改写。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ExchangeBandParameters.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+//==============================================================================
+// 一种 FFT 点数下的掩码。所有增益数组都按交错复数排布（每个 bin 两个相同的值），
+// 可以直接与 FFT 输出逐元素相乘；频段边缘按 bin 与频段的重叠比例取小数权重
+struct SpectralMask
+{
+    // 本位混合：bin ∈ [firstBin, firstBin + numBins) 时
+    //   data[bin] = main[bin] * mainGain[bin - firstBin] + sidechain[bin] * sidechainGain[bin - firstBin]
+    // 范围之外保持主链
+    int firstBin = 0, numBins = 0;
+    const float* mainGain = nullptr;
+    const float* sidechainGain = nullptr;
+
+    // 交换层：bin ∈ [firstBin, firstBin + numBins) 时再加上
+    //   main[bin + sourceOffset] * mainGain + sidechain[bin + sourceOffset] * sidechainGain
+    // 读取的都是交叉合成之前的主链
+    struct Layer
+    {
+        int firstBin = 0, numBins = 0;
+        int sourceOffset = 0;
+        const float* mainGain = nullptr;
+        const float* sidechainGain = nullptr;
+    };
+
+    std::array<Layer, ExchangeBandParameters::maxBands> layers;
+    int numLayers = 0;
+
+    // 所有交换层覆盖的 bin 的并集
+    int firstLayerBin = 0, numLayerBins = 0;
+
+    // 交叉合成真正会改变的 bin（本位混合不是恒等，或者有交换层），合并成按频率排列的连续区段。
+    // 稀疏修正合成只在这些 bin 上计算修正量；区段数超过容量时最后一段一直延伸到最后一个改变的 bin
+    struct BinRun
+    {
+        int firstBin = 0, numBins = 0;
+    };
+
+    static constexpr int maxChangedRuns = 2 * ExchangeBandParameters::maxBands;
+    std::array<BinRun, maxChangedRuns> changedRuns;
+    int numChangedRuns = 0;
+    int numChangedBins = 0;
+
+    // 上面所有增益数组都指向这里
+    std::vector<float> storage;
+};
+
+// 一次编译的结果：每种 FFT 点数一份掩码，下标为 fftOrder - StftSettings::minOrder
+struct SpectralMaskSet
+{
+    std::array<SpectralMask, StftSettings::numOrders> masks;
+    ExchangeBandParameters parameters;
+    double sampleRate = 0.0;
+
+    const SpectralMask& getMask (int fftOrder) const noexcept   { return masks[(size_t) (fftOrder - StftSettings::minOrder)]; }
+};
+
+//==============================================================================
+class SpectralMaskWatchThread;
+
+class SpectralMaskPublisher
+{
+public:
+    // 读者的 hazard 槽位数：引擎的两个 STFT slot 各需要两个（当前的和正在淡出的）
+    static constexpr int numReaders = 4;
+
+    SpectralMaskPublisher();
+    ~SpectralMaskPublisher();
+
+    //==============================================================================
+    // 写入端，只在非实时线程上调用。频段表或采样率与最新发布的不同时重新编译并发布
+    void compile (const ExchangeBandParameters& parameters, double sampleRate);
+
+    // 由共享的后台线程每隔几毫秒从 source 读一次频段表，有变化就编译（插件使用）
+    void startWatching (const ExchangeBandParameterPointers& source, double sampleRate);
+    void stopWatching();
+
+    //==============================================================================
+    // 读取端，只在音频线程上调用，每个 readerIndex 同一时间只能被一个线程使用。
+    // 返回最新发布的一套掩码（还没有发布过时为 nullptr），在 release() 之前一直有效
+    const SpectralMaskSet* acquire (int readerIndex) noexcept;
+    void release (int readerIndex) noexcept;
+
+private:
+    //==============================================================================
+    struct Workspace;
+
+    friend class SpectralMaskWatchThread;
+    void poll(); // 只在后台线程上调用
+
+    SpectralMaskSet* findUnusedSet() const noexcept;
+    static void compileMask (const ExchangeBandParameters& parameters, double sampleRate, int fftOrder,
+                             Workspace& workspace, SpectralMask& mask);
+
+    // 读者最多占用 numReaders 个，再加上最新发布的一个和正在写的一个
+    std::array<std::unique_ptr<SpectralMaskSet>, numReaders + 2> pool;
+    std::atomic<SpectralMaskSet*> latest { nullptr };
+    std::array<std::atomic<const SpectralMaskSet*>, numReaders> hazards;
+
+    juce::CriticalSection writeLock; // 只在写入端之间使用，音频线程不会碰它
+    std::unique_ptr<Workspace> workspace;
+    ExchangeBandParameterPointers watchedSource;
+    double watchedSampleRate = 0.0;
+
+    juce::SharedResourcePointer<SpectralMaskWatchThread> watchThread;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectralMaskPublisher)
+};
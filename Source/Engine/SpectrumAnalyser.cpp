@@ -0,0 +1,128 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyser.h"
+
+//==============================================================================
+double SpectrumAnalyser::getPointFrequency (int point) noexcept
+{
+    // 对数刻度，点 i 覆盖 [f(i - 0.5), f(i + 0.5)]
+    return minFrequency * std::pow (maxFrequency / minFrequency, (double) point / (double) (numPoints - 1));
+}
+
+void SpectrumAnalyser::prepare (double newSampleRate, int numLanes)
+{
+    sampleRate = newSampleRate;
+    pending.assign ((size_t) juce::jmax (1, numLanes), Frame{});
+
+    for (int order = StftSettings::minOrder; order <= StftSettings::maxOrder; ++order)
+    {
+        const int fftSize = 1 << order;
+        const int nyquistBin = fftSize / 2;
+        auto& ranges = pointRanges[(size_t) (order - StftSettings::minOrder)];
+
+        for (int point = 0; point < numPoints; ++point)
+        {
+            const auto low  = getPointFrequency (point) * std::pow (maxFrequency / minFrequency, -0.5 / (double) (numPoints - 1));
+            const auto high = getPointFrequency (point) * std::pow (maxFrequency / minFrequency,  0.5 / (double) (numPoints - 1));
+
+            // 中心落在范围内的 bin；低频端一个 bin 都没有时取最近的那个
+            auto first = (int) std::ceil (low * fftSize / sampleRate);
+            auto end   = (int) std::ceil (high * fftSize / sampleRate);
+
+            if (end <= first)
+            {
+                first = juce::roundToInt (getPointFrequency (point) * fftSize / sampleRate);
+                end = first + 1;
+            }
+
+            ranges.firstBin[(size_t) point] = juce::jlimit (0, nyquistBin + 1, first);
+            ranges.endBin[(size_t) point]   = juce::jlimit (0, nyquistBin + 1, end);
+        }
+    }
+}
+
+//==============================================================================
+bool SpectrumAnalyser::beginHop() noexcept
+{
+    const auto isOn = isEnabled();
+
+    // 重新打开时丢掉关闭之前没发完的数据
+    if (isOn && ! wasEnabled)
+    {
+        clearPending();
+        samplesSincePublish = 0;
+    }
+
+    wasEnabled = isOn;
+    return isOn;
+}
+
+void SpectrumAnalyser::accumulate (int lane, Source source, int fftOrder, const float* spectrum, float gain) noexcept
+{
+    const auto& ranges = pointRanges[(size_t) (fftOrder - StftSettings::minOrder)];
+    auto& destination = pending[(size_t) lane].power[(size_t) source];
+
+    for (int point = 0; point < numPoints; ++point)
+    {
+        auto peak = destination[(size_t) point];
+
+        for (int bin = ranges.firstBin[(size_t) point]; bin < ranges.endBin[(size_t) point]; ++bin)
+        {
+            const auto re = spectrum[2 * bin], im = spectrum[2 * bin + 1];
+            peak = juce::jmax (peak, (re * re + im * im) * gain);
+        }
+
+        destination[(size_t) point] = peak;
+    }
+}
+
+void SpectrumAnalyser::endHop (int hopSize) noexcept
+{
+    samplesSincePublish += hopSize;
+
+    if ((double) samplesSincePublish < sampleRate / framesPerSecond)
+        return;
+
+    samplesSincePublish = 0;
+
+    // 写满时丢掉这一帧，峰值继续累加到下一帧
+    const auto scope = fifo.write (1);
+
+    if (scope.blockSize1 == 0)
+        return;
+
+    // 各 lane 的峰值合并成一帧
+    auto& frame = frames[(size_t) scope.startIndex1];
+    frame = pending.front();
+
+    for (size_t lane = 1; lane < pending.size(); ++lane)
+        for (size_t source = 0; source < (size_t) numSources; ++source)
+            for (size_t point = 0; point < (size_t) numPoints; ++point)
+                frame.power[source][point] = juce::jmax (frame.power[source][point], pending[lane].power[source][point]);
+
+    clearPending();
+}
+
+void SpectrumAnalyser::clearPending() noexcept
+{
+    for (auto& frame : pending)
+        for (auto& source : frame.power)
+            source.fill (0.0f);
+}
+
+bool SpectrumAnalyser::pop (Frame& destination) noexcept
+{
+    const auto scope = fifo.read (1);
+
+    if (scope.blockSize1 == 0)
+        return false;
+
+    destination = frames[(size_t) scope.startIndex1];
+    return true;
+}
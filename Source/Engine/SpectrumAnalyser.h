@@ -0,0 +1,97 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyser.h
+    给编辑器的频谱显示用：音频线程把主链、侧链和输出的频谱抽取成对数频率上的
+    numPoints 个点，按显示帧率通过无锁 FIFO 交给 UI 线程。
+
+    - 没有编辑器打开时 isEnabled() 为 false，音频线程每个 hop 只多一次原子读取。
+    - 两次发布之间的所有 hop、所有通道取峰值，所以不会漏掉短促的瞬态。
+    - 多声道并行处理时每个 lane（执行线程）各累加一份，发布时再合并，lane 之间不共享写入。
+    - FIFO 满了（UI 线程来不及取）就丢掉这一帧，音频线程从不等待。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "ExchangeBandParameters.h"
+#include <array>
+#include <atomic>
+#include <vector>
+
+//==============================================================================
+class SpectrumAnalyser
+{
+public:
+    static constexpr int numPoints = 256;
+    static constexpr double minFrequency = 20.0;
+    static constexpr double maxFrequency = 20000.0;
+    static constexpr double framesPerSecond = 60.0;
+
+    enum Source
+    {
+        mainInput = 0,
+        sidechainInput,
+        output,
+        numSources
+    };
+
+    // 一帧显示数据：每个点是对应频率范围内最大的功率，已按分析窗归一化（满幅正弦为 1）。
+    // 第 i 个点的中心频率为 getPointFrequency (i)，超过 Nyquist 的点为 0
+    struct Frame
+    {
+        std::array<std::array<float, numPoints>, numSources> power {};
+    };
+
+    SpectrumAnalyser() = default;
+
+    // 生成每种 FFT 点数下显示点到 bin 范围的对应表，并为 numLanes 个执行线程各分配一份累加区。
+    // 只在音频回调停止时调用
+    void prepare (double newSampleRate, int numLanes = 1);
+
+    // 任意线程调用：编辑器打开时开启，关闭时停止
+    void setEnabled (bool shouldBeEnabled) noexcept  { enabled.store (shouldBeEnabled, std::memory_order_relaxed); }
+    bool isEnabled() const noexcept                  { return enabled.load (std::memory_order_relaxed); }
+
+    static double getPointFrequency (int point) noexcept;
+
+    //==============================================================================
+    // 音频线程，每个 hop：beginHop() 返回 false 时这个 hop 什么都不用做；
+    // 否则对每个通道调用 accumulate()，最后调用 endHop()，到了显示帧的时间就发布一帧。
+    // spectrum 是 FFT 输出的交错复数（numBins 个），gain 为功率的归一化系数。
+    // accumulate() 可以在不同 lane 上并发调用，beginHop() / endHop() 只在音频线程上调用
+    bool beginHop() noexcept;
+    void accumulate (int lane, Source source, int fftOrder, const float* spectrum, float gain) noexcept;
+    void endHop (int hopSize) noexcept;
+
+    //==============================================================================
+    // UI 线程：取出最早的一帧，没有时返回 false（只能有一个消费线程）
+    bool pop (Frame& destination) noexcept;
+
+private:
+    //==============================================================================
+    static constexpr int fifoSize = 8;
+
+    void clearPending() noexcept;
+
+    struct PointRanges
+    {
+        std::array<int, numPoints> firstBin {}, endBin {};
+    };
+
+    std::array<PointRanges, StftSettings::numOrders> pointRanges;
+    double sampleRate = 44100.0;
+
+    std::atomic<bool> enabled { false };
+
+    // 只由音频线程（和处理它的通道的工作线程）访问，每个 lane 一份
+    std::vector<Frame> pending = std::vector<Frame> (1);
+    bool wasEnabled = false;
+    int samplesSincePublish = 0;
+
+    juce::AbstractFifo fifo { fifoSize };
+    std::array<Frame, fifoSize> frames;
+
+    JUCE_DECLARE_NON_COPYABLE (SpectrumAnalyser)
+};
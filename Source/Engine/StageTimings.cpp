@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    StageTimings.cpp
+
+  ==============================================================================
+*/
+
+#include "StageTimings.h"
+#include <cmath>
+
+const char* StageTimings::getStageName (Stage stage) noexcept
+{
+    switch (stage)
+    {
+        case ringFill:        return "ring fill";
+        case forwardFft:      return "FFT";
+        case crossSynthesis:  return "cross-synthesis";
+        case inverseFft:      return "IFFT";
+        case overlapAdd:      return "overlap-add";
+        case block:           return "block";
+        case numStages:       break;
+    }
+
+    return "";
+}
+
+//==============================================================================
+int StageTimings::getBucket (juce::int64 ticks) noexcept
+{
+    // 桶 4k .. 4k + 3 覆盖 [2^k, 2^(k+1))，按最高位之后的两位再分四份
+    if (ticks < bucketsPerOctave)
+        return (int) juce::jmax ((juce::int64) 0, ticks);
+
+    // 最后一个桶以上的都截到最后一个桶，先截到 32 位
+    const auto value = (juce::uint32) juce::jmin (ticks, (juce::int64) std::numeric_limits<juce::uint32>::max());
+    const int octave = juce::findHighestSetBit (value);
+    const int fraction = (int) (value >> (octave - 2)) & (bucketsPerOctave - 1);
+
+    return juce::jmin (numBuckets - 1, octave * bucketsPerOctave + fraction);
+}
+
+juce::int64 StageTimings::getBucketUpperBound (int bucket) noexcept
+{
+    // 2、3 ticks 直接落在桶 2、3，桶 4 .. 7 不会用到
+    if (bucket < 2 * bucketsPerOctave)
+        return bucket + 1;
+
+    const int octave = bucket / bucketsPerOctave;
+    const int fraction = bucket % bucketsPerOctave;
+    return ((juce::int64) (bucketsPerOctave + fraction + 1) << (octave - 2));
+}
+
+#if EXCHANGEBAND_STAGE_TIMING
+
+void StageTimings::Histogram::add (juce::int64 ticks) noexcept
+{
+    auto& bucket = buckets[(size_t) getBucket (ticks)];
+    bucket.store (bucket.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    count.store (count.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    totalTicks.store (totalTicks.load (std::memory_order_relaxed) + ticks, std::memory_order_relaxed);
+
+    if (ticks < minTicks.load (std::memory_order_relaxed))
+        minTicks.store (ticks, std::memory_order_relaxed);
+
+    if (ticks > maxTicks.load (std::memory_order_relaxed))
+        maxTicks.store (ticks, std::memory_order_relaxed);
+}
+
+void StageTimings::Histogram::clear() noexcept
+{
+    for (auto& bucket : buckets)
+        bucket.store (0, std::memory_order_relaxed);
+
+    count.store (0, std::memory_order_relaxed);
+    totalTicks.store (0, std::memory_order_relaxed);
+    minTicks.store (std::numeric_limits<juce::int64>::max(), std::memory_order_relaxed);
+    maxTicks.store (0, std::memory_order_relaxed);
+}
+
+void StageTimings::record (int lane, Stage stage, juce::int64 ticks) noexcept
+{
+    jassert (juce::isPositiveAndBelow (lane, maxLanes));
+    lanes[(size_t) lane].stages[(size_t) stage].add (ticks);
+}
+
+void StageTimings::requestReset() noexcept
+{
+    resetRequested.store (true, std::memory_order_relaxed);
+}
+
+juce::int64 StageTimings::beginBlock() noexcept
+{
+    // 工作线程只在 process() 里处理通道，这里没有其他写入者，可以直接清空
+    if (resetRequested.exchange (false, std::memory_order_relaxed))
+    {
+        for (auto& lane : lanes)
+            for (auto& histogram : lane.stages)
+                histogram.clear();
+
+        numDeadlineMisses.store (0, std::memory_order_relaxed);
+    }
+
+    return getTicks();
+}
+
+void StageTimings::endBlock (juce::int64 startTicks, int numSamples, double sampleRate) noexcept
+{
+    const auto ticks = getTicks() - startTicks;
+    record (0, block, ticks);
+
+    if (sampleRate > 0.0 && (double) ticks > (double) numSamples / sampleRate * ticksPerSecond)
+        numDeadlineMisses.store (numDeadlineMisses.load (std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+StageTimings::Snapshot StageTimings::getSnapshot() const noexcept
+{
+    Snapshot snapshot;
+    const auto microsecondsPerTick = 1.0e6 / ticksPerSecond;
+
+    for (int stage = 0; stage < numStages; ++stage)
+    {
+        std::array<juce::uint64, numBuckets> buckets {};
+        juce::int64 count = 0, totalTicks = 0, maxTicks = 0;
+        auto minTicks = std::numeric_limits<juce::int64>::max();
+
+        for (auto& lane : lanes)
+        {
+            const auto& histogram = lane.stages[(size_t) stage];
+
+            for (int bucket = 0; bucket < numBuckets; ++bucket)
+                buckets[(size_t) bucket] += histogram.buckets[(size_t) bucket].load (std::memory_order_relaxed);
+
+            count += histogram.count.load (std::memory_order_relaxed);
+            totalTicks += histogram.totalTicks.load (std::memory_order_relaxed);
+            minTicks = juce::jmin (minTicks, histogram.minTicks.load (std::memory_order_relaxed));
+            maxTicks = juce::jmax (maxTicks, histogram.maxTicks.load (std::memory_order_relaxed));
+        }
+
+        if (count == 0)
+            continue;
+
+        // 第 99 百分位所在的桶，取它的上界（不超过实际的最大值）
+        const auto target = (juce::uint64) std::ceil (0.99 * (double) count);
+        juce::uint64 cumulative = 0;
+        int p99Bucket = numBuckets - 1;
+
+        for (int bucket = 0; bucket < numBuckets; ++bucket)
+        {
+            cumulative += buckets[(size_t) bucket];
+
+            if (cumulative >= target)
+            {
+                p99Bucket = bucket;
+                break;
+            }
+        }
+
+        auto& summary = snapshot.stages[(size_t) stage];
+        summary.count = count;
+        summary.minMicroseconds = (double) minTicks * microsecondsPerTick;
+        summary.meanMicroseconds = (double) totalTicks / (double) count * microsecondsPerTick;
+        summary.p99Microseconds = (double) juce::jmin (getBucketUpperBound (p99Bucket), maxTicks) * microsecondsPerTick;
+        summary.maxMicroseconds = (double) maxTicks * microsecondsPerTick;
+    }
+
+    snapshot.numDeadlineMisses = numDeadlineMisses.load (std::memory_order_relaxed);
+    return snapshot;
+}
+
+#else
+
+void StageTimings::record (int, Stage, juce::int64) noexcept {}
+void StageTimings::requestReset() noexcept {}
+juce::int64 StageTimings::beginBlock() noexcept                   { return 0; }
+void StageTimings::endBlock (juce::int64, int, double) noexcept   {}
+StageTimings::Snapshot StageTimings::getSnapshot() const noexcept { return {}; }
+
+#endif
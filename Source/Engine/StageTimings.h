@@ -0,0 +1,180 @@
+/*
+  ==============================================================================
+
+    StageTimings.h
+    处理路径上各阶段的耗时统计：环形缓冲区读写、正向 FFT、交叉合成、IFFT、overlap-add，
+    以及整个 process() 调用（超过这个 block 的实时时长就算一次超时）。
+
+    - 计时用 std::chrono::steady_clock 的纳秒计数（juce::Time::getHighResolutionTicks() 在 Linux 上
+      只有微秒精度，几微秒的阶段会被量化掉），在 getSnapshot() 里才换算成微秒。
+      每个计时点只有两次读时钟和几次 relaxed 原子读写。
+    - 每个 lane（执行线程）有自己的一份直方图，只由那个线程写入，写入不需要 RMW 原子操作；
+      任意线程都可以用 getSnapshot() 读，读到的是各计数器某一时刻的近似值。
+    - 直方图按纳秒数的对数分桶（每个二倍程 4 个桶），p99 取所在桶的上界，误差在 25% 以内；
+      最小值和最大值是精确的。
+    - 编译时定义 EXCHANGEBAND_STAGE_TIMING=0 时计时宏展开为空，统计数据也不占内存，
+      getSnapshot() 返回的计数全为 0。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include "ChannelWorkerPool.h"
+#include "RealFft.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+#ifndef EXCHANGEBAND_STAGE_TIMING
+ #define EXCHANGEBAND_STAGE_TIMING 1
+#endif
+
+//==============================================================================
+class StageTimings
+{
+public:
+    enum Stage
+    {
+        ringFill = 0,     // 输入写进环形缓冲区、输出从 overlap-add 缓冲区取出（稀疏修正合成时再加上干声）
+        forwardFft,       // 读帧加窗和正向 FFT（主链和侧链）
+        crossSynthesis,   // 按掩码混合 / 交换，polar 模式下包括坐标转换
+        inverseFft,       // IFFT，稀疏修正合成时为差值的 IFFT 或振荡器组
+        overlapAdd,       // 加合成窗写回 overlap-add 缓冲区
+        block,            // 整个 process() 调用
+        numStages
+    };
+
+    static const char* getStageName (Stage stage) noexcept;
+
+    struct StageSummary
+    {
+        juce::int64 count = 0;
+        double minMicroseconds = 0.0, meanMicroseconds = 0.0, p99Microseconds = 0.0, maxMicroseconds = 0.0;
+    };
+
+    struct Snapshot
+    {
+        std::array<StageSummary, numStages> stages;
+        juce::int64 numDeadlineMisses = 0;   // 耗时超过 block 实时时长的 process() 调用次数
+
+        // 当前 FFT 点数所用的后端，以及它是被强制指定的还是自动测出的最快后端。
+        // StageTimings 本身不知道这些，由持有引擎的一方（ExchangeBandAudioProcessor::getStageTimings()）填入
+        RealFft::Backend fftBackend = RealFft::Backend::juce;
+        bool fftBackendForced = false;
+    };
+
+    static constexpr bool isCompiledIn() noexcept   { return EXCHANGEBAND_STAGE_TIMING != 0; }
+
+    // 所有计时点共用的时钟，单位纳秒
+    static constexpr double ticksPerSecond = 1.0e9;
+
+    static juce::int64 getTicks() noexcept
+    {
+        using namespace std::chrono;
+        return (juce::int64) duration_cast<nanoseconds> (steady_clock::now().time_since_epoch()).count();
+    }
+
+    StageTimings() = default;
+
+    // 任意线程：取出当前的统计
+    Snapshot getSnapshot() const noexcept;
+
+    // 任意线程：请求清空统计，下一次 beginBlock() 时由处理线程执行
+    void requestReset() noexcept;
+
+    //==============================================================================
+    // 处理线程：每个 process() 开始时调用，返回的 ticks 交给 endBlock()
+    juce::int64 beginBlock() noexcept;
+    void endBlock (juce::int64 startTicks, int numSamples, double sampleRate) noexcept;
+
+    // 某个 lane 记录一次阶段耗时（ticks），只能在这个 lane 的线程上调用
+    void record (int lane, Stage stage, juce::int64 ticks) noexcept;
+
+    // 作用域覆盖整个 process() 调用，通过 EXCHANGEBAND_TIME_BLOCK 使用
+    class ScopedBlockTimer
+    {
+    public:
+        ScopedBlockTimer (StageTimings& owner, int numSamplesInBlock, double sampleRateToUse) noexcept
+            : timings (owner), numSamples (numSamplesInBlock), sampleRate (sampleRateToUse), startTicks (owner.beginBlock())
+        {
+        }
+
+        ~ScopedBlockTimer() noexcept   { timings.endBlock (startTicks, numSamples, sampleRate); }
+
+    private:
+        StageTimings& timings;
+        const int numSamples;
+        const double sampleRate;
+        const juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedBlockTimer)
+    };
+
+    // 作用域结束时记录一次阶段耗时，通过 EXCHANGEBAND_TIME_STAGE 使用
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer (StageTimings& owner, int laneToUse, Stage stageToTime) noexcept
+            : timings (owner), lane (laneToUse), stage (stageToTime), startTicks (getTicks())
+        {
+        }
+
+        ~ScopedTimer() noexcept    { timings.record (lane, stage, getTicks() - startTicks); }
+
+    private:
+        StageTimings& timings;
+        const int lane;
+        const Stage stage;
+        const juce::int64 startTicks;
+
+        JUCE_DECLARE_NON_COPYABLE (ScopedTimer)
+    };
+
+private:
+    //==============================================================================
+    static constexpr int maxLanes = ChannelWorkerPool::maxWorkers + 1;
+    static constexpr int bucketsPerOctave = 4;
+    static constexpr int numBuckets = 32 * bucketsPerOctave;   // 超过 2^32 ticks（约 4.3 秒）的都计入最后一个桶
+
+    static int getBucket (juce::int64 ticks) noexcept;
+    static juce::int64 getBucketUpperBound (int bucket) noexcept;
+
+   #if EXCHANGEBAND_STAGE_TIMING
+    // 单写者：只有所属的 lane 写入，用 relaxed 的读 + 写代替 fetch_add
+    struct Histogram
+    {
+        std::array<std::atomic<juce::uint64>, numBuckets> buckets {};
+        std::atomic<juce::int64> count { 0 }, totalTicks { 0 };
+        std::atomic<juce::int64> minTicks { std::numeric_limits<juce::int64>::max() }, maxTicks { 0 };
+
+        void add (juce::int64 ticks) noexcept;
+        void clear() noexcept;
+    };
+
+    // 按 lane 分开，不同线程不会写同一条缓存行上的计数
+    struct alignas (64) LaneHistograms
+    {
+        std::array<Histogram, numStages> stages;
+    };
+
+    std::array<LaneHistograms, maxLanes> lanes;
+    std::atomic<juce::int64> numDeadlineMisses { 0 };
+    std::atomic<bool> resetRequested { false };
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (StageTimings)
+};
+
+// 在当前作用域内计时一个阶段 / 整个 block；EXCHANGEBAND_STAGE_TIMING=0 时什么都不生成
+#if EXCHANGEBAND_STAGE_TIMING
+ #define EXCHANGEBAND_TIME_STAGE(timings, lane, stage) \
+    const StageTimings::ScopedTimer JUCE_JOIN_MACRO (stageTimer_, __LINE__) (timings, lane, StageTimings::stage)
+ #define EXCHANGEBAND_TIME_BLOCK(timings, numSamples, sampleRate) \
+    const StageTimings::ScopedBlockTimer JUCE_JOIN_MACRO (blockTimer_, __LINE__) (timings, numSamples, sampleRate)
+#else
+ #define EXCHANGEBAND_TIME_STAGE(timings, lane, stage)
+ #define EXCHANGEBAND_TIME_BLOCK(timings, numSamples, sampleRate)
+#endif
@@ -0,0 +1,59 @@
+/*
+  ==============================================================================
+
+    TripleBuffer.h
+    单生产者 / 单消费者的 wait-free 三缓冲：生产者（音频线程）总是写自己的槽，
+    publish() 时和中间槽交换；消费者（UI 等线程）update() 时取走最新的一份。
+    双方都不会等待对方，旧数据会被直接覆盖。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <array>
+#include <atomic>
+
+//==============================================================================
+template <typename Type>
+class TripleBuffer
+{
+public:
+    TripleBuffer() = default;
+
+    //==============================================================================
+    // 生产者：写完 getWriteBuffer() 后调用 publish()
+    Type& getWriteBuffer() noexcept              { return buffers[(size_t) writeIndex]; }
+
+    void publish() noexcept
+    {
+        const auto previous = middle.exchange (writeIndex | newDataFlag, std::memory_order_acq_rel);
+        writeIndex = previous & indexMask;
+    }
+
+    //==============================================================================
+    // 消费者：有新数据时把它换到读槽并返回 true
+    bool update() noexcept
+    {
+        if ((middle.load (std::memory_order_acquire) & newDataFlag) == 0)
+            return false;
+
+        const auto previous = middle.exchange (readIndex, std::memory_order_acq_rel);
+        readIndex = previous & indexMask;
+        return true;
+    }
+
+    const Type& getReadBuffer() const noexcept   { return buffers[(size_t) readIndex]; }
+
+private:
+    //==============================================================================
+    static constexpr int indexMask = 3;
+    static constexpr int newDataFlag = 4;
+
+    std::array<Type, 3> buffers {};
+    int writeIndex = 0;              // 只由生产者访问
+    int readIndex = 1;               // 只由消费者访问
+    std::atomic<int> middle { 2 };   // 中间槽的索引 + 是否有新数据
+
+    static_assert (std::atomic<int>::is_always_lock_free, "TripleBuffer needs a lock-free atomic int");
+};
@@ -14,7 +14,7 @@ ExchangeBandAudioProcessorEditor::ExchangeBandAudioProcessorEditor (ExchangeBand
     : AudioProcessorEditor (&p), audioProcessor (p)
 {
     
-    setSize (400, 300);
+    setSize (760, 480);
     // Define the frequency range limits as double
         double minFreq = 20.0;
         double maxFreq = 20000.0;
@@ -166,16 +166,101 @@ ExchangeBandAudioProcessorEditor::ExchangeBandAudioProcessorEditor (ExchangeBand
     sidechainInstructionLabel.setText("Please Set your SideChain in your DAW.", juce::dontSendNotification);
     addAndMakeVisible(sidechainInstructionLabel);
     
+    setupChoiceBox(fftSizeBox, "fftSize", fftSizeAttachment);
+    setupChoiceBox(overlapBox, "overlap", overlapAttachment);
+    setupChoiceBox(windowBox, "window", windowAttachment);
+    setupChoiceBox(engineBox, "engine", engineAttachment);
+
+    lowLatencyAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+            audioProcessor.parameters, "lowLatency", lowLatencyButton);
+    addAndMakeVisible(lowLatencyButton);
+
+    sidechainLinkAttachment = std::make_unique<juce::AudioProcessorValueTreeState::ButtonAttachment>(
+            audioProcessor.parameters, "sidechainLink", sidechainLinkButton);
+    addAndMakeVisible(sidechainLinkButton);
+
+    // 耗时统计：等宽字体的多行文本，不拦截鼠标，不挡住下面的频谱
+    stageTimingsOverlay.setFont(juce::Font(juce::Font::getDefaultMonospacedFontName(), 11.0f, juce::Font::plain));
+    stageTimingsOverlay.setJustificationType(juce::Justification::topLeft);
+    stageTimingsOverlay.setColour(juce::Label::backgroundColourId, juce::Colours::black.withAlpha(0.6f));
+    stageTimingsOverlay.setColour(juce::Label::textColourId, juce::Colours::white);
+    stageTimingsOverlay.setInterceptsMouseClicks(false, false);
+    addChildComponent(stageTimingsOverlay);
+
+    stageTimingsButton.onClick = [this]
+    {
+        if (stageTimingsButton.getToggleState())
+            audioProcessor.resetStageTimings();
+
+        stageTimingsOverlay.setVisible(stageTimingsButton.getToggleState());
+        updateStageTimingsOverlay();
+    };
+    addAndMakeVisible(stageTimingsButton);
+
     band1Label.setText("Band1", juce::dontSendNotification);
     addAndMakeVisible(band1Label);
     band2Label.setText("Band2", juce::dontSendNotification);
     addAndMakeVisible(band2Label);
 
+    // 频谱显示：编辑器打开期间才让音频线程发布频谱帧
+    addAndMakeVisible(spectrumView);
+    stageTimingsOverlay.toFront(false);
+    audioProcessor.getEngine().getSpectrumAnalyser().setEnabled(true);
+    openGLContext.attachTo(*this);
+    startTimerHz(60);
 
 }
 
 ExchangeBandAudioProcessorEditor::~ExchangeBandAudioProcessorEditor()
 {
+    stopTimer();
+    audioProcessor.getEngine().getSpectrumAnalyser().setEnabled(false);
+    openGLContext.detach();
+}
+
+void ExchangeBandAudioProcessorEditor::timerCallback()
+{
+    auto& engine = audioProcessor.getEngine();
+
+    while (engine.getSpectrumAnalyser().pop(spectrumFrame))
+        spectrumView.pushFrame(spectrumFrame);
+
+    spectrumView.setBands(audioProcessor.getCurrentParameters(), engine.getSampleRate());
+
+    const bool usingStft = ! audioProcessor.isUsingCrossoverEngine();
+    for (auto* component : std::initializer_list<juce::Component*> { &fftSizeBox, &overlapBox, &windowBox, &lowLatencyButton })
+        component->setEnabled(usingStft);
+
+    if (stageTimingsOverlay.isVisible() && ++timerCallbacksSinceTimingUpdate >= 15)
+        updateStageTimingsOverlay();
+}
+
+void ExchangeBandAudioProcessorEditor::updateStageTimingsOverlay()
+{
+    timerCallbacksSinceTimingUpdate = 0;
+
+    if (! StageTimings::isCompiledIn())
+    {
+        stageTimingsOverlay.setText("Stage timing compiled out\n(EXCHANGEBAND_STAGE_TIMING=0)", juce::dontSendNotification);
+        return;
+    }
+
+    const auto snapshot = audioProcessor.getStageTimings();
+    const auto format = [] (double microseconds) { return juce::String(microseconds, 1).paddedLeft(' ', 8); };
+
+    juce::String text = "stage               mean     p99     max  us\n";
+
+    for (int stage = 0; stage < StageTimings::numStages; ++stage)
+    {
+        const auto& summary = snapshot.stages[(size_t) stage];
+        text << juce::String(StageTimings::getStageName((StageTimings::Stage) stage)).paddedRight(' ', 16)
+             << format(summary.meanMicroseconds) << format(summary.p99Microseconds) << format(summary.maxMicroseconds) << "\n";
+    }
+
+    text << "late callbacks: " << snapshot.numDeadlineMisses << " of " << snapshot.stages[StageTimings::block].count
+         << "\nFFT backend: " << RealFft::getBackendName(snapshot.fftBackend)
+         << (snapshot.fftBackendForced ? " (forced)" : " (auto)");
+    stageTimingsOverlay.setText(text, juce::dontSendNotification);
 }
 
 //==============================================================================
@@ -221,6 +306,18 @@ void ExchangeBandAudioProcessorEditor::setupSlider(juce::Slider& slider, const j
     addAndMakeVisible(slider);
 }
 
+void ExchangeBandAudioProcessorEditor::setupChoiceBox(juce::ComboBox& box, const juce::String& parameterID,
+                                                      std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>& attachment)
+{
+    // 选项必须在创建 attachment 之前加好，attachment 按下标同步
+    if (auto* choice = dynamic_cast<juce::AudioParameterChoice*>(audioProcessor.parameters.getParameter(parameterID)))
+        box.addItemList(choice->choices, 1);
+
+    attachment = std::make_unique<juce::AudioProcessorValueTreeState::ComboBoxAttachment>(
+            audioProcessor.parameters, parameterID, box);
+    addAndMakeVisible(box);
+}
+
 void ExchangeBandAudioProcessorEditor::resized()
 {
     // Set sliders to be round
@@ -243,6 +340,9 @@ void ExchangeBandAudioProcessorEditor::resized()
     sidechainInstructionLabel.setText("Please set your SideChain in your DAW.", juce::dontSendNotification);
     sidechainInstructionLabel.setColour(juce::Label::textColourId, juce::Colours::black);
     sidechainInstructionLabel.setColour(juce::Label::outlineColourId, juce::Colours::white); // Set white border
+    lowLatencyButton.setColour(juce::ToggleButton::textColourId, juce::Colours::black);
+    sidechainLinkButton.setColour(juce::ToggleButton::textColourId, juce::Colours::black);
+    stageTimingsButton.setColour(juce::ToggleButton::textColourId, juce::Colours::black);
 
     auto area = getLocalBounds();
 
@@ -255,10 +355,33 @@ void ExchangeBandAudioProcessorEditor::resized()
     
     int labelWidth = sidechainInstructionLabel.getFont().getStringWidth(sidechainInstructionLabel.getText()) + margin * 2;
     // Set the width of the label based on the text width
-    sidechainInstructionLabel.setBounds(area.removeFromTop(labelHeight).removeFromLeft(labelWidth));
-
-    // Add extra vertical space after the label
+    auto topRow = area.removeFromTop(labelHeight);
+    sidechainInstructionLabel.setBounds(topRow.removeFromLeft(labelWidth));
+
+    // STFT geometry selectors on the right of the instruction label
+    int choiceBoxWidth = 110;
+    windowBox.setBounds(topRow.removeFromRight(choiceBoxWidth));
+    topRow.removeFromRight(margin);
+    overlapBox.setBounds(topRow.removeFromRight(choiceBoxWidth));
+    topRow.removeFromRight(margin);
+    fftSizeBox.setBounds(topRow.removeFromRight(choiceBoxWidth));
+    topRow.removeFromRight(margin);
+    lowLatencyButton.setBounds(topRow.removeFromRight(choiceBoxWidth));
+
+    // Add extra vertical space after the label; the engine selector sits in it under the window selector,
+    // the sidechain link toggle under the low latency toggle
     int verticalSpacingAfterLabel = 20; // Increase this value for more spacing
+    auto secondRow = area.removeFromTop(verticalSpacingAfterLabel);
+    engineBox.setBounds(secondRow.removeFromRight(choiceBoxWidth));
+    secondRow.removeFromRight(margin + 2 * (choiceBoxWidth + margin));
+    sidechainLinkButton.setBounds(secondRow.removeFromRight(choiceBoxWidth));
+    secondRow.removeFromRight(margin);
+    stageTimingsButton.setBounds(secondRow.removeFromRight(choiceBoxWidth));
+
+    // Spectrum analyser below the top row
+    int spectrumHeight = 170;
+    spectrumView.setBounds(area.removeFromTop(spectrumHeight));
+    stageTimingsOverlay.setBounds(spectrumView.getBounds().removeFromRight(330).removeFromTop(126).reduced(4));
     area.removeFromTop(verticalSpacingAfterLabel);
 
     // Vertical spacing between rows
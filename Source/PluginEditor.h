@@ -10,12 +10,14 @@
 
 #include <JuceHeader.h>
 #include "PluginProcessor.h"
+#include "SpectrumAnalyserComponent.h"
 
 //==============================================================================
 /**
 */
 class ExchangeBandAudioProcessorEditor  : public juce::AudioProcessorEditor,
-                                   public juce::Slider::Listener 
+                                   public juce::Slider::Listener,
+                                   private juce::Timer
 {
 public:
     ExchangeBandAudioProcessorEditor (ExchangeBandAudioProcessor&);
@@ -25,7 +27,8 @@ public:
     void paint (juce::Graphics&) override;
     void resized() override;
     
-    void timerCallback() ;
+    // 每秒 60 次：取出音频线程发布的频谱帧，同步频段显示，刷新耗时统计
+    void timerCallback() override;
     // 检查侧链输入是否激活
     // 实现 ChangeListener 的回调
     void changeListenerCallback(juce::ChangeBroadcaster* source) ;
@@ -40,6 +43,11 @@ private:
 
     // 添加一个标签用于提示用户设置侧链输入
     juce::Label sidechainInstructionLabel;
+
+    // 实时频谱。整个编辑器通过 OpenGL 渲染，只有 repaint() 标记过的区域会重画
+    juce::OpenGLContext openGLContext;
+    SpectrumAnalyserComponent spectrumView;
+    SpectrumAnalyser::Frame spectrumFrame;
     
     // 定义九个滑块
     juce::Slider cutFrequencyFrom1Slider; //第一个交换的band的frequency开始值
@@ -57,6 +65,28 @@ private:
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> band1MixAttachment;
     std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment> band2MixAttachment;
 
+    // STFT 几何（FFT 点数 / 重叠 / 窗类型）
+    juce::ComboBox fftSizeBox;
+    juce::ComboBox overlapBox;
+    juce::ComboBox windowBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> fftSizeAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> overlapAttachment;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> windowAttachment;
+    juce::ToggleButton lowLatencyButton { "Low latency" };
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> lowLatencyAttachment;
+    juce::ToggleButton sidechainLinkButton { "Link sidechain" };
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ButtonAttachment> sidechainLinkAttachment;
+
+    // 处理引擎（STFT / 零延迟 IIR）。选 IIR 时 STFT 几何的控件变灰
+    juce::ComboBox engineBox;
+    std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment> engineAttachment;
+
+    // 各处理阶段的耗时统计，叠加在频谱右上角；打开时清空统计，之后每秒刷新 4 次
+    juce::ToggleButton stageTimingsButton { "Timing" };
+    juce::Label stageTimingsOverlay;
+    int timerCallbacksSinceTimingUpdate = 0;
+    void updateStageTimingsOverlay();
+
     // 定义标签（可选）
     juce::Label cutFrequencyFrom1Label;
     juce::Label cutFrequencyFrom2Label;
@@ -71,6 +101,9 @@ private:
     
     // 帮助函数，用于设置滑块
     void setupSlider(juce::Slider& slider, const juce::String& name);
+    // 帮助函数，用选项参数的选项填充下拉框并绑定参数
+    void setupChoiceBox(juce::ComboBox& box, const juce::String& parameterID,
+                        std::unique_ptr<juce::AudioProcessorValueTreeState::ComboBoxAttachment>& attachment);
     // 帮助函数，用于设置标签
     void setupLabel(juce::Label& label, const juce::String& text);
     
@@ -20,28 +20,7 @@ ExchangeBandAudioProcessor::ExchangeBandAudioProcessor()
                        .withInput ("Input", juce::AudioChannelSet::stereo(), true)       // 主输入
                        .withInput ("Sidechain", juce::AudioChannelSet::stereo(), true)   // 侧链输入，false代表他不是总线，即为辅助总线。
                        .withOutput ("Output", juce::AudioChannelSet::stereo(), true)),//输出
-windowFunction(nullptr),    // 初始化输入缓冲区，假设是立体声和2048点FFT
-sampleRate(0.0), // 初始化侧链输入缓冲区
-fft(fftOrder),    // 初始化输出缓冲区
-fftFrequency(fftSize / 2),           // 初始化采样率
-sampleRateOverFftSize(0.0f), // 初始化为默认值
-parameters (*this, nullptr, juce::Identifier ("Parameters"),
-            {
-    std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("cutFrequencyFrom1",1), "CutFrequencyFrom1", createFrequencyRange(), 2000.0f),
-    std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("cutFrequencyFrom2",1), "CutFrequencyFrom2", createFrequencyRange(), 2000.0f),
-    //band可以是中心的
-    //slider非线性
-    std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("FrequencyBandLength",1), "FrequencyBandLength",  juce::NormalisableRange<float>(0.0f, 2.0f), 1.0f),//length之于cutofffrequency的比率 q值 比例关系
-    //0-200%*cutofffrequency
-    std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("ExchangeBandValue",1), "ExchangeBandValueOrNot", 0.0f, 1.0f, 1.0f),
-    std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("band1Mix",1), "Band1Mix", 0.0f, 1.0f, 0.01f),
-    std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("band2Mix",1), "Band2Mix", 0.0f, 1.0f, 0.01f),
-}),  // 假设频率数据只需要一半
-    formatManager(),
-    overlapAddBuffer(2, fftSize),  // overlap-add buffer，假设是立体声
-    mainchainFrequency(fftSize / 2),
-    sidechainFrequency(fftSize / 2),
-    mixedFrequency(fftSize / 2)
+parameters (*this, nullptr, juce::Identifier ("Parameters"), createParameterLayout())
 {
     // 设置默认总线布局
     BusesLayout defaultLayout;
@@ -52,38 +31,90 @@ parameters (*this, nullptr, juce::Identifier ("Parameters"),
     // 直接将侧链输入总线的通道数设置为 2
     getBus(true, 1)->setNumberOfChannels(2);
 
-    formatManager.registerBasicFormats(); // 注册基本音频格式
+    // 缓存原始参数指针，音频线程每个 hop 只做原子读取，不再按字符串 ID 查找
+    parameterPointers.cutFrequencyFrom1   = parameters.getRawParameterValue("cutFrequencyFrom1");
+    parameterPointers.cutFrequencyFrom2   = parameters.getRawParameterValue("cutFrequencyFrom2");
+    parameterPointers.frequencyBandLength = parameters.getRawParameterValue("FrequencyBandLength");
+    parameterPointers.exchangeBandValue   = parameters.getRawParameterValue("ExchangeBandValue");
+    parameterPointers.band1Mix            = parameters.getRawParameterValue("band1Mix");
+    parameterPointers.band2Mix            = parameters.getRawParameterValue("band2Mix");
+    parameterPointers.fftSizeIndex        = parameters.getRawParameterValue("fftSize");
+    parameterPointers.overlapIndex        = parameters.getRawParameterValue("overlap");
+    parameterPointers.windowType          = parameters.getRawParameterValue("window");
+    parameterPointers.lowLatency          = parameters.getRawParameterValue("lowLatency");
+    parameterPointers.sidechainLink       = parameters.getRawParameterValue("sidechainLink");
+    parameterPointers.numBands            = parameters.getRawParameterValue("numBands");
+
+    for (int band = 3; band <= ExchangeBandParameters::maxBands; ++band)
+    {
+        const auto prefix = "band" + juce::String(band);
+        auto& bandPointers = parameterPointers.extraBands[(size_t) (band - 1)];
+        bandPointers.centreFrequency = parameters.getRawParameterValue(prefix + "Frequency");
+        bandPointers.width           = parameters.getRawParameterValue(prefix + "Width");
+        bandPointers.widthUnit       = parameters.getRawParameterValue(prefix + "WidthUnit");
+        bandPointers.mix             = parameters.getRawParameterValue(prefix + "Mix");
+        bandPointers.partner         = parameters.getRawParameterValue(prefix + "Partner");
+        jassert(bandPointers.isValid());
+    }
+    jassert(parameterPointers.isValid());
+    engine.setParameterSource(parameterPointers);
+    crossover.setParameterSource(parameterPointers);
+    engineChoice = parameters.getRawParameterValue("engine");
 
-    // 初始化FFT数据缓冲区
-    mainchainFFTData.resize(fftSize, 0.0f);
-    sidechainFFTData.resize(fftSize, 0.0f);
+    // FFT 后端默认在 prepareToPlay 时按 CPU 自动选择；排查问题时可以用环境变量强制指定（juce / stockham）
+    RealFft::Backend forcedBackend;
 
-    // 初始化频率、幅度和相位缓冲区
-    mainMagnitude.resize(fftSize / 2 + 1);
-    mainPhase.resize(fftSize / 2 + 1);
+    if (RealFft::parseBackendName(juce::SystemStats::getEnvironmentVariable("EXCHANGEBAND_FFT_BACKEND", {}), forcedBackend))
+        engine.forceFftBackend(forcedBackend);
 
-    sidechainMagnitude.resize(fftSize / 2 + 1);
-    sidechainPhase.resize(fftSize / 2 + 1);
-    
-    mixedMagnitude1.resize(fftSize / 2 + 1);
-    mixedPhase1.resize(fftSize / 2 + 1);
-    
-    mixedMagnitude2.resize(fftSize / 2 + 1);
-    mixedPhase2.resize(fftSize / 2 + 1);
-    outMagnitude.resize(fftSize / 2 + 1);
-    outPhase.resize(fftSize / 2 + 1);
-    outputFFTData.resize(fftSize, 0.0f); // 逆 FFT 存储 fftSize 个元素
-    mainRingBuffer.resize(fftSize, 0.0f);
-    sidechainRingBuffer.resize(fftSize, 0.0f);
-    // 初始化代码
-    sampleRateOverFftSize = static_cast<float>(sampleRate) / static_cast<float>(fftSize);
-    jassert(mainRingBuffer.size() == fftSize);  // 确保主链环形缓冲区大小一致
-    jassert(sidechainRingBuffer.size() == fftSize);  // 确保侧链环形缓冲区大小一致
+    // 音频线程发布的延迟由 message 线程轮询后报告给宿主，不在音频线程上投递消息
+    updateLatencyAndTail();
+    startTimerHz(20);
 }
 
 
 ExchangeBandAudioProcessor::~ExchangeBandAudioProcessor()
 {
+    stopTimer();
+}
+
+//==============================================================================
+void ExchangeBandAudioProcessor::publishLatencyAndTail() noexcept
+{
+    outputLatencySamples.store(engineSwitcher.getLatencySamples(), std::memory_order_relaxed);
+    outputTailSamples.store(engineSwitcher.getTailSamples(), std::memory_order_relaxed);
+}
+
+void ExchangeBandAudioProcessor::timerCallback()
+{
+    updateLatencyAndTail();
+}
+
+void ExchangeBandAudioProcessor::updateLatencyAndTail()
+{
+    const auto sampleRate = getSampleRate();
+    const auto latency = outputLatencySamples.load(std::memory_order_relaxed);
+
+    // prepareToPlay 之前引擎还没有输出，按参数里的目标报告
+    if (latency < 0 || sampleRate <= 0.0)
+    {
+        // 零延迟引擎没有延迟，尾音只是 IIR 的衰减
+        if (isUsingCrossoverEngine())
+        {
+            setLatencySamples(0);
+            tailLengthSeconds = CrossoverEngine::tailSeconds;
+            return;
+        }
+
+        const auto stft = parameterPointers.load().stft;
+        setLatencySamples(stft.getLatencySamples());
+        tailLengthSeconds = sampleRate > 0.0 ? (double) stft.getTailSamples() / sampleRate : 0.0;
+        return;
+    }
+
+    // setLatencySamples() 只在值变化时通知宿主
+    setLatencySamples(latency);
+    tailLengthSeconds = (double) outputTailSamples.load(std::memory_order_relaxed) / sampleRate;
 }
 
 //==============================================================================
@@ -121,7 +152,7 @@ bool ExchangeBandAudioProcessor::isMidiEffect() const
 
 double ExchangeBandAudioProcessor::getTailLengthSeconds() const
 {
-    return 0.0;
+    return tailLengthSeconds;
 }
 
 int ExchangeBandAudioProcessor::getNumPrograms()
@@ -149,6 +180,63 @@ void ExchangeBandAudioProcessor::changeProgramName (int index, const juce::Strin
 }
 
 //==============================================================================
+juce::AudioProcessorValueTreeState::ParameterLayout ExchangeBandAudioProcessor::createParameterLayout()
+{
+    juce::AudioProcessorValueTreeState::ParameterLayout layout;
+
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("cutFrequencyFrom1",1), "CutFrequencyFrom1", createFrequencyRange(), 2000.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("cutFrequencyFrom2",1), "CutFrequencyFrom2", createFrequencyRange(), 2000.0f));
+    //band可以是中心的
+    //slider非线性
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("FrequencyBandLength",1), "FrequencyBandLength",  juce::NormalisableRange<float>(0.0f, 2.0f), 1.0f));//length之于cutofffrequency的比率 q值 比例关系
+    //0-200%*cutofffrequency
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("ExchangeBandValue",1), "ExchangeBandValueOrNot", 0.0f, 1.0f, 1.0f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("band1Mix",1), "Band1Mix", 0.0f, 1.0f, 0.01f));
+    layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID("band2Mix",1), "Band2Mix", 0.0f, 1.0f, 0.01f));
+    // STFT 几何：点数越大频率分辨率越高、延迟越大；切换时引擎内部交叉淡化
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("fftSize",1), "FFTSize",
+        juce::StringArray { "256", "512", "1024", "2048", "4096", "8192", "16384", "32768" }, 3));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("overlap",1), "Overlap",
+        juce::StringArray { "50%", "75%", "87.5%" }, 0));
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("window",1), "Window",
+        juce::StringArray { "Sqrt Hann", "Hann", "Blackman-Harris" }, 0));
+    // 低延迟模式：非对称窗，延迟 = 2 * hop（1024 点 + 87.5% 重叠时为 256 个样本）
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("lowLatency",1), "LowLatency", false));
+    // 侧链联动：多声道侧链取平均后只分析一次，所有主链通道用同一份侧链频谱（单声道侧链总是如此）
+    layout.add(std::make_unique<juce::AudioParameterBool>(juce::ParameterID("sidechainLink",1), "SidechainLink", false));
+
+    // 第 3 个及以后的频段：numBands 之外的频段不生效。
+    // 宽度的单位由 WidthUnit 决定（Hz / 倍频程 / ERB），Partner 为 0 表示不交换，n 表示输出第 n 个频段的内容
+    layout.add(std::make_unique<juce::AudioParameterInt>(juce::ParameterID("numBands",1), "NumBands", 2, ExchangeBandParameters::maxBands, 2));
+
+    juce::StringArray partnerChoices { "None" };
+    for (int band = 1; band <= ExchangeBandParameters::maxBands; ++band)
+        partnerChoices.add("Band " + juce::String(band));
+
+    juce::NormalisableRange<float> widthRange (0.01f, 10000.0f);
+    widthRange.setSkewForCentre(1.0f);
+
+    for (int band = 3; band <= ExchangeBandParameters::maxBands; ++band)
+    {
+        const auto prefix = "band" + juce::String(band);
+        const auto name = "Band" + juce::String(band);
+
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(prefix + "Frequency",1), name + "Frequency", createFrequencyRange(), 1000.0f));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(prefix + "Width",1), name + "Width", widthRange, 1.0f));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(prefix + "WidthUnit",1), name + "WidthUnit",
+            juce::StringArray { "Hz", "Octaves", "ERB" }, (int) ExchangeBand::octaves));
+        layout.add(std::make_unique<juce::AudioParameterFloat>(juce::ParameterID(prefix + "Mix",1), name + "Mix", 0.0f, 1.0f, 0.0f));
+        layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID(prefix + "Partner",1), name + "Partner", partnerChoices, 0));
+    }
+
+    // 处理引擎：STFT 的频段边缘陡、延迟随 FFT 点数变化；零延迟的 IIR 分频器边缘较缓，适合现场演出和录音监听。
+    // 放在最后，旧工程里已有参数的下标不变
+    layout.add(std::make_unique<juce::AudioParameterChoice>(juce::ParameterID("engine",1), "Engine",
+        juce::StringArray { "Spectral (STFT)", "Zero latency (IIR)" }, 0));
+
+    return layout;
+}
+
 juce::NormalisableRange<float> ExchangeBandAudioProcessor::createFrequencyRange()
 {
     // 定义频率范围的最小值和最大值
@@ -224,312 +312,116 @@ void ExchangeBandAudioProcessor::prepareToPlay (double sampleRate, int samplesPe
     int sidechainBusNumInputChannels = getBus(true, 1)->getNumberOfChannels();  // 默认值
     DBG("sidechainBusNumInputChannels: " << sidechainBusNumInputChannels);
 
-    int numOutputChannels = getTotalNumOutputChannels(); // 输出通道的总数
     DBG("prepareToPlay Called");
     DBG("Sample Rate: " << sampleRate);
     DBG("Samples Per Block: " << samplesPerBlock);
-    // 检查 FFT 大小和 FIFO 初始化参数
-    jassert(fftSize > 0);
     jassert(mainBusNumInputChannels > 0);
     jassert(getBusCount(true) > 0);
-    DBG("FIFOs Initialized");
-    fft = juce::dsp::FFT (std::log2 (fftSize)); // 初始化 FFT 处理器，使用 FFT 大小的对数值（以 2 为底）
-
-    overlapAddBuffer.setSize (getTotalNumOutputChannels(), fftSize * 2); // 设置存储重叠部分的缓冲区大小
-    overlapAddBuffer.clear(); // 清空重叠缓冲区
-    overlapWriteIndex = 0; // 初始化重叠缓冲区写入索引为 0
-
-    // 初始化 FFT 相关的缓冲区
-    mainchainFFTData.resize(fftSize * 2, 0.0f);
-    mainMagnitude.resize (fftSize / 2 + 1, 0.0f);
-    mainPhase.resize(fftSize / 2 + 1);
-    sidechainFFTData.resize(fftSize * 2, 0.0f);
-    sidechainMagnitude.resize (fftSize / 2 + 1, 0.0f);
-    sidechainPhase.resize(fftSize / 2 + 1);
-    mixedMagnitude1.resize(fftSize / 2 + 1);
-    mixedPhase1.resize(fftSize / 2 + 1);
-    mixedMagnitude2.resize(fftSize / 2 + 1);
-    mixedPhase2.resize(fftSize / 2 + 1);
-    outMagnitude.resize(fftSize / 2 + 1);
-    outPhase.resize(fftSize / 2 + 1);
-    outputFFTData.resize(fftSize * 2, 0.0f);
-    // 初始化 windowFunction 窗函数
-    windowFunction = std::make_unique<juce::dsp::WindowingFunction<float>>(fftSize, juce::dsp::WindowingFunction<float>::hann); // 使用 Hann 窗函数初始化
-
-    this->sampleRate = sampleRate; // 存储采样率
-    // 预计算值
-    sampleRateOverFftSize = static_cast<float> (sampleRate) / static_cast<float> (fftSize); // 计算采样率除以 FFT 大小的值
-    
-    // 计算频率向量
-    mainchainFrequency.resize(fftSize / 2 + 1);
-    sidechainFrequency.resize(fftSize / 2 + 1);
-    mixedFrequency.resize(fftSize / 2 + 1);
 
-    for (int bin = 0; bin <= fftSize / 2; ++bin)
-    {
-        float freq = bin * sampleRateOverFftSize; // 计算每个 bin 的频率值
-        mainchainFrequency[bin] = freq; // 存储到主链频率缓冲区
-        sidechainFrequency[bin] = freq; // 存储到侧链频率缓冲区
-        mixedFrequency[bin] = freq; // 存储到混合频率缓冲区
-    }
-    // 如果采样率变化，需要重新初始化 FFT 或缓冲区
-    jassert(fftSize == (1 << fftOrder));
-    DBG("fftSize Changed");
+    // FFT、窗函数、环形缓冲区和 overlap-add 状态都由引擎分配，精度跟随宿主选择的 processBlock
+    const auto precision = isUsingDoublePrecision() ? ExchangeBandEngine::ProcessingPrecision::doublePrecision
+                                                    : ExchangeBandEngine::ProcessingPrecision::singlePrecision;
+    engine.prepare (sampleRate, samplesPerBlock, getTotalNumOutputChannels(), sidechainBusNumInputChannels, precision);
+    // 两个引擎都准备好，播放中切换引擎时不需要分配内存
+    crossover.prepare (sampleRate, samplesPerBlock, getTotalNumOutputChannels(), sidechainBusNumInputChannels, precision);
+    engineSwitcher.prepare (samplesPerBlock, getTotalNumOutputChannels(), precision, isUsingCrossoverEngine());
+    publishLatencyAndTail();
+    updateLatencyAndTail();
+
     int inputBusCount = getBusCount(true); // true 表示输入总线
     DBG("Input Bus Count: " << inputBusCount); // 应该输出 2
 }
 
 void ExchangeBandAudioProcessor::releaseResources()
 {
-    // 重置所有缓冲区和处理器
-    windowFunction.reset();
-    overlapAddBuffer.clear();
-    mainRingBuffer.clear();
-    sidechainRingBuffer.clear();
-    mainMagnitude.clear();
-    mainPhase.clear();
-    sidechainMagnitude.clear();
-    sidechainPhase.clear();
-    mixedMagnitude1.clear();
-    mixedPhase1.clear();
-    mixedMagnitude2.clear();
-    mixedPhase2.clear();
-    outputFFTData.clear();
-    outMagnitude.clear();
-    outPhase.clear();
-    
-    printf("Release Sources");
+    // 引擎的缓冲区保留到下一次 prepareToPlay，避免重复分配；这里只清空状态
+    engine.reset();
+    crossover.reset();
+    engineSwitcher.reset(isUsingCrossoverEngine());
 }
 
-
 bool ExchangeBandAudioProcessor::isBusesLayoutSupported(const BusesLayout& layouts) const
 {
-    DBG("Main Input Channels: " << layouts.getMainInputChannelSet().size());
-    DBG("Main Output Channels: " << layouts.getMainOutputChannelSet().size());
+    const auto mainInput = layouts.getMainInputChannelSet();
+    const auto mainOutput = layouts.getMainOutputChannelSet();
+    DBG("Main Input: " << mainInput.getDescription());
+    DBG("Main Output: " << mainOutput.getDescription());
     DBG("Input Buses Count: " << layouts.inputBuses.size());
-    // 检查主输出是否为立体声
-    if (layouts.getMainOutputChannelSet() != juce::AudioChannelSet::stereo())
+
+    // 主输入和输出可以是任意布局（立体声、5.1、7.1.4、Ambisonics ...），但两者必须相同，
+    // 每个通道各有一套 STFT 状态
+    if (mainOutput.isDisabled() || mainInput != mainOutput)
     {
-        DBG("Main output is not stereo");
+        DBG("Main input and output layouts differ");
         return false;
     }
 
-    // 检查主输入是否为立体声
-    if (layouts.getMainInputChannelSet() != juce::AudioChannelSet::stereo())
+    // 更多的通道在音频线程上建立总线视图时会分配内存（见 ExchangeBandEngine::maxChannels）
+    if (mainInput.size() > ExchangeBandEngine::maxChannels)
     {
-        DBG("Main input is not stereo");
+        DBG("Too many channels");
         return false;
     }
-    int sidechainBusNumInputChannels = getBus(true, 1)->getNumberOfChannels();  // 默认值
+
     if (layouts.inputBuses.size() > 1)
     {
         auto sidechainInput = layouts.getChannelSet(true, 1);
-        DBG("Sidechain Channels: " << sidechainInput.size());
-        DBG("sidechainInput: " << sidechainInput.getDescription());
+        DBG("Sidechain: " << sidechainInput.getDescription());
 
-        // 检查侧链输入是否禁用或为单声道/立体声
-        if (!sidechainInput.isDisabled())
-        {
-            if (sidechainInput != juce::AudioChannelSet::mono() &&
-                sidechainInput != juce::AudioChannelSet::stereo())
-            {
-                DBG("Sidechain input is neither mono nor stereo");
-                return false;
-            }
-        }
-        else
+        // 侧链可以禁用、为单声道（所有主链通道共用）或与主链布局相同
+        if (!sidechainInput.isDisabled()
+            && sidechainInput != juce::AudioChannelSet::mono()
+            && sidechainInput != mainInput)
         {
-            DBG("Sidechain input is disabled");
+            DBG("Sidechain is neither mono nor the main layout");
+            return false;
         }
     }
 
     // 如果所有检查通过，则支持该布局
-    DBG("Layout supported: Mono and Stereo");
+    DBG("Layout supported");
     return true;
 }
 
 
+StageTimings::Snapshot ExchangeBandAudioProcessor::getStageTimings() const noexcept
+{
+    auto snapshot = engine.getStageTimings().getSnapshot();
+    snapshot.fftBackend = getFftBackend();
+    snapshot.fftBackendForced = isFftBackendForced();
+    return snapshot;
+}
+
 //检查sideChain input是否被激活
 bool ExchangeBandAudioProcessor::isSidechainInputActive() const
 {
-    // 假设侧链需要至少两个输入通道（一个主链，一个侧链）
-    if (getTotalNumInputChannels() < 1) // 至少需要一个输入总线
-        {
-            DBG("No SidechainInput.");
-        }
-    return false;
-
+    // 只看总线：侧链总线已启用且通道数大于 0（单声道或与主链相同，由 isBusesLayoutSupported 保证）。
+    // 总线启用但信号静音的情况由引擎按每个 block 的 RMS 判断
     const juce::AudioProcessor::Bus* sidechainBus = getBus(true, 1); // 输入总线索引 1 为侧链
-    if (sidechainBus)
-    {
-        int sidechainChannels = sidechainBus->getNumberOfChannels();
-
-        // 如果侧链通道数小于2，则填充为2
-        if (sidechainChannels != 2)
-        {
-            DBG("Sidechain input channel count is not 2, adjusting to stereo.");
-            // 在此处执行调整逻辑，强制为 2 通道（通常这是通过音频处理中的填充实现的）
-            // 例如，你可以将其信号路由到两个通道，确保它是立体声
-            return false; // 或者执行其他行为，取决于你的需求
-        }
-
-        // 确保侧链总线已启用且通道数大于0
-        return sidechainBus->isEnabled() && sidechainChannels > 0;
-    }
-
-    return false;
+    return sidechainBus != nullptr && sidechainBus->isEnabled() && sidechainBus->getNumberOfChannels() > 0;
 }
 
 
 
-//FFT操作
-void ExchangeBandAudioProcessor::performFFT(float* inputData, std::vector<float>& magnitude, std::vector<float>& phase, bool isMainchain)
-{
-    std::lock_guard<std::mutex> lock(vectorMutex); // 确保线程安全
-    // 执行 FFT
-    fft.performRealOnlyForwardTransform(inputData);
-
-    // 计算幅度和相位
-    for (int bin = 0; bin <= fftSize / 2; ++bin)
-    {
-        float real = inputData[2 * bin];
-        float imag = inputData[2 * bin + 1];
-        magnitude[bin] = std::sqrt(real * real + imag * imag);
-        phase[bin] = std::atan2(imag, real);
-    }
-}
-
-void ExchangeBandAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
+template <typename SampleType>
+void ExchangeBandAudioProcessor::processSamples(juce::AudioBuffer<SampleType>& buffer)
 {
-    // 这里手动检查布局是否有效
-    if (!isBusesLayoutSupported(getBusesLayout()))
-    {
-        // 如果不支持，可能需要采取其他措施，如发送错误或禁用某些功能
-        DBG("Unsupported buses layout!");
-    }
-
-    std::lock_guard<std::mutex> lock(vectorMutex); // 确保线程安全
-    auto numSamples = buffer.getNumSamples();
-
-    // 确保 FFT 相关缓冲区大小正确
-    jassert(mainMagnitude.size() == fftSize / 2 + 1);
-    jassert(mainPhase.size() == fftSize / 2 + 1);
-    jassert(sidechainMagnitude.size() == fftSize / 2 + 1);
-    jassert(sidechainPhase.size() == fftSize / 2 + 1);
-    jassert(mixedMagnitude1.size() == fftSize / 2 + 1);
-    jassert(mixedPhase1.size() == fftSize / 2 + 1);
-    jassert(mixedMagnitude2.size() == fftSize / 2 + 1);
-    jassert(mixedPhase2.size() == fftSize / 2 + 1);
-    jassert(outputFFTData.size() == 2 * fftSize);
-    jassert(overlapAddBuffer.getNumChannels() >= buffer.getNumChannels());
-    jassert(overlapAddBuffer.getNumSamples() >= fftSize * 2);
-    DBG("fftBufferGreat");
-    // 侧链输入激活时，处理主链和侧链
-    if (isSidechainInputActive())
-    {
-        int mainNumChannels = getBus(true, 0)->getNumberOfChannels();
-        for (int ch = 0; ch < mainNumChannels; ++ch)
-        {
-            buffer.copyFrom(ch, 0, buffer.getReadPointer(ch), numSamples);
-        }
-        int sidechainNumChannels = getBus(true, 1)->getNumberOfChannels();
-        DBG("Main input channels: " << mainNumChannels);
-        DBG("Sidechain input channels: " << sidechainNumChannels);
-        
-        for (int channel = 0; channel < mainNumChannels; ++channel)
-        {
-            const float* readPtr = buffer.getReadPointer(channel);
-            for (int sample = 0; sample < numSamples; ++sample)
-            {
-                mainRingBuffer[mainRingBufferWriteIdx] = readPtr[sample];
-                mainRingBufferWriteIdx = (mainRingBufferWriteIdx + 1) % fftSize;  // 使用模运算确保写入不越界
-                mainSampleCount++;
-            }
-        }
-        DBG("mainRingBufferGet");
-
-        // 将侧链数据写入侧链环形缓冲区
-        for (int channel = 0; channel < sidechainNumChannels; ++channel)
-        {
-            const float* readPtr_1 = buffer.getReadPointer(channel + mainNumChannels);  // 获取侧链通道数据
-            for (int sample = 0; sample < numSamples; ++sample)
-            {
-                sidechainRingBuffer[sidechainRingBufferWriteIdx] = readPtr_1[sample];
-                sidechainRingBufferWriteIdx = (sidechainRingBufferWriteIdx + 1) % fftSize;  // 确保不越界
-                sidechainSampleCount++;
-            }
-        }
-        DBG("sidechainRingBufferGet");
-        jassert(mainRingBufferWriteIdx >= 0 && mainRingBufferWriteIdx < fftSize);
-        jassert(sidechainRingBufferWriteIdx >= 0 && sidechainRingBufferWriteIdx < fftSize);
-
-        // 判断是否有足够的数据进行 FFT
-        if (mainSampleCount >= fftSize && sidechainSampleCount >= fftSize)
-        {
-            DBG("Enough data for FFT processing");
-
-            std::vector<float> mainFFTData(fftSize);
-            std::vector<float> sidechainFFTData(fftSize);
-
-            for (int i = 0; i < fftSize; ++i)
-            {
-                int readIdx = (mainRingBufferWriteIdx + i - fftSize) % mainRingBuffer.size();
-                if (readIdx < 0)
-                    readIdx += mainRingBuffer.size();
-
-                //mainFFTData[i] = mainRingBuffer[readIdx];
-                //sidechainFFTData[i] = sidechainRingBuffer[readIdx];
-                mainFFTData[i] = mainRingBuffer[(ringBufferReadIdx + i) % fftSize];
-                sidechainFFTData[i] = sidechainRingBuffer[(ringBufferReadIdx + i) % fftSize];
-            }
-
-            juce::String mainFFTString;
-            
-            for (int i = 0; i < fftSize; ++i)
-            {
-                mainFFTString += juce::String(mainFFTData[i], 2) + " "; // 保留2位小数，空格分隔
-            }
-            DBG("Main FFT Data: " << mainFFTString);
-
-            juce::String sidechainFFTString;
-            for (int i = 0; i < fftSize; ++i)
-            {
-                sidechainFFTString += juce::String(sidechainFFTData[i], 2) + " "; // 保留2位小数，空格分隔
-            }
-            DBG("Sidechain FFT Data: " << sidechainFFTString);
-            jassert(mainFFTData.size() == fftSize);
-            jassert(sidechainFFTData.size() == fftSize);
-            DBG("mainFFTData size: " << mainFFTData.size());
-            DBG("sidechainFFTData size: " << sidechainFFTData.size());
-
-            // 执行主链和侧链的 FFT
-            performFFT(mainFFTData.data(), mainMagnitude, mainPhase, true);  // 主链FFT
-            performFFT(sidechainFFTData.data(), sidechainMagnitude, sidechainPhase, false);  // 侧链FFT
-            DBG("performFFT");
-            // 执行交叉合成和 IFFT
-            crossSynthesis();
-            DBG("crossSynthesis");
-            jassert(buffer.getNumSamples() >= fftSize);
-            performIFFT(buffer);
-            DBG("performIFFT");
-
-            // 更新计数器
-            mainSampleCount -= fftSize;
-            sidechainSampleCount -= fftSize;
-            DBG("updateCounter");
-
-        }
-    }
-    else
-    {
-        // 侧链未激活时，直接将输入数据复制到输出
-        int mainNumChannels = getBus(true, 0)->getNumberOfChannels();
-        for (int channel = 0; channel < mainNumChannels; ++channel)
-        {
-            buffer.copyFrom(channel, 0, buffer.getReadPointer(channel), numSamples);
-        }
-        DBG("outputDirecly");
-    }
+    // 音频线程上不做任何内存分配和字符串格式化（布局由 host 通过 isBusesLayoutSupported 检查），
+    // 也不加锁：引擎状态只属于这个线程，对外发布的数据走 wait-free 通道。
+    // 用 EXCHANGEBAND_REALTIME_CHECKS=1 构建时，违反这两条会被 RealtimeSafety 报告
+    EXCHANGEBAND_REALTIME_SECTION();
+
+    auto mainBuffer = getBusBuffer(buffer, true, 0);
+
+    // 侧链未激活时传入没有通道的 buffer；侧链缺失或静音时引擎跳过 STFT，
+    // 输出与处理时同样延迟的主链，宿主的延迟补偿不受影响
+    const auto sidechainBuffer = isSidechainInputActive() ? getBusBuffer(buffer, true, 1)
+                                                          : juce::AudioBuffer<SampleType>();
+
+    // 引擎选择改变时 engineSwitcher 让两个引擎并行处理，对齐后交叉淡化；
+    // 发布的延迟在输出跳变的那个 block 里切换
+    engineSwitcher.process (mainBuffer, sidechainBuffer, isUsingCrossoverEngine());
+    publishLatencyAndTail();
 //    else // 如果侧链未激活
 //    {
 //        int mainNumChannels = getBus(true, 0)->getNumberOfChannels();
@@ -557,6 +449,18 @@ void ExchangeBandAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
 //    }
     
 }
+
+void ExchangeBandAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer&)
+{
+    processSamples(buffer);
+}
+
+void ExchangeBandAudioProcessor::processBlock(juce::AudioBuffer<double>& buffer, juce::MidiBuffer&)
+{
+    // 64 位混音总线直接以 double 处理，不用每次回调都转换成 float
+    processSamples(buffer);
+}
+
 //void ExchangeBandAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer, juce::MidiBuffer& midiMessages)
 //{
 //    std::lock_guard<std::mutex> lock(vectorMutex); // 确保线程安全
@@ -618,315 +522,6 @@ void ExchangeBandAudioProcessor::processBlock(juce::AudioBuffer<float>& buffer,
 //    }
 //}
 
-//void ExchangeBandAudioProcessor::crossSynthesis()
-//{
-//
-//    // 获取参数值
-//    float cutFrequencyFrom1 = parameters.getParameterAsValue("cutFrequencyFrom1").getValue();
-//    float cutFrequencyFrom2 = parameters.getParameterAsValue("cutFrequencyFrom2").getValue();
-//    float bandLength = parameters.getParameterAsValue("FrequencyBandLength").getValue();
-//    float exchangeBandValue = parameters.getParameterAsValue("ExchangeBandValue").getValue();
-//    float band1Mix = parameters.getParameterAsValue("band1Mix").getValue();
-//    float band2Mix = parameters.getParameterAsValue("band2Mix").getValue();
-//
-//    // 计算 bandLength 对应的频段宽度
-//    float bandWidth = juce::jmap(bandLength, 0.0f, 2.0f, 20.0f, 2000.0f); // 可以调整映射范围
-//    // 确保频段宽度在合理范围内
-//    bandWidth = juce::jlimit(20.0f, static_cast<float>(sampleRate) / 2.0f, bandWidth);
-//
-//    // 确保 cutFrequency 在合理范围内
-//    cutFrequencyFrom1 = juce::jlimit(20.0f, static_cast<float>(sampleRate) / 2.0f, cutFrequencyFrom1);
-//    cutFrequencyFrom2 = juce::jlimit(20.0f, static_cast<float>(sampleRate) / 2.0f, cutFrequencyFrom2);
-//
-//    // 计算中心 bin 索引
-//    int centerBin1 = static_cast<int>(cutFrequencyFrom1 * fftSize / static_cast<float>(sampleRate));
-//    int centerBin2 = static_cast<int>(cutFrequencyFrom2 * fftSize / static_cast<float>(sampleRate));
-//
-//    // 计算半带宽对应的 bin 数
-//    int halfBandBins1 = static_cast<int>((bandWidth / 2.0f) * fftSize / static_cast<float>(sampleRate));
-//    int halfBandBins2 = static_cast<int>((bandWidth / 2.0f) * fftSize / static_cast<float>(sampleRate));
-//
-//    // 确保半带宽至少为 1
-//    halfBandBins1 = std::max(1, halfBandBins1);
-//    halfBandBins2 = std::max(1, halfBandBins2);
-//
-//    // 计算索引范围
-//    int startBin1 = juce::jmax(0, centerBin1 - halfBandBins1);
-//    int endBin1 = juce::jmin(fftSize / 2, centerBin1 + halfBandBins1);
-//
-//    int startBin2 = juce::jmax(0, centerBin2 - halfBandBins2);
-//    int endBin2 = juce::jmin(fftSize / 2, centerBin2 + halfBandBins2);///test2
-//
-//
-//    // 添加断言以确保索引合法
-//    jassert(startBin1 >= 0 && startBin1 <= fftSize / 2);
-//    jassert(endBin1 >= 0 && endBin1 <= fftSize / 2);
-//    jassert(startBin2 >= 0 && startBin2 <= fftSize / 2);
-//    jassert(endBin2 >= 0 && endBin2 <= fftSize / 2);
-//    DBG("startBinAndEndBinGreat");
-//
-//    // 初始化混合后的幅度和相位为主链和侧链的原始值
-//    mixedMagnitude1 = mainMagnitude;
-//    mixedPhase1 = mainPhase;
-//    mixedMagnitude2 = sidechainMagnitude;
-//    mixedPhase2 = sidechainPhase;
-void ExchangeBandAudioProcessor::crossSynthesis()
-{
-    // 1) 获取参数值
-    float cutFrequencyFrom1  = parameters.getParameterAsValue("cutFrequencyFrom1").getValue();
-    float cutFrequencyFrom2  = parameters.getParameterAsValue("cutFrequencyFrom2").getValue();
-    float bandLength         = parameters.getParameterAsValue("FrequencyBandLength").getValue();
-    float exchangeBandValue  = parameters.getParameterAsValue("ExchangeBandValue").getValue();
-    float band1Mix           = parameters.getParameterAsValue("band1Mix").getValue();
-    float band2Mix           = parameters.getParameterAsValue("band2Mix").getValue();
-
-    // 2) 根据 bandLength 计算出实际带宽 bandWidth
-    //    下面这一行是你原先的映射，根据需要可自行修改数值范围
-    float bandWidth = juce::jmap(bandLength, 0.0f, 2.0f, 20.0f, 2000.0f);
-
-    // 3) 可选：再对 bandWidth 做一个基本的限幅，别小于 20Hz 或超过 Nyquist
-    bandWidth = juce::jlimit(20.0f, static_cast<float>(sampleRate) / 2.0f, bandWidth);
-    // 4) 计算半带宽 halfBW
-    float halfBW = bandWidth * 0.5f;
-
-    // 5) 为了保证不会越界，先设定中心频率的合法范围
-    //    这样在后面计算 centerBin ± halfBandBins 时就不会触发边界裁剪
-    float minCenterFreq = halfBW;
-    float maxCenterFreq = (sampleRate * 0.5f) - halfBW;
-
-    // 6) 把用户/算法得到的 cutFrequency clamping 到安全范围
-    cutFrequencyFrom1 = juce::jlimit(minCenterFreq, maxCenterFreq, cutFrequencyFrom1);
-    cutFrequencyFrom2 = juce::jlimit(minCenterFreq, maxCenterFreq, cutFrequencyFrom2);
-
-    // ========== 下面的逻辑就跟以往大同小异，只是注意这时不用再 clamp 20.0f ~ (sampleRate/2.0f) ==========
-
-    // 7) 计算中心 bin 索引
-    int centerBin1 = static_cast<int>(cutFrequencyFrom1 * fftSize / sampleRate);
-    int centerBin2 = static_cast<int>(cutFrequencyFrom2 * fftSize / sampleRate);
-
-    // 8) 根据 bandWidth -> halfBW -> 转成 bin 数
-    int halfBandBins = static_cast<int>( (halfBW) * fftSize / sampleRate );
-    // 如果你仍然想保证至少1个bin，就这样
-    halfBandBins = std::max(1, halfBandBins);
-
-    // 注意：如果两个频段都用同样的 bandWidth，就只需要一个 halfBandBins，
-    // 无论是1还是2，值都会一样，这样两个频段才会相同。
-    // 如果你用相同 bandWidth，那 halfBandBins1 == halfBandBins2，
-    // 这里演示就写成一个 halfBandBins 即可，省去重复代码。
-
-    // 9) 计算 startBin/endBin（这里保留 jmax / jmin 也无妨，
-    //    因为通过前面的 clamp，这里基本不会再被“截掉”了）
-    int startBin1 = juce::jmax(0, centerBin1 - halfBandBins);
-    int endBin1   = juce::jmin(fftSize / 2, centerBin1 + halfBandBins);
-
-    int startBin2 = juce::jmax(0, centerBin2 - halfBandBins);
-    int endBin2   = juce::jmin(fftSize / 2, centerBin2 + halfBandBins);
-
-    // 10) 断言检查，确认不会越界
-    jassert(startBin1 >= 0 && startBin1 <= fftSize / 2);
-    jassert(endBin1   >= 0 && endBin1   <= fftSize / 2);
-    jassert(startBin2 >= 0 && startBin2 <= fftSize / 2);
-    jassert(endBin2   >= 0 && endBin2   <= fftSize / 2);
-    DBG("startBinAndEndBinGreat");
-
-    // 11) 如果你想直接查看两个band的长度是否一致，可以 dbg一下:
-    int len1 = endBin1 - startBin1 + 1;
-    int len2 = endBin2 - startBin2 + 1;
-    DBG("band1 bin length: " << len1 << ", band2 bin length: " << len2);
-
-    // 12) 初始化混合后的幅度和相位
-    mixedMagnitude1 = mainMagnitude;
-    mixedPhase1     = mainPhase;
-    mixedMagnitude2 = sidechainMagnitude;
-    mixedPhase2     = sidechainPhase;
-    // 在 band1 频段内混合主链和侧链
-    for (int i = startBin1; i <= endBin1; ++i)
-    {
-        try
-        {
-            // 混合主链和侧链的幅度
-            mixedMagnitude1.at(i) = (1.0f - band1Mix) * mainMagnitude.at(i) + band1Mix * sidechainMagnitude.at(i);
-
-            // 混合主链和侧链的相位
-            mixedPhase1.at(i) = (1.0f - band1Mix) * mainPhase.at(i) + band1Mix * sidechainPhase.at(i);
-        }
-        catch (const std::out_of_range& e)
-        {
-            DBG("Out of range access in band1 loop at index " << i << ": " << e.what());
-        }
-    }
-
-    // 在 band2 频段内混合主链和侧链
-    for (int i = startBin2; i <= endBin2; ++i)
-    {
-        try
-        {
-            // 混合主链和侧链的幅度
-            mixedMagnitude1.at(i) = (1.0f - band2Mix) * mainMagnitude.at(i) + band2Mix * sidechainMagnitude.at(i);
-
-            // 混合主链和侧链的相位
-            mixedPhase1.at(i) = (1.0f - band2Mix) * mainPhase.at(i) + band2Mix * sidechainPhase.at(i);
-
-        }
-        catch (const std::out_of_range& e)
-        {
-            DBG("Out of range access in band2 loop at index " << i << ": " << e.what());
-        }
-    }
-
-    // 根据 exchangeBandValue 进行更复杂的频段交换
-    if (exchangeBandValue != 0.0f)
-    {
-        // 完全交换 band1 和 band2 的频域数据
-        for (int i = startBin1, j = startBin2; i <= endBin1 && j <= endBin2; ++i, ++j)
-        {
-            try
-            {
-                std::swap(mixedMagnitude1.at(i), mixedMagnitude2.at(j));
-                std::swap(mixedPhase1.at(i), mixedPhase2.at(j));
-            }
-            catch (const std::out_of_range& e)
-            {
-                DBG("Out of range access in exchangeBandValue != 0.0f loop at indices (" << i << ", " << j << "): " << e.what());
-            }
-        }
-    }
-    outMagnitude = mainMagnitude;
-    outPhase = mainPhase;
-    for (int i = startBin1; i <= endBin1; ++i)
-    {
-        outMagnitude[i] = mixedMagnitude1[i];
-        outPhase[i] = mixedPhase1[i];
-    }
-    for (int i = startBin2; i <= endBin2; ++i)
-    {
-        outMagnitude[i] = mixedMagnitude2[i];
-        outPhase[i] = mixedPhase2[i];
-    }
-}
-
-
-void ExchangeBandAudioProcessor::performIFFT(juce::AudioBuffer<float>& buffer)
-{
-    std::lock_guard<std::mutex> lock(vectorMutex); // 确保线程安全
-
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-    {
-        // 1) 清空输出频域数据，确保没有垃圾数据
-        std::fill(outputFFTData.begin(), outputFFTData.end(), 0.0f);
-
-        //===========================================================
-        // 2) 正频率部分 [0 ~ fftSize/2]
-        //    使用 outMagnitude[i]、outPhase[i]
-        //===========================================================
-        for (int i = 0; i <= fftSize / 2; ++i)
-        {
-            // 根据 outMagnitude/outPhase 来生成实部 & 虚部
-            float mag   = outMagnitude[i];
-            float ph    = outPhase[i];
-
-            int index   = 2 * i;
-            jassert(index + 1 < outputFFTData.size());
-
-            outputFFTData[index]     = mag * std::cos(ph);   // 实部
-            outputFFTData[index + 1] = mag * std::sin(ph);   // 虚部
-        }
-
-        //===========================================================
-        // 3) 负频率部分 (1 ~ fftSize/2 - 1)，做“对称共轭”镜像
-        //    注：i=0 和 i=fftSize/2 这两个点都是实数，无需重复。
-        //===========================================================
-        for (int i = 1; i < fftSize / 2; ++i)
-        {
-            // 取出正频率的幅度和相位
-            float mag   = outMagnitude[i];
-            float ph    = outPhase[i];
-
-            // 负频率对应的索引
-            int conjIndex = 2 * (fftSize - i);
-            jassert(conjIndex + 1 < outputFFTData.size());
-
-            // 负频率部分是正频率的共轭 -> e^{-j\theta} = cos(-θ) + i sin(-θ)
-            // 这里要注意一下：如果你后面还要手动再对 “虚部取负一次”，
-            // 那么这里你可以先写成 cos(ph), sin(ph)。具体看你的实现约定。
-            //
-            // 常规写法：cos(-θ) = cos(θ)，sin(-θ) = -sin(θ)
-            outputFFTData[conjIndex]     = mag * std::cos(-ph);  // = mag * cos(ph)
-            outputFFTData[conjIndex + 1] = mag * std::sin(-ph);  // = - (mag * sin(ph))
-        }
-
-        //===========================================================
-        // 4) 确保 DC(0Hz) 和 Nyquist(fftSize/2) 频率的虚部为 0
-        //===========================================================
-        outputFFTData[1] = 0.0f;  // DC 的虚部
-        outputFFTData[2 * (fftSize / 2) + 1] = 0.0f; // Nyquist 虚部
-
-        //===========================================================
-        // 5) 手动对虚部取负，以实现共轭对称
-        //    这一步要根据你的 transform 实现而定。
-        //    绝大多数 JUCE 的例子中，performRealOnlyInverseTransform
-        //    往往需要先对所有虚部取负一次。
-        //===========================================================
-        for (int i = 0; i < 2 * fftSize; i += 2)
-        {
-            outputFFTData[i + 1] = -outputFFTData[i + 1];
-        }
-
-        //===========================================================
-        // 6) 执行逆 FFT ( 注意：与正变换不同的是调用函数名称或参数！ )
-        //    如果你这里用的是 performRealOnlyForwardTransform 做逆变换，
-        //    说明你的库/代码里把这个当作逆变换在使用，请确保理解一致。
-        //===========================================================
-        fft.performRealOnlyForwardTransform(outputFFTData.data());
-
-        //===========================================================
-        // 7) 再次手动对虚部取负，以完成逆 FFT 的共轭操作
-        //===========================================================
-        for (int i = 0; i < 2 * fftSize; i += 2)
-        {
-            outputFFTData[i + 1] = -outputFFTData[i + 1];
-        }
-
-        //===========================================================
-        // 8) 归一化 (ifft 通常要除以 fftSize)
-        //===========================================================
-        for (int i = 0; i < fftSize; ++i)
-        {
-            outputFFTData[i] /= float(fftSize);
-        }
-
-        //===========================================================
-        // 9) overlap-add（OLA）写入
-        //===========================================================
-        overlapAddBuffer.addFrom(channel, overlapWriteIndex, outputFFTData.data(), fftSize);
-    }
-
-    //===========================================================
-    // 10) 将 OLA 缓冲区数据写回输出音频缓冲区
-    //===========================================================
-    for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
-    {
-        float* outputBufferData  = buffer.getWritePointer(channel);
-        const float* overlapData = overlapAddBuffer.getReadPointer(channel, overlapWriteIndex);
-
-        for (int sample = 0; sample < fftSize; ++sample)
-        {
-            if (sample < overlapAddBuffer.getNumSamples())
-                outputBufferData[sample] += overlapData[sample];
-            else
-                DBG("Index out of range in output buffer loop at sample " << sample);
-        }
-    }
-
-    //===========================================================
-    // 11) 更新重叠写入索引
-    //===========================================================
-    overlapWriteIndex = (overlapWriteIndex + fftSize) % (2 * fftSize);
-}
-
-
-
-
 //==============================================================================
 bool ExchangeBandAudioProcessor::hasEditor() const
 {
@@ -10,11 +10,14 @@
 
 #include <JuceHeader.h>
 #include <juce_audio_processors/juce_audio_processors.h>
-#include <mutex>
+#include "Engine/CrossoverEngine.h"
+#include "Engine/EngineSwitcher.h"
+#include "Engine/ExchangeBandEngine.h"
 //==============================================================================
 /**
 */
-class ExchangeBandAudioProcessor  : public juce::AudioProcessor
+class ExchangeBandAudioProcessor  : public juce::AudioProcessor,
+                                    private juce::Timer
 {
 public:
     //==============================================================================
@@ -30,6 +33,8 @@ public:
    #endif
 
     void processBlock (juce::AudioBuffer<float>&, juce::MidiBuffer&) override;
+    void processBlock (juce::AudioBuffer<double>&, juce::MidiBuffer&) override;
+    bool supportsDoublePrecisionProcessing() const override { return true; }
 
     //==============================================================================
     juce::AudioProcessorEditor* createEditor() override;
@@ -56,87 +61,60 @@ public:
 
     //==============================================================================
     
-    juce::CriticalSection bufferLock;  // 用于保护缓冲区的线程安全
-    bool isSidechainInputActive() const;//检查side chain是否激活
-    
-    // 用于存储窗函数数据
-    std::vector<float> windowingTable;
-std::unique_ptr<juce::dsp::WindowingFunction<float>> windowFunction;
-    
-    //FFT相关数据
-    static constexpr int fftOrder = 11; // FFT的阶数，2^11 = 2048点FFT
-    static constexpr int fftSize = 1 << fftOrder;
-    double sampleRate = 0.0;  // 用于存储采样率
-    juce::dsp::FFT fft;
-    void processFFTBlock();
-
-    // 准备进行处理的数据缓冲区
-    std::vector<float> mainchainFFTData;
-    std::vector<float> sidechainFFTData;
-    
-    // 储存fft后幅度和相位信息
-    std::vector<float> mainMagnitude;
-    std::vector<float> mainPhase;
+    bool isSidechainInputActive() const;//检查side chain总线是否启用且有通道
 
-    std::vector<float> sidechainMagnitude;
-    std::vector<float> sidechainPhase;
-    
-    // 混合后的 FFT 结果-band1
-    std::vector<float> mixedMagnitude1;
-    std::vector<float> mixedPhase1;
-
-    // 混合后的 FFT 结果-band2
-    std::vector<float> mixedMagnitude2;
-    std::vector<float> mixedPhase2;
-    // 用于IFFT的buffer
-    std::vector<float> outMagnitude;
-    std::vector<float> outPhase;
-    // 用于存储逆 FFT 的数据
-    std::vector<float> outputFFTData;
-    //std::vector<float> outputMagnitude;
-    std::vector<float> fftFrequency; // 频率向量
     // 公共成员以访问ValueTreeState
     juce::AudioProcessorValueTreeState parameters;
-    
-    std::vector<float> mainRingBuffer;  // 主链环形缓冲区
-    std::vector<float> sidechainRingBuffer;  // 侧链环形缓冲区
-    // 封装的环形缓冲区读取函数
-    float readMainRingBuffer(int i) const;
-    float readSidechainRingBuffer(int i) const;
+
+    // 频段交换 DSP 引擎（FFT / 交叉合成 / IFFT 以及环形缓冲区、overlap-add 状态都在里面）。
+    // 编辑器等其他线程只能通过引擎的 wait-free 接口读数据（见 ExchangeBandEngine.h 的线程模型）
+    ExchangeBandEngine& getEngine() noexcept { return engine; }
+
+    // "engine" 参数选中零延迟的 IIR 分频引擎时为 true，任意线程都可以调用。
+    // 此时频谱显示和耗时统计不再更新（它们来自 STFT 引擎）
+    bool isUsingCrossoverEngine() const noexcept { return engineChoice->load() >= 0.5f; }
+
+    // 当前的参数快照（频段表 + STFT 几何），任意线程都可以调用
+    ExchangeBandParameters getCurrentParameters() const noexcept { return parameterPointers.load(); }
+
+    // 各处理阶段（环形缓冲区 / FFT / 交叉合成 / IFFT / overlap-add / 整个 block）的耗时统计和超时次数，
+    // 以及所用的 FFT 后端（与 getFftBackend() 相同）。不要与 prepareToPlay 同时调用；
+    // 编译时 EXCHANGEBAND_STAGE_TIMING=0 时计数全为 0
+    StageTimings::Snapshot getStageTimings() const noexcept;
+    void resetStageTimings() noexcept { engine.getStageTimings().requestReset(); }
+
+    // 当前 FFT 点数所用的 FFT 后端（prepareToPlay 时选定），只在 message 线程上调用
+    RealFft::Backend getFftBackend() const noexcept { return engine.getFftBackend(getCurrentParameters().stft.withLegalValues().fftOrder); }
+    bool isFftBackendForced() const noexcept { return engine.isFftBackendForced(); }
 
 private:
     //==============================================================================
-    //管理音频格式
-    juce::AudioFormatManager formatManager;
-    // overlap-add buffer
-    juce::AudioBuffer<float> overlapAddBuffer;
-    int overlapWriteIndex = 0;
-    // 保护 FFT 数据的互斥锁
-    juce::CriticalSection fftDataLock;
-    // 频率向量
-    std::vector<float> mainchainFrequency;
-    std::vector<float> sidechainFrequency;
-    std::vector<float> mixedFrequency;
-    
+    ExchangeBandEngine engine;
+    CrossoverEngine crossover;
+    ExchangeBandParameterPointers parameterPointers;
+
+    // 处理引擎的选择（0 = STFT，1 = 零延迟 IIR）。参数改变时两个引擎并行处理一小段时间，
+    // 按 STFT 的延迟对齐后交叉淡化过去（见 EngineSwitcher.h）
+    std::atomic<float>* engineChoice = nullptr;
+    EngineSwitcher engineSwitcher { engine, crossover };
+
+    // 延迟 / 尾音随 STFT 几何和引擎选择变化。参数改变之后引擎还要预热、淡化一段时间，
+    // 所以报告的不是参数里的目标，而是音频线程每个 block 发布的、输出实际的延迟：
+    // 引擎在哪个 block 里跳到新的延迟，message 线程的 timer 就在下一次回调时报告给宿主。
+    // outputLatencySamples 为 -1 表示还没有 prepareToPlay，按参数报告
+    std::atomic<int> outputLatencySamples { -1 };
+    std::atomic<int> outputTailSamples { 0 };
+    std::atomic<double> tailLengthSeconds { 0.0 };
+    void publishLatencyAndTail() noexcept;
+    void timerCallback() override;
+    void updateLatencyAndTail();
+
     juce::AudioProcessorValueTreeState::ParameterLayout createParameterLayout();
 
-//    // FFT 相关成员变量
-//    int fftOrder = 11;               // FFT 的阶数（log2大小）
-//    int fftSize = 2048;                // FFT 大小（2的幂次方）
-    int hopSize = fftSize / 2; // 50% 重叠
-    float sampleRateOverFftSize;
-    // 辅助方法
-    void performFFT(float* inputData, std::vector<float>& magnitude, std::vector<float>& phase, bool isMainchain);
-    void crossSynthesis();
-    void performIFFT(juce::AudioBuffer<float>& buffer);
-    int mainRingBufferWriteIdx = 0;     // 主链环形缓冲区写入指针
-    int sidechainRingBufferWriteIdx = 0; // 侧链环形缓冲区写入指针
-    int ringBufferReadIdx = 0;          // 读取指针
-    const int bufferSize = 512;         // 每次处理的缓冲区大小
-    int mainSampleCount = 0;
-    int sidechainSampleCount = 0;
-    std::mutex vectorMutex;
-    void adjustSidechainToStereo(juce::AudioBuffer<float>& buffer, int mainNumChannels);
+    // float / double 两个 processBlock 共用的实现
+    template <typename SampleType>
+    void processSamples(juce::AudioBuffer<SampleType>& buffer);
+
     juce::NormalisableRange<float> createFrequencyRange();
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ExchangeBandAudioProcessor)
 };
@@ -0,0 +1,144 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyserComponent.cpp
+
+  ==============================================================================
+*/
+
+#include "SpectrumAnalyserComponent.h"
+
+//==============================================================================
+SpectrumAnalyserComponent::SpectrumAnalyserComponent()
+{
+    for (auto& source : levels)        source.fill (minDecibels);
+    for (auto& source : paintedLevels) source.fill (minDecibels);
+
+    // 曲线下面没有别的组件，不透明可以省掉父组件的重绘
+    setOpaque (true);
+}
+
+void SpectrumAnalyserComponent::pushFrame (const SpectrumAnalyser::Frame& frame)
+{
+    int firstChanged = SpectrumAnalyser::numPoints, lastChanged = -1;
+
+    for (int source = 0; source < SpectrumAnalyser::numSources; ++source)
+    {
+        for (int point = 0; point < SpectrumAnalyser::numPoints; ++point)
+        {
+            const auto power = frame.power[(size_t) source][(size_t) point];
+            const auto target = power > 0.0f ? juce::jlimit (minDecibels, maxDecibels, 10.0f * std::log10 (power)) : minDecibels;
+
+            auto& level = levels[(size_t) source][(size_t) point];
+            level = juce::jmax (target, level - releaseDecibelsPerFrame);
+
+            if (std::abs (level - paintedLevels[(size_t) source][(size_t) point]) > repaintThresholdDecibels)
+            {
+                firstChanged = juce::jmin (firstChanged, point);
+                lastChanged = point;
+            }
+        }
+    }
+
+    // 只重绘变化了的横向范围，两边各多一个点，连到相邻线段
+    if (lastChanged >= 0)
+    {
+        const auto left  = (int) std::floor (getXForPoint ((float) firstChanged - 1.0f)) - 1;
+        const auto right = (int) std::ceil (getXForPoint ((float) lastChanged + 1.0f)) + 1;
+        repaint (left, 0, right - left, getHeight());
+    }
+}
+
+void SpectrumAnalyserComponent::setBands (const ExchangeBandParameters& newParameters, double newSampleRate)
+{
+    if (bands.hasSameBands (newParameters) && sampleRate == newSampleRate)
+        return;
+
+    bands = newParameters;
+    sampleRate = newSampleRate;
+    repaint();
+}
+
+//==============================================================================
+float SpectrumAnalyserComponent::getXForPoint (float point) const noexcept
+{
+    return (float) getWidth() * point / (float) (SpectrumAnalyser::numPoints - 1);
+}
+
+float SpectrumAnalyserComponent::getXForFrequency (double frequency) const noexcept
+{
+    const auto point = std::log (frequency / SpectrumAnalyser::minFrequency)
+                     / std::log (SpectrumAnalyser::maxFrequency / SpectrumAnalyser::minFrequency);
+    return getXForPoint ((float) point * (float) (SpectrumAnalyser::numPoints - 1));
+}
+
+float SpectrumAnalyserComponent::getYForDecibels (float decibels) const noexcept
+{
+    return juce::jmap (decibels, minDecibels, maxDecibels, (float) getHeight(), 0.0f);
+}
+
+void SpectrumAnalyserComponent::paint (juce::Graphics& g)
+{
+    const auto clip = g.getClipBounds();
+    const auto height = (float) getHeight();
+
+    g.fillAll (juce::Colour (0xff1e1e24));
+
+    // 频段：交换的频段用橙色，只做混合的用蓝色，越往侧链混合越不透明
+    for (int i = 0; i < bands.numBands; ++i)
+    {
+        const auto& band = bands.bands[(size_t) i];
+        const auto range = band.getFrequencyRange (sampleRate);
+        const auto left = getXForFrequency (juce::jmax (SpectrumAnalyser::minFrequency, range.getStart()));
+        const auto right = getXForFrequency (juce::jmax (SpectrumAnalyser::minFrequency, range.getEnd()));
+
+        if (right <= (float) clip.getX() || left >= (float) clip.getRight())
+            continue;
+
+        const auto colour = band.partner >= 0 ? juce::Colours::orange : juce::Colours::deepskyblue;
+        g.setColour (colour.withAlpha (0.12f + 0.2f * juce::jlimit (0.0f, 1.0f, band.mix)));
+        g.fillRect (juce::Rectangle<float> (left, 0.0f, juce::jmax (1.0f, right - left), height));
+
+        g.setColour (colour);
+        g.drawText (juce::String (i + 1), juce::Rectangle<float> (left, 2.0f, juce::jmax (12.0f, right - left), 14.0f),
+                    juce::Justification::centredTop);
+    }
+
+    // 网格：每十倍频程一条竖线，每 24 dB 一条横线
+    g.setColour (juce::Colours::white.withAlpha (0.12f));
+
+    for (auto frequency : { 100.0, 1000.0, 10000.0 })
+        g.drawVerticalLine (juce::roundToInt (getXForFrequency (frequency)), 0.0f, height);
+
+    for (auto decibels = 0.0f; decibels > minDecibels; decibels -= 24.0f)
+        g.drawHorizontalLine (juce::roundToInt (getYForDecibels (decibels)), 0.0f, (float) getWidth());
+
+    // 曲线只画裁剪范围内的点（两边各多一个，保证线段连续）
+    const auto firstPoint = juce::jlimit (0, SpectrumAnalyser::numPoints - 1,
+                                          (int) std::floor ((float) clip.getX() * (float) (SpectrumAnalyser::numPoints - 1) / (float) juce::jmax (1, getWidth())) - 1);
+    const auto lastPoint  = juce::jlimit (0, SpectrumAnalyser::numPoints - 1,
+                                          (int) std::ceil ((float) clip.getRight() * (float) (SpectrumAnalyser::numPoints - 1) / (float) juce::jmax (1, getWidth())) + 1);
+
+    const std::array<juce::Colour, SpectrumAnalyser::numSources> colours
+    {
+        juce::Colours::white.withAlpha (0.6f),     // 主链
+        juce::Colours::lightgreen.withAlpha (0.6f),  // 侧链
+        juce::Colours::yellow                      // 输出
+    };
+
+    for (int source = 0; source < SpectrumAnalyser::numSources; ++source)
+    {
+        const auto& sourceLevels = levels[(size_t) source];
+        juce::Path curve;
+        curve.startNewSubPath (getXForPoint ((float) firstPoint), getYForDecibels (sourceLevels[(size_t) firstPoint]));
+
+        for (int point = firstPoint + 1; point <= lastPoint; ++point)
+            curve.lineTo (getXForPoint ((float) point), getYForDecibels (sourceLevels[(size_t) point]));
+
+        g.setColour (colours[(size_t) source]);
+        g.strokePath (curve, juce::PathStrokeType (source == SpectrumAnalyser::output ? 1.5f : 1.0f));
+
+        for (int point = firstPoint; point <= lastPoint; ++point)
+            paintedLevels[(size_t) source][(size_t) point] = sourceLevels[(size_t) point];
+    }
+}
@@ -0,0 +1,47 @@
+/*
+  ==============================================================================
+
+    SpectrumAnalyserComponent.h
+    编辑器里的实时频谱：主链、侧链、输出三条曲线，叠加频段表的覆盖范围。
+    数据由编辑器的 timer 从 SpectrumAnalyser 的无锁 FIFO 取出后交给这里，
+    只重绘曲线真正变化了的那一段横向范围。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <JuceHeader.h>
+#include "Engine/ExchangeBandEngine.h"
+
+//==============================================================================
+class SpectrumAnalyserComponent  : public juce::Component
+{
+public:
+    SpectrumAnalyserComponent();
+
+    // 只在 message 线程上调用
+    void pushFrame (const SpectrumAnalyser::Frame& frame);
+    void setBands (const ExchangeBandParameters& newParameters, double newSampleRate);
+
+    void paint (juce::Graphics&) override;
+
+private:
+    static constexpr float minDecibels = -96.0f;
+    static constexpr float maxDecibels = 6.0f;
+    static constexpr float releaseDecibelsPerFrame = 1.5f;  // 下降时每帧最多回落这么多，上升立即跟随
+    static constexpr float repaintThresholdDecibels = 0.25f;
+
+    float getXForPoint (float point) const noexcept;
+    float getXForFrequency (double frequency) const noexcept;
+    float getYForDecibels (float decibels) const noexcept;
+
+    // 当前显示的电平（dB），以及上次重绘时的电平，用于计算需要重绘的范围
+    std::array<std::array<float, SpectrumAnalyser::numPoints>, SpectrumAnalyser::numSources> levels;
+    std::array<std::array<float, SpectrumAnalyser::numPoints>, SpectrumAnalyser::numSources> paintedLevels;
+
+    ExchangeBandParameters bands;
+    double sampleRate = 44100.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (SpectrumAnalyserComponent)
+};
@@ -0,0 +1,206 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    ExchangeBandBenchmark：用白噪声驱动引擎，比较单精度 / 双精度两条路径的吞吐量。
+
+      ExchangeBandBenchmark [--seconds n] [--block n] [--channels n] [--threads n] [--rate hz] [--polar] [--idle] [--fft backend] [--full-inverse]
+
+    每种 FFT 点数各测一次，输出每秒音频的处理耗时、相对实时的倍数和所用的 FFT 后端。
+    --fft 强制所有点数使用同一个 FFT 后端，用来和自动选择的结果对比。
+    --full-inverse 关闭稀疏修正合成，每帧都对整个频谱做 IFFT（SynthesisMode::fullInverse）。
+    --idle 时侧链为静音，测的是 STFT 暂停后空闲实例的开销（延迟线和侧链 RMS）。
+    两种精度共用同一份模板代码，这里的差别只来自时域缓冲区和窗表的数据宽度。
+
+  ==============================================================================
+*/
+
+#include "ExchangeBandEngine.h"
+#include <iostream>
+
+namespace
+{
+    struct BenchmarkOptions
+    {
+        double seconds = 10.0;
+        double sampleRate = 48000.0;
+        int blockSize = 512;
+        int numChannels = 2;
+        int maxWorkerThreads = ChannelWorkerPool::maxWorkers;
+        bool silentSidechain = false;
+        bool forceFftBackend = false;
+        RealFft::Backend fftBackend = RealFft::Backend::juce;
+        ExchangeBandEngine::CrossSynthesisMode crossSynthesisMode = ExchangeBandEngine::CrossSynthesisMode::rectangular;
+        ExchangeBandEngine::SynthesisMode synthesisMode = ExchangeBandEngine::SynthesisMode::sparseCorrection;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: ExchangeBandBenchmark [options]\n"
+                     "\n"
+                     "Options:\n"
+                     "  --seconds <n>     length of audio processed per measurement (default: 10)\n"
+                     "  --block <n>       samples per process() call (default: 512)\n"
+                     "  --channels <n>    main and sidechain channel count (default: 2, at most 31)\n"
+                     "  --threads <n>     maximum worker threads for multichannel processing (default: automatic, 0 = none)\n"
+                     "  --rate <hz>       sample rate (default: 48000)\n"
+                     "  --polar           cross-synthesise magnitude/phase instead of real/imaginary\n"
+                     "  --idle            silent sidechain: measure an idle instance with the STFT paused\n"
+                     "  --fft <backend>   force an FFT backend: juce or stockham (default: fastest per FFT size)\n"
+                     "  --full-inverse    inverse-transform the whole spectrum every frame instead of only the changed bins\n";
+    }
+
+    template <typename SampleType>
+    void fillWithNoise (juce::AudioBuffer<SampleType>& buffer, juce::Random& random)
+    {
+        for (int channel = 0; channel < buffer.getNumChannels(); ++channel)
+        {
+            auto* data = buffer.getWritePointer (channel);
+
+            for (int i = 0; i < buffer.getNumSamples(); ++i)
+                data[i] = (SampleType) (random.nextFloat() * 0.5f - 0.25f);
+        }
+    }
+
+    // 返回处理 options.seconds 秒音频所用的时间（秒）。噪声预先生成，不计入耗时
+    template <typename SampleType>
+    double measure (const BenchmarkOptions& options, int fftOrder)
+    {
+        constexpr auto precision = std::is_same_v<SampleType, double> ? ExchangeBandEngine::ProcessingPrecision::doublePrecision
+                                                                      : ExchangeBandEngine::ProcessingPrecision::singlePrecision;
+
+        ExchangeBandParameters parameters;
+        parameters.stft.fftOrder = fftOrder;
+
+        ExchangeBandEngine engine;
+        engine.setCrossSynthesisMode (options.crossSynthesisMode);
+        engine.setSynthesisMode (options.synthesisMode);
+        engine.setMaxWorkerThreads (options.maxWorkerThreads);
+
+        if (options.forceFftBackend)
+            engine.forceFftBackend (options.fftBackend);
+
+        engine.setParameters (parameters);
+        engine.prepare (options.sampleRate, options.blockSize, options.numChannels, options.numChannels, precision);
+
+        const int numSamples = juce::roundToInt (options.seconds * options.sampleRate);
+        const int numBlocks = juce::jmax (1, numSamples / options.blockSize);
+
+        // 循环使用一小段噪声，避免生成噪声本身影响结果
+        constexpr int numSourceBlocks = 64;
+        juce::Random random (0x45b);
+        juce::AudioBuffer<SampleType> mainSource (options.numChannels, options.blockSize * numSourceBlocks);
+        juce::AudioBuffer<SampleType> sidechainSource (options.numChannels, options.blockSize * numSourceBlocks);
+        fillWithNoise (mainSource, random);
+        fillWithNoise (sidechainSource, random);
+
+        if (options.silentSidechain)
+            sidechainSource.clear();
+
+        juce::AudioBuffer<SampleType> mainBuffer (options.numChannels, options.blockSize);
+        juce::AudioBuffer<SampleType> sidechainBuffer (options.numChannels, options.blockSize);
+
+        // 静音侧链要先等过保持时间和淡化，STFT 暂停之后再开始计时
+        if (options.silentSidechain)
+        {
+            mainBuffer.clear();
+            sidechainBuffer.clear();
+
+            while (! engine.isIdle())
+                engine.process (mainBuffer, sidechainBuffer);
+        }
+
+        const auto startTicks = juce::Time::getHighResolutionTicks();
+
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            const int sourceStart = (block % numSourceBlocks) * options.blockSize;
+
+            for (int channel = 0; channel < options.numChannels; ++channel)
+            {
+                mainBuffer.copyFrom (channel, 0, mainSource, channel, sourceStart, options.blockSize);
+                sidechainBuffer.copyFrom (channel, 0, sidechainSource, channel, sourceStart, options.blockSize);
+            }
+
+            engine.process (mainBuffer, sidechainBuffer);
+        }
+
+        return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks)
+                 * numSamples / ((double) numBlocks * options.blockSize);
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    BenchmarkOptions options;
+
+    if (args.containsOption ("--seconds"))   options.seconds = args.removeValueForOption ("--seconds").getDoubleValue();
+    if (args.containsOption ("--block"))     options.blockSize = args.removeValueForOption ("--block").getIntValue();
+    if (args.containsOption ("--channels"))  options.numChannels = args.removeValueForOption ("--channels").getIntValue();
+    if (args.containsOption ("--threads"))   options.maxWorkerThreads = args.removeValueForOption ("--threads").getIntValue();
+    if (args.containsOption ("--rate"))      options.sampleRate = args.removeValueForOption ("--rate").getDoubleValue();
+
+    if (args.removeOptionIfFound ("--polar"))
+        options.crossSynthesisMode = ExchangeBandEngine::CrossSynthesisMode::polar;
+
+    options.silentSidechain = args.removeOptionIfFound ("--idle");
+
+    if (args.removeOptionIfFound ("--full-inverse"))
+        options.synthesisMode = ExchangeBandEngine::SynthesisMode::fullInverse;
+
+    if (args.containsOption ("--fft"))
+    {
+        options.forceFftBackend = true;
+
+        if (! RealFft::parseBackendName (args.removeValueForOption ("--fft"), options.fftBackend))
+        {
+            printUsage();
+            return 2;
+        }
+    }
+
+    if (args.size() != 0 || options.seconds <= 0.0 || options.blockSize <= 0
+         || options.numChannels <= 0 || options.numChannels > ExchangeBandEngine::maxChannels
+         || options.maxWorkerThreads < 0 || options.sampleRate <= 0.0)
+    {
+        printUsage();
+        return 2;
+    }
+
+    std::cout << "ExchangeBandBenchmark: " << options.numChannels << " ch, " << options.sampleRate << " Hz, "
+              << options.blockSize << "-sample blocks, " << options.seconds << " s per run"
+              << (options.silentSidechain ? ", silent sidechain" : "")
+              << (options.synthesisMode == ExchangeBandEngine::SynthesisMode::fullInverse ? ", full inverse" : ", sparse correction") << "\n"
+              << "kernels: " << SpectralKernels::getInstructionSetName (SpectralKernels::getBestTable (SpectralKernels::Accuracy::exact).instructionSet)
+              << "\n\n"
+              << "  FFT     float ms/s   x realtime   double ms/s   x realtime   double/float   FFT backend\n";
+
+    for (int order = StftSettings::minOrder; order <= StftSettings::maxOrder; ++order)
+    {
+        const auto singleSeconds = measure<float> (options, order);
+        const auto doubleSeconds = measure<double> (options, order);
+
+        // 每秒音频的处理耗时（毫秒）
+        const auto singleCost = singleSeconds * 1000.0 / options.seconds;
+        const auto doubleCost = doubleSeconds * 1000.0 / options.seconds;
+
+        std::cout << juce::String (1 << order).paddedLeft (' ', 5)
+                  << juce::String (singleCost, 2).paddedLeft (' ', 15)
+                  << juce::String (options.seconds / singleSeconds, 1).paddedLeft (' ', 13)
+                  << juce::String (doubleCost, 2).paddedLeft (' ', 14)
+                  << juce::String (options.seconds / doubleSeconds, 1).paddedLeft (' ', 13)
+                  << juce::String (doubleSeconds / singleSeconds, 2).paddedLeft (' ', 15)
+                  << "   " << RealFft::getBackendName (options.forceFftBackend ? options.fftBackend : RealFft::getFastestBackend (order)) << "\n";
+    }
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    ExchangeBandRender：不经过 DAW，批量渲染主链 + 侧链文件对。
+
+      ExchangeBandRender --preset preset.xml [options] main.wav sidechain.wav output.wav [...]
+      ExchangeBandRender --preset preset.xml [options] --list pairs.txt
+
+    pairs.txt 每行一对：主链、侧链、输出三个路径，用 Tab 分隔，# 开头为注释。
+    多对文件按 CPU 核数并行，每个工作线程持有一个 OfflineRenderer，依次领取下一对。
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include <iostream>
+
+namespace
+{
+    struct RenderPair
+    {
+        juce::File main, sidechain, output;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: ExchangeBandRender --preset <file.xml> [options] <main> <sidechain> <output> [...]\n"
+                     "       ExchangeBandRender --preset <file.xml> [options] --list <pairs.txt>\n"
+                     "\n"
+                     "Options:\n"
+                     "  --preset <file>   plugin state XML (<Parameters><PARAM id=.. value=../></Parameters>)\n"
+                     "  --list <file>     one pair per line: main<TAB>sidechain<TAB>output\n"
+                     "  --jobs <n>        number of pairs rendered at once (default: number of CPU cores)\n"
+                     "  --block <n>       samples per read/process/write block (default: 65536)\n"
+                     "  --bits <n>        output bit depth (default: 24)\n"
+                     "  --tail            keep the engine's tail after the end of the main file\n"
+                     "  --no-mmap         stream WAV/AIFF inputs instead of memory-mapping them\n"
+                     "  --polar           cross-synthesise magnitude/phase instead of real/imaginary\n";
+    }
+
+    juce::Result readPairList (const juce::File& listFile, juce::Array<RenderPair>& pairs)
+    {
+        if (! listFile.existsAsFile())
+            return juce::Result::fail ("Cannot find " + listFile.getFullPathName());
+
+        juce::StringArray lines;
+        listFile.readLines (lines);
+
+        for (int i = 0; i < lines.size(); ++i)
+        {
+            const auto line = lines[i].trim();
+
+            if (line.isEmpty() || line.startsWithChar ('#'))
+                continue;
+
+            const auto fields = juce::StringArray::fromTokens (line, "\t", "\"");
+
+            if (fields.size() != 3)
+                return juce::Result::fail (listFile.getFileName() + ":" + juce::String (i + 1) + ": expected main<TAB>sidechain<TAB>output");
+
+            const auto directory = listFile.getParentDirectory();
+            pairs.add ({ directory.getChildFile (fields[0].unquoted()),
+                         directory.getChildFile (fields[1].unquoted()),
+                         directory.getChildFile (fields[2].unquoted()) });
+        }
+
+        return juce::Result::ok();
+    }
+
+    //==============================================================================
+    // 一个工作线程：持有自己的引擎，从共享的下标里依次领取文件对，直到领完
+    class RenderWorker  : public juce::ThreadPoolJob
+    {
+    public:
+        RenderWorker (const ExchangeBandParameters& parameters, const OfflineRenderOptions& options,
+                      const juce::Array<RenderPair>& pairsToRender, std::atomic<int>& nextPairIndex,
+                      std::atomic<int>& failureCount, juce::CriticalSection& outputLock)
+            : juce::ThreadPoolJob ("ExchangeBand render"),
+              renderer (parameters, options), pairs (pairsToRender), nextPair (nextPairIndex),
+              numFailed (failureCount), printLock (outputLock)
+        {
+        }
+
+        JobStatus runJob() override
+        {
+            for (int index = nextPair++; index < pairs.size() && ! shouldExit(); index = nextPair++)
+            {
+                const auto& pair = pairs.getReference (index);
+                const auto startTime = juce::Time::getMillisecondCounterHiRes();
+                const auto result = renderer.render (pair.main, pair.sidechain, pair.output);
+                const auto seconds = (juce::Time::getMillisecondCounterHiRes() - startTime) * 0.001;
+
+                if (result.failed())
+                    ++numFailed;
+
+                const juce::ScopedLock sl (printLock);
+
+                if (result.wasOk())
+                    std::cout << "[" << (index + 1) << "/" << pairs.size() << "] " << pair.output.getFullPathName()
+                              << " (" << juce::String (seconds, 2) << " s)" << std::endl;
+                else
+                    std::cerr << "[" << (index + 1) << "/" << pairs.size() << "] FAILED " << pair.output.getFullPathName()
+                              << ": " << result.getErrorMessage() << std::endl;
+            }
+
+            return jobHasFinished;
+        }
+
+    private:
+        OfflineRenderer renderer;
+        const juce::Array<RenderPair>& pairs;
+        std::atomic<int>& nextPair;
+        std::atomic<int>& numFailed;
+        juce::CriticalSection& printLock;
+    };
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.size() == 0 || args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return args.size() == 0 ? 2 : 0;
+    }
+
+    OfflineRenderOptions options;
+    int numJobs = juce::SystemStats::getNumCpus();
+
+    const auto presetPath = args.removeValueForOption ("--preset");
+    const auto listPath = args.removeValueForOption ("--list");
+
+    if (args.containsOption ("--jobs"))   numJobs = args.removeValueForOption ("--jobs").getIntValue();
+    if (args.containsOption ("--block"))  options.blockSize = args.removeValueForOption ("--block").getIntValue();
+    if (args.containsOption ("--bits"))   options.bitsPerSample = args.removeValueForOption ("--bits").getIntValue();
+
+    options.includeTail = args.removeOptionIfFound ("--tail");
+    options.useMemoryMapping = ! args.removeOptionIfFound ("--no-mmap");
+
+    if (args.removeOptionIfFound ("--polar"))
+        options.crossSynthesisMode = ExchangeBandEngine::CrossSynthesisMode::polar;
+
+    if (presetPath.isEmpty() || numJobs <= 0 || options.blockSize <= 0)
+    {
+        printUsage();
+        return 2;
+    }
+
+    ExchangeBandParameters parameters;
+
+    if (const auto result = OfflineRenderer::loadPreset (juce::File::getCurrentWorkingDirectory().getChildFile (presetPath), parameters, options);
+        result.failed())
+    {
+        std::cerr << result.getErrorMessage() << std::endl;
+        return 2;
+    }
+
+    // 余下的参数按 主链 / 侧链 / 输出 三个一组
+    juce::Array<RenderPair> pairs;
+
+    if (listPath.isNotEmpty())
+    {
+        if (const auto result = readPairList (juce::File::getCurrentWorkingDirectory().getChildFile (listPath), pairs); result.failed())
+        {
+            std::cerr << result.getErrorMessage() << std::endl;
+            return 2;
+        }
+    }
+
+    if (args.size() % 3 != 0)
+    {
+        printUsage();
+        return 2;
+    }
+
+    for (int i = 0; i < args.size(); i += 3)
+        pairs.add ({ args[i].resolveAsFile(), args[i + 1].resolveAsFile(), args[i + 2].resolveAsFile() });
+
+    if (pairs.isEmpty())
+    {
+        printUsage();
+        return 2;
+    }
+
+    //==============================================================================
+    numJobs = juce::jmin (numJobs, pairs.size());
+
+    // 文件之间已经并行时不再在文件内部按通道并行；只渲染一对文件时，多声道文件的通道分给其余的核
+    options.maxChannelThreads = numJobs > 1 ? 0 : juce::SystemStats::getNumCpus() - 1;
+
+    std::atomic<int> nextPair { 0 }, numFailed { 0 };
+    juce::CriticalSection printLock;
+    juce::OwnedArray<RenderWorker> workers;
+    juce::ThreadPool pool (juce::ThreadPoolOptions{}.withNumberOfThreads (numJobs));
+
+    for (int i = 0; i < numJobs; ++i)
+        pool.addJob (workers.add (new RenderWorker (parameters, options, pairs, nextPair, numFailed, printLock)), false);
+
+    for (auto* worker : workers)
+        pool.waitForJobToFinish (worker, -1);
+
+    std::cout << (pairs.size() - numFailed) << " of " << pairs.size() << " rendered" << std::endl;
+    return numFailed > 0 ? 1 : 0;
+}
@@ -0,0 +1,300 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.cpp
+
+  ==============================================================================
+*/
+
+#include "OfflineRenderer.h"
+#include <map>
+
+#if JUCE_LINUX || JUCE_BSD
+ #include <fcntl.h>
+ #include <unistd.h>
+#endif
+
+//==============================================================================
+// 一个输入文件。内存映射时只映射当前读取位置之后 mapWindowBlocks 个块的窗口，读到窗口外再整体往后滑，
+// 常驻内存与文件长度无关。每次滑动时让内核在后台预读下一个窗口，转换时就不会停在缺页上
+class OfflineRenderer::Input
+{
+public:
+    static constexpr int mapWindowBlocks = 16;
+
+    Input (const juce::File& fileToRead, std::unique_ptr<juce::AudioFormatReader> readerToUse,
+           juce::MemoryMappedAudioFormatReader* mappedReader)
+        : file (fileToRead), reader (std::move (readerToUse)), mapped (mappedReader)
+    {
+       #if JUCE_LINUX || JUCE_BSD
+        if (mapped != nullptr)
+            fileDescriptor = open (file.getFullPathName().toRawUTF8(), O_RDONLY | O_CLOEXEC);
+       #endif
+    }
+
+    ~Input()
+    {
+       #if JUCE_LINUX || JUCE_BSD
+        if (fileDescriptor >= 0)
+            close (fileDescriptor);
+       #endif
+    }
+
+    const juce::File& getFile() const noexcept             { return file; }
+    const juce::AudioFormatReader& getReader() const noexcept  { return *reader; }
+
+    // 读取 [startSample, startSample + numSamples) 到 destination 的开头，超出文件长度的部分填 0。
+    // 映射的文件由 reader 直接从映射的页面转换成 float，中间不经过流的缓冲区
+    bool read (juce::AudioBuffer<float>& destination, juce::int64 startSample, int numSamples)
+    {
+        const auto numInFile = (int) juce::jlimit ((juce::int64) 0, (juce::int64) numSamples, reader->lengthInSamples - startSample);
+
+        if (numInFile < numSamples)
+            destination.clear (numInFile, numSamples - numInFile);
+
+        if (numInFile == 0)
+            return true;
+
+        if (mapped != nullptr && ! mapped->getMappedSection().contains ({ startSample, startSample + numInFile })
+             && ! mapWindow (startSample, numSamples))
+            return false;
+
+        reader->read (&destination, 0, numInFile, startSample, true, true);
+        return true;
+    }
+
+private:
+    bool mapWindow (juce::int64 startSample, int blockSize)
+    {
+        const auto windowLength = (juce::int64) blockSize * mapWindowBlocks;
+        const auto end = juce::jmin (reader->lengthInSamples, startSample + windowLength);
+
+        if (! mapped->mapSectionOfFile ({ startSample, end }))
+            return false;
+
+        adviseReadahead (end, windowLength);
+        return true;
+    }
+
+    void adviseReadahead (juce::int64 startSample, juce::int64 numSamples) const noexcept
+    {
+       #if JUCE_LINUX || JUCE_BSD
+        if (fileDescriptor < 0 || startSample >= reader->lengthInSamples)
+            return;
+
+        // 数据块在文件里的偏移由 reader 内部解析，这里按文件长度等比例估算，并多预读一个窗口的余量。
+        // 只是提示，偏差不影响正确性
+        const auto fileSize = file.getSize();
+        const auto bytesPerSample = (double) fileSize / (double) reader->lengthInSamples;
+        posix_fadvise (fileDescriptor, (off_t) ((double) startSample * bytesPerSample),
+                       (off_t) ((double) (2 * numSamples) * bytesPerSample), POSIX_FADV_WILLNEED);
+       #else
+        juce::ignoreUnused (startSample, numSamples);
+       #endif
+    }
+
+    juce::File file;
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    juce::MemoryMappedAudioFormatReader* mapped = nullptr;  // 与 reader 是同一个对象，不能映射时为空
+
+   #if JUCE_LINUX || JUCE_BSD
+    int fileDescriptor = -1;  // 只用于预读提示
+   #endif
+
+    JUCE_DECLARE_NON_COPYABLE (Input)
+};
+
+//==============================================================================
+OfflineRenderer::OfflineRenderer (const ExchangeBandParameters& parametersToUse, const OfflineRenderOptions& optionsToUse)
+    : parameters (parametersToUse), options (optionsToUse)
+{
+    jassert (options.blockSize > 0);
+    formatManager.registerBasicFormats();
+    engine.setCrossSynthesisMode (options.crossSynthesisMode);
+    engine.setMaxWorkerThreads (options.maxChannelThreads);
+}
+
+std::unique_ptr<OfflineRenderer::Input> OfflineRenderer::openInput (const juce::File& file)
+{
+    // 能内存映射的格式（WAV / AIFF）优先映射，其他格式或映射失败时退回流式读取
+    if (options.useMemoryMapping)
+        for (auto* format : formatManager)
+            if (format->canHandleFile (file))
+                if (auto* mapped = format->createMemoryMappedReader (file))
+                    return std::make_unique<Input> (file, std::unique_ptr<juce::AudioFormatReader> (mapped), mapped);
+
+    if (auto* reader = formatManager.createReaderFor (file))
+        return std::make_unique<Input> (file, std::unique_ptr<juce::AudioFormatReader> (reader), nullptr);
+
+    return nullptr;
+}
+
+juce::Result OfflineRenderer::render (const juce::File& mainFile, const juce::File& sidechainFile, const juce::File& outputFile)
+{
+    auto mainInput = openInput (mainFile);
+    if (mainInput == nullptr)
+        return juce::Result::fail ("Cannot read " + mainFile.getFullPathName());
+
+    auto sidechainInput = openInput (sidechainFile);
+    if (sidechainInput == nullptr)
+        return juce::Result::fail ("Cannot read " + sidechainFile.getFullPathName());
+
+    const auto& mainReader = mainInput->getReader();
+    const auto& sidechainReader = sidechainInput->getReader();
+
+    if (sidechainReader.sampleRate != mainReader.sampleRate)
+        return juce::Result::fail ("Sample rates differ: " + juce::String (mainReader.sampleRate) + " Hz (main) vs "
+                                   + juce::String (sidechainReader.sampleRate) + " Hz (sidechain)");
+
+    auto* format = formatManager.findFormatForFileExtension (outputFile.getFileExtension());
+    if (format == nullptr)
+        return juce::Result::fail ("Unsupported output format: " + outputFile.getFileName());
+
+    if (! format->getPossibleBitDepths().contains (options.bitsPerSample))
+        return juce::Result::fail (format->getFormatName() + " cannot write " + juce::String (options.bitsPerSample) + "-bit files");
+
+    // 先写临时文件，渲染失败或中断时不会留下半个输出
+    juce::TemporaryFile temporaryFile (outputFile);
+    std::unique_ptr<juce::OutputStream> stream (temporaryFile.getFile().createOutputStream ((size_t) 1 << 20));
+    if (stream == nullptr)
+        return juce::Result::fail ("Cannot write " + outputFile.getFullPathName());
+
+    std::unique_ptr<juce::AudioFormatWriter> writer (format->createWriterFor (stream.get(), mainReader.sampleRate,
+                                                                              mainReader.numChannels, options.bitsPerSample,
+                                                                              {}, 0));
+    if (writer == nullptr)
+        return juce::Result::fail ("Cannot create a " + format->getFormatName() + " writer for " + outputFile.getFullPathName());
+
+    stream.release(); // 已经归 writer 所有
+
+    const auto result = render (*mainInput, *sidechainInput, *writer);
+    writer.reset();   // 写完文件头
+
+    if (result.failed())
+        return result;
+
+    if (! temporaryFile.overwriteTargetFileWithTemporary())
+        return juce::Result::fail ("Cannot replace " + outputFile.getFullPathName());
+
+    return juce::Result::ok();
+}
+
+juce::Result OfflineRenderer::render (Input& mainInput, Input& sidechainInput, juce::AudioFormatWriter& writer)
+{
+    const auto& mainReader = mainInput.getReader();
+    const int numChannels = (int) mainReader.numChannels;
+
+    if (numChannels > ExchangeBandEngine::maxChannels)
+        return juce::Result::fail ("At most " + juce::String (ExchangeBandEngine::maxChannels) + " channels are supported, the main input has "
+                                   + juce::String (numChannels));
+
+    // 引擎只接受与主链相同或单声道的侧链，其他通道数按单声道读取
+    const int numSidechainChannels = (int) sidechainInput.getReader().numChannels == numChannels ? numChannels : 1;
+
+    mainBuffer.setSize (numChannels, options.blockSize, false, false, true);
+    sidechainBuffer.setSize (numSidechainChannels, options.blockSize, false, false, true);
+
+    // 只准备用到的那个引擎
+    const bool useCrossover = options.useCrossoverEngine;
+
+    if (useCrossover)
+    {
+        crossover.setParameters (parameters);
+        crossover.prepare (mainReader.sampleRate, options.blockSize, numChannels, numSidechainChannels);
+    }
+    else
+    {
+        engine.setParameters (parameters);
+        engine.prepare (mainReader.sampleRate, options.blockSize, numChannels, numSidechainChannels);
+    }
+
+    // 输出比输入晚 latency 个样本：开头丢掉这么多，结尾用静音把它推出来（零延迟引擎两者都是 0，只有尾音）
+    const auto latency = (juce::int64) (useCrossover ? crossover.getLatencySamples() : engine.getLatencySamples());
+    const auto tail = (juce::int64) (useCrossover ? crossover.getTailSamples() : engine.getTailSamples());
+    const auto outputLength = mainReader.lengthInSamples + (options.includeTail ? tail - latency : 0);
+
+    juce::int64 readPosition = 0, numWritten = 0, numToSkip = latency;
+
+    while (numWritten < outputLength)
+    {
+        const int numSamples = options.blockSize;
+
+        // 超出文件长度的部分填 0
+        if (! mainInput.read (mainBuffer, readPosition, numSamples))
+            return juce::Result::fail ("Cannot map " + mainInput.getFile().getFullPathName());
+
+        if (! sidechainInput.read (sidechainBuffer, readPosition, numSamples))
+            return juce::Result::fail ("Cannot map " + sidechainInput.getFile().getFullPathName());
+
+        readPosition += numSamples;
+
+        if (useCrossover)
+            crossover.process (mainBuffer, sidechainBuffer);
+        else
+            engine.process (mainBuffer, sidechainBuffer);
+
+        const auto numSkipped = (int) juce::jmin (numToSkip, (juce::int64) numSamples);
+        const auto numToWrite = (int) juce::jmin ((juce::int64) (numSamples - numSkipped), outputLength - numWritten);
+        numToSkip -= numSkipped;
+
+        if (numToWrite > 0 && ! writer.writeFromAudioSampleBuffer (mainBuffer, numSkipped, numToWrite))
+            return juce::Result::fail ("Write error");
+
+        numWritten += numToWrite;
+    }
+
+    return juce::Result::ok();
+}
+
+//==============================================================================
+juce::Result OfflineRenderer::loadPreset (const juce::File& presetFile, ExchangeBandParameters& destination, OfflineRenderOptions& options)
+{
+    const auto xml = juce::parseXML (presetFile);
+    if (xml == nullptr)
+        return juce::Result::fail ("Cannot parse " + presetFile.getFullPathName());
+
+    // 与 ExchangeBandAudioProcessor::createParameterLayout() 的 ID 和默认值一致（均为未归一化的原始值），
+    // 再走插件同样的 ExchangeBandParameterPointers::load()，两边的换算规则不会分叉
+    std::map<juce::String, std::atomic<float>> values;
+
+    const auto add = [&] (const juce::String& id, float defaultValue)
+    {
+        auto& value = values[id];
+        value = defaultValue;
+
+        if (auto* element = xml->getChildByAttribute ("id", id))
+            value = (float) element->getDoubleAttribute ("value", defaultValue);
+
+        return &value;
+    };
+
+    ExchangeBandParameterPointers pointers;
+    pointers.cutFrequencyFrom1   = add ("cutFrequencyFrom1", 2000.0f);
+    pointers.cutFrequencyFrom2   = add ("cutFrequencyFrom2", 2000.0f);
+    pointers.frequencyBandLength = add ("FrequencyBandLength", 1.0f);
+    pointers.exchangeBandValue   = add ("ExchangeBandValue", 1.0f);
+    pointers.band1Mix            = add ("band1Mix", 0.01f);
+    pointers.band2Mix            = add ("band2Mix", 0.01f);
+    pointers.fftSizeIndex        = add ("fftSize", 3.0f);
+    pointers.overlapIndex        = add ("overlap", 0.0f);
+    pointers.windowType          = add ("window", 0.0f);
+    pointers.lowLatency          = add ("lowLatency", 0.0f);
+    pointers.sidechainLink       = add ("sidechainLink", 0.0f);
+    pointers.numBands            = add ("numBands", 2.0f);
+    const auto* engineChoice     = add ("engine", 0.0f);  // 0 = STFT，1 = 零延迟 IIR
+
+    for (int band = 3; band <= ExchangeBandParameters::maxBands; ++band)
+    {
+        const auto prefix = "band" + juce::String (band);
+        auto& bandPointers = pointers.extraBands[(size_t) (band - 1)];
+        bandPointers.centreFrequency = add (prefix + "Frequency", 1000.0f);
+        bandPointers.width           = add (prefix + "Width", 1.0f);
+        bandPointers.widthUnit       = add (prefix + "WidthUnit", (float) ExchangeBand::octaves);
+        bandPointers.mix             = add (prefix + "Mix", 0.0f);
+        bandPointers.partner         = add (prefix + "Partner", 0.0f);
+    }
+
+    destination = pointers.load();
+    options.useCrossoverEngine = engineChoice->load() >= 0.5f;
+    return juce::Result::ok();
+}
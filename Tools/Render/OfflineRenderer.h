@@ -0,0 +1,61 @@
+/*
+  ==============================================================================
+
+    OfflineRenderer.h
+    离线渲染一对主链 / 侧链文件：与插件相同的 ExchangeBandEngine（或零延迟的 CrossoverEngine），按大块流式读写，
+    内存占用只与块大小有关，与文件长度无关。
+    WAV / AIFF 输入通过内存映射读取：每块直接从映射的页面转换进引擎的缓冲区，
+    并提前提示内核预读下一段；其他格式按普通的流式读取。
+    每个 OfflineRenderer 只在一个线程上使用，可以依次渲染多对文件并复用引擎的缓冲区。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include <juce_audio_formats/juce_audio_formats.h>
+#include "CrossoverEngine.h"
+#include "ExchangeBandEngine.h"
+
+struct OfflineRenderOptions
+{
+    int blockSize = 65536;        // 每次读写和交给引擎处理的样本数
+    int bitsPerSample = 24;       // 输出位深（输出格式必须支持）
+    bool includeTail = false;     // 在主链结尾之后再输出引擎的尾音
+    bool useMemoryMapping = true; // WAV / AIFF 输入使用内存映射读取
+    int maxChannelThreads = 0;    // 多声道文件内部并行处理通道的工作线程数上限，多个文件并行渲染时保持 0
+    bool useCrossoverEngine = false; // 用零延迟的 IIR 分频引擎代替 STFT（插件的 "engine" 参数）
+    ExchangeBandEngine::CrossSynthesisMode crossSynthesisMode = ExchangeBandEngine::CrossSynthesisMode::rectangular;
+};
+
+class OfflineRenderer
+{
+public:
+    OfflineRenderer (const ExchangeBandParameters& parametersToUse, const OfflineRenderOptions& optionsToUse);
+
+    // 输出与主链对齐（已扣除引擎延迟），长度与主链相同（includeTail 时再加上尾音）。
+    // 侧链比主链短时后面按静音处理；两者采样率必须相同。
+    // 先写到临时文件，成功后才替换 outputFile
+    juce::Result render (const juce::File& mainFile, const juce::File& sidechainFile, const juce::File& outputFile);
+
+    // 读取插件状态 XML（AudioProcessorValueTreeState 的 <Parameters><PARAM id=".." value=".."/></Parameters>），
+    // 缺少的参数保持插件的默认值。频段表和 STFT 几何写进 destination，处理引擎的选择写进 options
+    static juce::Result loadPreset (const juce::File& presetFile, ExchangeBandParameters& destination, OfflineRenderOptions& options);
+
+private:
+    // 一个输入文件：能映射的格式持有 MemoryMappedAudioFormatReader，否则是普通 reader（定义在 .cpp 里）
+    class Input;
+
+    std::unique_ptr<Input> openInput (const juce::File& file);
+    juce::Result render (Input& mainInput, Input& sidechainInput, juce::AudioFormatWriter& writer);
+
+    ExchangeBandParameters parameters;
+    OfflineRenderOptions options;
+
+    juce::AudioFormatManager formatManager;
+    ExchangeBandEngine engine;
+    CrossoverEngine crossover;
+    juce::AudioBuffer<float> mainBuffer, sidechainBuffer;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (OfflineRenderer)
+};
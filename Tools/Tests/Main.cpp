@@ -0,0 +1,486 @@
+/*
+  ==============================================================================
+
+    Main.cpp
+    ExchangeBandTests：引擎的确定性回归测试和 CPU 预算检查（用例见 RegressionSuite.h）。
+
+      ExchangeBandTests [--golden] [--null] [--block-sizes] [--band2-mix] [--transitions] [--crossover] [--engine-switch] [--kernels] [--fft-backends] [--cpu] [options]
+
+    --golden       与 GoldenOutputs.txt 里存档的输出指纹比较；--update-golden 用当前引擎重新生成
+    --null         所有频段混合比为 0 时，输出必须与延迟对齐的输入一致
+    --block-sizes  只改变宿主的 block 长度时输出不变
+    --band2-mix    两种引擎里，两个频段重叠时 band2Mix 改变输出，不重叠时不影响输出
+    --transitions  处理中途切换 STFT 几何时输出不越界、不跳变，并且始终按报告的延迟对齐
+    --crossover    分频引擎：混合比为 0 时幅度响应是平的，交换的内容按正确的方向移频，
+                   分频点个数变化时不跳变
+    --engine-switch EngineSwitcher 在 block 中间切换引擎时输出不越界、不跳变，报告的延迟每次只变一次
+    --kernels      当前 CPU 支持的每个 SIMD 频谱内核表与标量参考实现一致（容差 kernelTolerance）
+    --fft-backends 每个 FFT 后端的每种点数：正向和逆向变换与双精度朴素 DFT、与 juce 后端一致，
+                   正向后逆向回到原信号（容差 fftTolerance）
+    --cpu          每个配置每次 process() 的平均耗时不能比基线慢 --cpu-tolerance 以上，
+                   p99 不能超过 block 的实时时长。基线与机器有关，不放进仓库，
+                   用 --record-cpu-baseline 在参考机器上记录；没有基线时只检查实时性，返回 77（ctest 记为跳过）
+    --fft          所有用例强制使用指定的 FFT 后端（juce / stockham），默认按 CPU 自动选择
+    --synthesis    所有用例使用指定的合成方式（full / sparse），默认 sparse，与插件相同
+    不指定时运行 --golden、--null 和 --block-sizes。全部通过返回 0，有失败返回 1。
+    用 EXCHANGEBAND_REALTIME_CHECKS=1 构建时，引擎在 process() 里分配内存或加锁也算失败。
+
+  ==============================================================================
+*/
+
+#include "RegressionSuite.h"
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <map>
+
+#ifndef EXCHANGEBAND_TESTS_DIR
+ #define EXCHANGEBAND_TESTS_DIR "."
+#endif
+
+namespace
+{
+    constexpr int skippedExitCode = 77;
+
+    struct TestOptions
+    {
+        juce::File goldenFile { juce::File::getCurrentWorkingDirectory().getChildFile (EXCHANGEBAND_TESTS_DIR).getChildFile ("GoldenOutputs.txt") };
+        juce::File cpuBaselineFile { juce::File::getCurrentWorkingDirectory().getChildFile ("cpu-baseline.txt") };
+        bool updateGolden = false;
+        bool recordCpuBaseline = false;
+        double cpuTolerance = 0.25;
+        double cpuSeconds = 2.0;
+        int cpuRuns = 5;
+    };
+
+    void printUsage()
+    {
+        std::cout << "Usage: ExchangeBandTests [--golden] [--null] [--block-sizes] [--band2-mix] [--transitions] [--crossover] [--engine-switch] [--kernels] [--fft-backends] [--cpu] [options]\n"
+                     "\n"
+                     "Tests (default: --golden --null --block-sizes):\n"
+                     "  --golden                 compare output fingerprints with the stored golden outputs\n"
+                     "  --null                   all band mixes at 0 must reproduce the latency-aligned input\n"
+                     "  --block-sizes            irregular host block sizes must not change the output\n"
+                     "  --band2-mix              band2Mix must change the output only where the two bands overlap\n"
+                     "  --transitions            STFT geometry changes mid-stream must stay bounded, continuous and aligned\n"
+                     "  --crossover              the crossover engine must be flat at unity gain and shift exchanged bands the right way\n"
+                     "  --engine-switch          switching engines mid-block must stay bounded, continuous and aligned\n"
+                     "  --kernels                every supported SIMD kernel table must match the scalar reference\n"
+                     "  --fft-backends           every FFT backend must match a naive DFT and the juce backend at every size\n"
+                     "  --cpu                    per-block CPU time against a recorded baseline and the real-time budget\n"
+                     "\n"
+                     "Options:\n"
+                     "  --golden-file <file>     golden fingerprints (default: Tools/Tests/GoldenOutputs.txt)\n"
+                     "  --update-golden          rewrite the golden file from the current engine\n"
+                     "  --cpu-baseline <file>    machine-specific CPU baseline (default: ./cpu-baseline.txt)\n"
+                     "  --record-cpu-baseline    measure and write the CPU baseline instead of checking it\n"
+                     "  --cpu-tolerance <x>      allowed slowdown against the baseline (default: 0.25 = 25%)\n"
+                     "  --cpu-seconds <n>        audio processed per measurement run (default: 2)\n"
+                     "  --cpu-runs <n>           measurement runs per configuration, the median is used (default: 5)\n"
+                     "  --fft <backend>          force an FFT backend for every case: juce or stockham (default: fastest)\n"
+                     "  --synthesis <mode>       full (inverse-transform every frame) or sparse (changed bins only, default)\n";
+    }
+
+    void printResult (bool passed, const char* test, const char* name, const juce::String& details)
+    {
+        std::cout << (passed ? "PASS  " : "FAIL  ") << juce::String (test).paddedRight (' ', 12)
+                  << juce::String (name).paddedRight (' ', 30) << details << std::endl;
+    }
+
+    juce::String formatDecibels (double error)
+    {
+        return juce::String (juce::Decibels::gainToDecibels (error, -200.0), 1) + " dB";
+    }
+
+    //==============================================================================
+    // 黄金输出文件：每个用例一行 "case <名称> <数值个数>"，后面是数值，每行 8 个
+    using Fingerprints = std::map<juce::String, std::vector<double>>;
+
+    juce::Result readGoldenFile (const juce::File& file, Fingerprints& fingerprints)
+    {
+        if (! file.existsAsFile())
+            return juce::Result::fail ("Cannot find " + file.getFullPathName() + " (create it with --update-golden)");
+
+        juce::StringArray lines;
+        file.readLines (lines);
+        std::vector<double>* current = nullptr;
+
+        for (int i = 0; i < lines.size(); ++i)
+        {
+            const auto line = lines[i].trim();
+
+            if (line.isEmpty() || line.startsWithChar ('#'))
+                continue;
+
+            const auto tokens = juce::StringArray::fromTokens (line, " ", "");
+
+            if (tokens[0] == "case")
+            {
+                if (tokens.size() != 3)
+                    return juce::Result::fail (file.getFileName() + ":" + juce::String (i + 1) + ": expected case <name> <count>");
+
+                current = &fingerprints[tokens[1]];
+                current->reserve ((size_t) tokens[2].getIntValue());
+                continue;
+            }
+
+            if (current == nullptr)
+                return juce::Result::fail (file.getFileName() + ":" + juce::String (i + 1) + ": values before the first case");
+
+            for (const auto& token : tokens)
+                current->push_back (token.getDoubleValue());
+        }
+
+        return juce::Result::ok();
+    }
+
+    juce::Result writeGoldenFile (const juce::File& file, const std::vector<RegressionSuite::RegressionCase>& cases,
+                                  const Fingerprints& fingerprints)
+    {
+        juce::String text;
+        text << "# ExchangeBandTests golden outputs: per channel, the RMS of each "
+             << RegressionSuite::fingerprintSegment << "-sample segment,\n"
+             << "# then one sample every " << RegressionSuite::fingerprintStride << " samples of the latency-aligned output.\n"
+             << "# Regenerate with ExchangeBandTests --update-golden after an intended change to the output.\n";
+
+        for (const auto& testCase : cases)
+        {
+            const auto& values = fingerprints.at (testCase.name);
+            text << "case " << testCase.name << " " << (int) values.size() << "\n";
+
+            for (size_t i = 0; i < values.size(); ++i)
+                text << juce::String (values[i], 8) << ((i % 8 == 7 || i + 1 == values.size()) ? "\n" : " ");
+        }
+
+        if (! file.replaceWithText (text, false, false, "\n"))
+            return juce::Result::fail ("Cannot write " + file.getFullPathName());
+
+        return juce::Result::ok();
+    }
+
+    //==============================================================================
+    bool runGoldenTests (const TestOptions& options)
+    {
+        const auto cases = RegressionSuite::getGoldenCases();
+        Fingerprints expected, actual;
+
+        if (! options.updateGolden)
+        {
+            if (const auto result = readGoldenFile (options.goldenFile, expected); result.failed())
+            {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return false;
+            }
+        }
+
+        bool allPassed = true;
+
+        for (const auto& testCase : cases)
+        {
+            auto& fingerprint = actual[testCase.name] = RegressionSuite::computeFingerprint (RegressionSuite::render (testCase));
+
+            if (options.updateGolden)
+                continue;
+
+            const auto found = expected.find (testCase.name);
+
+            if (found == expected.end() || found->second.size() != fingerprint.size())
+            {
+                printResult (false, "golden", testCase.name, found == expected.end() ? "no stored output" : "stored output has a different length");
+                allPassed = false;
+                continue;
+            }
+
+            // 最大的偏差相对于容差的比例，超过 1 就是失败
+            double worstRatio = 0.0, worstDifference = 0.0;
+            size_t worstIndex = 0;
+
+            for (size_t i = 0; i < fingerprint.size(); ++i)
+            {
+                const auto difference = std::abs (fingerprint[i] - found->second[i]);
+                const auto tolerance = testCase.goldenToleranceScale * (RegressionSuite::goldenAbsoluteTolerance
+                                                                          + RegressionSuite::goldenRelativeTolerance * std::abs (found->second[i]));
+                const auto ratio = std::isfinite (difference) ? difference / tolerance : std::numeric_limits<double>::infinity();
+
+                if (ratio > worstRatio)
+                {
+                    worstRatio = ratio;
+                    worstDifference = difference;
+                    worstIndex = i;
+                }
+            }
+
+            const auto passed = worstRatio <= 1.0;
+            allPassed = allPassed && passed;
+            printResult (passed, "golden", testCase.name,
+                         "max deviation " + juce::String (worstDifference, 8)
+                           + (passed ? juce::String() : " at value " + juce::String ((int) worstIndex)
+                                                          + ", expected " + juce::String (found->second[worstIndex], 8)
+                                                          + ", got " + juce::String (fingerprint[worstIndex], 8)));
+        }
+
+        if (options.updateGolden)
+        {
+            if (const auto result = writeGoldenFile (options.goldenFile, cases, actual); result.failed())
+            {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return false;
+            }
+
+            std::cout << "Wrote " << cases.size() << " golden outputs to " << options.goldenFile.getFullPathName() << std::endl;
+        }
+
+        return allPassed;
+    }
+
+    bool runNullTests()
+    {
+        bool allPassed = true;
+
+        for (const auto& testCase : RegressionSuite::getNullCases())
+        {
+            const auto error = RegressionSuite::getMaximumDifference (RegressionSuite::render (testCase),
+                                                                      RegressionSuite::generateMainInput (testCase));
+            const auto passed = error <= RegressionSuite::nullTolerance;
+            allPassed = allPassed && passed;
+            printResult (passed, "null", testCase.name, "max error " + formatDecibels (error));
+        }
+
+        return allPassed;
+    }
+
+    bool runBlockSizeTests()
+    {
+        bool allPassed = true;
+
+        for (const auto& testCase : RegressionSuite::getBlockSizeCases())
+        {
+            auto regularCase = testCase;
+            regularCase.blockSizes = { 4096, 0, 0, 0 };
+
+            const auto difference = RegressionSuite::getMaximumDifference (RegressionSuite::render (testCase),
+                                                                           RegressionSuite::render (regularCase));
+            const auto passed = difference <= RegressionSuite::blockSizeTolerance;
+            allPassed = allPassed && passed;
+            printResult (passed, "block-sizes", testCase.name, "max difference " + formatDecibels (difference));
+        }
+
+        return allPassed;
+    }
+
+    // 组件检查：逐项输出结果，全部通过才算通过
+    bool runChecks (const char* test, const std::vector<RegressionSuite::CheckResult>& results)
+    {
+        bool allPassed = true;
+
+        for (const auto& result : results)
+        {
+            printResult (result.passed, test, result.name.toRawUTF8(), result.details);
+            allPassed = allPassed && result.passed;
+        }
+
+        return allPassed;
+    }
+
+    //==============================================================================
+    // CPU 基线：每行 "<配置名> <每次 process() 的平均微秒数>"
+    juce::Result readCpuBaseline (const juce::File& file, std::map<juce::String, double>& baseline)
+    {
+        juce::StringArray lines;
+        file.readLines (lines);
+
+        for (int i = 0; i < lines.size(); ++i)
+        {
+            const auto line = lines[i].trim();
+
+            if (line.isEmpty() || line.startsWithChar ('#'))
+                continue;
+
+            const auto tokens = juce::StringArray::fromTokens (line, " ", "");
+
+            if (tokens.size() != 2 || tokens[1].getDoubleValue() <= 0.0)
+                return juce::Result::fail (file.getFileName() + ":" + juce::String (i + 1) + ": expected <configuration> <microseconds>");
+
+            baseline[tokens[0]] = tokens[1].getDoubleValue();
+        }
+
+        return juce::Result::ok();
+    }
+
+    int runCpuTests (const TestOptions& options)
+    {
+        std::map<juce::String, double> baseline;
+        const auto haveBaseline = ! options.recordCpuBaseline && options.cpuBaselineFile.existsAsFile();
+
+        if (haveBaseline)
+        {
+            if (const auto result = readCpuBaseline (options.cpuBaselineFile, baseline); result.failed())
+            {
+                std::cerr << result.getErrorMessage() << std::endl;
+                return 1;
+            }
+        }
+
+        juce::String recorded;
+        recorded << "# ExchangeBandTests CPU baseline: mean microseconds per process() call\n"
+                 << "# " << juce::SystemStats::getCpuModel() << ", " << juce::SystemStats::getNumCpus() << " cores, "
+                 << juce::Time::getCurrentTime().toString (true, true) << "\n";
+
+        bool allPassed = true;
+
+        for (const auto& testCase : RegressionSuite::getCpuCases())
+        {
+            const auto measurement = RegressionSuite::measureCpu (testCase, options.cpuSeconds, options.cpuRuns);
+            recorded << testCase.name << " " << juce::String (measurement.meanMicroseconds, 3) << "\n";
+
+            auto details = "mean " + juce::String (measurement.meanMicroseconds, 1) + " us, p99 "
+                             + juce::String (measurement.p99Microseconds, 1) + " us of "
+                             + juce::String (measurement.budgetMicroseconds, 1) + " us";
+
+            // 实时性：p99 超过 block 的实时时长，宿主里就会断音
+            auto passed = measurement.p99Microseconds <= measurement.budgetMicroseconds;
+
+            if (const auto found = baseline.find (testCase.name); found != baseline.end())
+            {
+                const auto ratio = measurement.meanMicroseconds / found->second;
+                details << ", " << juce::String (ratio, 2) << "x baseline";
+                passed = passed && ratio <= 1.0 + options.cpuTolerance;
+            }
+            else if (haveBaseline)
+            {
+                details << ", not in baseline";
+            }
+
+            allPassed = allPassed && passed;
+            printResult (passed, "cpu", testCase.name, details);
+        }
+
+        if (options.recordCpuBaseline)
+        {
+            if (! options.cpuBaselineFile.replaceWithText (recorded, false, false, "\n"))
+            {
+                std::cerr << "Cannot write " << options.cpuBaselineFile.getFullPathName() << std::endl;
+                return 1;
+            }
+
+            std::cout << "Wrote CPU baseline to " << options.cpuBaselineFile.getFullPathName() << std::endl;
+        }
+        else if (! haveBaseline && allPassed)
+        {
+            std::cout << "No CPU baseline at " << options.cpuBaselineFile.getFullPathName()
+                      << "; only the real-time budget was checked (record one with --record-cpu-baseline)" << std::endl;
+            return skippedExitCode;
+        }
+
+        return allPassed ? 0 : 1;
+    }
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    juce::ArgumentList args (argc, argv);
+
+    if (args.containsOption ("--help|-h"))
+    {
+        printUsage();
+        return 0;
+    }
+
+    TestOptions options;
+
+    const auto workingDirectory = juce::File::getCurrentWorkingDirectory();
+
+    if (args.containsOption ("--golden-file"))    options.goldenFile = workingDirectory.getChildFile (args.removeValueForOption ("--golden-file"));
+    if (args.containsOption ("--cpu-baseline"))   options.cpuBaselineFile = workingDirectory.getChildFile (args.removeValueForOption ("--cpu-baseline"));
+    if (args.containsOption ("--cpu-tolerance"))  options.cpuTolerance = args.removeValueForOption ("--cpu-tolerance").getDoubleValue();
+    if (args.containsOption ("--cpu-seconds"))    options.cpuSeconds = args.removeValueForOption ("--cpu-seconds").getDoubleValue();
+    if (args.containsOption ("--cpu-runs"))       options.cpuRuns = args.removeValueForOption ("--cpu-runs").getIntValue();
+
+    if (args.containsOption ("--fft"))
+    {
+        RealFft::Backend backend;
+
+        if (! RealFft::parseBackendName (args.removeValueForOption ("--fft"), backend))
+        {
+            printUsage();
+            return 2;
+        }
+
+        RegressionSuite::forceFftBackend (backend);
+    }
+
+    if (args.containsOption ("--synthesis"))
+    {
+        const auto mode = args.removeValueForOption ("--synthesis");
+
+        if (mode != "full" && mode != "sparse")
+        {
+            printUsage();
+            return 2;
+        }
+
+        RegressionSuite::setSynthesisMode (mode == "full" ? ExchangeBandEngine::SynthesisMode::fullInverse
+                                                          : ExchangeBandEngine::SynthesisMode::sparseCorrection);
+    }
+
+    options.updateGolden = args.removeOptionIfFound ("--update-golden");
+    options.recordCpuBaseline = args.removeOptionIfFound ("--record-cpu-baseline");
+
+    auto runGolden = args.removeOptionIfFound ("--golden") || options.updateGolden;
+    auto runNull = args.removeOptionIfFound ("--null");
+    auto runBlockSizes = args.removeOptionIfFound ("--block-sizes");
+    const auto runBand2Mix = args.removeOptionIfFound ("--band2-mix");
+    const auto runTransitions = args.removeOptionIfFound ("--transitions");
+    const auto runCrossover = args.removeOptionIfFound ("--crossover");
+    const auto runEngineSwitch = args.removeOptionIfFound ("--engine-switch");
+    const auto runKernels = args.removeOptionIfFound ("--kernels");
+    const auto runFftBackends = args.removeOptionIfFound ("--fft-backends");
+    const auto runCpu = args.removeOptionIfFound ("--cpu") || options.recordCpuBaseline;
+
+    if (args.size() != 0 || options.cpuTolerance < 0.0 || options.cpuSeconds <= 0.0 || options.cpuRuns <= 0)
+    {
+        printUsage();
+        return 2;
+    }
+
+    if (! (runGolden || runNull || runBlockSizes || runBand2Mix || runTransitions || runCrossover || runEngineSwitch
+            || runKernels || runFftBackends || runCpu))
+        runGolden = runNull = runBlockSizes = true;
+
+    bool allPassed = true;
+
+    if (runGolden)      allPassed = runGoldenTests (options) && allPassed;
+    if (runNull)        allPassed = runNullTests() && allPassed;
+    if (runBlockSizes)  allPassed = runBlockSizeTests() && allPassed;
+    if (runBand2Mix)    allPassed = runChecks ("band2-mix", RegressionSuite::checkBand2Mix()) && allPassed;
+    if (runTransitions) allPassed = runChecks ("transitions", RegressionSuite::checkGeometryTransitions()) && allPassed;
+    if (runCrossover)   allPassed = runChecks ("crossover", RegressionSuite::checkCrossoverEngine()) && allPassed;
+    if (runEngineSwitch) allPassed = runChecks ("engine-switch", RegressionSuite::checkEngineSwitching()) && allPassed;
+    if (runKernels)     allPassed = runChecks ("kernels", RegressionSuite::checkKernelTables()) && allPassed;
+    if (runFftBackends) allPassed = runChecks ("fft-backends", RegressionSuite::checkFftBackends()) && allPassed;
+
+    auto cpuSkipped = false;
+
+    if (runCpu)
+    {
+        const auto result = runCpuTests (options);
+
+        if (result == skippedExitCode)
+            cpuSkipped = true;
+        else if (result != 0)
+            allPassed = false;
+    }
+
+    // 用 EXCHANGEBAND_REALTIME_CHECKS=1 构建时，process() 里的任何分配或加锁都算失败
+    if (const auto numViolations = RealtimeSafety::getNumViolations(); numViolations > 0)
+    {
+        std::cerr << "FAILED: " << numViolations << " realtime violation(s) inside process(), see the backtrace above" << std::endl;
+        allPassed = false;
+    }
+
+    if (! allPassed)
+        return 1;
+
+    return cpuSkipped ? skippedExitCode : 0;
+}
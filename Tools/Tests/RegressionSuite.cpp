@@ -0,0 +1,1225 @@
+/*
+  ==============================================================================
+
+    RegressionSuite.cpp
+
+  ==============================================================================
+*/
+
+#include "RegressionSuite.h"
+#include "EngineSwitcher.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace RegressionSuite
+{
+namespace
+{
+    bool fftBackendForced = false;
+    RealFft::Backend forcedFftBackend = RealFft::Backend::juce;
+    ExchangeBandEngine::SynthesisMode synthesisMode = ExchangeBandEngine::SynthesisMode::sparseCorrection;
+
+    // xorshift32：序列只由种子决定，不依赖 juce::Random 的实现
+    class NoiseGenerator
+    {
+    public:
+        explicit NoiseGenerator (juce::uint32 seed) noexcept  : state (seed != 0 ? seed : 1) {}
+
+        // [-1, 1)
+        double next() noexcept
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            return (double) state / 2147483648.0 - 1.0;
+        }
+
+    private:
+        juce::uint32 state;
+    };
+
+    juce::AudioBuffer<double> generateSignal (TestSignal signal, int numChannels, int numSamples, juce::uint32 seed)
+    {
+        juce::AudioBuffer<double> buffer (numChannels, numSamples);
+        buffer.clear();
+
+        for (int channel = 0; channel < numChannels; ++channel)
+        {
+            auto* data = buffer.getWritePointer (channel);
+
+            switch (signal)
+            {
+                case TestSignal::silence:
+                    break;
+
+                case TestSignal::sweep:
+                {
+                    // 对数扫频的相位：2π f0 T / ln(k) * (k^(t/T) - 1)，k = f1 / f0
+                    constexpr double startFrequency = 20.0, endFrequency = 20000.0;
+                    const auto duration = numSamples / sampleRate;
+                    const auto logRatio = std::log (endFrequency / startFrequency);
+                    const auto offset = 7 * channel + 3 * (int) seed;
+
+                    for (int i = 0; i < numSamples; ++i)
+                    {
+                        const auto t = (i + offset) / sampleRate;
+                        const auto phase = juce::MathConstants<double>::twoPi * startFrequency * duration / logRatio
+                                             * (std::exp (logRatio * t / duration) - 1.0);
+                        data[i] = 0.5 * std::sin (phase);
+                    }
+
+                    break;
+                }
+
+                case TestSignal::noise:
+                {
+                    NoiseGenerator generator (0x9e3779b9u * (seed * 64 + (juce::uint32) channel + 1));
+
+                    for (int i = 0; i < numSamples; ++i)
+                        data[i] = 0.25 * generator.next();
+
+                    break;
+                }
+
+                case TestSignal::impulses:
+                {
+                    constexpr int period = 4801;
+                    double amplitude = 0.8;
+
+                    for (int i = 240 + 13 * channel + 29 * (int) seed; i < numSamples; i += period)
+                    {
+                        data[i] = amplitude;
+                        amplitude = -amplitude;
+                    }
+
+                    break;
+                }
+            }
+        }
+
+        return buffer;
+    }
+
+    juce::AudioBuffer<double> generateSidechainInput (const RegressionCase& testCase)
+    {
+        return generateSignal (testCase.sidechainSignal, testCase.numSidechainChannels, testCase.numSamples, 2);
+    }
+
+    ExchangeBandParameters makeParameters (const RegressionCase& testCase)
+    {
+        ExchangeBandParameters parameters;
+        parameters.setTwoBandLayout (1000.0f, testCase.cutFrequency2, testCase.bandLength, testCase.exchange ? 1.0f : 0.0f,
+                                     testCase.band1Mix, testCase.band2Mix);
+        parameters.stft = testCase.stft.withLegalValues();
+        parameters.sidechainLink = testCase.sidechainLink;
+
+        if (testCase.nullMix)
+        {
+            for (int band = 0; band < parameters.numBands; ++band)
+            {
+                parameters.bands[(size_t) band].mix = 0.0f;
+                parameters.bands[(size_t) band].partner = -1;
+            }
+        }
+
+        return parameters;
+    }
+
+    int getMaximumBlockSize (const RegressionCase& testCase)
+    {
+        return juce::jmax (1, *std::max_element (testCase.blockSizes.begin(), testCase.blockSizes.end()));
+    }
+
+    int getBlockSize (const RegressionCase& testCase, int blockIndex)
+    {
+        const auto numSizes = (int) std::count_if (testCase.blockSizes.begin(), testCase.blockSizes.end(), [] (int size) { return size > 0; });
+        return numSizes > 0 ? testCase.blockSizes[(size_t) (blockIndex % numSizes)] : 512;
+    }
+
+    void prepareEngine (ExchangeBandEngine& engine, const RegressionCase& testCase)
+    {
+        if (fftBackendForced)
+            engine.forceFftBackend (forcedFftBackend);
+
+        engine.setSynthesisMode (synthesisMode);
+        engine.setCrossSynthesisMode (testCase.polar ? ExchangeBandEngine::CrossSynthesisMode::polar
+                                                     : ExchangeBandEngine::CrossSynthesisMode::rectangular);
+        engine.setParameters (makeParameters (testCase));
+        engine.prepare (sampleRate, getMaximumBlockSize (testCase), testCase.numChannels, testCase.numSidechainChannels,
+                        testCase.doublePrecision ? ExchangeBandEngine::ProcessingPrecision::doublePrecision
+                                                 : ExchangeBandEngine::ProcessingPrecision::singlePrecision);
+    }
+
+    void prepareEngine (CrossoverEngine& engine, const RegressionCase& testCase)
+    {
+        engine.setParameters (makeParameters (testCase));
+        engine.prepare (sampleRate, getMaximumBlockSize (testCase), testCase.numChannels, testCase.numSidechainChannels,
+                        testCase.doublePrecision ? CrossoverEngine::ProcessingPrecision::doublePrecision
+                                                 : CrossoverEngine::ProcessingPrecision::singlePrecision);
+    }
+
+    // 从 startSample 开始引用 numSamples 个样本（没有侧链时为空 buffer）
+    template <typename SampleType>
+    juce::AudioBuffer<SampleType> referToBlock (juce::AudioBuffer<SampleType>& source, int startSample, int numSamples)
+    {
+        if (source.getNumChannels() == 0)
+            return {};
+
+        return { source.getArrayOfWritePointers(), source.getNumChannels(), startSample, numSamples };
+    }
+
+    template <typename EngineType, typename SampleType>
+    juce::AudioBuffer<double> renderWithEngine (const RegressionCase& testCase)
+    {
+        EngineType engine;
+        prepareEngine (engine, testCase);
+
+        // 输入后面补上延迟长度的静音，输出去掉开头的延迟后与输入对齐
+        const int latency = engine.getLatencySamples();
+        const int totalSamples = testCase.numSamples + latency;
+
+        juce::AudioBuffer<SampleType> mainBuffer, sidechainBuffer;
+        mainBuffer.makeCopyOf (generateMainInput (testCase));
+        sidechainBuffer.makeCopyOf (generateSidechainInput (testCase));
+        mainBuffer.setSize (testCase.numChannels, totalSamples, true, true);
+        sidechainBuffer.setSize (testCase.numSidechainChannels, totalSamples, true, true);
+
+        for (int position = 0, blockIndex = 0; position < totalSamples; ++blockIndex)
+        {
+            const int numThisTime = juce::jmin (getBlockSize (testCase, blockIndex), totalSamples - position);
+            auto mainBlock = referToBlock (mainBuffer, position, numThisTime);
+            const auto sidechainBlock = referToBlock (sidechainBuffer, position, numThisTime);
+
+            engine.process (mainBlock, sidechainBlock);
+            position += numThisTime;
+        }
+
+        juce::AudioBuffer<double> output (testCase.numChannels, testCase.numSamples);
+
+        for (int channel = 0; channel < testCase.numChannels; ++channel)
+        {
+            const auto* source = mainBuffer.getReadPointer (channel, latency);
+            auto* destination = output.getWritePointer (channel);
+
+            for (int i = 0; i < testCase.numSamples; ++i)
+                destination[i] = (double) source[i];
+        }
+
+        return output;
+    }
+
+    template <typename EngineType, typename SampleType>
+    CpuMeasurement measureWithEngine (const RegressionCase& testCase, double seconds, int numRuns)
+    {
+        EngineType engine;
+        prepareEngine (engine, testCase);
+
+        const int blockSize = getBlockSize (testCase, 0);
+
+        // 循环使用一小段输入，生成输入本身不计入耗时
+        constexpr int numSourceBlocks = 64;
+        auto sourceCase = testCase;
+        sourceCase.numSamples = blockSize * numSourceBlocks;
+
+        juce::AudioBuffer<SampleType> mainSource, sidechainSource;
+        mainSource.makeCopyOf (generateMainInput (sourceCase));
+        sidechainSource.makeCopyOf (generateSidechainInput (sourceCase));
+
+        juce::AudioBuffer<SampleType> mainBuffer (testCase.numChannels, blockSize);
+        juce::AudioBuffer<SampleType> sidechainBuffer (testCase.numSidechainChannels, blockSize);
+        int sourceBlock = 0;
+
+        const auto processNextBlock = [&]
+        {
+            const int sourceStart = (sourceBlock++ % numSourceBlocks) * blockSize;
+
+            for (int channel = 0; channel < testCase.numChannels; ++channel)
+                mainBuffer.copyFrom (channel, 0, mainSource, channel, sourceStart, blockSize);
+
+            for (int channel = 0; channel < testCase.numSidechainChannels; ++channel)
+                sidechainBuffer.copyFrom (channel, 0, sidechainSource, channel, sourceStart, blockSize);
+
+            const auto startTicks = juce::Time::getHighResolutionTicks();
+            engine.process (mainBuffer, sidechainBuffer);
+            return juce::Time::highResolutionTicksToSeconds (juce::Time::getHighResolutionTicks() - startTicks) * 1.0e6;
+        };
+
+        // 预热半秒；侧链静音时等到引擎旁路之后再开始计时
+        for (int i = 0; i < juce::roundToInt (0.5 * sampleRate / blockSize); ++i)
+            processNextBlock();
+
+        if (testCase.sidechainSignal == TestSignal::silence)
+            while (! engine.isIdle())
+                processNextBlock();
+
+        const int blocksPerRun = juce::jmax (1, juce::roundToInt (seconds * sampleRate / blockSize));
+        std::vector<double> blockTimes, runMeans;
+        blockTimes.reserve ((size_t) (blocksPerRun * numRuns));
+
+        for (int run = 0; run < numRuns; ++run)
+        {
+            double total = 0.0;
+
+            for (int block = 0; block < blocksPerRun; ++block)
+            {
+                blockTimes.push_back (processNextBlock());
+                total += blockTimes.back();
+            }
+
+            runMeans.push_back (total / blocksPerRun);
+        }
+
+        const auto nthValue = [] (std::vector<double>& values, size_t index)
+        {
+            std::nth_element (values.begin(), values.begin() + (std::ptrdiff_t) index, values.end());
+            return values[index];
+        };
+
+        CpuMeasurement measurement;
+        measurement.meanMicroseconds = nthValue (runMeans, runMeans.size() / 2);
+        measurement.p99Microseconds = nthValue (blockTimes, (size_t) ((double) (blockTimes.size() - 1) * 0.99));
+        measurement.budgetMicroseconds = blockSize / sampleRate * 1.0e6;
+        return measurement;
+    }
+}
+
+//==============================================================================
+void forceFftBackend (RealFft::Backend backend)
+{
+    fftBackendForced = true;
+    forcedFftBackend = backend;
+}
+
+void setSynthesisMode (ExchangeBandEngine::SynthesisMode mode)
+{
+    synthesisMode = mode;
+}
+
+//==============================================================================
+std::vector<RegressionCase> getGoldenCases()
+{
+    std::vector<RegressionCase> cases;
+
+    const auto add = [&cases] (const char* name, TestSignal mainSignal, TestSignal sidechainSignal) -> RegressionCase&
+    {
+        auto& testCase = cases.emplace_back();
+        testCase.name = name;
+        testCase.mainSignal = mainSignal;
+        testCase.sidechainSignal = sidechainSignal;
+        return testCase;
+    };
+
+    add ("sweep-noise-exchange", TestSignal::sweep, TestSignal::noise);
+
+    {
+        auto& testCase = add ("noise-sweep-blend", TestSignal::noise, TestSignal::sweep);
+        testCase.exchange = false;
+        testCase.band1Mix = 0.5f;
+    }
+
+    add ("mono-sidechain", TestSignal::noise, TestSignal::sweep).numSidechainChannels = 1;
+    add ("linked-sidechain", TestSignal::sweep, TestSignal::noise).sidechainLink = true;
+    add ("impulses-odd-blocks", TestSignal::impulses, TestSignal::noise).blockSizes = { 1, 37, 480, 1023 };
+    add ("noise-impulses", TestSignal::noise, TestSignal::impulses);
+    add ("silent-main", TestSignal::silence, TestSignal::noise);
+
+    {
+        // 两个频段重叠且交换：band2 换来的 band1 内容中落在重叠部分的按 band2Mix 混合
+        auto& testCase = add ("overlapping-exchange", TestSignal::noise, TestSignal::sweep);
+        testCase.cutFrequency2 = 1500.0f;
+        testCase.band1Mix = 0.25f;
+        testCase.band2Mix = 0.75f;
+    }
+
+    // 20 Hz 宽的频段只改变几个 bin，稀疏合成走振荡器组而不是 IFFT
+    add ("narrow-bands", TestSignal::noise, TestSignal::sweep).bandLength = 0.0f;
+
+    {
+        auto& testCase = add ("low-latency-1024-87", TestSignal::noise, TestSignal::sweep);
+        testCase.stft.fftOrder = 10;
+        testCase.stft.overlapIndex = 2;
+        testCase.stft.lowLatency = true;
+        testCase.blockSizes = { 64, 0, 0, 0 };
+    }
+
+    {
+        auto& testCase = add ("hann-4096-75", TestSignal::sweep, TestSignal::noise);
+        testCase.stft.fftOrder = 12;
+        testCase.stft.overlapIndex = 1;
+        testCase.stft.windowType = StftSettings::hann;
+        testCase.blockSizes = { 256, 999, 0, 0 };
+    }
+
+    {
+        auto& testCase = add ("blackman-harris-256-87", TestSignal::noise, TestSignal::sweep);
+        testCase.stft.fftOrder = 8;
+        testCase.stft.overlapIndex = 2;
+        testCase.stft.windowType = StftSettings::blackmanHarris;
+        testCase.blockSizes = { 128, 0, 0, 0 };
+    }
+
+    {
+        auto& testCase = add ("fft-32768", TestSignal::sweep, TestSignal::noise);
+        testCase.stft.fftOrder = 15;
+        testCase.numSamples = 131072;
+        testCase.blockSizes = { 2048, 0, 0, 0 };
+    }
+
+    {
+        // 相位按混合比线性插值，频段边缘的 bin 权重是小数，相位在 ±π 附近时舍入误差会被放大
+        auto& testCase = add ("polar", TestSignal::sweep, TestSignal::noise);
+        testCase.polar = true;
+        testCase.goldenToleranceScale = 10.0;
+    }
+
+    {
+        auto& testCase = add ("double-precision", TestSignal::sweep, TestSignal::noise);
+        testCase.doublePrecision = true;
+        testCase.blockSizes = { 441, 0, 0, 0 };
+    }
+
+    {
+        auto& testCase = add ("six-channels-odd-blocks", TestSignal::noise, TestSignal::sweep);
+        testCase.numChannels = testCase.numSidechainChannels = 6;
+        testCase.blockSizes = { 333, 97, 0, 0 };
+    }
+
+    {
+        auto& testCase = add ("six-channels-mono-sidechain", TestSignal::sweep, TestSignal::noise);
+        testCase.numChannels = 6;
+        testCase.numSidechainChannels = 1;
+    }
+
+    // 侧链静音：保持时间过后淡化到延迟后的主链，STFT 暂停
+    add ("silent-sidechain", TestSignal::sweep, TestSignal::silence).numSamples = 96000;
+    add ("no-sidechain", TestSignal::noise, TestSignal::silence).numSidechainChannels = 0;
+
+    // 零延迟的 IIR 分频引擎：同样的频段表，在时域里分频、移频后交换
+    add ("crossover-exchange", TestSignal::sweep, TestSignal::noise).crossover = true;
+
+    {
+        auto& testCase = add ("crossover-blend-double", TestSignal::noise, TestSignal::sweep);
+        testCase.crossover = true;
+        testCase.exchange = false;
+        testCase.band1Mix = 0.5f;
+        testCase.doublePrecision = true;
+    }
+
+    {
+        // 三个通道：float 的一个 SIMD 向量里有空的 lane，double 时分成两组
+        auto& testCase = add ("crossover-three-channels", TestSignal::sweep, TestSignal::noise);
+        testCase.crossover = true;
+        testCase.numChannels = testCase.numSidechainChannels = 3;
+        testCase.blockSizes = { 333, 97, 0, 0 };
+    }
+
+    {
+        auto& testCase = add ("crossover-overlapping-exchange", TestSignal::noise, TestSignal::sweep);
+        testCase.crossover = true;
+        testCase.cutFrequency2 = 1500.0f;
+        testCase.band1Mix = 0.25f;
+        testCase.band2Mix = 0.75f;
+    }
+
+    {
+        auto& testCase = add ("crossover-silent-sidechain", TestSignal::sweep, TestSignal::silence);
+        testCase.crossover = true;
+        testCase.numSamples = 96000;
+    }
+
+    return cases;
+}
+
+std::vector<RegressionCase> getNullCases()
+{
+    std::vector<RegressionCase> cases;
+
+    const auto add = [&cases] (const char* name, int fftOrder, int overlapIndex, int windowType, bool lowLatency) -> RegressionCase&
+    {
+        auto& testCase = cases.emplace_back();
+        testCase.name = name;
+        testCase.mainSignal = TestSignal::noise;
+        testCase.sidechainSignal = TestSignal::sweep;
+        testCase.nullMix = true;
+        testCase.stft.fftOrder = fftOrder;
+        testCase.stft.overlapIndex = overlapIndex;
+        testCase.stft.windowType = windowType;
+        testCase.stft.lowLatency = lowLatency;
+        return testCase;
+    };
+
+    add ("sqrt-hann-2048-50", 11, 0, StftSettings::sqrtHann, false);
+    add ("sqrt-hann-2048-75", 11, 1, StftSettings::sqrtHann, false);
+    add ("sqrt-hann-2048-87", 11, 2, StftSettings::sqrtHann, false);
+    add ("hann-2048-50", 11, 0, StftSettings::hann, false);
+    add ("hann-2048-75", 11, 1, StftSettings::hann, false);
+    add ("hann-2048-87", 11, 2, StftSettings::hann, false);
+    add ("blackman-harris-2048-50", 11, 0, StftSettings::blackmanHarris, false);
+    add ("blackman-harris-2048-75", 11, 1, StftSettings::blackmanHarris, false);
+    add ("blackman-harris-2048-87", 11, 2, StftSettings::blackmanHarris, false);
+    add ("low-latency-512-50", 9, 0, StftSettings::sqrtHann, true);
+    add ("low-latency-2048-75", 11, 1, StftSettings::sqrtHann, true);
+    add ("low-latency-2048-87", 11, 2, StftSettings::sqrtHann, true).blockSizes = { 1, 63, 0, 0 };
+    add ("fft-256", 8, 1, StftSettings::sqrtHann, false).mainSignal = TestSignal::impulses;
+    add ("fft-32768", 15, 0, StftSettings::sqrtHann, false).numSamples = 131072;
+
+    {
+        auto& testCase = add ("sweep-odd-blocks", 11, 0, StftSettings::sqrtHann, false);
+        testCase.mainSignal = TestSignal::sweep;
+        testCase.blockSizes = { 17, 1000, 3, 0 };
+    }
+
+    add ("polar", 11, 0, StftSettings::sqrtHann, false).polar = true;
+    add ("double-precision", 11, 1, StftSettings::sqrtHann, false).doublePrecision = true;
+    add ("mono-sidechain", 11, 0, StftSettings::sqrtHann, false).numSidechainChannels = 1;
+
+    {
+        auto& testCase = add ("six-channels", 12, 1, StftSettings::sqrtHann, false);
+        testCase.numChannels = testCase.numSidechainChannels = 6;
+        testCase.blockSizes = { 333, 0, 0, 0 };
+    }
+
+    return cases;
+}
+
+std::vector<RegressionCase> getBlockSizeCases()
+{
+    // 与 getGoldenCases() 的对应用例相同，只把 block 长度换成不规则的序列；
+    // 侧链静音检测按 block 进行，所以这里不包括静音侧链
+    std::vector<RegressionCase> cases;
+
+    for (const auto& goldenCase : getGoldenCases())
+    {
+        const juce::String name (goldenCase.name);
+
+        if (name == "sweep-noise-exchange" || name == "low-latency-1024-87" || name == "double-precision"
+             || name == "six-channels-mono-sidechain" || name == "polar" || name == "crossover-three-channels")
+        {
+            auto& testCase = cases.emplace_back (goldenCase);
+            testCase.blockSizes = { 1, 7, 1021, 64 };
+        }
+    }
+
+    return cases;
+}
+
+std::vector<RegressionCase> getCpuCases()
+{
+    std::vector<RegressionCase> cases;
+
+    const auto add = [&cases] (const char* name, int fftOrder, int overlapIndex) -> RegressionCase&
+    {
+        auto& testCase = cases.emplace_back();
+        testCase.name = name;
+        testCase.mainSignal = TestSignal::noise;
+        testCase.sidechainSignal = TestSignal::noise;
+        testCase.stft.fftOrder = fftOrder;
+        testCase.stft.overlapIndex = overlapIndex;
+        return testCase;
+    };
+
+    add ("stereo-2048-50", 11, 0);
+    add ("stereo-256-87", 8, 2);
+    add ("stereo-8192-75", 13, 1);
+    add ("stereo-low-latency-1024-87", 10, 2).stft.lowLatency = true;
+    add ("stereo-polar-2048-50", 11, 0).polar = true;
+    add ("stereo-double-2048-50", 11, 0).doublePrecision = true;
+    add ("stereo-idle", 11, 0).sidechainSignal = TestSignal::silence;
+
+    {
+        auto& testCase = add ("six-channels-4096-50", 12, 0);
+        testCase.numChannels = testCase.numSidechainChannels = 6;
+    }
+
+    add ("stereo-crossover", 11, 0).crossover = true;
+
+    {
+        auto& testCase = add ("stereo-crossover-double", 11, 0);
+        testCase.crossover = true;
+        testCase.doublePrecision = true;
+    }
+
+    return cases;
+}
+
+//==============================================================================
+juce::AudioBuffer<double> generateMainInput (const RegressionCase& testCase)
+{
+    return generateSignal (testCase.mainSignal, testCase.numChannels, testCase.numSamples, 1);
+}
+
+juce::AudioBuffer<double> render (const RegressionCase& testCase)
+{
+    if (testCase.crossover)
+        return testCase.doublePrecision ? renderWithEngine<CrossoverEngine, double> (testCase)
+                                        : renderWithEngine<CrossoverEngine, float> (testCase);
+
+    return testCase.doublePrecision ? renderWithEngine<ExchangeBandEngine, double> (testCase)
+                                    : renderWithEngine<ExchangeBandEngine, float> (testCase);
+}
+
+std::vector<double> computeFingerprint (const juce::AudioBuffer<double>& output)
+{
+    std::vector<double> fingerprint;
+    const int numSamples = output.getNumSamples();
+
+    for (int channel = 0; channel < output.getNumChannels(); ++channel)
+    {
+        for (int start = 0; start < numSamples; start += fingerprintSegment)
+            fingerprint.push_back (output.getRMSLevel (channel, start, juce::jmin (fingerprintSegment, numSamples - start)));
+
+        for (int i = 0; i < numSamples; i += fingerprintStride)
+            fingerprint.push_back (output.getSample (channel, i));
+    }
+
+    return fingerprint;
+}
+
+double getMaximumDifference (const juce::AudioBuffer<double>& a, const juce::AudioBuffer<double>& b)
+{
+    if (a.getNumChannels() != b.getNumChannels() || a.getNumSamples() != b.getNumSamples())
+        return std::numeric_limits<double>::infinity();
+
+    double maximum = 0.0;
+
+    for (int channel = 0; channel < a.getNumChannels(); ++channel)
+    {
+        const auto* x = a.getReadPointer (channel);
+        const auto* y = b.getReadPointer (channel);
+
+        for (int i = 0; i < a.getNumSamples(); ++i)
+        {
+            const auto difference = std::abs (x[i] - y[i]);
+
+            // NaN 也算作不相等
+            if (! (difference <= maximum))
+                maximum = std::isnan (difference) ? std::numeric_limits<double>::infinity() : difference;
+        }
+    }
+
+    return maximum;
+}
+
+CpuMeasurement measureCpu (const RegressionCase& testCase, double seconds, int numRuns)
+{
+    if (testCase.crossover)
+        return testCase.doublePrecision ? measureWithEngine<CrossoverEngine, double> (testCase, seconds, numRuns)
+                                        : measureWithEngine<CrossoverEngine, float> (testCase, seconds, numRuns);
+
+    return testCase.doublePrecision ? measureWithEngine<ExchangeBandEngine, double> (testCase, seconds, numRuns)
+                                    : measureWithEngine<ExchangeBandEngine, float> (testCase, seconds, numRuns);
+}
+
+//==============================================================================
+std::vector<CheckResult> checkKernelTables()
+{
+    using namespace SpectralKernels;
+
+    // 不是任何向量宽度的整数倍，各实现的尾部处理都会用到
+    constexpr int numValues = 1027;
+    constexpr double pi = juce::MathConstants<double>::pi;
+
+    NoiseGenerator generator (0x5eed);
+    std::vector<float> a (numValues), b (numValues), gainA (numValues), gainB (numValues);
+    std::vector<float> magnitude (numValues), phase (numValues), interleaved (2 * numValues);
+
+    for (int i = 0; i < numValues; ++i)
+    {
+        a[(size_t) i] = (float) (4.0 * generator.next());
+        b[(size_t) i] = (float) (4.0 * generator.next());
+        gainA[(size_t) i] = (float) (0.5 + 0.5 * generator.next());
+        gainB[(size_t) i] = (float) (0.5 + 0.5 * generator.next());
+        magnitude[(size_t) i] = (float) (2.0 + 2.0 * generator.next());
+        phase[(size_t) i] = (float) (pi * generator.next());
+        interleaved[(size_t) (2 * i)] = (float) (4.0 * generator.next());
+        interleaved[(size_t) (2 * i + 1)] = (float) (4.0 * generator.next());
+    }
+
+    std::vector<CheckResult> results;
+
+    for (const auto accuracy : { Accuracy::exact, Accuracy::fast })
+    {
+        const auto& reference = getScalarTable (accuracy);
+
+        for (const auto instructionSet : { InstructionSet::sse2, InstructionSet::avx2, InstructionSet::avx512, InstructionSet::neon })
+        {
+            const auto* table = getTable (instructionSet, accuracy);
+
+            // CPU 不支持或这个平台没有编译这一版
+            if (table == nullptr)
+                continue;
+
+            double worstError = 0.0;
+            const char* worstKernel = "";
+
+            const auto compare = [&] (const char* kernel, const std::vector<float>& expected, const std::vector<float>& actual, bool isPhase)
+            {
+                for (size_t i = 0; i < expected.size(); ++i)
+                {
+                    auto difference = (double) actual[i] - (double) expected[i];
+
+                    if (isPhase)
+                        difference = std::remainder (difference, 2.0 * pi);
+
+                    const auto error = std::abs (difference) / juce::jmax (1.0, std::abs ((double) expected[i]));
+
+                    if (! (error <= worstError))
+                    {
+                        worstError = std::isnan (error) ? std::numeric_limits<double>::infinity() : error;
+                        worstKernel = kernel;
+                    }
+                }
+            };
+
+            std::vector<float> expected (numValues), actual (numValues);
+            reference.blend (expected.data(), a.data(), 0.3f, b.data(), 0.7f, numValues);
+            table->blend (actual.data(), a.data(), 0.3f, b.data(), 0.7f, numValues);
+            compare ("blend", expected, actual, false);
+
+            // 原地：destination 与 a 重合
+            expected = a;
+            actual = a;
+            reference.blendWithGains (expected.data(), expected.data(), gainA.data(), b.data(), gainB.data(), numValues);
+            table->blendWithGains (actual.data(), actual.data(), gainA.data(), b.data(), gainB.data(), numValues);
+            compare ("blendWithGains", expected, actual, false);
+
+            expected = b;
+            actual = b;
+            reference.accumulateWithGains (expected.data(), a.data(), gainA.data(), b.data(), gainB.data(), 0.6f, numValues);
+            table->accumulateWithGains (actual.data(), a.data(), gainA.data(), b.data(), gainB.data(), 0.6f, numValues);
+            compare ("accumulateWithGains", expected, actual, false);
+
+            std::vector<float> expectedPhase (numValues), actualPhase (numValues);
+            reference.cartesianToPolar (interleaved.data(), expected.data(), expectedPhase.data(), numValues);
+            table->cartesianToPolar (interleaved.data(), actual.data(), actualPhase.data(), numValues);
+            compare ("cartesianToPolar", expected, actual, false);
+            compare ("cartesianToPolar", expectedPhase, actualPhase, true);
+
+            expected.assign (2 * numValues, 0.0f);
+            actual.assign (2 * numValues, 0.0f);
+            reference.polarToCartesian (magnitude.data(), phase.data(), expected.data(), numValues);
+            table->polarToCartesian (magnitude.data(), phase.data(), actual.data(), numValues);
+            compare ("polarToCartesian", expected, actual, false);
+
+            const auto passed = worstError <= kernelTolerance;
+            results.push_back ({ juce::String (getInstructionSetName (instructionSet)) + (accuracy == Accuracy::fast ? " fast" : " exact"),
+                                 passed,
+                                 "max relative error " + juce::String (worstError, 2, true) + (worstError > 0.0 ? juce::String (" in ") + worstKernel : juce::String()) });
+        }
+    }
+
+    if (results.empty())
+        results.push_back ({ "scalar", true, "no SIMD kernel table on this CPU" });
+
+    return results;
+}
+
+std::vector<CheckResult> checkFftBackends()
+{
+    constexpr double pi = juce::MathConstants<double>::pi;
+
+    std::vector<CheckResult> results;
+
+    for (int order = StftSettings::minOrder; order <= StftSettings::maxOrder; ++order)
+    {
+        const int size = 1 << order;
+        const int numBins = size / 2 + 1;
+
+        NoiseGenerator generator ((juce::uint32) (0xf0f0 + order));
+        std::vector<double> signal ((size_t) size);
+
+        for (auto& sample : signal)
+            sample = (double) (float) generator.next();
+
+        // 双精度朴素 DFT：X[k] = sum x[n] e^(-2 pi i k n / N)，旋转因子查表，k * n 按 N 取模
+        std::vector<double> cosTable ((size_t) size), sinTable ((size_t) size);
+
+        for (int n = 0; n < size; ++n)
+        {
+            cosTable[(size_t) n] = std::cos (2.0 * pi * n / size);
+            sinTable[(size_t) n] = std::sin (2.0 * pi * n / size);
+        }
+
+        std::vector<double> spectrum ((size_t) (2 * numBins));
+        double spectrumPeak = 0.0, signalPeak = 0.0;
+
+        for (int k = 0; k < numBins; ++k)
+        {
+            double re = 0.0, im = 0.0;
+
+            for (int n = 0, index = 0; n < size; ++n, index = (index + k) & (size - 1))
+            {
+                re += signal[(size_t) n] * cosTable[(size_t) index];
+                im -= signal[(size_t) n] * sinTable[(size_t) index];
+            }
+
+            spectrum[(size_t) (2 * k)] = re;
+            spectrum[(size_t) (2 * k + 1)] = im;
+            spectrumPeak = juce::jmax (spectrumPeak, std::abs (re), std::abs (im));
+        }
+
+        for (const auto sample : signal)
+            signalPeak = juce::jmax (signalPeak, std::abs (sample));
+
+        // 误差相对于参考值的峰值；NaN 记为无穷大
+        const auto getError = [] (const float* actual, const auto& expected, int count, double peak)
+        {
+            double worst = 0.0;
+
+            for (int i = 0; i < count; ++i)
+            {
+                const auto error = std::abs ((double) actual[i] - (double) expected[(size_t) i]) / peak;
+                worst = error <= worst ? worst : (std::isnan (error) ? std::numeric_limits<double>::infinity() : error);
+            }
+
+            return worst;
+        };
+
+        std::vector<float> juceForward, juceInverse;
+
+        for (const auto backend : { RealFft::Backend::juce, RealFft::Backend::stockham })
+        {
+            const auto fft = RealFft::create (backend, order);
+            std::vector<float> workspace ((size_t) juce::jmax (1, fft->getWorkspaceSize()));
+
+            std::vector<float> forward ((size_t) (2 * size), 0.0f);
+            std::copy (signal.begin(), signal.end(), forward.begin());
+            fft->forward (forward.data(), workspace.data());
+
+            // 逆变换的参考：参考频谱的朴素逆 DFT 就是原信号
+            std::vector<float> inverse ((size_t) (2 * size), 0.0f);
+            std::copy (spectrum.begin(), spectrum.end(), inverse.begin());
+            fft->inverse (inverse.data(), workspace.data());
+
+            auto roundTrip = forward;
+            fft->inverse (roundTrip.data(), workspace.data());
+
+            const auto forwardError = getError (forward.data(), spectrum, 2 * numBins, spectrumPeak);
+            const auto inverseError = getError (inverse.data(), signal, size, signalPeak);
+            const auto roundTripError = getError (roundTrip.data(), signal, size, signalPeak);
+            auto passed = forwardError <= fftTolerance && inverseError <= fftTolerance && roundTripError <= fftTolerance;
+            auto details = "forward " + juce::String (forwardError, 2, true) + ", inverse " + juce::String (inverseError, 2, true)
+                         + ", round trip " + juce::String (roundTripError, 2, true);
+
+            if (backend == RealFft::Backend::juce)
+            {
+                juceForward = forward;
+                juceInverse = inverse;
+            }
+            else
+            {
+                const auto juceError = juce::jmax (getError (forward.data(), juceForward, 2 * numBins, spectrumPeak),
+                                                   getError (inverse.data(), juceInverse, size, signalPeak));
+                passed = passed && juceError <= fftTolerance;
+                details << ", against juce " << juce::String (juceError, 2, true);
+            }
+
+            results.push_back ({ juce::String (RealFft::getBackendName (backend)) + " " + juce::String (size), passed, details });
+        }
+    }
+
+    return results;
+}
+
+std::vector<CheckResult> checkBand2Mix()
+{
+    std::vector<CheckResult> results;
+
+    for (const auto crossover : { false, true })
+    {
+        // band2 的中心从 4000 Hz 移到 1500 Hz，与 1000 Hz 的 band1 重叠
+        for (const auto overlapping : { true, false })
+        {
+            RegressionCase testCase;
+            testCase.name = "band2-mix";
+            testCase.crossover = crossover;
+            testCase.cutFrequency2 = overlapping ? 1500.0f : 4000.0f;
+            testCase.band1Mix = 0.25f;
+            testCase.band2Mix = 0.25f;
+
+            auto otherCase = testCase;
+            otherCase.band2Mix = 0.75f;
+
+            const auto difference = getMaximumDifference (render (testCase), render (otherCase));
+            const auto passed = overlapping ? difference >= band2MixMinimumChange : difference <= blockSizeTolerance;
+            results.push_back ({ juce::String (crossover ? "crossover " : "stft ") + (overlapping ? "overlapping" : "separate"), passed,
+                                 "band2Mix 0.25 -> 0.75 changes the output by " + juce::String (difference, 2, true) });
+        }
+    }
+
+    return results;
+}
+
+std::vector<CheckResult> checkCrossoverEngine()
+{
+    constexpr double twoPi = juce::MathConstants<double>::twoPi;
+    constexpr int blockSize = 512;
+
+    std::vector<CheckResult> results;
+
+    RegressionCase testCase;
+    testCase.crossover = true;
+    testCase.numChannels = 1;
+    testCase.numSidechainChannels = 1;
+
+    // 按 block 处理 main（原地）
+    const auto process = [] (CrossoverEngine& engine, juce::AudioBuffer<float>& main, juce::AudioBuffer<float>& sidechain)
+    {
+        for (int position = 0; position < main.getNumSamples(); position += blockSize)
+        {
+            const int numThisTime = juce::jmin (blockSize, main.getNumSamples() - position);
+            auto mainBlock = referToBlock (main, position, numThisTime);
+            const auto sidechainBlock = referToBlock (sidechain, position, numThisTime);
+            engine.process (mainBlock, sidechainBlock);
+        }
+    };
+
+    // 所有混合比为 0、没有交换：每个区段的增益都是 1，输出是主链的全通版本，
+    // 冲激响应在 20 Hz ~ 20 kHz 的幅度应当处处为 0 dB。band2 在 4000 Hz 与 band1 分开，在 1500 Hz 与它重叠
+    for (const auto cutFrequency2 : { 4000.0f, 1500.0f })
+    {
+        testCase.cutFrequency2 = cutFrequency2;
+        testCase.nullMix = true;
+
+        CrossoverEngine engine;
+        prepareEngine (engine, testCase);
+
+        constexpr int order = 15;
+        const auto fft = RealFft::create (RealFft::Backend::juce, order);
+        const int size = fft->getSize();
+
+        juce::AudioBuffer<float> impulse (1, size);
+        impulse.clear();
+        impulse.setSample (0, 0, 1.0f);
+
+        // 侧链是噪声，引擎不会进入空闲旁路；混合比为 0 时它不进入输出
+        juce::AudioBuffer<float> sidechain;
+        sidechain.makeCopyOf (generateSignal (TestSignal::noise, 1, size, 2));
+        process (engine, impulse, sidechain);
+
+        std::vector<float> spectrum ((size_t) (2 * size), 0.0f), workspace ((size_t) juce::jmax (1, fft->getWorkspaceSize()));
+        std::copy (impulse.getReadPointer (0), impulse.getReadPointer (0) + size, spectrum.begin());
+        fft->forward (spectrum.data(), workspace.data());
+
+        double deviation = 0.0;
+
+        for (int bin = juce::roundToInt (20.0 * size / sampleRate); bin <= juce::roundToInt (20000.0 * size / sampleRate); ++bin)
+        {
+            const auto magnitude = std::hypot ((double) spectrum[(size_t) (2 * bin)], (double) spectrum[(size_t) (2 * bin + 1)]);
+            deviation = juce::jmax (deviation, std::abs (juce::Decibels::gainToDecibels (magnitude, -200.0)));
+        }
+
+        results.push_back ({ "flat, band2 at " + juce::String (juce::roundToInt (cutFrequency2)) + " Hz", deviation <= crossoverFlatnessTolerance,
+                             juce::String (engine.getNumEdges()) + " edges, max deviation " + juce::String (deviation, 2, true) + " dB" });
+    }
+
+    // 交换：band1 输出 band2 的内容，移频 range1.start - range2.start（向下），band2 反过来向上。
+    // 主链和侧链是同一个正弦，混合比不影响结果。正弦放在来源频段的（几何）中心，电平补偿按这一点计算，
+    // 移到的频率上电平应当与输入相同，符号反了的那个频率上应当几乎没有
+    testCase.cutFrequency2 = 4000.0f;
+    testCase.nullMix = false;
+    testCase.exchange = true;
+
+    const auto parameters = makeParameters (testCase);
+    const auto range1 = parameters.bands[0].getFrequencyRange (sampleRate);
+    const auto range2 = parameters.bands[1].getFrequencyRange (sampleRate);
+    const auto shift = range1.getStart() - range2.getStart();
+
+    for (const auto down : { true, false })
+    {
+        const auto& sourceRange = down ? range2 : range1;
+        const auto input = std::sqrt (sourceRange.getStart() * sourceRange.getEnd());
+        const auto expected = down ? input + shift : input - shift;
+        const auto mirrored = std::abs (down ? input - shift : input + shift);
+
+        CrossoverEngine engine;
+        prepareEngine (engine, testCase);
+
+        const int numSamples = 2 * (int) sampleRate;
+        juce::AudioBuffer<float> main (1, numSamples);
+
+        for (int i = 0; i < numSamples; ++i)
+            main.setSample (0, i, (float) (0.5 * std::sin (twoPi * input * i / sampleRate)));
+
+        juce::AudioBuffer<float> sidechain;
+        sidechain.makeCopyOf (main);
+        process (engine, main, sidechain);
+
+        // 后一秒（滤波器和移频已经稳定）加 Hann 窗后在单个频率上的幅度
+        const auto getAmplitude = [&main, numSamples] (double frequency)
+        {
+            const int start = numSamples / 2, length = numSamples - start;
+            double re = 0.0, im = 0.0, windowSum = 0.0;
+
+            for (int i = 0; i < length; ++i)
+            {
+                const auto window = 0.5 - 0.5 * std::cos (twoPi * i / length);
+                const auto phase = twoPi * frequency * (start + i) / sampleRate;
+                re += window * main.getSample (0, start + i) * std::cos (phase);
+                im -= window * main.getSample (0, start + i) * std::sin (phase);
+                windowSum += window;
+            }
+
+            return 2.0 * std::hypot (re, im) / windowSum;
+        };
+
+        const auto level = juce::Decibels::gainToDecibels (getAmplitude (expected) / 0.5, -200.0);
+        const auto rejection = juce::Decibels::gainToDecibels (getAmplitude (expected) / getAmplitude (mirrored));
+        const auto passed = std::abs (level) <= crossoverShiftLevelTolerance && rejection >= crossoverShiftRejection;
+        results.push_back ({ juce::String (down ? "shift down " : "shift up ") + juce::String (juce::roundToInt (input)) + " Hz", passed,
+                             "at " + juce::String (juce::roundToInt (expected)) + " Hz " + juce::String (level, 2) + " dB, "
+                               + juce::String (rejection, 1) + " dB above " + juce::String (juce::roundToInt (mirrored)) + " Hz" });
+    }
+
+    // 所有混合比为 0 时，处理中途把 band2 的下沿移到 band1 的上沿，两者合并，分频点从 4 个变成 3 个：
+    // 输出先淡化到未处理的主链再淡入，相邻样本之差不能超过输入的 transitionStepRatio 倍。
+    // 峰值只报告：滤波器从清空的状态重新开始时，全通自身的起始瞬态会略超过输入
+    {
+        testCase.nullMix = true;
+
+        CrossoverEngine engine;
+        prepareEngine (engine, testCase);
+        const int edgesBefore = engine.getNumEdges();
+
+        const int numSamples = (int) sampleRate;
+        juce::AudioBuffer<float> main (1, numSamples), input;
+
+        for (int i = 0; i < numSamples; ++i)
+            main.setSample (0, i, (float) (0.5 * std::sin (twoPi * 700.0 * i / sampleRate)));
+
+        input.makeCopyOf (main);
+        juce::AudioBuffer<float> sidechain;
+        sidechain.makeCopyOf (generateSignal (TestSignal::noise, 1, numSamples, 2));
+
+        auto firstHalf = referToBlock (main, 0, numSamples / 2);
+        auto firstSidechain = referToBlock (sidechain, 0, numSamples / 2);
+        process (engine, firstHalf, firstSidechain);
+
+        auto changed = makeParameters (testCase);
+        changed.bands[1].centreFrequency = (float) (range1.getEnd() + 0.5 * range2.getLength());
+        engine.setParameters (changed);
+
+        auto secondHalf = referToBlock (main, numSamples / 2, numSamples / 2);
+        auto secondSidechain = referToBlock (sidechain, numSamples / 2, numSamples / 2);
+        process (engine, secondHalf, secondSidechain);
+
+        double inputPeak = 0.0, inputStep = 0.0, peak = 0.0, step = 0.0;
+
+        for (int i = 1; i < numSamples; ++i)
+        {
+            inputPeak = juce::jmax (inputPeak, (double) std::abs (input.getSample (0, i)));
+            inputStep = juce::jmax (inputStep, (double) std::abs (input.getSample (0, i) - input.getSample (0, i - 1)));
+            peak = juce::jmax (peak, (double) std::abs (main.getSample (0, i)));
+            step = juce::jmax (step, (double) std::abs (main.getSample (0, i) - main.getSample (0, i - 1)));
+        }
+
+        const auto passed = engine.getNumEdges() != edgesBefore && step <= inputStep * transitionStepRatio;
+        results.push_back ({ "edge count change", passed,
+                             juce::String (edgesBefore) + " -> " + juce::String (engine.getNumEdges()) + " edges, peak "
+                               + juce::String (peak / inputPeak, 4) + "x, max step " + juce::String (step / inputStep, 2) + "x input" });
+    }
+
+    return results;
+}
+
+std::vector<CheckResult> checkEngineSwitching()
+{
+    // 所有混合比为 0、不交换：STFT 的输出是延迟后的主链，分频引擎的是全通版本。
+    // 0.5 s 时切到分频引擎，1.5 s 时切回；block 长度是奇数，切换在 block 中间完成
+    RegressionCase testCase;
+    testCase.name = "engine-switch";
+    testCase.numSamples = 5 * (int) sampleRate / 2;
+    testCase.nullMix = true;
+    testCase.blockSizes = { 479, 0, 0, 0 };
+
+    const int blockSize = getBlockSize (testCase, 0);
+    const int firstSwitch = (int) sampleRate / 2, secondSwitch = 3 * (int) sampleRate / 2;
+    const int settleSamples = (int) sampleRate / 2;
+
+    juce::AudioBuffer<float> input (testCase.numChannels, testCase.numSamples), sidechain;
+    sidechain.makeCopyOf (generateSignal (TestSignal::noise, testCase.numSidechainChannels, testCase.numSamples, 2));
+
+    for (int channel = 0; channel < testCase.numChannels; ++channel)
+        for (int i = 0; i < testCase.numSamples; ++i)
+            input.setSample (channel, i, (float) (0.5 * std::sin (juce::MathConstants<double>::twoPi * 220.0 * (i + 37 * channel) / sampleRate)));
+
+    // useCrossover (位置) 选择引擎；每个 block 之后记录报告的延迟
+    const auto render = [&] (auto useCrossover, juce::AudioBuffer<float>& output, std::vector<int>& latency)
+    {
+        ExchangeBandEngine engine;
+        CrossoverEngine crossover;
+        prepareEngine (engine, testCase);
+        prepareEngine (crossover, testCase);
+
+        EngineSwitcher switcher (engine, crossover);
+        switcher.prepare (blockSize, testCase.numChannels, ExchangeBandEngine::ProcessingPrecision::singlePrecision, useCrossover (0));
+
+        output.makeCopyOf (input);
+        latency.assign ((size_t) testCase.numSamples, 0);
+
+        for (int position = 0; position < testCase.numSamples; position += blockSize)
+        {
+            const int numThisTime = juce::jmin (blockSize, testCase.numSamples - position);
+            auto mainBlock = referToBlock (output, position, numThisTime);
+            const auto sidechainBlock = referToBlock (sidechain, position, numThisTime);
+
+            switcher.process (mainBlock, sidechainBlock, useCrossover (position));
+            std::fill (latency.begin() + position, latency.begin() + position + numThisTime, switcher.getLatencySamples());
+        }
+    };
+
+    juce::AudioBuffer<float> output, stftOutput, crossoverOutput;
+    std::vector<int> latency, stftLatency, crossoverLatency;
+    render ([] (int) { return false; }, stftOutput, stftLatency);
+    render ([] (int) { return true; }, crossoverOutput, crossoverLatency);
+    render ([&] (int position) { return position >= firstSwitch && position < secondSwitch; }, output, latency);
+
+    // 每次切换报告的延迟只变一次
+    int numLatencyChanges = 0;
+
+    for (size_t i = 1; i < latency.size(); ++i)
+        if (latency[i] != latency[i - 1])
+            ++numLatencyChanges;
+
+    // 切换开始后半秒以外与只用当前引擎的输出相同，半秒以内只检查峰值和相邻样本之差。
+    // 第二个通道的正弦不从 0 开始，延迟结束时输出本身有一个阶跃，从那之后才比较
+    const int firstOutput = stftLatency.front() + 1;
+    double inputPeak = 0.0, inputStep = 0.0, peak = 0.0, step = 0.0, error = 0.0;
+
+    for (int channel = 0; channel < testCase.numChannels; ++channel)
+    {
+        const auto* x = input.getReadPointer (channel);
+        const auto* y = output.getReadPointer (channel);
+
+        for (int i = 1; i < testCase.numSamples; ++i)
+        {
+            inputPeak = juce::jmax (inputPeak, (double) std::abs (x[i]));
+            inputStep = juce::jmax (inputStep, (double) std::abs (x[i] - x[i - 1]));
+        }
+
+        for (int i = firstOutput; i < testCase.numSamples; ++i)
+        {
+            peak = juce::jmax (peak, (double) std::abs (y[i]));
+            step = juce::jmax (step, (double) std::abs (y[i] - y[i - 1]));
+
+            const auto settling = (i >= firstSwitch && i < firstSwitch + settleSamples) || (i >= secondSwitch && i < secondSwitch + settleSamples);
+            const auto& reference = i >= firstSwitch && i < secondSwitch ? crossoverOutput : stftOutput;
+
+            if (! settling)
+                error = juce::jmax (error, (double) std::abs (y[i] - reference.getSample (channel, i)));
+        }
+    }
+
+    const auto passed = numLatencyChanges == 2 && peak <= inputPeak * transitionPeakRatio
+                         && step <= inputStep * transitionStepRatio && error <= nullTolerance;
+
+    return { { "stft-crossover-stft", passed,
+               "latency " + juce::String (stftLatency.front()) + " -> " + juce::String (crossoverLatency.front()) + " -> "
+                 + juce::String (latency.back()) + " (" + juce::String (numLatencyChanges) + " changes), peak "
+                 + juce::String (peak / inputPeak, 4) + "x, max step " + juce::String (step / inputStep, 2)
+                 + "x input, max error " + juce::String (error, 2, true) } };
+}
+
+std::vector<CheckResult> checkGeometryTransitions()
+{
+    struct Transition
+    {
+        const char* name;
+        StftSettings from, to;
+    };
+
+    const auto makeSettings = [] (int fftOrder, bool lowLatency, int windowType)
+    {
+        StftSettings settings;
+        settings.fftOrder = fftOrder;
+        settings.overlapIndex = 1;
+        settings.windowType = windowType;
+        settings.lowLatency = lowLatency;
+        return settings;
+    };
+
+    const Transition transitions[] =
+    {
+        { "2048-to-512",          makeSettings (11, false, StftSettings::sqrtHann), makeSettings (9, false, StftSettings::sqrtHann) },
+        { "512-to-4096",          makeSettings (9, false, StftSettings::sqrtHann),  makeSettings (12, false, StftSettings::sqrtHann) },
+        { "1024-to-low-latency",  makeSettings (10, false, StftSettings::sqrtHann), makeSettings (10, true, StftSettings::sqrtHann) },
+        { "low-latency-to-2048",  makeSettings (10, true, StftSettings::sqrtHann),  makeSettings (11, false, StftSettings::sqrtHann) },
+        { "2048-window",          makeSettings (11, false, StftSettings::sqrtHann), makeSettings (11, false, StftSettings::hann) }
+    };
+
+    std::vector<CheckResult> results;
+
+    for (const auto& transition : transitions)
+    {
+        RegressionCase testCase;
+        testCase.name = transition.name;
+        testCase.numChannels = 1;
+        testCase.numSidechainChannels = 1;
+        testCase.numSamples = 2 * (int) sampleRate;
+        testCase.exchange = false;
+        testCase.band1Mix = 0.5f;
+        testCase.stft = transition.from;
+
+        ExchangeBandEngine engine;
+        prepareEngine (engine, testCase);
+
+        // 220 Hz 正弦同时作为主链和侧链：无论掩码怎样混合，输出都应当是延迟后的主链，STFT 仍然照常运行
+        juce::AudioBuffer<float> input (1, testCase.numSamples), output (1, testCase.numSamples);
+
+        for (int i = 0; i < testCase.numSamples; ++i)
+            input.setSample (0, i, (float) (0.5 * std::sin (juce::MathConstants<double>::twoPi * 220.0 * i / sampleRate)));
+
+        output.makeCopyOf (input);
+
+        const int switchSample = testCase.numSamples / 4;
+        std::vector<int> latency ((size_t) testCase.numSamples);
+        auto switched = false;
+
+        for (int position = 0, blockIndex = 0; position < testCase.numSamples; ++blockIndex)
+        {
+            if (! switched && position >= switchSample)
+            {
+                testCase.stft = transition.to;
+                engine.setParameters (makeParameters (testCase));
+                switched = true;
+            }
+
+            const int numThisTime = juce::jmin (getBlockSize (testCase, blockIndex), testCase.numSamples - position);
+            auto mainBlock = referToBlock (output, position, numThisTime);
+            const auto sidechainBlock = referToBlock (input, position, numThisTime);
+
+            engine.process (mainBlock, sidechainBlock);
+            std::fill (latency.begin() + position, latency.begin() + position + numThisTime, engine.getLatencySamples());
+            position += numThisTime;
+        }
+
+        // 延迟不同时，切换开始后半秒内（预热、交叉淡化和延迟跳变都在其中）只检查峰值和相邻样本之差
+        const auto* x = input.getReadPointer (0);
+        const auto* y = output.getReadPointer (0);
+        const auto sameLatency = transition.from.getLatencySamples() == transition.to.getLatencySamples();
+        const int settledSample = switchSample + (int) sampleRate / 2;
+        double inputPeak = 0.0, inputStep = 0.0, peak = 0.0, step = 0.0, error = 0.0;
+
+        for (int i = 1; i < testCase.numSamples; ++i)
+        {
+            inputPeak = juce::jmax (inputPeak, (double) std::abs (x[i]));
+            inputStep = juce::jmax (inputStep, (double) std::abs (x[i] - x[i - 1]));
+            peak = juce::jmax (peak, (double) std::abs (y[i]));
+            step = juce::jmax (step, (double) std::abs (y[i] - y[i - 1]));
+        }
+
+        for (int i = transition.from.getTailSamples(); i < testCase.numSamples; ++i)
+            if (sameLatency || i < switchSample || i >= settledSample)
+                error = juce::jmax (error, (double) std::abs (y[i] - x[i - latency[(size_t) i]]));
+
+        const auto passed = peak <= inputPeak * transitionPeakRatio && step <= inputStep * transitionStepRatio && error <= nullTolerance;
+        results.push_back ({ transition.name, passed,
+                             "latency " + juce::String (transition.from.getLatencySamples()) + " -> " + juce::String (transition.to.getLatencySamples())
+                               + ", peak " + juce::String (peak / inputPeak, 4) + "x, max step " + juce::String (step / inputStep, 2)
+                               + "x input, max error " + juce::String (error, 2, true) });
+    }
+
+    return results;
+}
+}
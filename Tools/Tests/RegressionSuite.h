@@ -0,0 +1,164 @@
+/*
+  ==============================================================================
+
+    RegressionSuite.h
+    ExchangeBandTests 的用例和检查：用合成的主链 / 侧链信号驱动引擎，
+    与存档的黄金输出比较、做零混合的重建（null）测试，并测量每个 block 的 CPU 耗时；
+    另外直接检查引擎用到的组件（频谱内核表等），不经过黄金输出。
+
+    - 测试信号只用自己的伪随机数和 double 的 sin 生成，与 JUCE 版本和平台无关。
+    - 输出都已扣除引擎延迟，与输入逐样本对齐，再转换成 double 比较。
+    - 黄金输出不存原始样本，只存指纹：每个通道每 fingerprintSegment 个样本一段的 RMS，
+      加上每隔 fingerprintStride 个样本取的一个样本值。时间错位、符号错误、通道串扰和电平变化都会反映在指纹里，
+      不同平台的 FFT 实现带来的舍入差异远小于容差。
+
+  ==============================================================================
+*/
+
+#pragma once
+
+#include "CrossoverEngine.h"
+#include "ExchangeBandEngine.h"
+#include <vector>
+
+namespace RegressionSuite
+{
+    constexpr double sampleRate = 48000.0;
+
+    constexpr int fingerprintSegment = 1024;
+    constexpr int fingerprintStride = 401;
+
+    // 指纹比较的容差：|actual - expected| <= goldenAbsoluteTolerance + goldenRelativeTolerance * |expected|
+    constexpr double goldenAbsoluteTolerance = 1.0e-4;   // 约 -80 dBFS
+    constexpr double goldenRelativeTolerance = 1.0e-3;
+
+    // 零混合时输出与延迟对齐的输入之间允许的最大误差（float 频谱，约 -100 dBFS）
+    constexpr double nullTolerance = 1.0e-5;
+
+    // 只改变宿主 block 长度时输出允许的最大差别
+    constexpr double blockSizeTolerance = 1.0e-6;
+
+    // band2Mix 检查：两个频段重叠时改变 band2Mix，输出至少要变化这么多
+    constexpr double band2MixMinimumChange = 1.0e-2;
+
+    // 分频引擎检查：单位增益时幅度响应偏离 0 dB 的上限（dB）；交换时移到的频率上的电平误差（dB），
+    // 以及它比符号反了的那个频率至少高多少（dB）
+    constexpr double crossoverFlatnessTolerance = 0.01;
+    constexpr double crossoverShiftLevelTolerance = 1.0;
+    constexpr double crossoverShiftRejection = 40.0;
+
+    // 几何切换检查：输出峰值不能超过输入峰值的这么多倍，相邻样本之差不能超过输入的这么多倍
+    constexpr double transitionPeakRatio = 1.001;
+    constexpr double transitionStepRatio = 2.0;
+
+    // SIMD 内核与标量参考实现的逐元素误差，相对于 max(1, |参考值|)；相位按回绕后的差计算
+    constexpr double kernelTolerance = 1.0e-6;
+
+    // FFT 后端与双精度朴素 DFT、与 juce 后端之间，以及正向后逆向回到原信号的误差，相对于参考值的峰值
+    constexpr double fftTolerance = 1.0e-5;
+
+    enum class TestSignal
+    {
+        silence,
+        sweep,      // 20 Hz ~ 20 kHz 的对数扫频，-6 dBFS，每个通道错开几个样本
+        noise,      // 均匀白噪声，约 -12 dBFS 峰值，每个通道独立
+        impulses    // 每 4801 个样本一个正负交替的脉冲，每个通道错开几个样本
+    };
+
+    struct RegressionCase
+    {
+        const char* name = "";
+        TestSignal mainSignal = TestSignal::noise;
+        TestSignal sidechainSignal = TestSignal::sweep;
+        int numChannels = 2;
+        int numSidechainChannels = 2;      // 0 = 没有侧链，1 = 单声道侧链
+        int numSamples = 48000;
+
+        StftSettings stft;
+        bool exchange = true;              // 两个频段互换（ExchangeBandValue）
+        float band1Mix = 0.01f;
+        float band2Mix = 1.0f;             // 只影响交换时 band2 换来的内容中与 band2 重叠的部分
+        float cutFrequency2 = 4000.0f;     // band2 的中心（band1 固定在 1000 Hz）
+        float bandLength = 1.0f;           // FrequencyBandLength，0 ~ 2 对应 20 ~ 2000 Hz
+        bool sidechainLink = false;
+        bool nullMix = false;              // 所有频段混合比为 0 且不交换：输出应当就是延迟后的主链
+        bool polar = false;
+        bool doublePrecision = false;
+        bool crossover = false;            // 用零延迟的 CrossoverEngine 代替 STFT 引擎（stft / polar 不起作用）
+        double goldenToleranceScale = 1.0; // 黄金输出比较时容差的倍数
+
+        // 宿主的 block 长度，依次循环使用，0 表示结束
+        std::array<int, 4> blockSizes { 512, 0, 0, 0 };
+    };
+
+    // 之后渲染和测量的所有用例都使用这个 FFT 后端（默认与插件一样，按 CPU 选最快的）。
+    // 黄金输出与后端无关，每个后端都应当在容差以内
+    void forceFftBackend (RealFft::Backend backend);
+
+    // 之后的用例都使用这种合成方式（默认与引擎一样是 sparseCorrection）。两种方式的输出应当在同样的容差以内
+    void setSynthesisMode (ExchangeBandEngine::SynthesisMode mode);
+
+    // 黄金输出的用例 / 零混合的重建用例 / 只改变 block 长度的对比用例 / CPU 预算的配置。
+    // 分频引擎的输出是主链经过全通滤波的结果，不与输入逐样本一致，所以没有零混合的用例
+    std::vector<RegressionCase> getGoldenCases();
+    std::vector<RegressionCase> getNullCases();
+    std::vector<RegressionCase> getBlockSizeCases();
+    std::vector<RegressionCase> getCpuCases();
+
+    // 生成用例的主链输入（double，长度为 numSamples）
+    juce::AudioBuffer<double> generateMainInput (const RegressionCase& testCase);
+
+    // 按用例驱动一个新的引擎，返回与输入对齐的输出（长度为 numSamples）
+    juce::AudioBuffer<double> render (const RegressionCase& testCase);
+
+    // 指纹：逐通道依次为各段 RMS，再加上各个采样值
+    std::vector<double> computeFingerprint (const juce::AudioBuffer<double>& output);
+
+    // 两个信号之间最大的逐样本误差，通道数或长度不同时返回无穷大
+    double getMaximumDifference (const juce::AudioBuffer<double>& a, const juce::AudioBuffer<double>& b);
+
+    //==============================================================================
+    struct CpuMeasurement
+    {
+        double meanMicroseconds = 0.0;     // 每次 process() 的平均耗时，取各轮平均值的中位数
+        double p99Microseconds = 0.0;      // 所有轮次里每个 block 耗时的第 99 百分位
+        double budgetMicroseconds = 0.0;   // block 的实时时长
+    };
+
+    // 预热后测量 numRuns 轮，每轮 seconds 秒噪声
+    CpuMeasurement measureCpu (const RegressionCase& testCase, double seconds, int numRuns);
+
+    //==============================================================================
+    // 组件检查的结果，每项一个名称、是否通过和一行说明
+    struct CheckResult
+    {
+        juce::String name;
+        bool passed = false;
+        juce::String details;
+    };
+
+    // 当前 CPU 支持的每个 SIMD 内核表（两种精度）的所有内核都与 getScalarTable() 逐元素比较，
+    // 长度不是向量宽度的整数倍，混合内核还检查原地调用
+    std::vector<CheckResult> checkKernelTables();
+
+    // StftSettings 的每种点数、每个 FFT 后端：正向和逆向变换与双精度朴素 DFT 比较，正向后逆向要回到原信号，
+    // 其他后端还要与 juce 后端一致
+    std::vector<CheckResult> checkFftBackends();
+
+    // 两种引擎各自检查：两个频段重叠且交换时，改变 band2Mix 必须改变输出；
+    // 两个频段不重叠时 band2Mix 不起作用，输出在 blockSizeTolerance 以内不变
+    std::vector<CheckResult> checkBand2Mix();
+
+    // 分频引擎：所有混合比为 0 时幅度响应是平的；交换的内容按 range.getStart() - partnerRange.getStart()
+    // 移频，向下和向上各一个正弦
+    std::vector<CheckResult> checkCrossoverEngine();
+
+    // EngineSwitcher 在 block 中间从 STFT 切到分频引擎再切回：输出不越界、不跳变，每次切换报告的延迟只变一次，
+    // 切换半秒之后与只用当前引擎的输出一致
+    std::vector<CheckResult> checkEngineSwitching();
+
+    // 处理中途切换 FFT 点数 / 低延迟模式 / 窗函数：侧链与主链相同（输出应当就是延迟后的主链），
+    // 整个过程输出不越界、不跳变（见 transitionPeakRatio / transitionStepRatio），切换前后都与按报告的延迟对齐的输入一致；
+    // 延迟不变的切换全程一致
+    std::vector<CheckResult> checkGeometryTransitions();
+}